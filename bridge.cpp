@@ -1,166 +1,580 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <cstring>
 #include <cstdlib>
-#include <cstdio>
+#include <new>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "src/gals/Lexico.h"
 #include "src/gals/Sintatico.h"
 #include "src/gals/Semantico.h"
+#include "src/gals/BipGenerator.h"
+#include "src/gals/BipMachine.h"
 #include "src/gals/LexicalError.h"
 #include "src/gals/SyntacticError.h"
 #include "src/gals/SemanticError.h"
+#include "src/gals/SourceBuffer.h"
+#include "src/gals/CompilationContext.h"
+#include "src/gals/CompilationSession.h"
 
-static std::string jsonEscape(const char* s) {
-  std::string out;
-  if (!s) return out;
-  for (const unsigned char* p = (const unsigned char*)s; *p; ++p) {
-    unsigned char c = *p;
+// Resposta JSON escrita direto num bloco de malloc que cresce conforme
+// precisa: sem strings temporárias por campo e sem cópia no fim, release()
+// entrega o próprio bloco ao chamador (que libera com free).
+class JsonWriter {
+public:
+  explicit JsonWriter(std::size_t estimate) { grow(estimate); }
+  ~JsonWriter() { std::free(data); }
+
+  JsonWriter(const JsonWriter&) = delete;
+  JsonWriter& operator=(const JsonWriter&) = delete;
+
+  JsonWriter& raw(std::string_view text) {
+    ensure(text.size());
+    std::memcpy(data + size, text.data(), text.size());
+    size += text.size();
+    return *this;
+  }
+
+  // Texto entre aspas, escapado no próprio buffer: trechos sem caracteres
+  // especiais vão de uma vez.
+  JsonWriter& string(std::string_view text) {
+    ensure(text.size() + 2);
+    data[size++] = '"';
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+      const unsigned char c = static_cast<unsigned char>(text[i]);
+      if (c >= 0x20 && c != '"' && c != '\\') continue;
+      raw(text.substr(run, i - run));
+      escape(c);
+      run = i + 1;
+    }
+    raw(text.substr(run));
+    return raw("\"");
+  }
+
+  JsonWriter& number(int value) {
+    ensure(12);
+    size = std::to_chars(data + size, data + capacity, value).ptr - data;
+    return *this;
+  }
+
+  // Contadores de 64 bits (ciclos da máquina BIP).
+  JsonWriter& count(std::uint64_t value) {
+    ensure(21);
+    size = std::to_chars(data + size, data + capacity, value).ptr - data;
+    return *this;
+  }
+
+  JsonWriter& boolean(bool value) {
+    return raw(value ? "true" : "false");
+  }
+
+  char* release() {
+    ensure(1);
+    data[size] = '\0';
+    char* out = data;
+    data = nullptr;
+    size = capacity = 0;
+    return out;
+  }
+
+private:
+  char* data = nullptr;
+  std::size_t size = 0;
+  std::size_t capacity = 0;
+
+  void escape(unsigned char c) {
     switch (c) {
-      case '"': out += "\\\""; break;
-      case '\\': out += "\\\\"; break;
-      case '\b': out += "\\b"; break;
-      case '\f': out += "\\f"; break;
-      case '\n': out += "\\n"; break;
-      case '\r': out += "\\r"; break;
-      case '\t': out += "\\t"; break;
-      default:
-        if (c < 0x20) {
-          char buf[7];
-          std::snprintf(buf, sizeof(buf), "\\u%04x", c);
-          out += buf;
-        } else {
-          out += static_cast<char>(c);
-        }
+      case '"': raw("\\\""); break;
+      case '\\': raw("\\\\"); break;
+      case '\b': raw("\\b"); break;
+      case '\f': raw("\\f"); break;
+      case '\n': raw("\\n"); break;
+      case '\r': raw("\\r"); break;
+      case '\t': raw("\\t"); break;
+      default: {
+        static const char hex[] = "0123456789abcdef";
+        const char unicode[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+        raw(std::string_view(unicode, sizeof(unicode)));
+      }
     }
   }
-  return out;
-}
 
-static std::string jsonEscape(const std::string& s) {
-  return jsonEscape(s.c_str());
-}
+  // Sempre sobra um byte para o '\0' de release().
+  void ensure(std::size_t extra) {
+    if (size + extra >= capacity) {
+      grow(std::max(capacity * 2, size + extra + 1));
+    }
+  }
 
-static std::string boolToJson(bool value) {
-  return value ? "true" : "false";
-}
+  void grow(std::size_t wanted) {
+    char* bigger = static_cast<char*>(std::realloc(data, wanted));
+    if (!bigger) {
+      throw std::bad_alloc();
+    }
+    data = bigger;
+    capacity = wanted;
+  }
+};
 
-static std::string symbolTableToJson(const std::vector<ExportedSymbol>& symbols) {
-  std::string json = "[";
+static void writeSymbolTable(JsonWriter& json, const std::vector<ExportedSymbol>& symbols) {
+  json.raw("[");
   bool first = true;
   for (const auto& sym : symbols) {
-    if (!first) json += ",";
+    if (!first) json.raw(",");
     first = false;
 
-    json += "{";
-    json += "\"name\":\"" + jsonEscape(sym.name) + "\"";
-    json += ",\"type\":\"" + jsonEscape(sym.type) + "\"";
-    json += ",\"initialized\":" + boolToJson(sym.initialized);
-    json += ",\"used\":" + boolToJson(sym.used);
-    json += ",\"scope\":" + std::to_string(sym.scope);
-    json += ",\"isParameter\":" + boolToJson(sym.isParameter);
-    json += ",\"position\":" + std::to_string(sym.position);
-    json += ",\"line\":" + std::to_string(sym.line);
-    json += ",\"column\":" + std::to_string(sym.column);
-    json += ",\"isArray\":" + boolToJson(sym.isArray);
-    json += ",\"isFunction\":" + boolToJson(sym.isFunction);
-    json += ",\"isConstant\":" + boolToJson(sym.isConstant);
-    json += "}";
-  }
-  json += "]";
-  return json;
-}
-
-static std::string diagnosticsToJson(const std::vector<ExportedDiagnostic>& diagnostics) {
-  std::string json = "[";
+    json.raw("{\"name\":").string(sym.name);
+    json.raw(",\"type\":").string(sym.type);
+    json.raw(",\"initialized\":").boolean(sym.initialized);
+    json.raw(",\"used\":").boolean(sym.used);
+    json.raw(",\"scope\":").number(sym.scope);
+    json.raw(",\"isParameter\":").boolean(sym.isParameter);
+    json.raw(",\"position\":").number(sym.position);
+    json.raw(",\"line\":").number(sym.line);
+    json.raw(",\"column\":").number(sym.column);
+    json.raw(",\"isArray\":").boolean(sym.isArray);
+    json.raw(",\"isFunction\":").boolean(sym.isFunction);
+    json.raw(",\"isConstant\":").boolean(sym.isConstant);
+    json.raw("}");
+  }
+  json.raw("]");
+}
+
+static void writeDiagnostics(JsonWriter& json, const std::vector<ExportedDiagnostic>& diagnostics) {
+  json.raw("[");
   bool first = true;
   for (const auto& d : diagnostics) {
-    if (!first) json += ",";
+    if (!first) json.raw(",");
     first = false;
-    json += "{\"severity\":\"" + jsonEscape(d.severity) + "\",\"message\":\"" + jsonEscape(d.message) + "\",\"position\":" + std::to_string(d.position) + ",\"length\":" + std::to_string(d.length) + "}";
+    json.raw("{\"severity\":").string(d.severity);
+    json.raw(",\"message\":").string(d.message);
+    json.raw(",\"position\":").number(d.position);
+    json.raw(",\"length\":").number(d.length);
+    json.raw(",\"line\":").number(d.line);
+    json.raw(",\"column\":").number(d.column);
+    json.raw(",\"endLine\":").number(d.endLine);
+    json.raw(",\"endColumn\":").number(d.endColumn);
+    json.raw("}");
   }
-  json += "]";
-  return json;
+  json.raw("]");
+}
+
+// Estimativa do tamanho da resposta, para o buffer quase nunca crescer:
+// cada símbolo/diagnóstico tem ~200 bytes de chaves e números, e o código
+// BIP ganha um byte por quebra de linha escapada.
+static std::size_t estimateResponse(const std::vector<ExportedSymbol>& symbols,
+                                    const std::vector<ExportedDiagnostic>& diagnostics,
+                                    std::string_view bipCode) {
+  std::size_t estimate = 128 + bipCode.size() + bipCode.size() / 8;
+  for (const auto& sym : symbols) estimate += 200 + sym.name.size() + sym.type.size();
+  for (const auto& d : diagnostics) estimate += 200 + d.message.size();
+  return estimate;
+}
+
+static char* successResponse(const std::vector<ExportedSymbol>& symbols,
+                             const std::vector<ExportedDiagnostic>& diagnostics,
+                             std::string_view bipCode) {
+  JsonWriter json(estimateResponse(symbols, diagnostics, bipCode));
+  json.raw("{\"ok\":true,\"symbolTable\":");
+  writeSymbolTable(json, symbols);
+  json.raw(",\"diagnostics\":");
+  writeDiagnostics(json, diagnostics);
+  json.raw(",\"bipCode\":").string(bipCode);
+  json.raw("}");
+  return json.release();
 }
 
-static std::string successResponse(const std::vector<ExportedSymbol>& symbols,
-                                   const std::vector<ExportedDiagnostic>& diagnostics,
-                                   const std::string& bipCode) {
-  std::string json = "{\"ok\":true";
-  json += ",\"symbolTable\":" + symbolTableToJson(symbols);
-  json += ",\"diagnostics\":" + diagnosticsToJson(diagnostics);
-  json += ",\"bipCode\":\"" + jsonEscape(bipCode) + "\"";
-  json += "}";
-  return json;
+static void writeLineColumn(JsonWriter& json, CompilationContext& context, int pos, int length) {
+  const auto [line, column] = sourceLineColumn(context, pos);
+  const auto [endLine, endColumn] = sourceLineColumn(context, pos < 0 ? -1 : pos + length);
+  json.raw(",\"line\":").number(line).raw(",\"column\":").number(column);
+  json.raw(",\"endLine\":").number(endLine).raw(",\"endColumn\":").number(endColumn);
 }
 
-static std::string errorResponse(const char* kind, const char* message, int pos, int length) {
-  std::string json = "{\"ok\":false";
+// Erros de sintaxe e semânticos não interrompem a análise, que chega ao fim
+// do fonte: a resposta traz todos os diagnósticos, não só o primeiro erro.
+static bool reportsAllDiagnostics(const char* kind) {
+  return kind && (std::strcmp(kind, "syntactic") == 0 || std::strcmp(kind, "semantic") == 0);
+}
+
+// Deve ser chamada antes de resetState(): as linhas/colunas vêm do fonte atual.
+static char* errorResponse(CompilationContext& context, const char* kind, const char* message, int pos, int length) {
+  const int safeLength = length <= 0 ? 1 : length;
+  JsonWriter json(512 + (message ? 2 * std::strlen(message) : 0));
+  json.raw("{\"ok\":false");
   if (kind) {
-    json += ",\"kind\":\"";
-    json += jsonEscape(kind);
-    json += "\"";
+    json.raw(",\"kind\":").string(kind);
   }
   if (message) {
-    json += ",\"message\":\"";
-    json += jsonEscape(message);
-    json += "\"";
-  }
-  json += ",\"pos\":" + std::to_string(pos);
-  json += ",\"length\":" + std::to_string(length <= 0 ? 1 : length);
-  json += ",\"symbolTable\":[]";
-  json += ",\"diagnostics\":[";
-  if (message) {
-    json += "{\"severity\":\"error\",\"message\":\"" + jsonEscape(message) + "\",\"position\":" + std::to_string(pos) + ",\"length\":" + std::to_string(length <= 0 ? 1 : length) + "}";
+    json.raw(",\"message\":").string(message);
+  }
+  json.raw(",\"pos\":").number(pos);
+  json.raw(",\"length\":").number(safeLength);
+  writeLineColumn(json, context, pos, safeLength);
+  json.raw(",\"symbolTable\":[]");
+  json.raw(",\"diagnostics\":");
+  if (reportsAllDiagnostics(kind)) {
+    writeDiagnostics(json, snapshotDiagnostics(context));
+  } else {
+    json.raw("[");
+    if (message) {
+      json.raw("{\"severity\":\"error\",\"message\":").string(message);
+      json.raw(",\"position\":").number(pos).raw(",\"length\":").number(safeLength);
+      writeLineColumn(json, context, pos, safeLength);
+      json.raw("}");
+    }
+    json.raw("]");
   }
-  json += "]";
-  json += ",\"bipCode\":\"\"";
-  json += "}";
-  return json;
+  json.raw(",\"bipCode\":\"\"");
+  json.raw("}");
+  return json.release();
 }
 
-static char* duplicateString(const std::string& s) {
+static char* duplicateString(std::string_view s) {
   char* out = static_cast<char*>(std::malloc(s.size() + 1));
   if (!out) {
     return nullptr;
   }
-  std::memcpy(out, s.c_str(), s.size() + 1);
+  std::memcpy(out, s.data(), s.size());
+  out[s.size()] = '\0';
   return out;
 }
 
-extern "C" {
-__attribute__((used))
-char* uniscript_compile(const char* src) {
-  Lexico lex;
-  Sintatico sint;
-  Semantico sem;
+// Resultado em formato binário (docs/resultado-binario.md): cabeçalho,
+// registros de tamanho fixo e um bloco de strings UTF-8, num único malloc
+// que o TypeScript lê com typed arrays, sem JSON.parse.
+namespace binary {
 
-  sem.resetState();
-  sem.setSourceCode(src);
-  lex.setInput(src);
+const std::uint32_t MAGIC = 0x42525355; // "USRB"
+const std::uint32_t VERSION = 1;
+const std::size_t HEADER_WORDS = 24;
+const std::size_t SYMBOL_WORDS = 9;
+const std::size_t DIAGNOSTIC_WORDS = 9;
+
+enum Kind : std::int32_t { NONE, LEXICAL, SYNTACTIC, SEMANTIC, UNKNOWN };
+enum Severity : std::int32_t { ERROR, WARNING, INFO };
+
+struct Failure {
+  Kind kind;
+  std::string_view message;
+  int pos;
+  int length;
+  int line;
+  int column;
+  int endLine;
+  int endColumn;
+};
+
+class Writer {
+public:
+  Writer(std::size_t symbols, std::size_t diagnostics, std::size_t strings)
+      : symbols(HEADER_WORDS * 4),
+        diagnostics(this->symbols + symbols * SYMBOL_WORDS * 4),
+        strings(this->diagnostics + diagnostics * DIAGNOSTIC_WORDS * 4),
+        size(this->strings + ((strings + 3) & ~std::size_t(3))) {
+    data = static_cast<unsigned char*>(std::calloc(size, 1));
+    if (!data) {
+      throw std::bad_alloc();
+    }
+    word(0, MAGIC);
+    word(1, VERSION);
+    word(3, static_cast<std::uint32_t>(size));
+    word(4, static_cast<std::uint32_t>(symbols));
+    word(5, static_cast<std::uint32_t>(this->symbols));
+    word(6, static_cast<std::uint32_t>(diagnostics));
+    word(7, static_cast<std::uint32_t>(this->diagnostics));
+    word(8, static_cast<std::uint32_t>(this->strings));
+    word(9, static_cast<std::uint32_t>(strings));
+    pool = this->strings;
+  }
+  ~Writer() { std::free(data); }
+
+  Writer(const Writer&) = delete;
+  Writer& operator=(const Writer&) = delete;
+
+  void word(std::size_t index, std::uint32_t value) { put(index * 4, value); }
+
+  // Grava a string no bloco e a referência (offset relativo ao bloco,
+  // tamanho em bytes) nas palavras index e index + 1.
+  void text(std::size_t index, std::string_view value) { reference(index * 4, value); }
+
+  void symbol(std::size_t i, const ExportedSymbol& sym) {
+    const std::size_t at = symbols + i * SYMBOL_WORDS * 4;
+    reference(at, sym.name);
+    reference(at + 8, sym.type);
+    put(at + 16, (sym.initialized ? 1u : 0u) | (sym.used ? 2u : 0u) | (sym.isParameter ? 4u : 0u) |
+                 (sym.isArray ? 8u : 0u) | (sym.isFunction ? 16u : 0u) | (sym.isConstant ? 32u : 0u));
+    put(at + 20, sym.scope);
+    put(at + 24, sym.position);
+    put(at + 28, sym.line);
+    put(at + 32, sym.column);
+  }
+
+  void diagnostic(std::size_t i, const ExportedDiagnostic& d) {
+    const std::size_t at = diagnostics + i * DIAGNOSTIC_WORDS * 4;
+    put(at, d.severity == "error" ? ERROR : d.severity == "warning" ? WARNING : INFO);
+    reference(at + 4, d.message);
+    put(at + 12, d.position);
+    put(at + 16, d.length);
+    put(at + 20, d.line);
+    put(at + 24, d.column);
+    put(at + 28, d.endLine);
+    put(at + 32, d.endColumn);
+  }
+
+  char* release() {
+    char* out = reinterpret_cast<char*>(data);
+    data = nullptr;
+    return out;
+  }
+
+private:
+  std::size_t symbols;
+  std::size_t diagnostics;
+  std::size_t strings;
+  std::size_t size;
+  std::size_t pool = 0;
+  unsigned char* data = nullptr;
+
+  // WebAssembly é little-endian: a palavra vai como está na memória.
+  template <class T>
+  void put(std::size_t at, T value) {
+    static_assert(sizeof(T) == 4, "registros usam palavras de 32 bits");
+    std::memcpy(data + at, &value, 4);
+  }
+
+  void reference(std::size_t at, std::string_view value) {
+    std::memcpy(data + pool, value.data(), value.size());
+    put(at, static_cast<std::uint32_t>(pool - strings));
+    put(at + 4, static_cast<std::uint32_t>(value.size()));
+    pool += value.size();
+  }
+};
+
+static char* response(const std::vector<ExportedSymbol>& symbols,
+                      const std::vector<ExportedDiagnostic>& diagnostics,
+                      std::string_view bipCode, const Failure* failure) {
+  std::size_t strings = bipCode.size() + (failure ? failure->message.size() : 0);
+  for (const auto& sym : symbols) strings += sym.name.size() + sym.type.size();
+  for (const auto& d : diagnostics) strings += d.message.size();
 
+  Writer out(symbols.size(), diagnostics.size(), strings);
+  out.word(2, failure ? 0 : 1);
+  out.text(10, bipCode);
+  if (failure) {
+    out.word(12, failure->kind);
+    out.text(13, failure->message);
+    out.word(15, failure->pos);
+    out.word(16, failure->length);
+    out.word(17, failure->line);
+    out.word(18, failure->column);
+    out.word(19, failure->endLine);
+    out.word(20, failure->endColumn);
+  }
+  for (std::size_t i = 0; i < symbols.size(); ++i) out.symbol(i, symbols[i]);
+  for (std::size_t i = 0; i < diagnostics.size(); ++i) out.diagnostic(i, diagnostics[i]);
+  return out.release();
+}
+
+static char* successResponse(const std::vector<ExportedSymbol>& symbols,
+                             const std::vector<ExportedDiagnostic>& diagnostics,
+                             std::string_view bipCode) {
+  return response(symbols, diagnostics, bipCode, nullptr);
+}
+
+// Mesmo conteúdo da resposta de erro JSON: o erro também vai como único
+// diagnóstico, salvo nos de sintaxe e nos semânticos.
+static char* errorResponse(CompilationContext& context, const char* kind, const char* message, int pos, int length) {
+  const int safeLength = length <= 0 ? 1 : length;
+  const auto [line, column] = sourceLineColumn(context, pos);
+  const auto [endLine, endColumn] = sourceLineColumn(context, pos < 0 ? -1 : pos + safeLength);
+  const std::string_view name = kind ? kind : "";
+  const Kind code = name == "lexical" ? LEXICAL : name == "syntactic" ? SYNTACTIC : name == "semantic" ? SEMANTIC : UNKNOWN;
+  const Failure failure{code, message ? message : "", pos, safeLength, line, column, endLine, endColumn};
+
+  std::vector<ExportedDiagnostic> diagnostics;
+  if (reportsAllDiagnostics(kind)) {
+    diagnostics = snapshotDiagnostics(context);
+  } else if (message) {
+    diagnostics.push_back({"error", message, pos, safeLength, line, column, endLine, endColumn});
+  }
+  return response({}, diagnostics, "", &failure);
+}
+
+}
+
+// Executa compile() (que devolve a resposta de sucesso) e converte os erros da
+// análise na resposta de erro, com linha/coluna do fonte ainda carregado.
+using ErrorResponse = char* (*)(CompilationContext&, const char* kind, const char* message, int pos, int length);
+using SuccessResponse = char* (*)(const std::vector<ExportedSymbol>&, const std::vector<ExportedDiagnostic>&, std::string_view);
+
+template <class Compile>
+static char* guardedResponse(CompilationContext& context, Compile&& compile, ErrorResponse error = errorResponse) {
   try {
-    sint.parse(&lex, &sem);
-    finalizeSemanticAnalysis();
-    auto symbols = snapshotSymbolTable();
-    auto diagnostics = snapshotDiagnostics();
-    auto bipCode = snapshotBipCode();
-    std::string json = successResponse(symbols, diagnostics, bipCode);
-    sem.resetState();
-    return duplicateString(json);
+    return compile();
   } catch (const LexicalError& e) {
-    sem.resetState();
-    return duplicateString(errorResponse("lexical", e.getMessage(), e.getPosition(), e.getLength()));
+    return error(context, "lexical", e.getMessage(), e.getPosition(), e.getLength());
   } catch (const SyntacticError& e) {
-    sem.resetState();
-    return duplicateString(errorResponse("syntactic", e.getMessage(), e.getPosition(), e.getLength()));
+    return error(context, "syntactic", e.getMessage(), e.getPosition(), e.getLength());
   } catch (const SemanticError& e) {
-    sem.resetState();
-    return duplicateString(errorResponse("semantic", e.getMessage(), e.getPosition(), e.getLength()));
+    return error(context, "semantic", e.getMessage(), e.getPosition(), e.getLength());
   } catch (...) {
-    sem.resetState();
-    return duplicateString(errorResponse("unknown", "unknown error", -1, 1));
+    return error(context, "unknown", "unknown error", -1, 1);
   }
 }
 
+// Compila src do zero e monta a resposta no formato pedido.
+static char* compileResponse(const char* src, SuccessResponse success, ErrorResponse error) {
+  // Um contexto por thread, reaproveitado entre chamadas: resetState limpa
+  // o estado mas mantém a memória já alocada.
+  static thread_local CompilationContext context;
+  Lexico lex;
+  Sintatico sint;
+  Semantico sem(context);
+
+  // src pertence ao chamador e vive durante toda a compilação: sem cópia.
+  auto source = SourceBuffer::borrow(src ? src : "");
+  sem.resetState();
+  sem.setSourceCode(source);
+  lex.setInput(source);
+
+  char* response = guardedResponse(context, [&] {
+    sint.parse(&lex, &sem);
+    finalizeSemanticAnalysis(context);
+    auto symbols = snapshotSymbolTable(context);
+    auto diagnostics = snapshotDiagnostics(context);
+    return success(symbols, diagnostics, BipGenerator::lastCode(context));
+  }, error);
+  sem.resetState();
+  return response;
+}
+
+static char* runResponse(const BipMachine::Result& result) {
+  JsonWriter json(256 + 8 * result.output.size() + 64 * result.hotSpots.size());
+  json.raw("{\"ok\":true,\"halted\":").boolean(result.halted);
+  json.raw(",\"error\":").string(result.error);
+  json.raw(",\"errorLine\":").number(static_cast<int>(result.errorLine));
+  json.raw(",\"output\":[");
+  for (std::size_t i = 0; i < result.output.size(); ++i) {
+    if (i) json.raw(",");
+    json.number(result.output[i]);
+  }
+  json.raw("],\"instructions\":").count(result.instructions);
+  json.raw(",\"cycles\":").count(result.cycles);
+  json.raw(",\"hotSpots\":[");
+  for (std::size_t i = 0; i < result.hotSpots.size(); ++i) {
+    const auto& spot = result.hotSpots[i];
+    if (i) json.raw(",");
+    json.raw("{\"label\":").string(spot.label);
+    json.raw(",\"cycles\":").count(spot.cycles);
+    json.raw(",\"entries\":").count(spot.entries);
+    json.raw("}");
+  }
+  json.raw("]}");
+  return json.release();
+}
+
+// Sessão do editor: o programa fica compilado entre as edições.
+struct BridgeSession {
+  explicit BridgeSession(const char* src) : session(src ? src : "") {}
+
+  CompilationSession session;
+  bool ok = false;
+};
+
+static char* sessionResponse(BridgeSession* handle, bool edit, std::size_t offset, std::size_t removed, const char* inserted) {
+  CompilationContext& context = handle->session.context();
+  handle->ok = false;
+  return guardedResponse(context, [&] {
+    if (edit) {
+      const std::string_view text = handle->session.text();
+      if (offset > text.size() || removed > text.size() - offset) {
+        return errorResponse(context, "unknown", "edit out of range", -1, 1);
+      }
+      handle->session.edit(offset, removed, inserted ? inserted : "");
+    } else {
+      handle->session.compile();
+    }
+    handle->ok = true;
+    return successResponse(snapshotSymbolTable(context), snapshotDiagnostics(context), "");
+  });
+}
+
+extern "C" {
+__attribute__((used))
+char* uniscript_compile(const char* src) {
+  return compileResponse(src, successResponse, errorResponse);
+}
+
+// Como uniscript_compile, no formato binário de docs/resultado-binario.md.
+__attribute__((used))
+char* uniscript_compile_bin(const char* src) {
+  return compileResponse(src, binary::successResponse, binary::errorResponse);
+}
+
+// Cria uma sessão com o texto inicial; compile com uniscript_session_compile.
+__attribute__((used))
+void* uniscript_session_create(const char* src) {
+  return new BridgeSession(src);
+}
+
+// Compila o texto inteiro da sessão. Mesmo JSON de uniscript_compile, com
+// bipCode vazio (ver uniscript_session_bip).
+__attribute__((used))
+char* uniscript_session_compile(void* session) {
+  return sessionResponse(static_cast<BridgeSession*>(session), false, 0, 0, nullptr);
+}
+
+// Troca removed bytes a partir de offset (bytes UTF-8) por inserted e
+// recompila só o que a edição alcança.
+__attribute__((used))
+char* uniscript_session_edit(void* session, unsigned offset, unsigned removed, const char* inserted) {
+  return sessionResponse(static_cast<BridgeSession*>(session), true, offset, removed, inserted);
+}
+
+// Código BIP da última compilação da sessão; vazio se ela falhou.
+__attribute__((used))
+char* uniscript_session_bip(void* session) {
+  auto* handle = static_cast<BridgeSession*>(session);
+  if (!handle->ok) return duplicateString(std::string_view());
+  // nenhum erro pode atravessar o extern "C": se houver, o código sai vazio
+  CompilationContext& context = handle->session.context();
+  return guardedResponse(context, [&] { return duplicateString(handle->session.bipCode()); },
+                         [](CompilationContext&, const char*, const char*, int, int) { return duplicateString(std::string_view()); });
+}
+
+// Monta e executa código BIP (o de uniscript_session_bip, por exemplo) na
+// máquina BIP. inputs: valores de $in_port separados por espaço ou vírgula.
+__attribute__((used))
+char* uniscript_run_bip(const char* bip, const char* inputs) {
+  BipMachine::Options options;
+  for (const char* at = inputs ? inputs : ""; *at;) {
+    char* end = nullptr;
+    const long value = std::strtol(at, &end, 10);
+    if (end == at) {
+      ++at;
+      continue;
+    }
+    options.input.push_back(static_cast<int>(value));
+    at = end;
+  }
+  try {
+    return runResponse(BipMachine::run(BipMachine::assemble(bip ? bip : ""), options));
+  } catch (const std::runtime_error& err) {
+    JsonWriter json(64 + 2 * std::strlen(err.what()));
+    json.raw("{\"ok\":false,\"message\":").string(err.what()).raw("}");
+    return json.release();
+  }
+}
+
+__attribute__((used))
+void uniscript_session_free(void* session) {
+  delete static_cast<BridgeSession*>(session);
+}
+
 }
@@ -0,0 +1,99 @@
+#!/usr/bin/env node
+// Mede o código BIP gerado para expressões: gera um corpus de programas
+// sem desvios nem chamadas, compila com o CLI e conta as instruções de
+// output.bip. Em código corrido cada instrução executa uma vez, então a
+// contagem é também o número de ciclos do programa.
+//
+//   node scripts/bench-codegen.js ./uniscript [programas] [comandos] [semente] [cli de referência]
+//
+// Com um segundo CLI (por exemplo um build anterior) imprime as duas
+// contagens e a redução por programa.
+import { spawnSync } from 'node:child_process'
+import { mkdtempSync, readFileSync, rmSync, writeFileSync } from 'node:fs'
+import { tmpdir } from 'node:os'
+import { join, resolve } from 'node:path'
+
+const [cli, ...args] = process.argv.slice(2)
+if (!cli) {
+  console.error('Uso: node scripts/bench-codegen.js <cli> [programas] [comandos] [semente] [cli de referência]')
+  process.exit(2)
+}
+const [programs, statements, seed] = [20, 200, 1].map((fallback, i) => Number(args[i] ?? fallback))
+const baseline = args[3]
+
+// xorshift: o mesmo corpus a cada execução
+let state = seed >>> 0 || 1
+function random(n) {
+  state ^= state << 13
+  state ^= state >>> 17
+  state ^= state << 5
+  return (state >>> 0) % n
+}
+
+const scalars = ['a', 'b', 'c', 'd', 'e', 'f']
+const operators = ['+', '-', '*', '&', '|', '^', '+', '-']
+
+function operand(depth) {
+  const kind = random(10)
+  if (kind < 3) return String(random(10))
+  if (kind < 7 || depth === 0) return scalars[random(scalars.length)]
+  if (kind < 9) return `v[(${expression(depth - 1)}) & 7]`
+  return `(${expression(depth - 1)})`
+}
+
+function expression(depth) {
+  let text = operand(depth)
+  for (let terms = 1 + random(4); terms > 1; --terms) {
+    const op = random(8) === 0 ? (random(2) ? '<<' : '>>') : operators[random(operators.length)]
+    text += op === '<<' || op === '>>' ? ` ${op} ${random(4)}` : ` ${op} ${operand(depth)}`
+  }
+  return text
+}
+
+function program() {
+  const lines = scalars.map((name, i) => `var ${name}: int = ${i + 1};`)
+  lines.push('var v: int[] = [1, 2, 3, 4, 5, 6, 7, 8];')
+  for (let i = 0; i < statements; ++i) {
+    const kind = random(4)
+    if (kind === 0) lines.push(`v[(${expression(1)}) & 7] = ${expression(2)};`)
+    else if (kind === 1) lines.push(`print(${expression(2)});`)
+    else lines.push(`${scalars[random(scalars.length)]} = ${expression(2)};`)
+  }
+  return `${lines.join('\n')}\n`
+}
+
+function countInstructions(dir, compiler, file) {
+  const result = spawnSync(resolve(compiler), [file], { cwd: dir, encoding: 'utf8', stdio: ['ignore', 'ignore', 'pipe'] })
+  if (result.status !== 0 || result.stderr) {
+    throw new Error(`[bench-codegen] compilação falhou:\n${result.stderr}`)
+  }
+  const text = readFileSync(join(dir, 'output.bip'), 'utf8')
+  const code = text.slice(text.indexOf('.text'))
+  return code.split('\n').filter((line) => {
+    const trimmed = line.trim()
+    return trimmed && trimmed !== '.text' && !trimmed.endsWith(':')
+  }).length
+}
+
+const dir = mkdtempSync(join(tmpdir(), 'uniscript-bench-'))
+try {
+  let total = 0
+  let totalBaseline = 0
+  for (let p = 0; p < programs; ++p) {
+    const file = join(dir, `expressoes-${p}.us`)
+    writeFileSync(file, program())
+    const count = countInstructions(dir, cli, file)
+    total += count
+    if (baseline) {
+      const before = countInstructions(dir, baseline, file)
+      totalBaseline += before
+      console.log(`[bench-codegen] programa ${p}: ${before} -> ${count} instruções`)
+    }
+  }
+  console.log(`[bench-codegen] ${programs} programas × ${statements} comandos: ${total} instruções (= ciclos)`)
+  if (baseline) {
+    console.log(`[bench-codegen] referência: ${totalBaseline} instruções, redução de ${(100 * (1 - total / totalBaseline)).toFixed(1)}%`)
+  }
+} finally {
+  rmSync(dir, { recursive: true, force: true })
+}
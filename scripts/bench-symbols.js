@@ -0,0 +1,72 @@
+#!/usr/bin/env node
+// Mede a tabela de símbolos com blocos muito aninhados e milhares de
+// identificadores: gera um programa e compila com o CLI várias vezes.
+//
+//   node scripts/bench-symbols.js ./uniscript [globais] [profundidade] [locais] [termos] [rodadas]
+//
+// O programa declara <globais> variáveis no escopo 0 e repete uma pilha de
+// <profundidade> blocos if aninhados até ter ~<globais> × 20 declarações
+// locais. Cada bloco declara <locais> variáveis somando <termos> globais,
+// então cada uso busca um nome declarado no fundo da cadeia de escopos.
+// O mesmo programa com profundidade 1 serve de referência: a diferença é o
+// custo da profundidade.
+import { spawnSync } from 'node:child_process'
+import { mkdtempSync, rmSync, writeFileSync } from 'node:fs'
+import { tmpdir } from 'node:os'
+import { join, resolve } from 'node:path'
+
+const [cli, ...args] = process.argv.slice(2)
+if (!cli) {
+  console.error('Uso: node scripts/bench-symbols.js <cli> [globais] [profundidade] [locais] [termos] [rodadas]')
+  process.exit(2)
+}
+const [globals, depth, locals, terms, runs] = [2000, 256, 4, 8, 3].map((fallback, i) => Number(args[i] ?? fallback))
+
+function program(levels) {
+  const lines = []
+  for (let g = 0; g < globals; ++g) lines.push(`var g${g}: int = ${g};`)
+  const declarations = globals * 20
+  let next = 0
+  for (let done = 0; done < declarations; done += levels * locals) {
+    for (let d = 0; d < levels; ++d) {
+      const pad = '  '.repeat(d)
+      lines.push(`${pad}if (g${d % globals} >= 0) {`)
+      for (let l = 0; l < locals; ++l) {
+        const sum = Array.from({ length: terms }, () => `g${next++ % globals}`).join(' + ')
+        lines.push(`${pad}  var v${d}_${l}: int = ${sum};`)
+      }
+    }
+    for (let d = levels - 1; d >= 0; --d) lines.push(`${'  '.repeat(d)}}`)
+  }
+  return `${lines.join('\n')}\n`
+}
+
+function measure(dir, levels) {
+  const file = join(dir, `simbolos-${levels}.us`)
+  const source = program(levels)
+  writeFileSync(file, source)
+  const times = []
+  for (let i = 0; i < runs; ++i) {
+    const start = process.hrtime.bigint()
+    // a tabela impressa no stdout é grande; só o stderr indica erro
+    const result = spawnSync(resolve(cli), [file], { cwd: dir, encoding: 'utf8', stdio: ['ignore', 'ignore', 'pipe'] })
+    const elapsed = Number(process.hrtime.bigint() - start) / 1e6
+    if (result.status !== 0 || result.stderr) {
+      throw new Error(`[bench-symbols] compilação falhou:\n${result.stderr}`)
+    }
+    times.push(elapsed)
+  }
+  times.sort((a, b) => a - b)
+  const median = times[times.length >> 1]
+  console.log(`[bench-symbols] profundidade ${levels}: ${source.split('\n').length - 1} linhas, mediana ${median.toFixed(1)} ms (${runs} rodadas)`)
+  return median
+}
+
+const dir = mkdtempSync(join(tmpdir(), 'uniscript-bench-'))
+try {
+  const flat = measure(dir, 1)
+  const nested = measure(dir, depth)
+  console.log(`[bench-symbols] custo da profundidade ${depth}: ${(nested - flat).toFixed(1)} ms`)
+} finally {
+  rmSync(dir, { recursive: true, force: true })
+}
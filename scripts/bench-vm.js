@@ -0,0 +1,120 @@
+#!/usr/bin/env node
+// Mede a vazão da máquina BIP (BipMachine): gera programas com laços
+// aninhados, vetores e chamadas, e executa cada um com
+// `uniscript --run <programa> --repeat N`, que monta o código uma vez e o
+// executa N vezes.
+//
+//   node scripts/bench-vm.js ./uniscript [programas] [repetições] [semente] [cli de referência]
+//
+// Com um segundo CLI (por exemplo um build anterior) imprime as duas
+// vazões e a razão entre elas.
+import { spawnSync } from 'node:child_process'
+import { mkdtempSync, rmSync, writeFileSync } from 'node:fs'
+import { tmpdir } from 'node:os'
+import { join, resolve } from 'node:path'
+
+const [cli, ...args] = process.argv.slice(2)
+if (!cli) {
+  console.error('Uso: node scripts/bench-vm.js <cli> [programas] [repetições] [semente] [cli de referência]')
+  process.exit(2)
+}
+const [programs, repeat, seed] = [8, 200, 1].map((fallback, i) => Number(args[i] ?? fallback))
+const baseline = args[3]
+
+// xorshift: o mesmo corpus a cada execução
+let state = seed >>> 0 || 1
+function random(n) {
+  state ^= state << 13
+  state ^= state >>> 17
+  state ^= state << 5
+  return (state >>> 0) % n
+}
+
+const scalars = ['a', 'b', 'c']
+const operators = ['+', '-', '&', '|', '^', '+']
+
+function operand(counters) {
+  const kind = random(6)
+  if (kind === 0) return String(1 + random(9))
+  if (kind < 3) return scalars[random(scalars.length)]
+  if (kind < 5) return counters[random(counters.length)]
+  return `v[(${counters[random(counters.length)]}) & 7]`
+}
+
+function expression(counters) {
+  let text = operand(counters)
+  for (let terms = 1 + random(3); terms > 1; --terms) {
+    text += ` ${operators[random(operators.length)]} ${operand(counters)}`
+  }
+  return text
+}
+
+function body(counters, depth) {
+  const lines = []
+  for (let s = 1 + random(3); s > 0; --s) {
+    const kind = random(4)
+    if (kind === 0) lines.push(`v[(${expression(counters)}) & 7] = ${expression(counters)};`)
+    else if (kind === 1) lines.push(`${scalars[random(scalars.length)]} = mistura(${expression(counters)}, ${expression(counters)});`)
+    else lines.push(`${scalars[random(scalars.length)]} = ${expression(counters)};`)
+  }
+  if (depth > 0) {
+    const counter = `i${depth}`
+    lines.push(`for (var ${counter}: int = 0; ${counter} < ${4 + random(12)}; ${counter}++) {`)
+    lines.push(...body([...counters, counter], depth - 1))
+    lines.push('}')
+  }
+  return lines
+}
+
+function program() {
+  const lines = [
+    'function mistura(p: int, q: int): int {',
+    '    return (p ^ q) + (p & 7);',
+    '}'
+  ]
+  scalars.forEach((name, i) => lines.push(`var ${name}: int = ${i + 1};`))
+  lines.push('var v: int[] = [1, 2, 3, 4, 5, 6, 7, 8];')
+  lines.push('for (var i0: int = 0; i0 < 20; i0++) {')
+  lines.push(...body(['i0'], 2))
+  lines.push('}')
+  scalars.forEach((name) => lines.push(`print(${name});`))
+  return `${lines.join('\n')}\n`
+}
+
+function measure(dir, compiler, file) {
+  const result = spawnSync(resolve(compiler), ['--run', file, '--repeat', String(repeat)], { cwd: dir, encoding: 'utf8' })
+  const cycles = /Ciclos executados: (\d+)/.exec(result.stdout)
+  const rate = /Vazão: ([\d.]+)/.exec(result.stdout)
+  if (result.status !== 0 || !cycles || !rate) {
+    throw new Error(`[bench-vm] execução falhou:\n${result.stdout}${result.stderr}`)
+  }
+  return { cycles: Number(cycles[1]), rate: Number(rate[1]) }
+}
+
+const dir = mkdtempSync(join(tmpdir(), 'uniscript-bench-vm-'))
+try {
+  let cycles = 0
+  let seconds = 0
+  let secondsBaseline = 0
+  for (let p = 0; p < programs; ++p) {
+    const file = join(dir, `lacos-${p}.us`)
+    writeFileSync(file, program())
+    const run = measure(dir, cli, file)
+    const simulated = run.cycles * repeat
+    cycles += simulated
+    seconds += simulated / (run.rate * 1e6)
+    if (baseline) {
+      const before = measure(dir, baseline, file)
+      secondsBaseline += simulated / (before.rate * 1e6)
+      console.log(`[bench-vm] programa ${p}: ${run.cycles} ciclos, ${before.rate} -> ${run.rate} milhões de instruções/s`)
+    } else {
+      console.log(`[bench-vm] programa ${p}: ${run.cycles} ciclos, ${run.rate} milhões de instruções/s`)
+    }
+  }
+  console.log(`[bench-vm] ${programs} programas × ${repeat} execuções: ${(cycles / seconds / 1e6).toFixed(1)} milhões de instruções simuladas/s`)
+  if (baseline) {
+    console.log(`[bench-vm] referência: ${(cycles / secondsBaseline / 1e6).toFixed(1)} milhões de instruções simuladas/s, ${(secondsBaseline / seconds).toFixed(2)}× mais rápido`)
+  }
+} finally {
+  rmSync(dir, { recursive: true, force: true })
+}
@@ -0,0 +1,369 @@
+#!/usr/bin/env node
+// Benchmarks do compilador pelo CLI. Cada subcomando gera a própria
+// entrada (a mesma a cada execução, para a semente dada), executa o CLI e,
+// com um CLI de referência (por exemplo um build anterior), imprime os dois
+// resultados:
+//
+//   node scripts/bench.js scopes  ./uniscript [linhas] [rodadas] [cli de referência]
+//   node scripts/bench.js parse   ./uniscript [rotinas] [repetições] [semente] [cli de referência]
+//   node scripts/bench.js lexer   ./uniscript [linhas] [repetições] [semente] [cli de referência]
+//   node scripts/bench.js scanner ./uniscript [MB] [repetições] [semente] [cli escalar]
+//
+// scopes:  tempo de compilação com muitos blocos com declarações locais,
+//          com o número de linhas dobrando até <linhas>. Com custo linear,
+//          dobrar as linhas dobra o tempo (crescimento ~2×); um custo
+//          quadrático aparece como ~4×.
+// parse:   vazão do analisador sintático (com as ações semânticas) em um
+//          programa com rotinas, laços, desvios, vetores e expressões, por
+//          `uniscript --parse <programa> --repeat N`.
+// lexer:   vazão do Lexico em entrada cheia de identificadores parecidos
+//          com palavras reservadas, por `uniscript --lex <programa> --repeat N`.
+// scanner: vazão do Lexico sobre trechos longos (ScannerRuns.cpp) em três
+//          entradas de ~<MB> MB: comentários, strings e código indentado.
+//          O CLI de referência é o mesmo código compilado com
+//          -DSCANNER_RUNS_SCALAR:
+//            g++ -std=c++17 -O2 -pthread -DSCANNER_RUNS_SCALAR -I src src/gals/*.cpp src/main.cpp src/BatchCompiler.cpp -o uniscript-escalar
+//          Com ele também compara, com `--lex --tokens`, os tokens e erros
+//          das entradas grandes e de entradas aleatórias curtas (bytes
+//          inválidos, strings e comentários sem fim), e sai com 1 se
+//          diferirem.
+import { spawnSync } from 'node:child_process'
+import { mkdtempSync, rmSync, writeFileSync } from 'node:fs'
+import { tmpdir } from 'node:os'
+import { join, resolve } from 'node:path'
+
+// xorshift: as mesmas entradas a cada execução
+let state = 1
+function seed(value) {
+  state = value >>> 0 || 1
+}
+function random(n) {
+  state ^= state << 13
+  state ^= state >>> 17
+  state ^= state << 5
+  return (state >>> 0) % n
+}
+
+function run(tag, compiler, args, options = {}) {
+  const result = spawnSync(resolve(compiler), args, { encoding: 'utf8', maxBuffer: 1 << 30, ...options })
+  if (result.status !== 0) {
+    throw new Error(`[bench ${tag}] ${compiler} falhou:\n${result.stdout ?? ''}${result.stderr ?? ''}`)
+  }
+  return result.stdout ?? ''
+}
+
+function match(tag, pattern, output) {
+  const found = pattern.exec(output)
+  if (!found) throw new Error(`[bench ${tag}] saída inesperada:\n${output}`)
+  return found
+}
+
+// --- scopes --------------------------------------------------------------
+
+// Blocos if de quatro linhas, um em cada cinco com um if aninhado, para
+// as consultas caírem em profundidades diferentes.
+function scopesProgram(target) {
+  const lines = ['var a: int = 1;']
+  for (let i = 0; lines.length < target; ++i) {
+    lines.push(`if (a > ${i % 7}) {`)
+    lines.push(`    var b${i}: int = a + ${i % 13};`)
+    if (i % 5 === 0) {
+      lines.push(`    if (b${i} > ${i % 3}) {`)
+      lines.push(`        var c${i}: int = b${i} - a;`)
+      lines.push(`        b${i} = c${i} + 1;`)
+      lines.push('    }')
+    }
+    lines.push(`    a = b${i} - ${i % 11};`)
+    lines.push('}')
+  }
+  lines.push('print(a);')
+  return `${lines.join('\n')}\n`
+}
+
+function scopes(dir, cli, args) {
+  const [maxLines, runs] = [10000, 3].map((fallback, i) => Number(args[i] ?? fallback))
+  const baseline = args[2]
+  const SIZES = 4
+
+  const median = (compiler, file) => {
+    const times = []
+    for (let i = 0; i < runs; ++i) {
+      const start = process.hrtime.bigint()
+      // a tabela impressa no stdout é grande; só o stderr indica erro
+      const result = spawnSync(resolve(compiler), [file], { cwd: dir, encoding: 'utf8', stdio: ['ignore', 'ignore', 'pipe'] })
+      const elapsed = Number(process.hrtime.bigint() - start) / 1e6
+      if (result.status !== 0 || result.stderr) {
+        throw new Error(`[bench scopes] compilação falhou:\n${result.stderr}`)
+      }
+      times.push(elapsed)
+    }
+    times.sort((a, b) => a - b)
+    return times[times.length >> 1]
+  }
+
+  let previous = 0
+  for (let s = SIZES - 1; s >= 0; --s) {
+    const target = Math.max(1, Math.round(maxLines / 2 ** s))
+    const file = join(dir, `escopos-${target}.us`)
+    const source = scopesProgram(target)
+    writeFileSync(file, source)
+    const lines = source.split('\n').length - 1
+    const time = median(cli, file)
+    const growth = previous ? `, crescimento ${(time / previous).toFixed(2)}×` : ''
+    const before = baseline ? `${median(baseline, file).toFixed(1)} -> ` : ''
+    console.log(`[bench scopes] ${lines} linhas: ${before}${time.toFixed(1)} ms, ${((time * 1000) / lines).toFixed(2)} µs/linha${growth}`)
+    previous = time
+  }
+}
+
+// --- parse ---------------------------------------------------------------
+
+const operators = ['+', '-', '*', '&', '|', '^', '<<', '>>']
+const comparisons = ['<', '<=', '>', '>=', '==', '!=']
+
+function operand(names, depth) {
+  const kind = random(8)
+  if (kind < 2) return String(random(100))
+  if (kind < 5 || depth === 0) return names[random(names.length)]
+  if (kind < 7) return `v[(${expression(names, depth - 1)}) & 7]`
+  return `(${expression(names, depth - 1)})`
+}
+
+function expression(names, depth) {
+  let text = operand(names, depth)
+  for (let terms = 1 + random(4); terms > 1; --terms) {
+    text += ` ${operators[random(operators.length)]} ${operand(names, depth)}`
+  }
+  return text
+}
+
+// O Semantico tipa mal alguns parênteses logo após uma comparação: as
+// condições comparam um nome com um operando simples.
+function condition(names) {
+  return `${names[random(names.length)]} ${comparisons[random(comparisons.length)]} ${operand(names, 0)}`
+}
+
+function block(names, depth, pad) {
+  const lines = []
+  for (let s = 2 + random(4); s > 0; --s) {
+    const kind = depth > 0 ? random(8) : random(4)
+    const target = names[random(names.length)]
+    if (kind === 0) lines.push(`${pad}v[(${expression(names, 1)}) & 7] = ${expression(names, 2)};`)
+    else if (kind === 1) lines.push(`${pad}print(${expression(names, 2)});`)
+    else if (kind < 4) lines.push(`${pad}${target} = ${expression(names, 2)};`)
+    else if (kind === 4) {
+      lines.push(`${pad}if (${condition(names)}) {`, ...block(names, depth - 1, `${pad}    `))
+      if (random(2)) lines.push(`${pad}} else {`, ...block(names, depth - 1, `${pad}    `))
+      lines.push(`${pad}}`)
+    } else if (kind === 5) {
+      lines.push(`${pad}while (${condition(names)}) {`, ...block(names, depth - 1, `${pad}    `), `${pad}}`)
+    } else {
+      const counter = `i${depth}`
+      lines.push(`${pad}for (var ${counter}: int = 0; ${counter} < ${2 + random(20)}; ${counter}++) {`)
+      lines.push(...block([...names, counter], depth - 1, `${pad}    `), `${pad}}`)
+    }
+  }
+  return lines
+}
+
+function parseProgram(routines) {
+  const lines = ['var v: int[] = [1, 2, 3, 4, 5, 6, 7, 8];']
+  for (let r = 0; r < routines; ++r) {
+    lines.push(`function rotina${r}(p: int, q: int): int {`)
+    lines.push(`    var x: int = ${expression(['p', 'q'], 1)};`)
+    lines.push(...block(['p', 'q', 'x'], 2, '    '))
+    lines.push('    return x;', '}')
+    lines.push(`var g${r}: int = rotina${r}(${random(10)}, ${random(10)});`)
+  }
+  return `${lines.join('\n')}\n`
+}
+
+function parse(dir, cli, args) {
+  const [routines, repeat, initial] = [400, 20, 1].map((fallback, i) => Number(args[i] ?? fallback))
+  const baseline = args[3]
+  seed(initial)
+
+  const measure = (compiler, file) => {
+    const output = run('parse', compiler, ['--parse', file, '--repeat', String(repeat)], { cwd: dir })
+    const tokens = match('parse', /Tokens: (\d+)/, output)
+    const rate = match('parse', /Vazão: ([\d.]+)/, output)
+    return { tokens: Number(tokens[1]), rate: Number(rate[1]) }
+  }
+
+  const file = join(dir, 'rotinas.us')
+  const source = parseProgram(routines)
+  writeFileSync(file, source)
+  const result = measure(cli, file)
+  console.log(`[bench parse] ${source.split('\n').length - 1} linhas, ${result.tokens} tokens × ${repeat} análises: ${result.rate} milhões de tokens/s`)
+  if (baseline) {
+    const before = measure(baseline, file)
+    console.log(`[bench parse] referência: ${before.rate} milhões de tokens/s, ${(result.rate / before.rate).toFixed(2)}× mais rápido`)
+  }
+}
+
+// --- lexer ---------------------------------------------------------------
+
+// as mesmas de SPECIAL_CASES_KEYS em src/gals/Constants.cpp
+const keywords = ['bool', 'break', 'case', 'const', 'default', 'do', 'elif', 'else', 'false', 'float', 'for', 'function',
+  'if', 'int', 'null', 'return', 'string', 'switch', 'throw', 'true', 'var', 'void', 'while']
+const letters = 'abcdefghijklmnopqrstuvwxyz'
+
+// Mesmo tamanho, primeira e última letra de uma palavra reservada: passa
+// pelo filtro de tamanho e cai no hash, e só a comparação a descarta.
+function nearMiss(word) {
+  const at = word.length > 2 ? 1 + random(word.length - 2) : word.length - 1
+  let letter = letters[random(letters.length)]
+  if (letter === word[at]) letter = letter === 'x' ? 'y' : 'x'
+  return word.slice(0, at) + letter + word.slice(at + 1)
+}
+
+function identifier() {
+  const word = keywords[random(keywords.length)]
+  const kind = random(10)
+  if (kind < 4) return nearMiss(word)
+  if (kind < 6) return random(2) ? `${word}${letters[random(letters.length)]}` : `${letters[random(letters.length)]}${word}`
+  if (kind < 8) return `${word}_${random(100)}`
+  let name = letters[random(letters.length)]
+  for (let n = random(12); n > 0; --n) name += letters[random(letters.length)]
+  return name
+}
+
+function identifierLine() {
+  const kind = random(5)
+  if (kind === 0) return `var ${identifier()}: int = ${identifier()} + ${identifier()} * ${identifier()};`
+  if (kind === 1) return `if (${identifier()} < ${identifier()}) { ${identifier()} = ${identifier()}; } else { ${identifier()}(${identifier()}); }`
+  if (kind === 2) return `while (${identifier()} != ${identifier()}) { ${identifier()} = ${identifier()} - ${identifier()}; }`
+  if (kind === 3) return `const ${identifier()}: bool = ${random(2) ? 'true' : 'false'};`
+  return `function ${identifier()}(${identifier()}: int, ${identifier()}: string): void { return ${identifier()}; }`
+}
+
+function lexer(dir, cli, args) {
+  const [lineCount, repeat, initial] = [100000, 20, 1].map((fallback, i) => Number(args[i] ?? fallback))
+  const baseline = args[3]
+  seed(initial)
+
+  const measure = (compiler, file) => {
+    const output = run('lexer', compiler, ['--lex', file, '--repeat', String(repeat)], { cwd: dir })
+    const input = match('lexer', /Entrada: (\d+) bytes, (\d+) tokens/, output)
+    const rate = match('lexer', /Vazão: ([\d.]+) MB\/s, ([\d.]+) milhões de tokens\/s/, output)
+    return { bytes: Number(input[1]), tokens: Number(input[2]), mbs: Number(rate[1]), tokensRate: Number(rate[2]) }
+  }
+
+  const file = join(dir, 'identificadores.us')
+  writeFileSync(file, `${Array.from({ length: lineCount }, identifierLine).join('\n')}\n`)
+  const result = measure(cli, file)
+  console.log(`[bench lexer] ${(result.bytes / 1e6).toFixed(1)} MB, ${result.tokens} tokens × ${repeat} passadas: ${result.mbs} MB/s, ${result.tokensRate} milhões de tokens/s`)
+  if (baseline) {
+    const before = measure(baseline, file)
+    console.log(`[bench lexer] referência: ${before.mbs} MB/s, ${before.tokensRate} milhões de tokens/s, ${(result.tokensRate / before.tokensRate).toFixed(2)}× mais rápido`)
+  }
+}
+
+// --- scanner -------------------------------------------------------------
+
+const FUZZ_CASES = 300
+const words = ['valor', 'índice', 'contador', 'resultado', 'vetor', 'laço', 'soma', 'entrada', 'saída', 'x']
+
+function prose(length) {
+  let text = ''
+  while (text.length < length) text += `${words[random(words.length)]} `
+  return text
+}
+
+function fill(megabytes, line) {
+  const target = megabytes * 1e6
+  const lines = []
+  for (let size = 0; size < target;) {
+    const text = line()
+    lines.push(text)
+    size += Buffer.byteLength(text) + 1
+  }
+  return `${lines.join('\n')}\n`
+}
+
+const scannerInputs = {
+  comentarios: (megabytes) => fill(megabytes, () => (random(3)
+    ? `// ${prose(60 + random(200))}`
+    : `/* ${prose(100 + random(400))}\n${prose(50 + random(200))} */`)),
+  strings: (megabytes) => fill(megabytes, () => `var s${random(1000)}: string = "${prose(40 + random(300))}";`),
+  misto: (megabytes) => fill(megabytes, () => {
+    const pad = ' '.repeat(4 * random(6))
+    const kind = random(4)
+    if (kind === 0) return `${pad}// ${prose(20 + random(80))}`
+    if (kind === 1) return `${pad}print("${prose(10 + random(60))}");`
+    return `${pad}var identificador_longo_${random(10000)}: int = outro_identificador_${random(100)} + ${random(1000)};`
+  })
+}
+
+// bytes quaisquer, com preferência pelos que abrem e fecham trechos
+function fuzzInput() {
+  const pieces = ['"', '\\', '/', '*', '/*', '*/', '//', '\n', '\r', ' ', '\t', 'a', 'if', 'x1', '_', '9', '.', '{', '}', ';', 'é', '\u0000']
+  let text = ''
+  for (let n = random(200); n > 0; --n) {
+    text += random(8) === 0 ? String.fromCharCode(random(256)) : pieces[random(pieces.length)]
+    if (random(10) === 0) text += ' '.repeat(random(40))
+    if (random(20) === 0) text += 'a'.repeat(random(80))
+  }
+  return text
+}
+
+function scanner(dir, cli, args) {
+  const [megabytes, repeat, initial] = [8, 20, 1].map((fallback, i) => Number(args[i] ?? fallback))
+  const scalar = args[3]
+  seed(initial)
+
+  const tokens = (compiler, file) => run('scanner', compiler, ['--lex', file, '--tokens'])
+  const measure = (compiler, file) => {
+    const output = run('scanner', compiler, ['--lex', file, '--repeat', String(repeat)])
+    const kernel = match('scanner', /Núcleo do scanner: (\S+)/, output)
+    const rate = match('scanner', /Vazão: ([\d.]+) MB\/s/, output)
+    return { kernel: kernel[1], rate: Number(rate[1]) }
+  }
+
+  let mismatches = 0
+  for (const [name, generate] of Object.entries(scannerInputs)) {
+    const file = join(dir, `${name}.us`)
+    writeFileSync(file, generate(megabytes))
+    const result = measure(cli, file)
+    if (!scalar) {
+      console.log(`[bench scanner] ${name}: ${result.rate} MB/s (${result.kernel})`)
+      continue
+    }
+    const base = measure(scalar, file)
+    const same = tokens(cli, file) === tokens(scalar, file)
+    if (!same) ++mismatches
+    console.log(`[bench scanner] ${name}: ${base.rate} MB/s (${base.kernel}) -> ${result.rate} MB/s (${result.kernel}), ` +
+      `${(result.rate / base.rate).toFixed(2)}×, tokens ${same ? 'iguais' : 'DIFERENTES'}`)
+  }
+
+  if (!scalar) {
+    console.log('[bench scanner] sem CLI escalar: a comparação de tokens não foi feita')
+    return 0
+  }
+  const file = join(dir, 'aleatoria.us')
+  let differing = 0
+  for (let i = 0; i < FUZZ_CASES; ++i) {
+    writeFileSync(file, fuzzInput(), 'latin1')
+    if (tokens(cli, file) !== tokens(scalar, file)) ++differing
+  }
+  console.log(`[bench scanner] ${FUZZ_CASES} entradas aleatórias: ${differing ? `${differing} com tokens DIFERENTES` : 'tokens iguais'}`)
+  return mismatches + differing
+}
+
+// -------------------------------------------------------------------------
+
+const benchmarks = { scopes, parse, lexer, scanner }
+const [name, cli, ...args] = process.argv.slice(2)
+if (!benchmarks[name] || !cli) {
+  console.error(`Uso: node scripts/bench.js <${Object.keys(benchmarks).join('|')}> <cli> [argumentos...]`)
+  process.exit(2)
+}
+
+const dir = mkdtempSync(join(tmpdir(), `uniscript-bench-${name}-`))
+let failures = 0
+try {
+  failures = benchmarks[name](dir, cli, args) ?? 0
+} finally {
+  rmSync(dir, { recursive: true, force: true })
+}
+process.exit(failures ? 1 : 0)
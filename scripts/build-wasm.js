@@ -27,7 +27,7 @@ async function main() {
 
   if (has('emcc')) {
     console.log('[wasm] Using local Emscripten (emcc)')
-    const cmd = `emcc src/gals/*.cpp bridge.cpp -O3 -s MODULARIZE=1 -s EXPORT_NAME=createUniscriptModule -s ENVIRONMENT=web -fwasm-exceptions -s EXPORTED_FUNCTIONS='["_uniscript_compile","_free"]' -s EXPORTED_RUNTIME_METHODS='["cwrap","UTF8ToString"]' -I src -o web/public/uniscript.js`
+    const cmd = `emcc src/gals/*.cpp bridge.cpp -O3 -msimd128 -s MODULARIZE=1 -s EXPORT_NAME=createUniscriptModule -s ENVIRONMENT=web -fwasm-exceptions -s EXPORTED_FUNCTIONS='["_uniscript_compile","_uniscript_compile_bin","_uniscript_session_create","_uniscript_session_compile","_uniscript_session_edit","_uniscript_session_bip","_uniscript_session_free","_uniscript_run_bip","_free"]' -s EXPORTED_RUNTIME_METHODS='["cwrap","UTF8ToString","HEAPU8"]' -I src -o web/public/uniscript.js`
     const sh = spawnSync('bash', ['-lc', cmd], { stdio: 'inherit' })
     if (sh.status !== 0) process.exit(sh.status ?? 1)
     console.log('[wasm] Done: web/public/uniscript.js + web/public/uniscript.wasm')
@@ -0,0 +1,84 @@
+#!/usr/bin/env node
+// Executa cada programa de exemplos/ com `uniscript --run` e confere a
+// saída com o cabeçalho do arquivo:
+//
+//   // entrada: 3 1 4     (opcional: valores lidos por read, em ordem)
+//   // saída: 7 6
+//
+// Programas com erro trazem, no lugar da saída, uma linha por erro
+// esperado; a lista de diagnósticos precisa ter exatamente esses erros,
+// na ordem:
+//
+//   // erro: Uso de identificador não declarado: 'x'
+//
+//   node scripts/check-exemplos.js ./uniscript [arquivos...]
+//
+// O programa precisa montar e terminar em HLT; termina com código 1 se
+// algum exemplo falhar.
+import { spawnSync } from 'node:child_process'
+import { mkdtempSync, readdirSync, readFileSync, rmSync } from 'node:fs'
+import { tmpdir } from 'node:os'
+import { join, resolve } from 'node:path'
+
+const [cli, ...files] = process.argv.slice(2)
+if (!cli) {
+  console.error('Uso: node scripts/check-exemplos.js <cli> [arquivos...]')
+  process.exit(2)
+}
+const examples = files.length
+  ? files
+  : readdirSync('exemplos')
+      .filter((name) => name.endsWith('.us'))
+      .sort()
+      .map((name) => join('exemplos', name))
+
+function header(source, key) {
+  const match = new RegExp(`^//\\s*${key}:(.*)$`, 'm').exec(source)
+  return match ? match[1].trim().split(/\s+/).filter(Boolean) : null
+}
+
+function expectedErrors(source) {
+  return Array.from(source.matchAll(/^\/\/\s*erro:(.*)$/gm), (match) => match[1].trim())
+}
+
+const dir = mkdtempSync(join(tmpdir(), 'uniscript-exemplos-'))
+let failures = 0
+try {
+  for (const file of examples) {
+    const source = readFileSync(file, 'utf8')
+    const errors = expectedErrors(source)
+    if (errors.length) {
+      const result = spawnSync(resolve(cli), [resolve(file)], { cwd: dir, encoding: 'utf8' })
+      const got = Array.from(result.stdout.matchAll(/^\[ERRO\] (.*)$/gm), (match) => match[1])
+      if (got.join('\n') === errors.join('\n')) {
+        console.log(`[exemplos] ${file}: ok`)
+        continue
+      }
+      ++failures
+      console.log(`[exemplos] ${file}: FALHOU (esperado ${errors.length} erro(s))`)
+      console.log(`${result.stdout}${result.stderr}`.replace(/^/gm, '    '))
+      continue
+    }
+    const expected = header(source, 'saída')
+    if (!expected) {
+      console.log(`[exemplos] ${file}: sem linha "// saída:", ignorado`)
+      continue
+    }
+    const inputs = header(source, 'entrada') ?? []
+    const result = spawnSync(resolve(cli), ['--run', resolve(file), ...inputs], { cwd: dir, encoding: 'utf8' })
+    const output = /^Saída:(.*)$/m.exec(result.stdout)
+    const got = output ? output[1].trim().split(/\s+/).filter(Boolean) : null
+    const halted = /Execução concluída \(HLT\)/.test(result.stdout)
+    if (result.status === 0 && halted && got && got.join(' ') === expected.join(' ')) {
+      console.log(`[exemplos] ${file}: ok`)
+      continue
+    }
+    ++failures
+    console.log(`[exemplos] ${file}: FALHOU (esperado "${expected.join(' ')}")`)
+    console.log(`${result.stdout}${result.stderr}`.replace(/^/gm, '    '))
+  }
+} finally {
+  rmSync(dir, { recursive: true, force: true })
+}
+console.log(`[exemplos] ${examples.length - failures}/${examples.length} ok`)
+process.exit(failures ? 1 : 0)
@@ -0,0 +1,242 @@
+#!/usr/bin/env node
+// Compila cada programa de exemplos/ pelas duas portas do módulo WASM,
+// uniscript_compile (JSON) e uniscript_compile_bin (docs/resultado-binario.md),
+// decodifica o bloco binário e confere, campo a campo, que ele traz o mesmo
+// que o JSON. Além do programa original, compila três variantes com erro
+// (léxico, sintático e semântico) para cobrir o cabeçalho de erro e os
+// diagnósticos.
+//
+//   node scripts/check-resultado-binario.js web/public/uniscript.js [arquivos...]
+//
+// O decodificador daqui segue o documento, não o da interface web, e
+// também confere a estrutura do bloco: tamanhos e offsets dentro do bloco
+// e alinhados, palavras reservadas zeradas, toda referência de string
+// dentro do bloco de strings e em UTF-8 válido. Linha e coluna de símbolos,
+// diagnósticos e erro são recalculadas a partir do fonte (coluna em bytes,
+// a partir de 1). Termina com código 1 se algum programa divergir.
+import { readdirSync, readFileSync } from 'node:fs'
+import { join } from 'node:path'
+
+const [moduleJs, ...files] = process.argv.slice(2)
+if (!moduleJs) {
+  console.error('Uso: node scripts/check-resultado-binario.js <uniscript.js> [arquivos...]')
+  process.exit(2)
+}
+const programs = files.length
+  ? files
+  : readdirSync('exemplos')
+      .filter((name) => name.endsWith('.us'))
+      .sort()
+      .map((name) => join('exemplos', name))
+
+const MAGIC = 0x42525355
+const VERSION = 1
+const HEADER_WORDS = 24
+const SYMBOL_WORDS = 9
+const DIAGNOSTIC_WORDS = 9
+const KINDS = [undefined, 'lexical', 'syntactic', 'semantic', 'unknown']
+const SEVERITIES = ['error', 'warning', 'info']
+const SYMBOL_FLAGS = ['initialized', 'used', 'isParameter', 'isArray', 'isFunction', 'isConstant']
+
+// O módulo é gerado com ENVIRONMENT=web: avaliado aqui como script, com o
+// .wasm entregue em wasmBinary no lugar do fetch.
+async function loadModule() {
+  const factory = new Function(`${readFileSync(moduleJs, 'utf8')}\nreturn createUniscriptModule`)()
+  return factory({ wasmBinary: readFileSync(moduleJs.replace(/\.js$/, '.wasm')) })
+}
+
+// Lê o bloco em heap[ptr..] seguindo docs/resultado-binario.md; os
+// problemas de estrutura vão para problems.
+function decode(heap, ptr, problems) {
+  const word = (offset) => new DataView(heap.buffer, heap.byteOffset + ptr + offset, 4).getInt32(0, true)
+  const header = Array.from({ length: HEADER_WORDS }, (_, i) => word(4 * i))
+  if (header[0] >>> 0 !== MAGIC) throw new Error(`magic 0x${(header[0] >>> 0).toString(16)}`)
+  if (header[1] !== VERSION) throw new Error(`versão ${header[1]}`)
+
+  const size = header[3]
+  const section = (name, offset, length) => {
+    if (offset % 4 !== 0) problems.push(`${name}: offset ${offset} não é múltiplo de 4`)
+    if (offset < HEADER_WORDS * 4 || length < 0 || offset + length > size) {
+      problems.push(`${name}: [${offset}, ${offset + length}) fora do bloco de ${size} bytes`)
+    }
+  }
+  section('símbolos', header[5], header[4] * SYMBOL_WORDS * 4)
+  section('diagnósticos', header[7], header[6] * DIAGNOSTIC_WORDS * 4)
+  section('strings', header[8], header[9])
+  for (let i = 21; i < HEADER_WORDS; ++i) {
+    if (header[i] !== 0) problems.push(`palavra reservada ${i} = ${header[i]}`)
+  }
+
+  const utf8 = new TextDecoder('utf-8', { fatal: true })
+  const text = (where, offset, length) => {
+    if (offset < 0 || length < 0 || offset + length > header[9]) {
+      problems.push(`${where}: string [${offset}, ${offset + length}) fora do bloco de strings (${header[9]} bytes)`)
+      return ''
+    }
+    const start = ptr + header[8] + offset
+    try {
+      return utf8.decode(heap.subarray(start, start + length))
+    } catch {
+      problems.push(`${where}: string com UTF-8 inválido`)
+      return ''
+    }
+  }
+
+  const symbolTable = []
+  for (let i = 0; i < header[4]; ++i) {
+    const at = header[5] + 4 * SYMBOL_WORDS * i
+    const w = (k) => word(at + 4 * k)
+    const flags = w(4)
+    if (flags & ~((1 << SYMBOL_FLAGS.length) - 1)) problems.push(`símbolo ${i}: bits desconhecidos em ${flags}`)
+    const symbol = {
+      name: text(`símbolo ${i}.name`, w(0), w(1)),
+      type: text(`símbolo ${i}.type`, w(2), w(3)),
+      scope: w(5),
+      position: w(6),
+      line: w(7),
+      column: w(8)
+    }
+    SYMBOL_FLAGS.forEach((flag, bit) => { symbol[flag] = (flags & (1 << bit)) !== 0 })
+    symbolTable.push(symbol)
+  }
+
+  const diagnostics = []
+  for (let i = 0; i < header[6]; ++i) {
+    const at = header[7] + 4 * DIAGNOSTIC_WORDS * i
+    const w = (k) => word(at + 4 * k)
+    if (!SEVERITIES[w(0)]) problems.push(`diagnóstico ${i}: severity ${w(0)}`)
+    diagnostics.push({
+      severity: SEVERITIES[w(0)],
+      message: text(`diagnóstico ${i}.message`, w(1), w(2)),
+      position: w(3),
+      length: w(4),
+      line: w(5),
+      column: w(6),
+      endLine: w(7),
+      endColumn: w(8)
+    })
+  }
+
+  const result = { ok: header[2] !== 0, symbolTable, diagnostics, bipCode: text('bipCode', header[10], header[11]) }
+  if (header[2] !== 0 && header[2] !== 1) problems.push(`ok = ${header[2]}`)
+  if (!result.ok) {
+    if (!KINDS[header[12]]) problems.push(`kind ${header[12]}`)
+    Object.assign(result, {
+      kind: KINDS[header[12]],
+      message: text('message', header[13], header[14]),
+      pos: header[15],
+      length: header[16],
+      line: header[17],
+      column: header[18],
+      endLine: header[19],
+      endColumn: header[20]
+    })
+  }
+  return result
+}
+
+// Diferenças entre dois valores JSON, com o caminho de cada uma.
+function compare(path, expected, got, out) {
+  if (Array.isArray(expected) || Array.isArray(got)) {
+    if (!Array.isArray(expected) || !Array.isArray(got) || expected.length !== got.length) {
+      const describe = (value) => (Array.isArray(value) ? `${value.length} itens` : JSON.stringify(value))
+      out.push(`${path}: JSON com ${describe(expected)}, binário com ${describe(got)}`)
+      return
+    }
+    expected.forEach((item, i) => compare(`${path}[${i}]`, item, got[i], out))
+  } else if (expected && typeof expected === 'object' && got && typeof got === 'object') {
+    for (const key of new Set([...Object.keys(expected), ...Object.keys(got)])) {
+      if (!(key in expected)) out.push(`${path}.${key}: só no binário`)
+      else if (!(key in got)) out.push(`${path}.${key}: só no JSON`)
+      else compare(`${path}.${key}`, expected[key], got[key], out)
+    }
+  } else if (expected !== got) {
+    out.push(`${path}: JSON ${JSON.stringify(expected)}, binário ${JSON.stringify(got)}`)
+  }
+}
+
+// Linha e coluna (em bytes, a partir de 1) de um offset do fonte, como o
+// núcleo calcula; -1 para posições negativas.
+function lineColumn(bytes, position) {
+  if (position < 0) return [-1, -1]
+  const offset = Math.min(position, bytes.length)
+  let line = 1
+  let start = 0
+  for (let i = 0; i < offset; ++i) {
+    if (bytes[i] === 0x0a) {
+      ++line
+      start = i + 1
+    }
+  }
+  return [line, offset - start + 1]
+}
+
+function checkPositions(bytes, result, out) {
+  const expect = (where, position, line, column) => {
+    const [l, c] = lineColumn(bytes, position)
+    if (l !== line || c !== column) out.push(`${where}: posição ${position} é ${l}:${c}, veio ${line}:${column}`)
+  }
+  const span = (where, item, position, length) => {
+    expect(where, position, item.line, item.column)
+    expect(`${where} (fim)`, position < 0 ? -1 : position + Math.max(1, length), item.endLine, item.endColumn)
+  }
+  result.symbolTable.forEach((symbol, i) => expect(`symbolTable[${i}]`, symbol.position, symbol.line, symbol.column))
+  result.diagnostics.forEach((diagnostic, i) => span(`diagnostics[${i}]`, diagnostic, diagnostic.position, diagnostic.length))
+  if (!result.ok) span('erro', result, result.pos, result.length)
+}
+
+// O programa e três variantes com erro no fim: string sem fechar (léxico),
+// comando cortado (sintático) e nome não declarado (semântico).
+function variants(source) {
+  return [
+    ['', source],
+    [' +léxico', `${source}\nvar fim: string = "sem fim;\n`],
+    [' +sintático', `${source}\nvar fim: int = ;\n`],
+    [' +semântico', `${source}\nprint(naoDeclarada + 1);\n`]
+  ]
+}
+
+const Module = await loadModule()
+const compileJson = Module.cwrap('uniscript_compile', 'number', ['string'])
+const compileBin = Module.cwrap('uniscript_compile_bin', 'number', ['string'])
+const kinds = new Set()
+let failures = 0
+let checked = 0
+
+for (const file of programs) {
+  for (const [suffix, source] of variants(readFileSync(file, 'utf8'))) {
+    const jsonPtr = compileJson(source)
+    const json = JSON.parse(Module.UTF8ToString(jsonPtr))
+    Module._free(jsonPtr)
+
+    const problems = []
+    const binPtr = compileBin(source)
+    let decoded
+    try {
+      decoded = decode(Module.HEAPU8, binPtr, problems)
+    } catch (err) {
+      problems.push(`bloco recusado: ${err.message}`)
+    } finally {
+      Module._free(binPtr)
+    }
+    if (decoded) {
+      compare('resultado', json, decoded, problems)
+      checkPositions(Buffer.from(source, 'utf8'), decoded, problems)
+      kinds.add(decoded.ok ? 'ok' : decoded.kind)
+    }
+
+    ++checked
+    if (problems.length) {
+      ++failures
+      console.log(`[resultado-binario] ${file}${suffix}: FALHOU`)
+      for (const problem of problems.slice(0, 10)) console.log(`  ${problem}`)
+      if (problems.length > 10) console.log(`  ... e mais ${problems.length - 10}`)
+    } else {
+      const counts = `${decoded.symbolTable.length} símbolos, ${decoded.diagnostics.length} diagnósticos`
+      console.log(`[resultado-binario] ${file}${suffix}: ok (${decoded.ok ? 'compilou' : decoded.kind}, ${counts})`)
+    }
+  }
+}
+
+console.log(`[resultado-binario] ${checked - failures}/${checked} iguais (${[...kinds].join(', ')})`)
+process.exit(failures ? 1 : 0)
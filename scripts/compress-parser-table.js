@@ -0,0 +1,162 @@
+#!/usr/bin/env node
+// Compacta a PARSER_TABLE gerada pelo GALS (int [estados][simbolos][2]).
+//
+// Rodar depois de regerar src/gals/Constants.{h,cpp} no GALS:
+//   npm run parser-table
+//
+// A tabela densa é trocada por duas tabelas de deslocamento de linha
+// (comb vector) com células de 16 bits:
+//   - ACTION: colunas dos terminais; célula = (comando << 12) | valor.
+//   - GOTO: colunas dos não terminais e das ações semânticas; célula = estado.
+// Cada estado recebe uma base; a entrada (estado, coluna) está em
+// base + coluna se CHECK[base + coluna] == estado, senão é ERROR.
+import { readFileSync, writeFileSync } from 'node:fs'
+import { resolve } from 'node:path'
+
+const root = resolve(process.cwd())
+const cppPath = resolve(root, 'src/gals/Constants.cpp')
+const hPath = resolve(root, 'src/gals/Constants.h')
+
+const COMMANDS = { SHIFT: 0, REDUCE: 1, ACTION: 2, ACCEPT: 3, GO_TO: 4, ERROR: 5 }
+const EMPTY = 0xffff
+
+const cpp = readFileSync(cppPath, 'utf8')
+const header = readFileSync(hPath, 'utf8')
+
+const tableDecl = /const int PARSER_TABLE\[(\d+)\]\[(\d+)\]\[2\] =\s*\{/
+const match = tableDecl.exec(cpp)
+if (!match) {
+  console.log('[parser-table] PARSER_TABLE não encontrada; Constants.cpp já está compactado.')
+  process.exit(0)
+}
+
+const states = Number(match[1])
+const symbols = Number(match[2])
+const tableEnd = cpp.indexOf('};', match.index) + 2
+const cells = [...cpp.slice(match.index, tableEnd).matchAll(/\{\s*(SHIFT|REDUCE|ACTION|ACCEPT|GO_TO|ERROR)\s*,\s*(\d+)\s*\}/g)]
+  .map((m) => [COMMANDS[m[1]], Number(m[2])])
+if (cells.length !== states * symbols) {
+  throw new Error(`[parser-table] esperado ${states * symbols} células, encontrado ${cells.length}`)
+}
+
+const firstAction = Number(/const int FIRST_SEMANTIC_ACTION = (\d+);/.exec(header)[1])
+const tokenIds = [...header.matchAll(/^\s*t_\w+\s*=\s*(\d+)/gm)].map((m) => Number(m[1]))
+// colunas 0..terminals-1 são os terminais (DOLLAR incluso, EPSILON fora)
+const terminals = Math.max(...tokenIds)
+const gotoColumns = symbols - terminals
+if (firstAction - 1 < terminals) {
+  throw new Error('[parser-table] layout de colunas inesperado')
+}
+
+const cellAt = (state, column) => cells[state * symbols + column]
+
+function compress(columns, offset, encode) {
+  const rows = []
+  for (let state = 0; state < states; ++state) {
+    const entries = []
+    for (let column = 0; column < columns; ++column) {
+      const [command, value] = cellAt(state, offset + column)
+      if (command !== COMMANDS.ERROR) entries.push([column, encode(command, value)])
+    }
+    rows.push({ state, entries })
+  }
+
+  // first-fit com as linhas mais densas primeiro
+  const order = [...rows].sort((a, b) => b.entries.length - a.entries.length || a.state - b.state)
+  const check = []
+  const value = []
+  const base = new Array(states).fill(0)
+  for (const row of order) {
+    if (row.entries.length === 0) continue
+    let candidate = 0
+    for (;;) {
+      const fits = row.entries.every(([column]) => check[candidate + column] === undefined)
+      if (fits) break
+      ++candidate
+    }
+    base[row.state] = candidate
+    for (const [column, encoded] of row.entries) {
+      check[candidate + column] = row.state
+      value[candidate + column] = encoded
+    }
+  }
+
+  // garante que base + coluna nunca sai do vetor, dispensando teste de limite
+  const length = Math.max(check.length, ...base.map((b) => b + columns))
+  const checkOut = Array.from({ length }, (_, i) => (check[i] === undefined ? EMPTY : check[i]))
+  const valueOut = Array.from({ length }, (_, i) => (value[i] === undefined ? 0 : value[i]))
+  return { base, check: checkOut, value: valueOut }
+}
+
+const action = compress(terminals, 0, (command, value) => {
+  if (value >= 1 << 12) throw new Error('[parser-table] valor não cabe em 12 bits')
+  return (command << 12) | value
+})
+const gotoTable = compress(gotoColumns, terminals, (command, value) => {
+  if (command !== COMMANDS.GO_TO) throw new Error('[parser-table] célula de desvio inesperada')
+  return value
+})
+
+function formatArray(name, values) {
+  const lines = []
+  for (let i = 0; i < values.length; i += 16) {
+    lines.push('    ' + values.slice(i, i + 16).map((v) => String(v).padStart(5)).join(','))
+  }
+  return `const unsigned short ${name}[${values.length}] =\n{\n${lines.join(',\n')}\n};`
+}
+
+const compressed = [
+  formatArray('PARSER_ACTION_BASE', action.base),
+  formatArray('PARSER_ACTION_CHECK', action.check),
+  formatArray('PARSER_ACTION_CELL', action.value),
+  formatArray('PARSER_GOTO_BASE', gotoTable.base),
+  formatArray('PARSER_GOTO_CHECK', gotoTable.check),
+  formatArray('PARSER_GOTO_STATE', gotoTable.value)
+].join('\n\n')
+
+const declarations = `const int PARSER_STATES = ${states};
+const int PARSER_TERMINALS = ${terminals};
+
+const int PARSER_CELL_SHIFT = 12;
+const int PARSER_CELL_MASK = (1 << PARSER_CELL_SHIFT) - 1;
+const int PARSER_ERROR_CELL = ERROR << PARSER_CELL_SHIFT;
+
+extern const unsigned short PARSER_ACTION_BASE[${states}];
+extern const unsigned short PARSER_ACTION_CHECK[${action.check.length}];
+extern const unsigned short PARSER_ACTION_CELL[${action.value.length}];
+
+extern const unsigned short PARSER_GOTO_BASE[${states}];
+extern const unsigned short PARSER_GOTO_CHECK[${gotoTable.check.length}];
+extern const unsigned short PARSER_GOTO_STATE[${gotoTable.value.length}];
+
+// Célula ACTION de (estado, token - 1): comando nos bits altos, valor nos baixos.
+inline int parserActionCell(int state, int terminal)
+{
+    const int index = PARSER_ACTION_BASE[state] + terminal;
+    return PARSER_ACTION_CHECK[index] == state ? PARSER_ACTION_CELL[index] : PARSER_ERROR_CELL;
+}
+
+inline int parserCommand(int cell) { return cell >> PARSER_CELL_SHIFT; }
+
+inline int parserValue(int cell) { return cell & PARSER_CELL_MASK; }
+
+// Estado de desvio para a coluna (símbolo - 1) de um não terminal ou ação semântica.
+inline int parserGoto(int state, int column)
+{
+    const int index = PARSER_GOTO_BASE[state] + column - PARSER_TERMINALS;
+    return PARSER_GOTO_CHECK[index] == state ? PARSER_GOTO_STATE[index] : 0;
+}`
+
+const headerDecl = /extern const int PARSER_TABLE\[\d+\]\[\d+\]\[2\];/
+if (!headerDecl.test(header)) {
+  throw new Error('[parser-table] declaração de PARSER_TABLE não encontrada em Constants.h')
+}
+
+writeFileSync(cppPath, cpp.slice(0, match.index) + compressed + cpp.slice(tableEnd))
+writeFileSync(hPath, header.replace(headerDecl, declarations))
+
+const denseBytes = states * symbols * 2 * 4
+const packedBytes = 2 * (2 * states + 2 * action.check.length + 2 * gotoTable.check.length)
+console.log(`[parser-table] ${states} estados, ${terminals} terminais, ${gotoColumns} colunas de desvio`)
+console.log(`[parser-table] ACTION: ${action.check.length} slots, GOTO: ${gotoTable.check.length} slots`)
+console.log(`[parser-table] ${denseBytes} bytes -> ${packedBytes} bytes`)
@@ -0,0 +1,206 @@
+#include "BatchCompiler.h"
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "gals/BipGenerator.h"
+#include "gals/CompilationContext.h"
+#include "gals/Lexico.h"
+#include "gals/Semantico.h"
+#include "gals/Sintatico.h"
+#include "gals/SourceBuffer.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+  struct BatchFile
+  {
+    fs::path source;
+    fs::path relative;
+  };
+
+  struct BatchResult
+  {
+    bool compiled = false;
+    bool readable = true;
+    std::size_t bytes = 0;
+  };
+
+  bool isProgramFile(const fs::path &path)
+  {
+    const auto extension = path.extension();
+    return extension == ".us" || extension == ".txt";
+  }
+
+  bool collectFiles(const fs::path &input, std::vector<BatchFile> &files)
+  {
+    std::error_code error;
+    if (fs::is_directory(input, error))
+    {
+      for (fs::recursive_directory_iterator it(input, error), end; !error && it != end; it.increment(error))
+      {
+        if (it->is_regular_file(error) && isProgramFile(it->path()))
+          files.push_back({it->path(), fs::relative(it->path(), input, error)});
+      }
+      if (error)
+        return false;
+    }
+    else
+    {
+      std::ifstream manifest(input);
+      if (!manifest)
+        return false;
+      const fs::path base = input.parent_path();
+      std::string line;
+      while (std::getline(manifest, line))
+      {
+        if (!line.empty() && line.back() == '\r')
+          line.pop_back();
+        if (line.empty() || line[0] == '#')
+          continue;
+        const fs::path listed(line);
+        files.push_back({listed.is_absolute() ? listed : base / listed, listed.relative_path()});
+      }
+    }
+
+    // ordem estável: a saída não depende da ordem do sistema de arquivos
+    std::sort(files.begin(), files.end(), [](const BatchFile &a, const BatchFile &b) { return a.relative < b.relative; });
+    return true;
+  }
+
+  fs::path outputBase(const BatchFile &file, const std::string &outputDir)
+  {
+    if (outputDir.empty())
+      return fs::path(file.source).replace_extension();
+    return (fs::path(outputDir) / file.relative).replace_extension();
+  }
+
+  // Estado de um worker, reaproveitado entre os arquivos que ele compila.
+  struct Worker
+  {
+    CompilationContext context;
+    Lexico lex;
+    Sintatico sint;
+    Semantico sem{context};
+    std::ostringstream report;
+  };
+
+  BatchResult compileFile(Worker &worker, const BatchFile &file, const std::string &outputDir)
+  {
+    BatchResult result;
+    const fs::path base = outputBase(file, outputDir);
+    std::error_code error;
+    if (base.has_parent_path())
+      fs::create_directories(base.parent_path(), error);
+
+    worker.report.str(std::string());
+    worker.report.clear();
+
+    auto source = SourceBuffer::fromFile(file.source.string());
+    if (!source)
+    {
+      result.readable = false;
+      worker.report << "Erro ao abrir o arquivo: " << file.source.string() << std::endl;
+    }
+    else
+    {
+      result.bytes = source->view().size();
+      worker.sem.resetState();
+      worker.context.setReportStream(&worker.report);
+      worker.sem.setSourceCode(source);
+      worker.lex.setInput(source);
+
+      try
+      {
+        worker.sint.parse(&worker.lex, &worker.sem);
+        finalizeSemanticAnalysis(worker.context, false);
+        BipGenerator::writeToFile(snapshotBipCode(worker.context), base.string() + ".bip");
+        worker.report << "Analise concluida com sucesso!" << std::endl;
+        result.compiled = true;
+      }
+      catch (const LexicalError &err)
+      {
+        worker.report << "Problema lexico: " << err.getMessage() << std::endl;
+      }
+      catch (const SyntacticError &err)
+      {
+        worker.report << "Problema sintatico: " << err.getMessage() << std::endl;
+      }
+      catch (const SemanticError &err)
+      {
+        worker.report << "Problema semantico: " << err.getMessage() << std::endl;
+      }
+      catch (const std::exception &err)
+      {
+        worker.report << "Erro interno: " << err.what() << std::endl;
+      }
+
+      // solta o buffer do arquivo antes do próximo
+      worker.sem.resetState();
+      worker.lex.setInput("");
+    }
+
+    std::ofstream diagnostics(base.string() + ".diag");
+    diagnostics << worker.report.str();
+    return result;
+  }
+}
+
+int runBatch(const BatchOptions &options)
+{
+  std::vector<BatchFile> files;
+  if (!collectFiles(options.input, files))
+  {
+    std::cerr << "Erro ao ler o lote: " << options.input << std::endl;
+    return 2;
+  }
+
+  unsigned jobs = options.jobs;
+  if (jobs == 0)
+    jobs = std::max(1u, std::thread::hardware_concurrency());
+  if (!files.empty() && jobs > files.size())
+    jobs = static_cast<unsigned>(files.size());
+
+  WorkStealingPool pool(jobs);
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (unsigned w = 0; w < pool.workerCount(); ++w)
+    workers.push_back(std::make_unique<Worker>());
+
+  std::vector<BatchResult> results(files.size());
+  const auto start = std::chrono::steady_clock::now();
+  pool.run(files.size(), [&](std::size_t index, unsigned worker) {
+    results[index] = compileFile(*workers[worker], files[index], options.outputDir);
+  });
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::size_t compiled = 0;
+  std::size_t bytes = 0;
+  for (std::size_t i = 0; i < files.size(); ++i)
+  {
+    bytes += results[i].bytes;
+    if (results[i].compiled)
+      ++compiled;
+    else
+      std::cerr << "Falhou: " << files[i].source.string() << std::endl;
+  }
+
+  const double safeSeconds = seconds > 0 ? seconds : 1e-9;
+  char summary[256];
+  std::snprintf(summary, sizeof(summary),
+                "%zu arquivos (%zu ok, %zu com erro) em %.3f s com %u threads: %.1f arquivos/s, %.2f MB/s, %zu roubos",
+                files.size(), compiled, files.size() - compiled, seconds, pool.workerCount(),
+                files.size() / safeSeconds, bytes / safeSeconds / 1e6, pool.steals());
+  std::cout << summary << std::endl;
+
+  return compiled == files.size() ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+#ifndef BATCH_COMPILER_H
+#define BATCH_COMPILER_H
+
+#include <string>
+
+// Modo lote: compila todos os programas de um diretório (arquivos .us e
+// .txt, recursivamente) ou de um manifesto (um caminho por linha, relativo
+// ao manifesto; linhas vazias e iniciadas por # são ignoradas).
+//
+// Para cada arquivo grava <nome>.bip e <nome>.diag, com a mesma saída que o
+// modo de um arquivo imprime, ao lado da entrada ou espelhados em
+// outputDir. Cada worker usa o próprio CompilationContext.
+struct BatchOptions
+{
+  std::string input;
+  std::string outputDir;
+  unsigned jobs = 0; // 0 = todos os núcleos
+};
+
+// Retorna 0 se todos os arquivos compilaram, 1 se algum falhou e 2 se a
+// entrada não pôde ser lida.
+int runBatch(const BatchOptions &options);
+
+#endif
@@ -2,24 +2,29 @@
 #define SEMANTIC_TABLE_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 
-#include "gals/SemanticError.h"
+#include "gals/Interner.h"
 
 using namespace std;
 
 class SemanticTable {
 public:
-    enum Types { INT = 0, FLOAT, STRING, BOOLEAN, VOID };
+    // POISONED: tipo de uma expressão que já teve erro. Quem o recebe não
+    // acusa outro erro por causa dele.
+    enum Types { INT = 0, FLOAT, STRING, BOOLEAN, VOID, POISONED };
     enum Operations { SUM = 0, SUB, MUL, DIV, REL, MOD, POT, AND, OR };
     enum Status { ERR = -1, WAR, OK };
 
+    // name aponta para o texto internado (Interner da compilação) depois
+    // que o símbolo entra na tabela.
     struct SymbolEntry {
-        string name;
+        string_view name;
         Types type = INT;
         bool hasExplicitType = false;
         bool initialized = false;
@@ -32,6 +37,10 @@ public:
         bool isArray = false;
         bool isFunction = false;
         bool isConstant = false;
+        // Rotinas: as chamadas são conferidas com a assinatura.
+        int paramCount = 0;
+        bool intParams = true;
+        bool returnsArray = false;
     };
 
     struct DiagnosticEntry {
@@ -39,6 +48,7 @@ public:
         string message;
         int position = -1;
         int length = 1;
+        bool syntactic = false;
     };
 
     struct Param {
@@ -50,10 +60,13 @@ public:
         int column = -1;
     };
 
-    SemanticTable() { enterScope(); }
+    explicit SemanticTable(Interner &names) : names(&names) { enterScope(); }
 
     void reset() {
-        scopes.clear();
+        scopeStarts.clear();
+        scopeSymbols.clear();
+        visible.clear();
+        symbolNames.clear();
         symbolTable.clear();
         diagnostics.clear();
         openFunctions.clear();
@@ -63,18 +76,23 @@ public:
     }
 
     void declare(const SymbolEntry &e) {
-        auto &cur = scopes.back();
+        const Interner::Id name = nameId(e.name);
+        const int escopo = (int)scopeStarts.size()-1;
 
-        if (cur.count(e.name)) {
-            addError("Identificador já declarado neste escopo: '" + e.name + "'", e.position, static_cast<int>(e.name.size()));
+        // o símbolo visível mais interno é o único que pode ser deste escopo
+        if (!visible[name].empty() && symbolTable[visible[name].back()].scope == escopo) {
+            addError("Identificador já declarado neste escopo: '" + string(e.name) + "'", e.position, static_cast<int>(e.name.size()));
             return;
         }
 
         SymbolEntry copy = e;
-        copy.scope = (int)scopes.size()-1;
+        copy.name = names->text(name);
+        copy.scope = escopo;
         int idx = (int)symbolTable.size();
         symbolTable.push_back(copy);
-        cur[e.name] = idx;
+        symbolNames.push_back(name);
+        visible[name].push_back(idx);
+        scopeSymbols.push_back(idx);
     }
 
     void commitStatement(const SymbolEntry &instrucao) {
@@ -83,13 +101,13 @@ public:
             return;
         }
         const int indiceSimbolo = lookupIndex(instrucao.name);
-        const int escopoAtual = scopes.empty() ? -1 : static_cast<int>(scopes.size()) - 1;
+        const int escopoAtual = static_cast<int>(scopeStarts.size()) - 1;
         const bool tentativaDeclaracao = instrucao.hasExplicitType || instrucao.isParameter;
 
         if (tentativaDeclaracao) {
             const bool mesmaDeclaracao = indiceSimbolo >= 0 && symbolTable[indiceSimbolo].scope == escopoAtual;
             if (mesmaDeclaracao) {
-                addError("Identificador já declarado neste escopo: '" + instrucao.name + "'");
+                addError("Identificador já declarado neste escopo: '" + string(instrucao.name) + "'");
             } else {
                 tratarNovaDeclaracao(instrucao);
             }
@@ -102,10 +120,15 @@ public:
         limparTipoPendente();
     }
 
-    void beginFunction(const string& name, Types retType, const vector<Param>& params, int position = -1, int line = -1, int column = -1) {
+    void beginFunction(const string& name, Types retType, bool returnsArray, const vector<Param>& params, int position = -1, int line = -1, int column = -1) {
         SymbolEntry fun;
         fun.name = name;
         fun.type = retType;
+        fun.returnsArray = returnsArray;
+        fun.paramCount = static_cast<int>(params.size());
+        for (const auto &p : params) {
+            if (p.type != INT) fun.intParams = false;
+        }
         fun.initialized = true;
         fun.isFunction = true;
         fun.hasExplicitType = true;
@@ -115,7 +138,7 @@ public:
         fun.column = column;
         declare(fun);
         enterScope();
-        functionScopeDepths.push_back((int)scopes.size() - 1);
+        functionScopeDepths.push_back((int)scopeStarts.size() - 1);
         for (auto p : params) {
             SymbolEntry s;
             s.name = p.name;
@@ -129,7 +152,7 @@ public:
             s.isArray = p.isArray;
             declare(s);
         }
-        openFunctions.push_back(name);
+        openFunctions.push_back(names->intern(name));
     }
 
     // Fecha escopo de função quando apropriado
@@ -141,76 +164,94 @@ public:
     }
 
     void enterScope() {
-        scopes.emplace_back();
+        scopeStarts.push_back(scopeSymbols.size());
     }
 
     void exitScope() {
-        if (scopes.empty()) return;
-
-        auto &cur = scopes.back();
+        if (scopeStarts.empty()) return;
 
-        for (auto &kv : cur) {
-            auto &sym = symbolTable[kv.second];
+        const size_t inicio = scopeStarts.back();
+        for (size_t i = inicio; i < scopeSymbols.size(); ++i) {
+            const int idx = scopeSymbols[i];
+            auto &sym = symbolTable[idx];
             if (!sym.used) {
-                addWarning("Identificador declarado e não usado: '" + sym.name + "' (escopo " + to_string(sym.scope) + ")", sym.position, static_cast<int>(sym.name.size()));
+                addWarning("Identificador declarado e não usado: '" + string(sym.name) + "' (escopo " + to_string(sym.scope) + ")", sym.position, static_cast<int>(sym.name.size()));
             }
+            visible[symbolNames[idx]].pop_back();
         }
+        scopeSymbols.resize(inicio);
 
-        if (!functionScopeDepths.empty() && functionScopeDepths.back() == (int)scopes.size() - 1) {
+        if (!functionScopeDepths.empty() && functionScopeDepths.back() == (int)scopeStarts.size() - 1) {
             functionScopeDepths.pop_back();
         }
 
-        scopes.pop_back();
+        scopeStarts.pop_back();
     }
 
     void closeAllScopes() {
-        while (scopes.size() > 1) exitScope();
-        if (scopes.size() == 1) exitScope();
+        while (!scopeStarts.empty()) exitScope();
     }
 
-    void markUseIfDeclared(const string &name, int position = -1, int length = 1, bool requireArray = false) {
-        int idx = lookupIndex(name);
-        if (idx < 0) {
-            addError("Uso de identificador não declarado: '" + name + "'", position, length);
-            return;
-        }
-        if (!functionScopeDepths.empty()) {
-            int functionScopeDepth = functionScopeDepths.back();
-            const auto &sym = symbolTable[idx];
-            if (!sym.isFunction && sym.scope < functionScopeDepth && sym.scope != 0) {
-                addError("Identificador não declarado neste escopo: '" + name + "'", position, length);
-                return;
-            }
-        }
-        if (requireArray && !symbolTable[idx].isArray) {
-            addError("Identificador não é um vetor: '" + name + "'", position, length);
-            return;
-        }
-        symbolTable[idx].used = true;
-        if (!symbolTable[idx].initialized && !symbolTable[idx].isFunction) {
-            addWarning("Possível uso sem inicialização: '" + name + "'", position, length);
-        }
+    // Declaração interrompida por erro de sintaxe: o nome entra com o tipo
+    // POISONED, e os usos seguintes não acusam outro erro por causa dele.
+    void declarePoisoned(string_view name, int position, int line, int column, bool isFunction, bool isArray) {
+        const int idx = lookupIndex(name);
+        if (idx >= 0 && symbolTable[idx].scope == (int)scopeStarts.size() - 1) return;
+        SymbolEntry e;
+        e.name = name;
+        e.type = POISONED;
+        e.hasExplicitType = true;
+        e.initialized = true;
+        e.used = true;
+        e.position = position;
+        e.line = line;
+        e.column = column;
+        e.isFunction = isFunction;
+        e.isArray = isArray;
+        declare(e);
+    }
+
+    void markUseIfDeclared(string_view name, int position = -1, int length = 1, bool requireArray = false) {
+        markUse(lookupIndex(name), name, position, length, requireArray);
+    }
+    void markUseIfDeclared(Interner::Id name, int position = -1, int length = 1, bool requireArray = false) {
+        markUse(lookupIndex(name), names->text(name), position, length, requireArray);
     }
 
     void noteExprType(Types t) { pendingExpressionType = (int)t; }
     void discardPendingExpression() { limparTipoPendente(); }
-    Types getSymbolType(const string &name) const {
+    // As consultas aceitam o texto ou o id do nome no Interner.
+    template <class Name>
+    Types getSymbolType(const Name &name) const {
         int idx = lookupIndex(name);
         if (idx < 0) {
-            return INT;
+            return POISONED;
         }
         return symbolTable[idx].type;
     }
-    bool isArraySymbol(const string &name) const {
+    template <class Name>
+    bool isArraySymbol(const Name &name) const {
         int idx = lookupIndex(name);
         if (idx < 0) {
             return false;
         }
         return symbolTable[idx].isArray;
     }
-    bool hasSymbol(const string &name) const {
+    template <class Name>
+    bool hasSymbol(const Name &name) const {
         return lookupIndex(name) >= 0;
     }
+    template <class Name>
+    const SymbolEntry *findSymbol(const Name &name) const {
+        int idx = lookupIndex(name);
+        return idx < 0 ? nullptr : &symbolTable[idx];
+    }
+    // A função aberta mais interna (nullptr fora de funções).
+    const SymbolEntry *currentFunction() const {
+        if (openFunctions.empty()) return nullptr;
+        const SymbolEntry *fun = findSymbol(openFunctions.back());
+        return fun && fun->isFunction ? fun : nullptr;
+    }
 
     const vector<SymbolEntry> &getSymbolTable() const {
         return symbolTable;
@@ -220,6 +261,92 @@ public:
         return diagnostics;
     }
 
+    // Compilação incremental (CompilationSession). position leva uma posição
+    // do estado salvo para o texto atual; linha e coluna derivam da posição
+    // e ficam fora da comparação. Os diagnósticos também: a análise só os
+    // acrescenta, nunca os lê.
+    template <class Position>
+    bool sameState(const SemanticTable &saved, Position position) const {
+        if (symbolTable.size() != saved.symbolTable.size() || pendingExpressionType != saved.pendingExpressionType ||
+            openFunctions != saved.openFunctions || functionScopeDepths != saved.functionScopeDepths ||
+            scopeStarts != saved.scopeStarts || scopeSymbols != saved.scopeSymbols || symbolNames != saved.symbolNames) {
+            return false;
+        }
+        for (size_t i = 0; i < symbolTable.size(); ++i) {
+            const SymbolEntry &a = symbolTable[i];
+            const SymbolEntry &b = saved.symbolTable[i];
+            if (a.position != position(b.position) || a.type != b.type || a.hasExplicitType != b.hasExplicitType ||
+                a.initialized != b.initialized || a.used != b.used || a.scope != b.scope || a.isParameter != b.isParameter ||
+                a.isArray != b.isArray || a.isFunction != b.isFunction || a.isConstant != b.isConstant ||
+                a.paramCount != b.paramCount || a.intParams != b.intParams || a.returnsArray != b.returnsArray) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // shift(posição, linha, coluna) atualiza os três no lugar.
+    template <class Shift>
+    void shiftPositions(Shift shift) {
+        for (auto &sym : symbolTable) shift(sym.position, sym.line, sym.column);
+        int line = -1, column = -1;
+        for (auto &d : diagnostics) shift(d.position, line, column);
+    }
+
+    // Troca os count primeiros diagnósticos pelos de replacement.
+    void replaceDiagnostics(size_t count, const SemanticTable &replacement) {
+        vector<DiagnosticEntry> merged = replacement.diagnostics;
+        merged.insert(merged.end(), diagnostics.begin() + static_cast<std::ptrdiff_t>(min(count, diagnostics.size())), diagnostics.end());
+        diagnostics = std::move(merged);
+    }
+
+    size_t diagnosticCount() const { return diagnostics.size(); }
+
+    // Erros de sintaxe recuperados pelo Sintatico: entram na lista sem
+    // interromper a análise.
+    void addSyntaxError(const string& message, int position, int length) {
+        diagnostics.push_back({"error", message, position, length, true});
+    }
+
+    const DiagnosticEntry *firstSyntaxError() const {
+        for (auto &d : diagnostics) {
+            if (d.syntactic) return &d;
+        }
+        return nullptr;
+    }
+
+    // O erro que interrompe a compilação: o primeiro de sintaxe ou, sem
+    // eles, o primeiro erro semântico.
+    const DiagnosticEntry *firstError() const {
+        if (const DiagnosticEntry *syntax = firstSyntaxError()) return syntax;
+        for (auto &d : diagnostics) {
+            if (d.severity == "error") return &d;
+        }
+        return nullptr;
+    }
+
+    // Registra o erro e deixa a análise seguir. Mais de uma ação pode checar
+    // o mesmo token: o erro repetido do último não entra de novo.
+    void addError(const string& message, int position = -1, int length = 1){
+        for (auto it = diagnostics.rbegin(); it != diagnostics.rend(); ++it) {
+            if (it->severity != "error") continue;
+            if (it->position == position && it->message == message) return;
+            break;
+        }
+        diagnostics.push_back({"error", message, position, length});
+    }
+
+    size_t scopeDepth() const { return scopeStarts.size(); }
+    size_t functionDepth() const { return openFunctions.size(); }
+
+    // Fecha escopos e funções abertos depois do ponto de recuperação
+    // (profundidades de scopeDepth e functionDepth).
+    void unwindTo(size_t scopeCount, size_t functionCount) {
+        while (scopeStarts.size() > max<size_t>(scopeCount, 1)) exitScope();
+        if (openFunctions.size() > functionCount) openFunctions.resize(functionCount);
+        discardPendingExpression();
+    }
+
     static string typeToStr(Types t);
     void printTable(std::ostream& os) const {
         os << "\n==== TABELA DE SÍMBOLOS ====\n";
@@ -284,16 +411,26 @@ public:
     }
 
 private:
-    vector<unordered_map<string,int>> scopes;
+    // Escopos sem um mapa cada: scopeSymbols lista os símbolos declarados
+    // nos escopos abertos, em ordem, e o escopo i começa em scopeStarts[i].
+    // Cada nome tem o id do Interner e, em visible[id], a pilha dos símbolos
+    // com esse nome nos escopos abertos, o mais interno no topo: a busca é um
+    // único hash, sem percorrer a cadeia de escopos. symbolNames[i] é o id
+    // do nome de symbolTable[i].
+    Interner *names;
+    vector<size_t> scopeStarts;
+    vector<int> scopeSymbols;
+    vector<vector<int>> visible;
+    vector<Interner::Id> symbolNames;
     vector<SymbolEntry> symbolTable;
     vector<DiagnosticEntry> diagnostics;
-    vector<string> openFunctions;
+    vector<Interner::Id> openFunctions;
     vector<int> functionScopeDepths;
     int pendingExpressionType = -1;
 
     void tratarNovaDeclaracao(const SymbolEntry &instrucao) {
         if (!instrucao.hasExplicitType) {
-            addError("Uso de identificador não declarado: '" + instrucao.name + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
+            addError("Uso de identificador não declarado: '" + string(instrucao.name) + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
             return;
         }
 
@@ -302,14 +439,16 @@ private:
         int novoIndice = lookupIndex(instrucao.name);
         if (novoIndice < 0) return;
 
-        if (pendingExpressionType >= 0) {
+        if (pendingExpressionType == POISONED || symbolTable[novoIndice].type == POISONED) {
+            symbolTable[novoIndice].initialized = true;
+        } else if (pendingExpressionType >= 0) {
             int resultado = atribType((int)symbolTable[novoIndice].type, pendingExpressionType);
             if (resultado == ERR) {
-                addError("Tipos incompatíveis na inicialização de '" + instrucao.name + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
+                addError("Tipos incompatíveis na inicialização de '" + string(instrucao.name) + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
             } else {
                 symbolTable[novoIndice].initialized = true;
                 if (resultado == WAR) {
-                    addWarning("Conversão implícita na inicialização de '" + instrucao.name + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
+                    addWarning("Conversão implícita na inicialização de '" + string(instrucao.name) + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
                 }
             }
         } else if (instrucao.initialized) {
@@ -321,7 +460,7 @@ private:
         auto &simbolo = symbolTable[indiceSimbolo];
         const bool tentativaAtribuicao = instrucao.initialized || pendingExpressionType >= 0;
         if (tentativaAtribuicao && simbolo.isConstant) {
-            addError("Não é permitido modificar constante: '" + instrucao.name + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
+            addError("Não é permitido modificar constante: '" + string(instrucao.name) + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
             return;
         }
 
@@ -329,20 +468,22 @@ private:
             simbolo.used = true;
         }
 
-        if (pendingExpressionType >= 0) {
+        if (pendingExpressionType == POISONED || (pendingExpressionType >= 0 && simbolo.type == POISONED)) {
+            simbolo.initialized = true;
+        } else if (pendingExpressionType >= 0) {
             int resultado = atribType((int)simbolo.type, pendingExpressionType);
             if (resultado == ERR) {
-                addError("Tipos incompatíveis na atribuição para '" + instrucao.name + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
+                addError("Tipos incompatíveis na atribuição para '" + string(instrucao.name) + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
             } else {
                 simbolo.initialized = true;
                 if (resultado == WAR) {
-                    addWarning("Possível perda de precisão na atribuição para '" + instrucao.name + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
+                    addWarning("Possível perda de precisão na atribuição para '" + string(instrucao.name) + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
                 }
             }
         } else if (instrucao.initialized) {
             simbolo.initialized = true;
         } else if (!simbolo.initialized && !simbolo.isFunction) {
-            addWarning("Possível uso sem inicialização: '" + instrucao.name + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
+            addWarning("Possível uso sem inicialização: '" + string(instrucao.name) + "'", instrucao.position, static_cast<int>(instrucao.name.size()));
         }
     }
 
@@ -350,18 +491,44 @@ private:
         pendingExpressionType = -1;
     }
 
-    int lookupIndex(const string &name) const {
-        for (int i=(int)scopes.size()-1; i>=0; --i) {
-            auto it = scopes[i].find(name);
-            if (it != scopes[i].end()) return it->second;
+    int lookupIndex(string_view name) const {
+        return lookupIndex(names->find(name));
+    }
+
+    int lookupIndex(Interner::Id id) const {
+        if (id >= visible.size() || visible[id].empty()) return -1;
+        return visible[id].back();
+    }
+
+    void markUse(int idx, string_view name, int position, int length, bool requireArray) {
+        if (idx < 0) {
+            addError("Uso de identificador não declarado: '" + string(name) + "'", position, length);
+            return;
+        }
+        if (!functionScopeDepths.empty()) {
+            int functionScopeDepth = functionScopeDepths.back();
+            const auto &sym = symbolTable[idx];
+            if (!sym.isFunction && sym.scope < functionScopeDepth && sym.scope != 0) {
+                addError("Identificador não declarado neste escopo: '" + string(name) + "'", position, length);
+                return;
+            }
+        }
+        if (requireArray && !symbolTable[idx].isArray && symbolTable[idx].type != POISONED) {
+            addError("Identificador não é um vetor: '" + string(name) + "'", position, length);
+            return;
+        }
+        symbolTable[idx].used = true;
+        if (!symbolTable[idx].initialized && !symbolTable[idx].isFunction) {
+            addWarning("Possível uso sem inicialização: '" + string(name) + "'", position, length);
         }
-        return -1;
     }
 
-    void addError(const string& message, int position = -1, int length = 1){
-        diagnostics.push_back({"error", message, position, length});
-        throw SemanticError(message, position, length);
+    Interner::Id nameId(string_view name) {
+        const Interner::Id id = names->intern(name);
+        if (id >= visible.size()) visible.resize(id + 1);
+        return id;
     }
+
     void addWarning(const string& message, int position = -1, int length = 1){
         diagnostics.push_back({"warning", message, position, length});
     }
@@ -374,6 +541,7 @@ string SemanticTable::typeToStr(Types t) {
         case STRING: return "string";
         case BOOLEAN: return "bool";
         case VOID: return "void";
+        case POISONED: return "?";
     }
     return "?";
 }
@@ -0,0 +1,100 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pool de threads com roubo de trabalho para lotes de tarefas independentes.
+// Cada worker recebe um bloco contíguo de índices e consome a própria fila
+// pelo fim; quando ela esvazia, rouba do início da fila de outro worker.
+// Assim arquivos grandes não deixam os demais núcleos parados.
+class WorkStealingPool
+{
+public:
+  explicit WorkStealingPool(unsigned workers)
+      : queues(workers == 0 ? 1 : workers)
+  {
+  }
+
+  unsigned workerCount() const { return static_cast<unsigned>(queues.size()); }
+
+  // Executa task(índice, worker) para cada índice em [0, count) e espera
+  // todas terminarem. task não pode lançar exceções.
+  void run(std::size_t count, const std::function<void(std::size_t, unsigned)> &task)
+  {
+    const std::size_t workers = queues.size();
+    for (std::size_t w = 0; w < workers; ++w)
+    {
+      const std::size_t begin = count * w / workers;
+      const std::size_t end = count * (w + 1) / workers;
+      queues[w].items.clear();
+      for (std::size_t i = begin; i < end; ++i)
+        queues[w].items.push_back(i);
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (std::size_t w = 1; w < workers; ++w)
+      threads.emplace_back([this, w, &task] { work(static_cast<unsigned>(w), task); });
+    work(0, task);
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  // Tarefas executadas fora do worker a que foram distribuídas.
+  std::size_t steals() const { return stolen.load(); }
+
+private:
+  struct Queue
+  {
+    std::mutex lock;
+    std::deque<std::size_t> items;
+  };
+
+  std::vector<Queue> queues;
+  std::atomic<std::size_t> stolen{0};
+
+  bool popOwn(unsigned worker, std::size_t &item)
+  {
+    Queue &queue = queues[worker];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.items.empty())
+      return false;
+    item = queue.items.back();
+    queue.items.pop_back();
+    return true;
+  }
+
+  bool steal(unsigned thief, std::size_t &item)
+  {
+    const std::size_t workers = queues.size();
+    for (std::size_t offset = 1; offset < workers; ++offset)
+    {
+      Queue &victim = queues[(thief + offset) % workers];
+      std::lock_guard<std::mutex> guard(victim.lock);
+      if (victim.items.empty())
+        continue;
+      item = victim.items.front();
+      victim.items.pop_front();
+      ++stolen;
+      return true;
+    }
+    return false;
+  }
+
+  // As tarefas não geram novas tarefas: se nenhuma fila tem trabalho,
+  // o lote acabou para este worker.
+  void work(unsigned worker, const std::function<void(std::size_t, unsigned)> &task)
+  {
+    std::size_t item = 0;
+    while (popOwn(worker, item) || steal(worker, item))
+      task(item, worker);
+  }
+};
+
+#endif
@@ -1,72 +1,212 @@
 #include "BipGenerator.h"
+#include "BipInstruction.h"
+#include "CompilationContext.h"
 
 #include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <memory>
-#include <sstream>
+#include <new>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <algorithm>
 #include <limits>
+#include <map>
 #include <stdio.h>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace
 {
-  // Reservamos temporários para expressões bem abaixo do limite de 1023 do BIP
-  // e longe dos registradores auxiliares 1000/1001/1002.
+  // Reservamos temporários para expressões bem abaixo do limite de 1023 do BIP.
+  // O programa principal usa 900–949 e as rotinas 950–999: uma chamada no
+  // meio de uma expressão não sobrescreve os temporários vivos de quem chama.
   constexpr const int TEMP_BASE_ADDRESS = 900;
+  constexpr const int TEMP_ROUTINE_BASE_ADDRESS = 950;
   constexpr const int TEMP_MAX_ADDRESS = 999;
-  constexpr const char *TEMP_VECTOR_INDEX = "1002";
-  constexpr const char *TEMP_VECTOR_VALUE = "1000";
-  constexpr const char *TEMP_VECTOR_VALUE_ALT = "1001";
   constexpr const std::size_t DEFAULT_ARRAY_LENGTH = 16;
 
+  // Instruções de um trecho do programa; só viram texto no fim de render().
+  using Code = std::vector<Bip::Instruction>;
+  constexpr Bip::Instruction STORE_INDEX = {Bip::Opcode::STO, Bip::Operand::Index, 0};
+
+  // Blocos de uma rotina (ou do programa principal) já na ordem de saída:
+  // chave (posição, não é rótulo), de modo que na mesma posição os rótulos
+  // vêm primeiro; o multimap mantém a ordem de registro entre chaves iguais.
+  using StatementKey = std::pair<std::size_t, bool>;
+  using StatementBucket = std::multimap<StatementKey, Code>;
+
   struct Entry
   {
-    std::string name;
+    Interner::Id name = Interner::NONE;
     bool isArray = false;
     std::size_t elementCount = 1;
     bool hasInitializer = false;
     std::vector<std::string> literalValues;
   };
 
-  std::vector<Entry> entries;
-  std::vector<std::pair<std::size_t, std::vector<std::string>>> statementInstructions;
-  std::string cachedCode;
   constexpr const char *OUTPUT_FILE = "output.bip";
-  static bool readStatementsScanned = false;
-  static bool controlFlowGenerated = false;
-  static std::size_t labelCounter = 1;
-  static std::unordered_set<std::string> functionsWithReturn;
+
+  // Memória dos nós de expressão de uma compilação: alocação é avançar um
+  // ponteiro, e os nós (trivialmente destrutíveis) nunca são liberados um a
+  // um. reset() só volta ao primeiro bloco; os blocos ficam para a próxima
+  // compilação no mesmo contexto.
+  class ExprArena
+  {
+  public:
+    template <class T>
+    T *make()
+    {
+      static_assert(std::is_trivially_destructible_v<T>, "a arena não chama destrutores");
+      return new (allocate(sizeof(T), alignof(T))) T();
+    }
+
+    template <class T>
+    T *makeArray(std::size_t count)
+    {
+      static_assert(std::is_trivially_destructible_v<T>, "a arena não chama destrutores");
+      return new (allocate(sizeof(T) * count, alignof(T))) T[count]();
+    }
+
+    std::string_view copy(std::string_view text)
+    {
+      if (text.empty())
+        return {};
+      char *data = static_cast<char *>(allocate(text.size(), 1));
+      std::memcpy(data, text.data(), text.size());
+      return std::string_view(data, text.size());
+    }
+
+    void reset()
+    {
+      current = 0;
+      used = 0;
+    }
+
+  private:
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Block
+    {
+      std::unique_ptr<char[]> data;
+      std::size_t size = 0;
+    };
+    std::vector<Block> blocks;
+    std::size_t current = 0;
+    std::size_t used = 0;
+
+    void *allocate(std::size_t size, std::size_t align)
+    {
+      for (; current < blocks.size(); ++current, used = 0)
+      {
+        const std::size_t start = (used + align - 1) & ~(align - 1);
+        if (start + size <= blocks[current].size)
+        {
+          used = start + size;
+          return blocks[current].data.get() + start;
+        }
+      }
+      const std::size_t blockSize = std::max(BLOCK_SIZE, size + align);
+      blocks.push_back({std::make_unique<char[]>(blockSize), blockSize});
+      used = 0;
+      return allocate(size, align);
+    }
+  };
+
+  // Tokens aceitos pelo Sintatico, na ordem do fonte. É a única visão da
+  // estrutura do programa usada pelo gerador: nada é reescaneado no texto.
+  struct SourceToken
+  {
+    TokenId id = EPSILON;
+    std::size_t position = 0;
+    std::size_t length = 0;
+    std::size_t match = std::string::npos; // índice do delimitador par
+    Interner::Id name = Interner::NONE;    // identificadores: o lexema internado
+  };
+
+  // Tokens [first, last) de sourceTokens: é assim que o gerador guarda
+  // condições, argumentos e expressões, sem copiar texto.
+  struct TokenRange
+  {
+    std::size_t first = 0;
+    std::size_t last = 0;
+
+    bool empty() const { return first >= last; }
+  };
+
+  // Instruções registradas pelas ações semânticas durante o parse; só
+  // viram código em render(), quando o esboço do programa está completo.
+  struct RecordedStatement
+  {
+    enum class Kind
+    {
+      Declaration,
+      Assignment,
+      Print
+    } kind = Kind::Declaration;
+    Semantico::Variable variable;
+    std::size_t position = 0;
+    std::size_t argumentOpen = 0; // "(" do print
+  };
+
+  struct ReadStatement
+  {
+    std::size_t position = 0;
+    TokenRange argument;
+  };
+
+  struct ReturnStatement
+  {
+    std::size_t position = 0;
+    TokenRange expression;
+  };
+
+  struct CallStatement
+  {
+    std::size_t position = 0;
+    TokenRange call;
+  };
+
+  // Nomes internados no Interner da compilação; function é NONE no escopo
+  // global.
   struct AliasEntry
   {
-    std::string original;
-    std::string alias;
-    std::string functionName;
+    Interner::Id original = Interner::NONE;
+    Interner::Id alias = Interner::NONE;
+    Interner::Id function = Interner::NONE;
     int scopeDepth = 0;
     int position = -1;
   };
-  std::vector<AliasEntry> aliasEntries;
-  std::unordered_map<std::string, int> aliasCounters;
-  std::unordered_set<std::string> seenPrints;
+  // Índice de aliases: (nome original, função) -> profundidade -> entradas
+  // na ordem de registro. positionOrdered indica se essa ordem coincide com
+  // a ordem no fonte, caso em que a busca por posição é binária.
+  struct AliasBucket
+  {
+    std::vector<std::size_t> entryIndices;
+    bool positionOrdered = true;
+  };
+  using AliasDepthBuckets = std::map<int, AliasBucket>;
   struct ParameterInfo
   {
-    std::string name;
+    Interner::Id name = Interner::NONE;
     Semantico::Type type = Semantico::Type::INT;
     bool isArray = false;
     std::size_t position = 0;
-    std::string alias;
   };
 
   struct FunctionInfo
   {
-    std::string name;
-    std::string lowerName;
-    std::string label;
+    Interner::Id name = Interner::NONE; // como escrito no fonte
+    Interner::Id id = Interner::NONE;   // em minúsculas: identifica a rotina
+    Interner::Id label = Interner::NONE;
     Semantico::Type returnType = Semantico::Type::VOID;
     std::size_t headerStart = 0;
     std::size_t bodyStart = 0;
@@ -74,10 +214,116 @@ namespace
     std::vector<ParameterInfo> params;
   };
 
+  // Índice de escopo montado uma única vez a partir dos tokens: cada chave
+  // vira um evento com a profundidade resultante, e os cabeçalhos de for
+  // viram intervalos disjuntos. As consultas são buscas binárias.
+  struct BraceEvent
+  {
+    std::size_t position = 0;
+    int depthAfter = 0;
+  };
+
+  struct ForHeaderInfo
+  {
+    TokenRange condition;
+    TokenRange update;
+    std::size_t condStart = 0;
+    std::size_t condEnd = 0;
+    std::size_t updateStart = 0;
+    std::size_t updateEnd = 0;
+  };
+
+  // Nó de controle de fluxo extraído dos tokens; índices já resolvidos para
+  // posições no fonte, de modo que a geração só percorre a árvore.
+  struct FlowNode
+  {
+    enum class Kind
+    {
+      If,
+      While,
+      DoWhile,
+      For
+    } kind = Kind::If;
+    std::size_t keywordPos = 0;
+    TokenRange condition;
+    std::size_t condOpen = 0;
+    std::size_t bodyOpen = 0;
+    std::size_t bodyClose = 0;
+    bool hasElse = false;
+    std::size_t elseOpen = 0;
+    std::size_t elseClose = 0;
+    bool hasTrailingCondition = false;
+    std::size_t trailingKeywordPos = 0;
+    ForHeaderInfo header;
+    std::vector<FlowNode> body;
+    std::vector<FlowNode> elseBody;
+  };
+}
+
+// Estado do gerador para uma compilação; vive no CompilationContext.
+// reset() só limpa os vetores, então a memória é reaproveitada entre
+// compilações no mesmo contexto. As rotinas internas o recebem por
+// parâmetro.
+struct BipState
+{
+  explicit BipState(Interner &names) : names(names) {}
+
+  Interner &names; // o do contexto dono
+  std::string_view source; // fonte do render() em curso
+  std::vector<Entry> entries;
+  std::unordered_set<Interner::Id> entryNames;
+  // Um balde por rotina, no índice dela em functions, e o do programa
+  // principal por último.
+  std::vector<StatementBucket> statementBuckets;
+  std::string cachedCode;
+  BipPeephole::Options peephole; // configuração: reset() não mexe
+  BipPeephole::Stats peepholeStats;
+  bool controlFlowGenerated = false;
+  std::vector<SourceToken> sourceTokens;
+  std::vector<std::size_t> openDelimiters;
+  std::vector<RecordedStatement> recordedStatements;
+  bool recordedStatementsGenerated = false;
+  std::vector<ReadStatement> readStatements;
+  std::vector<ReturnStatement> returnStatements;
+  std::vector<CallStatement> callStatements;
+  std::size_t labelCounter = 1;
+  std::unordered_set<Interner::Id> functionsWithReturn; // ids das rotinas
+  std::vector<AliasEntry> aliasEntries;
+  std::unordered_map<std::uint64_t, AliasDepthBuckets> aliasIndex;
+  std::unordered_map<Interner::Id, int> aliasCounters;
+  std::unordered_set<std::size_t> seenPrints; // argumentOpen dos prints gerados
   std::vector<FunctionInfo> functions;
-  static bool functionsParsed = false;
-  static bool parametersRegistered = false;
-  std::unordered_map<std::string, std::string> parameterAliasMap;
+  std::vector<std::size_t> outerFunctions; // índices das rotinas fora de outra, na ordem do fonte
+  bool functionsParsed = false;
+  bool parametersRegistered = false;
+  std::unordered_map<std::uint64_t, Interner::Id> parameterAliasMap;
+  // Nome usado numa chamada -> índice da rotina em functions (npos se não há).
+  std::unordered_map<Interner::Id, std::size_t> functionsByName;
+  std::vector<BraceEvent> braceEvents;
+  std::vector<std::pair<std::size_t, std::size_t>> forHeaderRanges;
+  bool scopeIndexBuilt = false;
+  std::vector<FlowNode> flowNodes;
+  ExprArena exprArena;
+};
+
+void BipStateDeleter::operator()(BipState *state) const
+{
+  delete state;
+}
+
+std::unique_ptr<BipState, BipStateDeleter> createBipState(Interner &names)
+{
+  return std::unique_ptr<BipState, BipStateDeleter>(new BipState(names));
+}
+
+namespace
+{
+  // Chave dos índices por (nome, função) sem montar strings.
+  std::uint64_t nameKey(Interner::Id name, Interner::Id function)
+  {
+    return (static_cast<std::uint64_t>(name) << 32) | function;
+  }
+
 
   std::string toLower(std::string text)
   {
@@ -91,23 +337,11 @@ namespace
     return text;
   }
 
-  void ensureFunctionsParsed();
-  void ensureParametersRegistered();
-  std::vector<std::string> splitTopLevel(const std::string &source, char separator);
-
-  std::string trim(const std::string &text)
-  {
-    std::size_t start = 0;
-    while (start < text.size() && std::isspace(static_cast<unsigned char>(text[start])))
-      ++start;
-    std::size_t end = text.size();
-    while (end > start && std::isspace(static_cast<unsigned char>(text[end - 1])))
-      --end;
-    return text.substr(start, end - start);
-  }
+  void ensureFunctionsParsed(BipState &state);
+  void ensureParametersRegistered(BipState &state);
 
   // Converte binário para decimal
-  int binaryToDecimal(const std::string &binary)
+  int binaryToDecimal(std::string_view binary)
   {
     int decimal = 0;
     for (char c : binary)
@@ -121,7 +355,7 @@ namespace
   }
 
   // Verifica se string é um número binário
-  bool isBinaryLiteral(const std::string &str)
+  bool isBinaryLiteral(std::string_view str)
   {
     if (str.size() < 3)
       return false;
@@ -136,131 +370,14 @@ namespace
     return true;
   }
 
-  // Converte literal (pode ser binário) para decimal
-  std::string convertLiteralToDecimal(const std::string &literal)
+  // Instrução com um literal (pode ser binário) como operando
+  Bip::Instruction literalOperand(BipState &state, Bip::Opcode opcode, std::string_view literal)
   {
     if (isBinaryLiteral(literal))
     {
-      return std::to_string(binaryToDecimal(literal.substr(2)));
-    }
-    return literal;
-  }
-
-  std::size_t findMatchingParenthesis(const std::string &src, std::size_t openPos)
-  {
-    int depth = 0;
-    for (std::size_t idx = openPos; idx < src.size(); ++idx)
-    {
-      char c = src[idx];
-      if (c == '(')
-      {
-        ++depth;
-      }
-      else if (c == ')')
-      {
-        --depth;
-        if (depth == 0)
-        {
-          return idx;
-        }
-      }
-    }
-    return std::string::npos;
-  }
-
-  std::size_t skipWhitespaceAndComments(const std::string &src, std::size_t pos)
-  {
-    const std::size_t len = src.size();
-    while (pos < len)
-    {
-      char c = src[pos];
-      if (std::isspace(static_cast<unsigned char>(c)))
-      {
-        ++pos;
-        continue;
-      }
-      if (c == '/' && pos + 1 < len)
-      {
-        char next = src[pos + 1];
-        if (next == '/')
-        {
-          pos += 2;
-          while (pos < len && src[pos] != '\n')
-            ++pos;
-          continue;
-        }
-        if (next == '*')
-        {
-          pos += 2;
-          while (pos + 1 < len && !(src[pos] == '*' && src[pos + 1] == '/'))
-            ++pos;
-          if (pos + 1 < len)
-            pos += 2;
-          continue;
-        }
-      }
-      break;
-    }
-    return pos;
-  }
-
-  std::size_t findMatchingBrace(const std::string &src, std::size_t openPos)
-  {
-    if (openPos >= src.size() || src[openPos] != '{')
-      return std::string::npos;
-    int depth = 0;
-    const std::size_t len = src.size();
-    for (std::size_t idx = openPos; idx < len; ++idx)
-    {
-      char c = src[idx];
-      if (c == '"' || c == '\'')
-      {
-        const char delim = c;
-        ++idx;
-        while (idx < len)
-        {
-          if (src[idx] == '\\' && idx + 1 < len)
-          {
-            idx += 2;
-            continue;
-          }
-          if (src[idx] == delim)
-            break;
-          ++idx;
-        }
-        continue;
-      }
-      if (c == '/' && idx + 1 < len)
-      {
-        if (src[idx + 1] == '/')
-        {
-          idx += 2;
-          while (idx < len && src[idx] != '\n')
-            ++idx;
-          continue;
-        }
-        if (src[idx + 1] == '*')
-        {
-          idx += 2;
-          while (idx + 1 < len && !(src[idx] == '*' && src[idx + 1] == '/'))
-            ++idx;
-          continue;
-        }
-      }
-      if (c == '{')
-      {
-        ++depth;
-      }
-      else if (c == '}')
-      {
-        --depth;
-        if (depth == 0)
-        {
-          return idx;
-        }
-      }
+      return Bip::immediate(opcode, binaryToDecimal(literal.substr(2)));
     }
-    return std::string::npos;
+    return Bip::literal(opcode, literal, state.names);
   }
 
   Semantico::Type parseTypeName(const std::string &typeToken)
@@ -279,409 +396,351 @@ namespace
     return Semantico::Type::NULLABLE;
   }
 
-  bool isKeywordAt(const std::string &src, std::size_t pos, const std::string &keyword)
+  bool isOpeningDelimiter(TokenId id)
   {
-    const std::size_t len = src.size();
-    if (pos + keyword.size() > len)
-      return false;
-    if (src.compare(pos, keyword.size(), keyword) != 0)
-      return false;
-    auto isIdentChar = [](char ch) { return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_'; };
-    if (pos > 0 && isIdentChar(src[pos - 1]))
-      return false;
-    const std::size_t after = pos + keyword.size();
-    if (after < len && isIdentChar(src[after]))
-      return false;
-    return true;
+    return id == t_KEY_LPAREN || id == t_KEY_LBRACKET || id == t_KEY_LBRACE;
   }
 
-  bool isIdentifierStart(char c)
+  bool isClosingDelimiter(TokenId id)
   {
-    return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+    return id == t_KEY_RPAREN || id == t_KEY_RBRACKET || id == t_KEY_RBRACE;
   }
 
-  bool isIdentifierChar(char c)
+  bool matchesDelimiter(TokenId opening, TokenId closing)
   {
-    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    return (opening == t_KEY_LPAREN && closing == t_KEY_RPAREN) ||
+           (opening == t_KEY_LBRACKET && closing == t_KEY_RBRACKET) ||
+           (opening == t_KEY_LBRACE && closing == t_KEY_RBRACE);
   }
 
-  std::string mangleName(const std::string &name, const std::string &functionName)
+  bool isCommentToken(TokenId id)
   {
-    if (functionName.empty())
-    {
-      return name;
-    }
-    return toLower(functionName) + "_" + name;
+    return id == t_KEY_COMMENT_LINE || id == t_KEY_COMMENT_MULT_LINE;
   }
 
-  const FunctionInfo *findFunction(const std::string &name)
+  std::size_t tokenEnd(BipState &state, std::size_t idx)
   {
-    ensureFunctionsParsed();
-    const std::string lowered = toLower(name);
-    for (const auto &fn : functions)
-    {
-      if (fn.lowerName == lowered)
-        return &fn;
-    }
-    return nullptr;
+    return state.sourceTokens[idx].position + state.sourceTokens[idx].length;
   }
 
-  std::string functionLabel(const std::string &name)
+  std::string_view tokenView(BipState &state, std::size_t idx)
   {
-    return "_" + toUpper(name);
+    return state.source.substr(state.sourceTokens[idx].position, state.sourceTokens[idx].length);
   }
 
-  std::string functionForPosition(std::size_t pos)
+  std::string tokenText(BipState &state, std::size_t idx)
   {
-    ensureFunctionsParsed();
-    for (const auto &fn : functions)
-    {
-      if (pos >= fn.bodyStart && pos <= fn.bodyEnd)
-      {
-        return fn.lowerName;
-      }
-    }
-    return "";
+    return std::string(tokenView(state, idx));
   }
 
-  FunctionInfo parseFunctionAt(std::size_t keywordPos)
+  // Primeiro token com posição >= position.
+  std::size_t tokenIndexAt(BipState &state, std::size_t position)
   {
-    FunctionInfo fn;
-    const std::string &src = Semantico::sourceCode;
-    const std::size_t len = src.size();
-    const std::size_t afterKeyword = skipWhitespaceAndComments(src, keywordPos + 8); // "function"
-    std::size_t nameStart = afterKeyword;
-    while (nameStart < len && std::isspace(static_cast<unsigned char>(src[nameStart])))
-      ++nameStart;
-    if (nameStart >= len || !isIdentifierStart(src[nameStart]))
-      return fn;
-    std::size_t nameEnd = nameStart + 1;
-    while (nameEnd < len && isIdentifierChar(src[nameEnd]))
-      ++nameEnd;
-    fn.name = src.substr(nameStart, nameEnd - nameStart);
-    fn.lowerName = toLower(fn.name);
-    fn.label = functionLabel(fn.name);
-    fn.headerStart = keywordPos;
+    auto it = std::lower_bound(state.sourceTokens.begin(), state.sourceTokens.end(), position, [](const SourceToken &token, std::size_t pos) {
+      return token.position < pos;
+    });
+    return static_cast<std::size_t>(it - state.sourceTokens.begin());
+  }
+
+  // Pula comentários; espaços nunca chegam à lista de tokens.
+  std::size_t nextCodeToken(BipState &state, std::size_t idx)
+  {
+    while (idx < state.sourceTokens.size() && isCommentToken(state.sourceTokens[idx].id))
+      ++idx;
+    return idx;
+  }
+
+  std::size_t matchingToken(BipState &state, std::size_t idx, TokenId opening)
+  {
+    if (idx >= state.sourceTokens.size() || state.sourceTokens[idx].id != opening)
+      return std::string::npos;
+    return state.sourceTokens[idx].match;
+  }
+
+  // O texto dos nomes só é montado aqui, para formar nomes novos.
+  std::string mangledText(BipState &state, Interner::Id name, const FunctionInfo *fn)
+  {
+    std::string text;
+    if (fn)
+      text.append(state.names.text(fn->id)).append("_");
+    return text.append(state.names.text(name));
+  }
 
-    std::size_t parenOpen = skipWhitespaceAndComments(src, nameEnd);
-    if (parenOpen >= len || src[parenOpen] != '(')
-      return fn;
-    std::size_t parenClose = findMatchingParenthesis(src, parenOpen);
-    if (parenClose == std::string::npos)
-      return fn;
+  Interner::Id mangleName(BipState &state, Interner::Id name, const FunctionInfo *fn)
+  {
+    return fn ? state.names.intern(mangledText(state, name, fn)) : name;
+  }
 
-    const std::string paramsText = trim(src.substr(parenOpen + 1, parenClose - parenOpen - 1));
-    if (!paramsText.empty())
+  // Rotinas não diferenciam maiúsculas: o nome em minúsculas é procurado uma
+  // vez por id escrito, e o resultado fica em functionsByName.
+  const FunctionInfo *findFunction(BipState &state, Interner::Id name)
+  {
+    ensureFunctionsParsed(state);
+    auto &functions = state.functions;
+    auto [it, inserted] = state.functionsByName.try_emplace(name, std::string::npos);
+    if (inserted)
     {
-      auto parts = splitTopLevel(paramsText, ',');
-      std::size_t searchBase = parenOpen + 1;
-      for (const auto &part : parts)
+      const Interner::Id lowered = state.names.find(toLower(std::string(state.names.text(name))));
+      for (std::size_t idx = 0; idx < functions.size(); ++idx)
       {
-        const std::string trimmed = trim(part);
-        if (trimmed.empty())
-          continue;
-        std::size_t colonPos = trimmed.find(':');
-        std::string paramName = trimmed;
-        std::string typePart;
-        if (colonPos != std::string::npos)
-        {
-          paramName = trim(trimmed.substr(0, colonPos));
-          typePart = trim(trimmed.substr(colonPos + 1));
-        }
-        if (paramName.empty())
-          continue;
-        ParameterInfo param;
-        param.name = paramName;
-        bool hasArraySuffix = !typePart.empty() && typePart.size() >= 2 && typePart.substr(typePart.size() - 2) == "[]";
-        if (hasArraySuffix)
-        {
-          typePart = trim(typePart.substr(0, typePart.size() - 2));
-        }
-        param.type = typePart.empty() ? Semantico::Type::INT : parseTypeName(typePart);
-        param.isArray = hasArraySuffix;
-        std::size_t foundPos = src.find(paramName, searchBase);
-        if (foundPos != std::string::npos && foundPos < parenClose)
+        if (functions[idx].id == lowered)
         {
-          param.position = foundPos;
+          it->second = idx;
+          break;
         }
-        fn.params.push_back(param);
       }
     }
+    return it->second == std::string::npos ? nullptr : &functions[it->second];
+  }
 
-    std::size_t afterParams = skipWhitespaceAndComments(src, parenClose + 1);
-    if (afterParams < len && src[afterParams] == ':')
-    {
-      std::size_t typeStart = skipWhitespaceAndComments(src, afterParams + 1);
-      std::size_t typeEnd = typeStart;
-      while (typeEnd < len && (isIdentifierChar(src[typeEnd]) || src[typeEnd] == '[' || src[typeEnd] == ']'))
-        ++typeEnd;
-      const std::string typeToken = trim(src.substr(typeStart, typeEnd - typeStart));
-      fn.returnType = parseTypeName(typeToken);
-      afterParams = typeEnd;
-    }
-    else
-    {
-      fn.returnType = Semantico::Type::VOID;
-    }
-
-    fn.bodyStart = skipWhitespaceAndComments(src, afterParams);
-    if (fn.bodyStart >= len || src[fn.bodyStart] != '{')
-      return fn;
-    fn.bodyEnd = findMatchingBrace(src, fn.bodyStart);
-    return fn;
+  Interner::Id functionLabel(BipState &state, Interner::Id name)
+  {
+    return state.names.intern("_" + toUpper(std::string(state.names.text(name))));
   }
 
-  void ensureFunctionsParsed()
+  // Primeira rotina (na ordem do fonte) cujo corpo contém pos. Os corpos
+  // são pares de chaves, então ou se aninham ou são disjuntos: a primeira
+  // que contém pos é a mais externa, achada por busca binária.
+  const FunctionInfo *functionAt(BipState &state, std::size_t pos)
   {
-    if (functionsParsed)
-      return;
-    functionsParsed = true;
-    functions.clear();
-    const std::string &src = Semantico::sourceCode;
-    const std::size_t len = src.size();
-    for (std::size_t i = 0; i + 8 < len; ++i)
-    {
-      if (!isKeywordAt(src, i, "function"))
-        continue;
-      FunctionInfo fn = parseFunctionAt(i);
-      if (!fn.name.empty() && fn.bodyEnd != std::string::npos)
-      {
-        functions.push_back(std::move(fn));
-      }
-    }
+    ensureFunctionsParsed(state);
+    const auto &functions = state.functions;
+    const auto &outer = state.outerFunctions;
+    auto it = std::upper_bound(outer.begin(), outer.end(), pos, [&functions](std::size_t position, std::size_t index) {
+      return position < functions[index].bodyStart;
+    });
+    if (it == outer.begin())
+      return nullptr;
+    const FunctionInfo &fn = functions[*std::prev(it)];
+    return pos <= fn.bodyEnd ? &fn : nullptr;
   }
 
-  std::string nextLabel()
+  // R1, R2, ... internados sem montar std::string.
+  Interner::Id nextLabel(BipState &state)
   {
-    return "R" + std::to_string(labelCounter++);
+    char label[24] = "R";
+    const auto end = std::to_chars(label + 1, label + sizeof label, state.labelCounter++).ptr;
+    return state.names.intern(std::string_view(label, static_cast<std::size_t>(end - label)));
   }
 
-  int scopeDepthAt(std::size_t position)
+
+  void ensureScopeIndex(BipState &state)
   {
-    const std::string &src = Semantico::sourceCode;
-    const std::size_t len = std::min(position, src.size());
-    int depth = 0;
-    bool inString = false;
-    char stringDelim = 0;
-    bool inLineComment = false;
-    bool inBlockComment = false;
+    if (state.scopeIndexBuilt)
+      return;
+    state.scopeIndexBuilt = true;
+    state.braceEvents.clear();
+    state.forHeaderRanges.clear();
 
-    for (std::size_t i = 0; i < len; ++i)
+    int depth = 0;
+    for (std::size_t idx = 0; idx < state.sourceTokens.size(); ++idx)
     {
-      char c = src[i];
-      if (inString)
-      {
-        if (c == '\\' && i + 1 < len)
-        {
-          ++i;
-          continue;
-        }
-        if (c == stringDelim)
-        {
-          inString = false;
-        }
-        continue;
-      }
-      if (inLineComment)
+      const SourceToken &token = state.sourceTokens[idx];
+      if (token.id == t_KEY_LBRACE)
       {
-        if (c == '\n')
-          inLineComment = false;
-        continue;
+        state.braceEvents.push_back({token.position, ++depth});
       }
-      if (inBlockComment)
+      else if (token.id == t_KEY_RBRACE)
       {
-        if (c == '*' && i + 1 < len && src[i + 1] == '/')
-        {
-          inBlockComment = false;
-          ++i;
-        }
-        continue;
+        depth = std::max(0, depth - 1);
+        state.braceEvents.push_back({token.position, depth});
       }
-      if (c == '/' && i + 1 < len)
+      else if (token.id == t_KEY_FOR)
       {
-        if (src[i + 1] == '/')
-        {
-          inLineComment = true;
-          ++i;
-          continue;
-        }
-        if (src[i + 1] == '*')
+        const std::size_t parenOpen = nextCodeToken(state, idx + 1);
+        const std::size_t parenClose = matchingToken(state, parenOpen, t_KEY_LPAREN);
+        if (parenClose != std::string::npos)
         {
-          inBlockComment = true;
-          ++i;
-          continue;
+          state.forHeaderRanges.emplace_back(state.sourceTokens[parenOpen].position, state.sourceTokens[parenClose].position);
         }
       }
-      if (c == '"' || c == '\'')
-      {
-        inString = true;
-        stringDelim = c;
-        continue;
-      }
-      if (c == '{')
-        ++depth;
-      else if (c == '}')
-        depth = std::max(0, depth - 1);
     }
-    return depth;
   }
 
-  bool isInsideForHeader(std::size_t position)
+  int scopeDepthAt(BipState &state, std::size_t position)
+  {
+    ensureScopeIndex(state);
+    // último evento estritamente antes da posição
+    auto it = std::lower_bound(state.braceEvents.begin(), state.braceEvents.end(), position, [](const BraceEvent &event, std::size_t pos) {
+      return event.position < pos;
+    });
+    if (it == state.braceEvents.begin())
+      return 0;
+    return std::prev(it)->depthAfter;
+  }
+
+  bool isInsideForHeader(BipState &state, std::size_t position)
   {
-    const std::string &src = Semantico::sourceCode;
-    if (position >= src.size())
+    ensureScopeIndex(state);
+    auto it = std::lower_bound(state.forHeaderRanges.begin(), state.forHeaderRanges.end(), position, [](const std::pair<std::size_t, std::size_t> &range, std::size_t pos) {
+      return range.first < pos;
+    });
+    if (it == state.forHeaderRanges.begin())
       return false;
-    // procura um "for" antes da posição
-    std::size_t searchPos = position;
-    while (searchPos > 0)
+    --it;
+    return position > it->first && position < it->second;
+  }
+
+  int depthForPosition(BipState &state, std::size_t position)
+  {
+    int depth = scopeDepthAt(state, position);
+    if (isInsideForHeader(state, position))
     {
-      --searchPos;
-      if (!std::isspace(static_cast<unsigned char>(src[searchPos])))
-        break;
+      depth += 1;
     }
+    return depth;
+  }
 
-    for (std::size_t i = searchPos + 1; i > 0; --i)
-    {
-      std::size_t idx = i - 1;
-      if (src[idx] != 'f')
-        continue;
-      if (idx + 3 > src.size())
-        continue;
-      if (!isKeywordAt(src, idx, "for"))
-        continue;
-      std::size_t parenPos = skipWhitespaceAndComments(src, idx + 3);
-      if (parenPos >= src.size() || src[parenPos] != '(')
-        continue;
-      std::size_t parenClose = findMatchingParenthesis(src, parenPos);
-      if (parenClose == std::string::npos)
-        continue;
-      if (position > parenPos && position < parenClose)
-        return true;
-      if (position <= idx)
-        break;
-    }
-    return false;
-  }
-
-  int depthForPosition(std::size_t position)
+  void addAliasEntry(BipState &state, AliasEntry entry)
   {
-    int depth = scopeDepthAt(position);
-    if (isInsideForHeader(position))
-    {
-      depth += 1;
-    }
-    return depth;
+    const std::size_t index = state.aliasEntries.size();
+    AliasBucket &bucket = state.aliasIndex[nameKey(entry.original, entry.function)][entry.scopeDepth];
+    if (!bucket.entryIndices.empty() && state.aliasEntries[bucket.entryIndices.back()].position > entry.position)
+      bucket.positionOrdered = false;
+    bucket.entryIndices.push_back(index);
+    state.aliasEntries.push_back(std::move(entry));
   }
 
-  std::string makeAlias(const std::string &name, const std::string &functionName, int scopeDepth)
+  Interner::Id makeAlias(BipState &state, Interner::Id name, const FunctionInfo *fn, int scopeDepth)
   {
-    std::string base = mangleName(name, functionName);
-    if (scopeDepth > 0)
+    // global fora de blocos, o caso comum, não monta texto
+    std::string base;
+    Interner::Id baseId = name;
+    if (fn || scopeDepth > 0)
     {
-      base += "_s" + std::to_string(scopeDepth);
+      base = mangledText(state, name, fn);
+      if (scopeDepth > 0)
+      {
+        base += "_s" + std::to_string(scopeDepth);
+      }
+      baseId = state.names.intern(base);
     }
-    int count = ++aliasCounters[base];
+    int count = ++state.aliasCounters[baseId];
     if (count == 1)
-      return base;
-    return base + "_" + std::to_string(count);
+      return baseId;
+    if (base.empty())
+      base = state.names.text(name);
+    return state.names.intern(base + "_" + std::to_string(count));
   }
 
-  std::string registerAlias(const std::string &name, int position)
+  Interner::Id registerAlias(BipState &state, Interner::Id name, int position)
   {
-    ensureFunctionsParsed();
-    int depth = depthForPosition(static_cast<std::size_t>(std::max(0, position)));
-    const std::string func = functionForPosition(static_cast<std::size_t>(std::max(0, position)));
-    std::string alias = makeAlias(name, func, depth);
-    aliasEntries.push_back({name, alias, func, depth, position});
+    ensureFunctionsParsed(state);
+    int depth = depthForPosition(state, static_cast<std::size_t>(std::max(0, position)));
+    const FunctionInfo *fn = functionAt(state, static_cast<std::size_t>(std::max(0, position)));
+    const Interner::Id alias = makeAlias(state, name, fn, depth);
+    addAliasEntry(state, {name, alias, fn ? fn->id : Interner::NONE, depth, position});
     return alias;
   }
 
-  std::string resolveAlias(const std::string &name, std::size_t refPos)
+  // Mesma regra da antiga varredura linear: vence a maior profundidade que
+  // não excede a da referência; nela, a última entrada registrada cuja
+  // posição não ultrapassa a referência, ou a primeira, se nenhuma servir.
+  const AliasEntry *findAliasIn(BipState &state, const AliasDepthBuckets &buckets, int refDepth, int refPos)
+  {
+    auto it = buckets.upper_bound(refDepth);
+    if (it == buckets.begin())
+      return nullptr;
+    const AliasBucket &bucket = std::prev(it)->second;
+    const auto &indices = bucket.entryIndices;
+    if (bucket.positionOrdered)
+    {
+      auto last = std::upper_bound(indices.begin(), indices.end(), refPos, [&state](int pos, std::size_t index) {
+        return pos < state.aliasEntries[index].position;
+      });
+      return &state.aliasEntries[last == indices.begin() ? indices.front() : *std::prev(last)];
+    }
+    std::size_t chosen = indices.front();
+    for (std::size_t index : indices)
+    {
+      if (state.aliasEntries[index].position <= refPos)
+        chosen = index;
+    }
+    return &state.aliasEntries[chosen];
+  }
+
+  Interner::Id resolveAlias(BipState &state, Interner::Id name, std::size_t refPos)
   {
-    ensureFunctionsParsed();
-    ensureParametersRegistered();
-    const std::string func = functionForPosition(refPos);
-    int refDepth = depthForPosition(refPos);
+    ensureFunctionsParsed(state);
+    ensureParametersRegistered(state);
+    const FunctionInfo *fn = functionAt(state, refPos);
+    int refDepth = depthForPosition(state, refPos);
     const AliasEntry *best = nullptr;
-    const AliasEntry *global = nullptr;
-    for (const auto &entry : aliasEntries)
+    const auto &index = state.aliasIndex;
+    auto byFunction = index.find(nameKey(name, fn ? fn->id : Interner::NONE));
+    if (byFunction != index.end())
+      best = findAliasIn(state, byFunction->second, refDepth, static_cast<int>(refPos));
+    if (!best && fn)
     {
-      if (entry.original != name)
-        continue;
-      if (entry.scopeDepth > refDepth)
-        continue;
-      if (entry.functionName == func)
-      {
-        if (!best || entry.scopeDepth > best->scopeDepth ||
-            (entry.scopeDepth == best->scopeDepth && entry.position <= static_cast<int>(refPos)))
-        {
-          best = &entry;
-        }
-      }
-      else if (entry.functionName.empty())
-      {
-        if (!global || entry.scopeDepth > global->scopeDepth ||
-            (entry.scopeDepth == global->scopeDepth && entry.position <= static_cast<int>(refPos)))
-        {
-          global = &entry;
-        }
-      }
+      auto byGlobal = index.find(nameKey(name, Interner::NONE));
+      if (byGlobal != index.end())
+        best = findAliasIn(state, byGlobal->second, refDepth, static_cast<int>(refPos));
     }
     if (best)
       return best->alias;
-    if (global)
-      return global->alias;
-    if (!func.empty())
-      return mangleName(name, func);
-    return name;
+    return mangleName(state, name, fn);
   }
 
-  bool hasEntry(const std::string &alias)
+  // Registra a entrada da seção .data; false se o nome já tinha uma.
+  bool addEntry(BipState &state, Entry entry)
   {
-    return std::any_of(entries.begin(), entries.end(), [&](const Entry &e)
-                       { return e.name == alias; });
+    if (!state.entryNames.insert(entry.name).second)
+      return false;
+    state.entries.push_back(std::move(entry));
+    return true;
   }
 
-  void ensureParametersRegistered()
+  void ensureParametersRegistered(BipState &state)
   {
-    if (parametersRegistered)
+    if (state.parametersRegistered)
       return;
-    ensureFunctionsParsed();
-    parametersRegistered = true;
-    for (auto &fn : functions)
+    ensureFunctionsParsed(state);
+    state.parametersRegistered = true;
+    for (auto &fn : state.functions)
     {
       int paramDepth = 1;
-      for (auto &param : fn.params)
+      for (const auto &param : fn.params)
       {
-        const std::string alias = makeAlias(param.name, fn.lowerName, 0);
-        param.alias = alias;
-        parameterAliasMap[fn.lowerName + ":" + param.name] = alias;
-        aliasEntries.push_back({param.name, alias, fn.lowerName, paramDepth, static_cast<int>(param.position)});
-        if (!hasEntry(alias))
-        {
-          Entry entry;
-          entry.name = alias;
-          entry.isArray = param.isArray;
-          entry.elementCount = entry.isArray ? DEFAULT_ARRAY_LENGTH : 1;
-          entry.hasInitializer = false;
-          entries.push_back(std::move(entry));
-        }
+        const Interner::Id alias = makeAlias(state, param.name, &fn, 0);
+        state.parameterAliasMap[nameKey(param.name, fn.id)] = alias;
+        addAliasEntry(state, {param.name, alias, fn.id, paramDepth, static_cast<int>(param.position)});
+        Entry entry;
+        entry.name = alias;
+        entry.isArray = param.isArray;
+        entry.elementCount = entry.isArray ? DEFAULT_ARRAY_LENGTH : 1;
+        entry.hasInitializer = false;
+        addEntry(state, std::move(entry));
       }
     }
   }
 
-  std::string parameterAlias(const std::string &functionName, const std::string &paramName)
+  Interner::Id parameterAlias(BipState &state, const FunctionInfo &fn, std::size_t idx)
   {
-    ensureParametersRegistered();
-    const std::string key = toLower(functionName) + ":" + paramName;
-    auto it = parameterAliasMap.find(key);
-    if (it != parameterAliasMap.end())
+    ensureParametersRegistered(state);
+    const Interner::Id param = fn.params[idx].name;
+    auto it = state.parameterAliasMap.find(nameKey(param, fn.id));
+    if (it != state.parameterAliasMap.end())
       return it->second;
-    return mangleName(paramName, functionName);
+    return mangleName(state, param, &fn);
   }
 
+  // Nós e textos vivem na exprArena da compilação (até o próximo
+  // render): value e op são visões do texto copiado para a arena. Nomes
+  // (variável, vetor, rotina chamada) vão em name, já internados.
   struct Expr;
-  using ExprPtr = std::unique_ptr<Expr>;
+  using ExprPtr = const Expr *;
+
+  struct ExprList
+  {
+    const ExprPtr *items = nullptr;
+    std::size_t count = 0;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const ExprPtr *begin() const { return items; }
+    const ExprPtr *end() const { return items + count; }
+    ExprPtr operator[](std::size_t idx) const { return items[idx]; }
+  };
 
   struct Expr
   {
@@ -692,332 +751,263 @@ namespace
       ArrayAccess,
       Binary,
       Call
-    } kind;
-    std::string value;
-    std::string op; // Mudado de char para string para suportar operadores de 2 caracteres
-    ExprPtr left;
-    ExprPtr right;
-    ExprPtr index;
-    std::vector<ExprPtr> args;
-
-    static ExprPtr makeLiteral(std::string literal)
-    {
-      auto node = std::make_unique<Expr>();
+    } kind = Kind::Literal;
+    std::string_view value; // literais
+    Interner::Id name = Interner::NONE;
+    std::string_view op; // operadores de 1 ou 2 caracteres
+    ExprPtr left = nullptr;
+    ExprPtr right = nullptr;
+    ExprPtr index = nullptr;
+    ExprList args;
+
+    static ExprPtr makeLiteral(BipState &state, std::string_view literal)
+    {
+      Expr *node = state.exprArena.make<Expr>();
       node->kind = Kind::Literal;
       // Converte binário para decimal se necessário
-      node->value = convertLiteralToDecimal(literal);
+      node->value = isBinaryLiteral(literal) ? state.exprArena.copy(std::to_string(binaryToDecimal(literal.substr(2)))) : literal;
       return node;
     }
 
-    static ExprPtr makeVariable(std::string name)
+    static ExprPtr makeVariable(BipState &state, Interner::Id name)
     {
-      auto node = std::make_unique<Expr>();
+      Expr *node = state.exprArena.make<Expr>();
       node->kind = Kind::Variable;
-      node->value = std::move(name);
+      node->name = name;
       return node;
     }
 
-    static ExprPtr makeArrayAccess(std::string name, ExprPtr idx)
+    static ExprPtr makeArrayAccess(BipState &state, Interner::Id name, ExprPtr idx)
     {
-      auto node = std::make_unique<Expr>();
+      Expr *node = state.exprArena.make<Expr>();
       node->kind = Kind::ArrayAccess;
-      node->value = std::move(name);
-      node->index = std::move(idx);
+      node->name = name;
+      node->index = idx;
       return node;
     }
 
-    static ExprPtr makeBinary(std::string operation, ExprPtr lhs, ExprPtr rhs)
+    static ExprPtr makeBinary(BipState &state, std::string_view operation, ExprPtr lhs, ExprPtr rhs)
     {
-      auto node = std::make_unique<Expr>();
+      Expr *node = state.exprArena.make<Expr>();
       node->kind = Kind::Binary;
-      node->op = std::move(operation);
-      node->left = std::move(lhs);
-      node->right = std::move(rhs);
+      node->op = operation;
+      node->left = lhs;
+      node->right = rhs;
       return node;
     }
 
-    static ExprPtr makeCall(std::string callee, std::vector<ExprPtr> arguments)
+    static ExprPtr makeCall(BipState &state, Interner::Id callee, const std::vector<ExprPtr> &arguments)
     {
-      auto node = std::make_unique<Expr>();
+      Expr *node = state.exprArena.make<Expr>();
       node->kind = Kind::Call;
-      node->value = std::move(callee);
-      node->args = std::move(arguments);
+      node->name = callee;
+      ExprPtr *items = state.exprArena.makeArray<ExprPtr>(arguments.size());
+      std::copy(arguments.begin(), arguments.end(), items);
+      node->args = {items, arguments.size()};
       return node;
     }
   };
 
-  struct Token
-  {
-    enum class Type
-    {
-      End,
-      Identifier,
-      Number,
-      Operator,
-      LBracket,
-      RBracket,
-      LParen,
-      RParen,
-      Comma
-    } type = Type::End;
-    std::string lexeme;
-  };
-
-  class Lexer
+  // Partes de range separadas por vírgulas fora de parênteses e colchetes.
+  std::vector<TokenRange> splitTopLevel(BipState &state, TokenRange range)
   {
-  public:
-    explicit Lexer(const std::string &input) : text(input), length(input.size()) {}
-
-    Token next()
+    std::vector<TokenRange> parts;
+    std::size_t start = range.first;
+    for (std::size_t idx = range.first; idx < range.last; ++idx)
     {
-      skipWhitespace();
-      if (pos >= length)
-        return Token{Token::Type::End, ""};
-
-      char c = text[pos];
-
-      if (std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '$')
-        return identifier();
-      if (std::isdigit(static_cast<unsigned char>(c)))
-        return number();
-
-      // Verifica operadores de 2 caracteres
-      if (pos + 1 < length)
+      const SourceToken &token = state.sourceTokens[idx];
+      if (isOpeningDelimiter(token.id) && token.match != std::string::npos && token.match < range.last)
+        idx = token.match;
+      else if (token.id == t_KEY_COMMA)
       {
-        std::string twoChar = text.substr(pos, 2);
-        if (twoChar == "<<" || twoChar == ">>")
-        {
-          pos += 2;
-          return Token{Token::Type::Operator, twoChar};
-        }
-      }
-
-      ++pos;
-      switch (c)
-      {
-      case '+':
-      case '-':
-      case '&':
-      case '|':
-      case '^':
-      case '~':
-      case '*':
-      case '/':
-      case '%':
-        return Token{Token::Type::Operator, std::string(1, c)};
-      case '[':
-        return Token{Token::Type::LBracket, "["};
-      case ']':
-        return Token{Token::Type::RBracket, "]"};
-      case '(':
-        return Token{Token::Type::LParen, "("};
-      case ')':
-        return Token{Token::Type::RParen, ")"};
-      case ',':
-        return Token{Token::Type::Comma, ","};
-      default:
-        throw std::runtime_error("Token desconhecido: " + std::string(1, c));
+        parts.push_back({start, idx});
+        start = idx + 1;
       }
     }
+    parts.push_back({start, range.last});
+    return parts;
+  }
 
-  private:
-    const std::string &text;
-    const std::size_t length;
-    std::size_t pos = 0;
-
-    void skipWhitespace()
+  // Operador binário do token, no texto que o ExpressionEmitter entende;
+  // vazio para os que o BIP não tem (lógicos, relacionais, potência).
+  std::string_view binaryOperator(TokenId id)
+  {
+    switch (id)
     {
-      while (pos < length && std::isspace(static_cast<unsigned char>(text[pos])))
-        ++pos;
+    case t_KEY_SUM: return "+";
+    case t_KEY_SUB: return "-";
+    case t_KEY_MULT: return "*";
+    case t_KEY_DIV: return "/";
+    case t_KEY_MOD: return "%";
+    case t_KEY_BIT_AND: return "&";
+    case t_KEY_BIT_OR: return "|";
+    case t_KEY_BIT_XOR: return "^";
+    case t_KEY_BIT_NOT: return "~";
+    case t_KEY_BIT_SL: return "<<";
+    case t_KEY_BIT_SR: return ">>";
+    default: return {};
     }
+  }
+
+  // Monta a expressão de uma faixa de tokens já aceita pelo Sintatico. Os
+  // operadores são aplicados da esquerda para a direita, como o Semantico
+  // acumula os tipos. Devolve nullptr se a faixa tem algo que o BIP não
+  // representa (texto, decimal, operador lógico, ...) ou sobra token.
+  class ExpressionBuilder
+  {
+  public:
+    ExpressionBuilder(BipState &state, TokenRange range) : state(state), next(range.first), last(range.last) {}
 
-    Token identifier()
+    ExprPtr build()
     {
-      std::size_t start = pos;
-      while (pos < length)
-      {
-        char c = text[pos];
-        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '$')
-          break;
-        ++pos;
-      }
-      return Token{Token::Type::Identifier, text.substr(start, pos - start)};
+      ExprPtr expr = expression();
+      return next == last ? expr : nullptr;
     }
 
-    Token number()
+  private:
+    BipState &state;
+    std::size_t next;
+    std::size_t last;
+
+    const SourceToken &token(std::size_t idx) const
     {
-      std::size_t start = pos;
-      while (pos < length && std::isdigit(static_cast<unsigned char>(text[pos])))
-        ++pos;
-      return Token{Token::Type::Number, text.substr(start, pos - start)};
+      return state.sourceTokens[idx];
     }
-  };
 
-  class Parser
-  {
-  public:
-    explicit Parser(const std::string &input) : lexer(input)
+    // Par do delimitador em idx, se ele fecha dentro da faixa.
+    std::size_t closing(std::size_t idx) const
     {
-      advance();
+      const std::size_t match = token(idx).match;
+      return match != std::string::npos && match < last ? match : std::string::npos;
     }
 
-    ExprPtr parseExpression()
+    ExprPtr expression()
     {
-      auto expr = parseFactor();
-      while (matchOperator())
+      ExprPtr expr = factor();
+      while (expr && next < last)
       {
-        std::string op = previous.lexeme;
-        auto rhs = parseFactor();
-        expr = Expr::makeBinary(op, std::move(expr), std::move(rhs));
+        const std::string_view op = binaryOperator(token(next).id);
+        if (op.empty())
+          break;
+        ++next;
+        ExprPtr rhs = factor();
+        expr = rhs ? Expr::makeBinary(state, op, expr, rhs) : nullptr;
       }
       return expr;
     }
 
-    bool atEnd() const
-    {
-      return current.type == Token::Type::End;
-    }
-
-  private:
-    Lexer lexer;
-    Token current;
-    Token previous;
-
-    void advance()
-    {
-      previous = current;
-      current = lexer.next();
-    }
-
-    bool match(Token::Type type)
+    ExprPtr factor()
     {
-      if (current.type == type)
+      if (next >= last)
+        return nullptr;
+      const std::size_t idx = next++;
+      switch (token(idx).id)
       {
-        advance();
-        return true;
+      case t_KEY_INTEGER:
+      case t_KEY_BINARY:
+        return Expr::makeLiteral(state, tokenView(state, idx));
+      case t_KEY_VARIABLE:
+        return named(idx);
+      case t_KEY_LPAREN:
+        return enclosed(idx);
+      default:
+        return nullptr;
       }
-      return false;
     }
 
-    bool matchOperator()
+    // Conteúdo de ( ... ) ou [ ... ] aberto em open; next passa do par.
+    ExprPtr enclosed(std::size_t open)
     {
-      if (current.type == Token::Type::Operator)
-      {
-        advance();
-        return true;
-      }
-      return false;
+      const std::size_t close = closing(open);
+      if (close == std::string::npos)
+        return nullptr;
+      next = close + 1;
+      return ExpressionBuilder(state, {open + 1, close}).build();
     }
 
-    ExprPtr parseFactor()
+    ExprPtr named(std::size_t nameIdx)
     {
-      if (match(Token::Type::Number))
+      const Interner::Id name = token(nameIdx).name;
+      if (next < last && token(next).id == t_KEY_LBRACKET)
       {
-        return Expr::makeLiteral(previous.lexeme);
+        ExprPtr index = enclosed(next);
+        return index ? Expr::makeArrayAccess(state, name, index) : nullptr;
       }
-      if (match(Token::Type::Identifier))
+      if (next < last && token(next).id == t_KEY_LPAREN)
       {
-        std::string name = previous.lexeme;
-        if (match(Token::Type::LBracket))
-        {
-          auto index = parseExpression();
-          if (!match(Token::Type::RBracket))
-          {
-            throw std::runtime_error("Faltando ']' em acesso a vetor");
-          }
-          return Expr::makeArrayAccess(name, std::move(index));
-        }
-        if (match(Token::Type::LParen))
+        const std::size_t open = next;
+        const std::size_t close = closing(open);
+        if (close == std::string::npos)
+          return nullptr;
+        next = close + 1;
+        std::vector<ExprPtr> args;
+        if (close > open + 1)
         {
-          std::vector<ExprPtr> args;
-          if (!match(Token::Type::RParen))
+          for (TokenRange arg : splitTopLevel(state, {open + 1, close}))
           {
-            do
-            {
-              args.push_back(parseExpression());
-            } while (match(Token::Type::Comma));
-            if (!match(Token::Type::RParen))
-            {
-              throw std::runtime_error("Faltando ')' na chamada de função");
-            }
+            ExprPtr value = ExpressionBuilder(state, arg).build();
+            if (!value)
+              return nullptr;
+            args.push_back(value);
           }
-          return Expr::makeCall(name, std::move(args));
-        }
-        return Expr::makeVariable(name);
-      }
-      if (match(Token::Type::LParen))
-      {
-        auto expr = parseExpression();
-        if (!match(Token::Type::RParen))
-        {
-          throw std::runtime_error("Faltando ')' na expressão");
         }
-        return expr;
+        return Expr::makeCall(state, name, args);
       }
-
-      throw std::runtime_error("Expressão inválida");
+      return Expr::makeVariable(state, name);
     }
   };
 
-  std::vector<std::string> splitTopLevel(const std::string &source, char separator)
+  ExprPtr buildExpression(BipState &state, TokenRange range)
   {
-    std::vector<std::string> parts;
-    int depthParen = 0;
-    int depthBracket = 0;
-    int depthBrace = 0;
-    std::size_t last = 0;
-    for (std::size_t i = 0; i < source.size(); ++i)
-    {
-      char c = source[i];
-      switch (c)
-      {
-      case '(':
-        ++depthParen;
-        break;
-      case ')':
-        --depthParen;
-        break;
-      case '[':
-        ++depthBracket;
-        break;
-      case ']':
-        --depthBracket;
-        break;
-      case '{':
-        ++depthBrace;
-        break;
-      case '}':
-        --depthBrace;
-        break;
-      default:
-        break;
-      }
-      if (c == separator && depthParen == 0 && depthBracket == 0 && depthBrace == 0)
-      {
-        parts.push_back(trim(source.substr(last, i - last)));
-        last = i + 1;
-      }
-    }
-    if (last < source.size())
-    {
-      parts.push_back(trim(source.substr(last)));
-    }
-    return parts;
+    return ExpressionBuilder(state, range).build();
   }
 
   struct ParsedAssignment
   {
-    std::string targetName;
+    Interner::Id targetName = Interner::NONE;
     bool targetIsArray = false;
-    ExprPtr targetIndex;
-    ExprPtr rhsExpr;
+    ExprPtr targetIndex = nullptr;
+    ExprPtr rhsExpr = nullptr;
     std::vector<ExprPtr> rhsArrayElements;
     std::size_t statementStart = 0;
   };
 
-  bool extractAssignmentSlices(const Semantico::Variable &variable, std::string &lhsOut, std::string &rhsOut, std::size_t &statementStart)
+  // Profundidade de parênteses, colchetes e chaves, cada um no seu contador.
+  struct DelimiterDepth
+  {
+    int paren = 0;
+    int bracket = 0;
+    int brace = 0;
+
+    // true se id é delimitador (e já foi contado).
+    bool track(TokenId id)
+    {
+      switch (id)
+      {
+      case t_KEY_LPAREN: ++paren; return true;
+      case t_KEY_RPAREN: --paren; return true;
+      case t_KEY_LBRACKET: ++bracket; return true;
+      case t_KEY_RBRACKET: --bracket; return true;
+      case t_KEY_LBRACE: ++brace; return true;
+      case t_KEY_RBRACE: --brace; return true;
+      default: return false;
+      }
+    }
+
+    bool zero() const { return paren == 0 && bracket == 0 && brace == 0; }
+
+    // id fecha um delimitador que não foi aberto depois do início da contagem.
+    bool closesOuter(TokenId id) const
+    {
+      return (id == t_KEY_RPAREN && paren == 0) || (id == t_KEY_RBRACKET && bracket == 0) || (id == t_KEY_RBRACE && brace == 0);
+    }
+  };
+
+  // Tokens do destino (antes do "=") e do valor (até o ";") da atribuição
+  // registrada em variable.
+  bool findAssignmentTokens(BipState &state, const Semantico::Variable &variable, TokenRange &target, TokenRange &value, std::size_t &statementStart)
   {
-    const std::string &src = Semantico::sourceCode;
+    const auto &tokens = state.sourceTokens;
     std::size_t start = std::string::npos;
     if (variable.position >= 0)
     {
@@ -1039,1139 +1029,584 @@ namespace
       }
     }
 
-    auto fallbackFind = [&]() -> std::size_t {
-      if (variable.name.empty())
-        return std::string::npos;
-      std::size_t pos = 0;
-      while (true)
-      {
-        pos = src.find(variable.name, pos);
-        if (pos == std::string::npos)
-          return std::string::npos;
-        // garante que não está no meio de outro identificador
-        auto isIdent = [](char ch) { return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_'; };
-        if ((pos > 0 && isIdent(src[pos - 1])) || (pos + variable.name.size() < src.size() && isIdent(src[pos + variable.name.size()])))
-        {
-          pos += variable.name.size();
-          continue;
-        }
-        std::size_t eq = src.find('=', pos + variable.name.size());
-        if (eq == std::string::npos)
-          return std::string::npos;
-        std::size_t semi = src.find(';', eq);
-        if (semi == std::string::npos)
-          return std::string::npos;
-        return pos;
-      }
-    };
-
-    if (start == std::string::npos || start >= src.size())
+    std::size_t first = tokens.size();
+    if (start != std::string::npos)
     {
-      start = fallbackFind();
-      if (start == std::string::npos || start >= src.size())
-        return false;
+      first = tokenIndexAt(state, start);
     }
-
-    while (start > 0 && std::isspace(static_cast<unsigned char>(src[start - 1])))
-      --start;
-
-    int depthParen = 0;
-    int depthBracket = 0;
-    int depthBrace = 0;
-    bool inString = false;
-    char stringDelim = '\0';
-    std::size_t assignPos = std::string::npos;
-    for (std::size_t i = start; i < src.size(); ++i)
+    else if (variable.name != Interner::NONE)
     {
-      char c = src[i];
-      if (inString)
+      for (std::size_t idx = 0; idx < tokens.size(); ++idx)
       {
-        if (c == '\\' && i + 1 < src.size())
-        {
-          ++i;
-          continue;
-        }
-        if (c == stringDelim)
+        if (tokens[idx].name == variable.name)
         {
-          inString = false;
+          first = idx;
+          break;
         }
-        continue;
-      }
-      if (c == '"' || c == '\'')
-      {
-        inString = true;
-        stringDelim = c;
-        continue;
-      }
-      if (c == '(')
-      {
-        ++depthParen;
-        continue;
-      }
-      if (c == ')')
-      {
-        --depthParen;
-        continue;
       }
-      if (c == '[')
-      {
-        ++depthBracket;
-        continue;
-      }
-      if (c == ']')
-      {
-        --depthBracket;
-        continue;
-      }
-      if (c == '{')
+    }
+    if (first >= tokens.size())
+      return false;
+
+    // Um contador por tipo de delimitador: em "if (a > 0) { v[2] = a; }" o
+    // ")" e o "{" não se anulam. Atribuições dentro de blocos chegam sem
+    // posição e com os tokens da condição antes do destino; o que vem antes
+    // de um "{" ou ";" solto, ou de um delimitador que fecha algo aberto
+    // antes, é de outro comando e fica de fora.
+    DelimiterDepth depth;
+    std::size_t assignIdx = std::string::npos;
+    for (std::size_t idx = first; idx < tokens.size(); ++idx)
+    {
+      const TokenId id = tokens[idx].id;
+      if ((depth.zero() && (id == t_KEY_LBRACE || id == t_KEY_SEMICOLON)) || depth.closesOuter(id))
       {
-        ++depthBrace;
+        first = idx + 1;
+        depth = DelimiterDepth();
         continue;
       }
-      if (c == '}')
-      {
-        --depthBrace;
+      if (depth.track(id))
         continue;
-      }
-
-      if (c == '=' && depthParen == 0 && depthBracket == 0 && depthBrace == 0)
+      if (id == t_KEY_ATTR && depth.zero())
       {
-        if (i + 1 < src.size() && src[i + 1] == '=')
-        {
-          ++i;
-          continue;
-        }
-        if (i > 0)
-        {
-          char prev = src[i - 1];
-          if (prev == '<' || prev == '>' || prev == '!' || prev == '=')
-          {
-            continue;
-          }
-        }
-        assignPos = i;
+        assignIdx = idx;
         break;
       }
     }
 
-    if (assignPos == std::string::npos)
+    if (assignIdx == std::string::npos)
       return false;
 
-    depthParen = depthBracket = depthBrace = 0;
-    inString = false;
-    stringDelim = '\0';
-    std::size_t endPos = std::string::npos;
-    for (std::size_t i = assignPos + 1; i < src.size(); ++i)
+    depth = DelimiterDepth();
+    std::size_t endIdx = std::string::npos;
+    for (std::size_t idx = assignIdx + 1; idx < tokens.size(); ++idx)
     {
-      char c = src[i];
-      if (inString)
-      {
-        if (c == '\\' && i + 1 < src.size())
-        {
-          ++i;
-          continue;
-        }
-        if (c == stringDelim)
-        {
-          inString = false;
-        }
-        continue;
-      }
-      if (c == '"' || c == '\'')
-      {
-        inString = true;
-        stringDelim = c;
-        continue;
-      }
-      if (c == '(')
-      {
-        ++depthParen;
+      const TokenId id = tokens[idx].id;
+      if (depth.track(id))
         continue;
-      }
-      if (c == ')')
-      {
-        --depthParen;
-        continue;
-      }
-      if (c == '[')
-      {
-        ++depthBracket;
-        continue;
-      }
-      if (c == ']')
-      {
-        --depthBracket;
-        continue;
-      }
-      if (c == '{')
-      {
-        ++depthBrace;
-        continue;
-      }
-      if (c == '}')
-      {
-        --depthBrace;
-        continue;
-      }
-      if (c == ';' && depthParen == 0 && depthBracket == 0 && depthBrace == 0)
+      if (id == t_KEY_SEMICOLON && depth.zero())
       {
-        endPos = i;
+        endIdx = idx;
         break;
       }
     }
 
-    if (endPos == std::string::npos)
+    if (endIdx == std::string::npos)
       return false;
 
-    lhsOut = trim(src.substr(start, assignPos - start));
-    rhsOut = trim(src.substr(assignPos + 1, endPos - assignPos - 1));
-    statementStart = start;
-    return !lhsOut.empty() && !rhsOut.empty();
+    target = {first, assignIdx};
+    value = {assignIdx + 1, endIdx};
+    // o comando começa logo depois do token anterior
+    statementStart = first > 0 && tokens[first].position > 0 ? tokenEnd(state, first - 1) : 0;
+    return !target.empty() && !value.empty();
   }
 
-  bool quickSliceAroundPosition(const Semantico::Variable &variable, std::string &lhsOut, std::string &rhsOut, std::size_t &statementStart)
+  // Destino "nome" ou "nome[índice]" em target.
+  bool parseAssignmentTarget(BipState &state, TokenRange target, ParsedAssignment &parsed)
   {
-    const std::string &src = Semantico::sourceCode;
-    if (src.empty())
-      return false;
-    // tenta âncora próxima da posição conhecida
-    std::size_t anchor = (variable.position >= 0 && static_cast<std::size_t>(variable.position) < src.size())
-                             ? static_cast<std::size_t>(variable.position)
-                             : 0;
-
-    auto trySliceAt = [&](std::size_t namePos) -> bool {
-      std::size_t eq = src.find('=', namePos);
-      while (eq != std::string::npos)
-      {
-        if (!(eq + 1 < src.size() && src[eq + 1] == '='))
-          break;
-        eq = src.find('=', eq + 2);
-      }
-      if (eq == std::string::npos)
-        return false;
-      std::size_t semi = src.find(';', eq);
-      if (semi == std::string::npos)
+    const auto &tokens = state.sourceTokens;
+    for (std::size_t idx = target.first; idx < target.last; ++idx)
+    {
+      if (tokens[idx].id != t_KEY_LBRACKET)
+        continue;
+      const std::size_t close = tokens[idx].match;
+      if (idx == target.first || close == std::string::npos || close >= target.last)
         return false;
-      std::size_t lhsEnd = eq;
-      while (lhsEnd > 0 && std::isspace(static_cast<unsigned char>(src[lhsEnd - 1])))
-        --lhsEnd;
-      std::size_t lhsStart = lhsEnd;
-      while (lhsStart > 0)
-      {
-        char c = src[lhsStart - 1];
-        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '[' || c == ']')
-        {
-          --lhsStart;
-          continue;
-        }
-        if (std::isspace(static_cast<unsigned char>(c)))
-        {
-          --lhsStart;
-          continue;
-        }
-        break;
-      }
-      lhsOut = trim(src.substr(lhsStart, lhsEnd - lhsStart));
-      rhsOut = trim(src.substr(eq + 1, semi - eq - 1));
-      statementStart = lhsStart;
-      return !lhsOut.empty() && !rhsOut.empty();
-    };
+      parsed.targetIsArray = true;
+      parsed.targetName = tokens[idx - 1].name;
+      parsed.targetIndex = buildExpression(state, {idx + 1, close});
+      return parsed.targetIndex != nullptr;
+    }
+    return true;
+  }
 
-    if (trySliceAt(anchor))
-      return true;
+  bool parseAssignment(BipState &state, const Semantico::Variable &variable, ParsedAssignment &parsed)
+  {
+    TokenRange target;
+    TokenRange value;
+    if (!findAssignmentTokens(state, variable, target, value, parsed.statementStart))
+      return false;
 
-    // fallback: busca por atribuição usando o nome do vetor mais próximo do topo
-    if (!variable.name.empty())
+    parsed.targetName = variable.name;
+    if (!parseAssignmentTarget(state, target, parsed))
+      return false;
+
+    const auto &tokens = state.sourceTokens;
+    if (tokens[value.first].id == t_KEY_LBRACKET)
     {
-      std::size_t pos = 0;
-      auto isIdent = [](char ch) { return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_'; };
-      while (true)
+      // vetor literal: "[" e "]" cercam o valor inteiro
+      if (tokens[value.first].match != value.last - 1 || value.last - value.first < 3)
+        return false;
+      for (TokenRange element : splitTopLevel(state, {value.first + 1, value.last - 1}))
       {
-        pos = src.find(variable.name, pos);
-        if (pos == std::string::npos)
-          break;
-        if ((pos > 0 && isIdent(src[pos - 1])) || (pos + variable.name.size() < src.size() && isIdent(src[pos + variable.name.size()])))
-        {
-          pos += variable.name.size();
-          continue;
-        }
-
-        std::size_t afterName = pos + variable.name.size();
-        // se for atribuição de vetor, exige '[' logo após nome (ignorando espaços)
-        std::size_t scan = afterName;
-        while (scan < src.size() && std::isspace(static_cast<unsigned char>(src[scan])))
-          ++scan;
-        if (variable.isArray)
-        {
-          if (scan >= src.size() || src[scan] != '[')
-          {
-            pos += variable.name.size();
-            continue; // não é acesso a elemento
-          }
-        }
-
-        // evita pegar declaração: se houver ':' antes do '=' mais próximo, pula
-        std::size_t nextEq = src.find('=', scan);
-        if (nextEq == std::string::npos)
-        {
-          pos += variable.name.size();
-          continue;
-        }
-        std::size_t colonPos = src.find(':', afterName);
-        if (colonPos != std::string::npos && colonPos < nextEq)
-        {
-          pos += variable.name.size();
-          continue; // é declaração
-        }
-
-        if (trySliceAt(pos))
-          return true;
-
-        pos += variable.name.size();
+        ExprPtr expr = buildExpression(state, element);
+        if (!expr)
+          return false;
+        parsed.rhsArrayElements.push_back(expr);
       }
+      return true;
     }
 
-    return false;
+    parsed.rhsExpr = buildExpression(state, value);
+    return parsed.rhsExpr != nullptr;
   }
 
-  ExprPtr parseExpressionString(const std::string &exprString)
+  Bip::Opcode opcodeForOperator(std::string_view op)
   {
-    Parser parser(exprString);
-    auto expr = parser.parseExpression();
-    if (!parser.atEnd())
-    {
-      throw std::runtime_error("Tokens extras após expressão: " + exprString);
-    }
-    return expr;
+    if (op == "+") return Bip::Opcode::ADD;
+    if (op == "-") return Bip::Opcode::SUB;
+    if (op == "*") return Bip::Opcode::MUL;
+    if (op == "/") return Bip::Opcode::DIV;
+    if (op == "%") return Bip::Opcode::MOD;
+    if (op == "&") return Bip::Opcode::AND;
+    if (op == "|") return Bip::Opcode::OR;
+    if (op == "^") return Bip::Opcode::XOR;
+    if (op == "<<") return Bip::Opcode::SLL;
+    if (op == ">>") return Bip::Opcode::SRL;
+    if (op == "~") return Bip::Opcode::NOT;
+
+    throw std::runtime_error(std::string("Operador não suportado: ").append(op));
   }
 
-  bool parseAssignmentFromSource(const Semantico::Variable &variable, ParsedAssignment &parsed)
+  bool containsKind(const Expr &expr, Expr::Kind kind)
   {
-    std::string lhs;
-    std::string rhs;
-    std::size_t statementStart = 0;
-    if (!extractAssignmentSlices(variable, lhs, rhs, statementStart))
+    if (expr.kind == kind)
+      return true;
+    if ((expr.left && containsKind(*expr.left, kind)) || (expr.right && containsKind(*expr.right, kind)) ||
+        (expr.index && containsKind(*expr.index, kind)))
+      return true;
+    for (ExprPtr arg : expr.args)
     {
-      if (!quickSliceAroundPosition(variable, lhs, rhs, statementStart))
-        return false;
+      if (containsKind(*arg, kind))
+        return true;
     }
+    return false;
+  }
 
-    if (lhs.empty() || rhs.empty())
-      return false;
+  // Chamadas são o único efeito colateral de uma expressão: alteram
+  // globais, parâmetros e $indr.
+  bool containsCall(const Expr &expr)
+  {
+    return containsKind(expr, Expr::Kind::Call);
+  }
 
-    parsed.targetName = variable.name;
-    std::size_t bracketPos = lhs.find('[');
-    if (bracketPos != std::string::npos)
+  // Achata uma cadeia de + e - cujas folhas são literais ou variáveis,
+  // guardando o sinal de cada termo.
+  bool collectSimpleTerms(const Expr &expr, std::vector<std::pair<int, const Expr *>> &terms, int sign)
+  {
+    if (expr.kind == Expr::Kind::Binary && (expr.op == "+" || expr.op == "-"))
     {
-      std::size_t closing = lhs.rfind(']');
-      if (closing == std::string::npos || closing <= bracketPos)
+      if (!expr.left || !expr.right || !collectSimpleTerms(*expr.left, terms, sign))
         return false;
-      parsed.targetIsArray = true;
-      parsed.targetName = trim(lhs.substr(0, bracketPos));
-      std::string indexExpr = trim(lhs.substr(bracketPos + 1, closing - bracketPos - 1));
-      if (indexExpr.empty())
-        throw std::runtime_error("Índice vazio em acesso a vetor");
-      parsed.targetIndex = parseExpressionString(indexExpr);
+      return collectSimpleTerms(*expr.right, terms, expr.op == "+" ? sign : -sign);
     }
-
-    if (!rhs.empty() && rhs.front() == '[')
+    if (expr.kind == Expr::Kind::Literal || expr.kind == Expr::Kind::Variable)
     {
-      if (rhs.back() != ']')
-        throw std::runtime_error("Vetor literal mal formado");
-      std::string inner = trim(rhs.substr(1, rhs.size() - 2));
-      if (inner.empty())
-        throw std::runtime_error("Vetor literal vazio não suportado");
-      auto parts = splitTopLevel(inner, ',');
-      for (const auto &part : parts)
-      {
-        parsed.rhsArrayElements.push_back(parseExpressionString(part));
-      }
-      parsed.statementStart = statementStart;
+      terms.push_back({sign, &expr});
       return true;
     }
-
-    parsed.rhsExpr = parseExpressionString(rhs);
-    parsed.statementStart = statementStart;
-    return true;
-  }
-
-  std::string opcodeForOperator(const std::string &op)
-  {
-    if (op == "+") return "ADD";
-    if (op == "-") return "SUB";
-    if (op == "*") return "MUL"; 
-    if (op == "/") return "DIV"; 
-    if (op == "%") return "MOD";
-    if (op == "&") return "AND";
-    if (op == "|") return "OR";
-    if (op == "^") return "XOR";
-    if (op == "<<") return "SLL";
-    if (op == ">>") return "SRL";
-    if (op == "~") return "NOT";
-    
-    throw std::runtime_error(std::string("Operador não suportado: ") + op);
+    return false;
   }
 
   class ExpressionEmitter
   {
   public:
-    ExpressionEmitter(std::vector<std::string> &instructionsRef, std::size_t referencePos, bool expectsValue = true)
-        : instructions(instructionsRef), refPos(referencePos), valueRequired(expectsValue)
+    ExpressionEmitter(BipState &state, Code &instructionsRef, std::size_t referencePos)
+        : state(state), instructions(instructionsRef), refPos(referencePos)
     {
+      if (functionAt(state, referencePos))
+      {
+        tempBase = TEMP_ROUTINE_BASE_ADDRESS;
+        tempLimit = TEMP_MAX_ADDRESS;
+      }
+      nextTemp = tempBase;
     }
 
     void reset()
     {
-      nextTemp = TEMP_BASE_ADDRESS;
+      nextTemp = tempBase;
     }
 
-    std::string emit(const Expr &expr)
+    // Deixa o valor da expressão no acumulador. Literais e variáveis entram
+    // direto como operando (ADDI 3, SUB x) em vez de passar por um
+    // temporário; só um operando composto é guardado em memória, e o
+    // temporário volta para a pilha assim que a operação o consome.
+    void load(const Expr &expr)
     {
       switch (expr.kind)
       {
       case Expr::Kind::Literal:
-      {
-        std::string temp = allocateTemp();
-        std::string decimalValue = convertLiteralToDecimal(expr.value);
-        instructions.push_back("LDI " + decimalValue);
-        instructions.push_back("STO " + temp);
-        return temp;
-      }
+        instructions.push_back(literalOperand(state, Bip::Opcode::LDI, expr.value));
+        return;
       case Expr::Kind::Variable:
-      {
-        std::string temp = allocateTemp();
-        const std::string name = resolveName(expr.value);
-        instructions.push_back("LD " + name);
-        instructions.push_back("STO " + temp);
-        return temp;
-      }
+        instructions.push_back(Bip::symbol(Bip::Opcode::LD, resolveName(expr.name)));
+        return;
       case Expr::Kind::ArrayAccess:
-      {
         if (!expr.index)
         {
           throw std::runtime_error("Acesso a vetor sem índice");
         }
-        std::string indexTemp = emit(*expr.index);
-        instructions.push_back("LD " + indexTemp);
-        instructions.push_back(std::string("STO ") + TEMP_VECTOR_INDEX);
-        instructions.push_back(std::string("LD ") + TEMP_VECTOR_INDEX);
-        instructions.push_back("STO $indr");
-        const std::string arrayName = resolveName(expr.value);
-        instructions.push_back("LDV " + arrayName);
-        std::string temp = allocateTemp();
-        instructions.push_back("STO " + temp);
-        return temp;
-      }
+        load(*expr.index);
+        instructions.push_back(STORE_INDEX);
+        instructions.push_back(Bip::symbol(Bip::Opcode::LDV, resolveName(expr.name)));
+        return;
       case Expr::Kind::Binary:
+        loadBinary(expr);
+        return;
+      case Expr::Kind::Call:
+        loadCall(expr);
+        return;
+      }
+      throw std::runtime_error("Expressão desconhecida");
+    }
+
+    // left - right no acumulador, para o desvio condicional que vem logo
+    // depois. A esquerda é avaliada antes quando a direita chama rotinas.
+    void loadDifference(const Expr &left, const Expr &right)
+    {
+      if (std::optional<Bip::Instruction> operand = directOperand("-", right, containsCall(left)))
       {
-        if (!expr.left || !expr.right)
-        {
-          throw std::runtime_error("Expressão binária inválida");
-        }
-        
-        // Para operadores bit a bit e shifts, precisamos tratar de forma especial
-        if (expr.op == "<<" || expr.op == ">>")
-        {
-          // Para shifts: primeiro operando no ACC, segundo como operando imediato
-          std::string leftTemp = emit(*expr.left);
-          
-          // Se o operando direito for literal, podemos usar diretamente
-          if (expr.right->kind == Expr::Kind::Literal)
-          {
-            instructions.push_back("LD " + leftTemp);
-            std::string decimalValue = convertLiteralToDecimal(expr.right->value);
-            instructions.push_back(opcodeForOperator(expr.op) + " " + decimalValue);
-            std::string temp = allocateTemp();
-            instructions.push_back("STO " + temp);
-            return temp;
-          }
-          else
-          {
-            // Se não for literal, precisamos avaliar e usar como operando
-            std::string rightTemp = emit(*expr.right);
-            instructions.push_back("LD " + leftTemp);
-            instructions.push_back(opcodeForOperator(expr.op) + " " + rightTemp);
-            std::string temp = allocateTemp();
-            instructions.push_back("STO " + temp);
-            return temp;
-          }
-        }
-        
-        // Para outros operadores binários
-        std::string rightTemp = emit(*expr.right);
-        std::string leftTemp = emit(*expr.left);
-        
-        // Operações bit a bit usam instruções com operando de memória ou imediato
-        if (expr.op == "&" || expr.op == "|" || expr.op == "^")
-        {
-          // Se o operando direito for literal, usar versão imediata
-          if (expr.right->kind == Expr::Kind::Literal)
-          {
-            instructions.push_back("LD " + leftTemp);
-            std::string decimalValue = convertLiteralToDecimal(expr.right->value);
-            instructions.push_back(opcodeForOperator(expr.op) + "I " + decimalValue);
-            std::string temp = allocateTemp();
-            instructions.push_back("STO " + temp);
-            return temp;
-          }
-          else
-          {
-            instructions.push_back("LD " + leftTemp);
-            instructions.push_back(opcodeForOperator(expr.op) + " " + rightTemp);
-            std::string temp = allocateTemp();
-            instructions.push_back("STO " + temp);
-            return temp;
-          }
-        }
-        
-        // Operadores aritméticos padrão
-        instructions.push_back("LD " + leftTemp);
-        instructions.push_back(opcodeForOperator(expr.op) + " " + rightTemp);
-        std::string temp = allocateTemp();
-        instructions.push_back("STO " + temp);
-        return temp;
+        load(left);
+        instructions.push_back(*operand);
+        return;
       }
-      case Expr::Kind::Call:
+      if (containsCall(right))
       {
-        ensureFunctionsParsed();
-        ensureParametersRegistered();
-        if (!functionsParsed)
-        {
-          throw std::runtime_error("Nenhuma função registrada");
-        }
-        const FunctionInfo *fn = findFunction(expr.value);
-        if (!fn)
-        {
-          throw SemanticError("A rotina \"" + expr.value + "\" não existe.", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-        }
-        if (fn->returnType == Semantico::Type::VOID && valueRequired)
-        {
-          throw SemanticError("A rotina \"" + expr.value + "\" não retorna valor.", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-        }
-        if (valueRequired && fn->returnType != Semantico::Type::INT && fn->returnType != Semantico::Type::VOID)
-        {
-          throw SemanticError("Tipo de retorno incompatível na rotina \"" + fn->name + "\".", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-        }
-        const std::size_t expected = fn->params.size();
-        const std::size_t provided = expr.args.size();
-        if (expected != provided)
-        {
-          throw SemanticError("A função \"" + expr.value + "\" esperava " + std::to_string(expected) + " parâmetros e foram passados " + std::to_string(provided) + " parâmetros.", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-        }
-
-        // Avalia e copia parâmetros por cópia
-        for (std::size_t idx = 0; idx < fn->params.size(); ++idx)
-        {
-          if (fn->params[idx].type != Semantico::Type::INT)
-          {
-            throw SemanticError("Tipo de parâmetro incompatível na rotina \"" + fn->name + "\".", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-          }
-          std::string argTemp = emit(*expr.args[idx]);
-          const std::string paramAlias = parameterAlias(fn->lowerName, fn->params[idx].name);
-          instructions.push_back("LD " + argTemp);
-          instructions.push_back("STO " + paramAlias);
-        }
+        const int leftTemp = spill(left);
+        const int rightTemp = spill(right);
+        instructions.push_back(Bip::temp(Bip::Opcode::LD, leftTemp));
+        instructions.push_back(Bip::temp(Bip::Opcode::SUB, rightTemp));
+        releaseTemp();
+        releaseTemp();
+        return;
+      }
+      const int rightTemp = spill(right);
+      load(left);
+      instructions.push_back(Bip::temp(Bip::Opcode::SUB, rightTemp));
+      releaseTemp();
+    }
 
-        instructions.push_back("CALL " + fn->label);
-        std::string temp = allocateTemp();
-        instructions.push_back("STO " + temp);
-        return temp;
+    // Grava value em array[index]. Sem temporários quando o valor não
+    // mexe em $indr (nem acesso a vetor nem chamada); indexFirst diz em
+    // que ordem o fonte avalia os dois lados.
+    void storeElement(Interner::Id array, const Expr &index, const Expr &value, bool indexFirst)
+    {
+      const Interner::Id arrayName = resolveName(array);
+      const bool valueKeepsIndr = !containsKind(value, Expr::Kind::ArrayAccess) && !containsCall(value);
+      if (valueKeepsIndr && (indexFirst || !containsCall(index)))
+      {
+        load(index);
+        instructions.push_back(STORE_INDEX);
+        load(value);
+        instructions.push_back(Bip::symbol(Bip::Opcode::STOV, arrayName));
+        return;
       }
+      // valor antes do índice só se isso não muda o que cada um lê
+      const bool valueFirst = !indexFirst || index.kind == Expr::Kind::Literal || (!containsCall(index) && !containsCall(value));
+      if (!valueFirst)
+      {
+        const int indexTemp = spill(index);
+        const int valueTemp = spill(value);
+        instructions.push_back(Bip::temp(Bip::Opcode::LD, indexTemp));
+        instructions.push_back(STORE_INDEX);
+        instructions.push_back(Bip::temp(Bip::Opcode::LD, valueTemp));
+        instructions.push_back(Bip::symbol(Bip::Opcode::STOV, arrayName));
+        releaseTemp();
+        releaseTemp();
+        return;
       }
-      throw std::runtime_error("Expressão desconhecida");
+      const int valueTemp = spill(value);
+      load(index);
+      instructions.push_back(STORE_INDEX);
+      instructions.push_back(Bip::temp(Bip::Opcode::LD, valueTemp));
+      instructions.push_back(Bip::symbol(Bip::Opcode::STOV, arrayName));
+      releaseTemp();
     }
 
     std::size_t position() const { return refPos; }
-    std::string resolveSymbol(const std::string &name) const { return resolveName(name); }
+    Interner::Id resolveSymbol(Interner::Id name) const { return resolveName(name); }
 
   private:
-    std::vector<std::string> &instructions;
+    BipState &state;
+    Code &instructions;
+    int tempBase = TEMP_BASE_ADDRESS;
+    int tempLimit = TEMP_ROUTINE_BASE_ADDRESS - 1;
     int nextTemp = TEMP_BASE_ADDRESS;
     std::size_t refPos = 0;
-    bool valueRequired = true;
 
-    std::string allocateTemp()
+    int allocateTemp()
     {
-      if (nextTemp > TEMP_MAX_ADDRESS)
+      if (nextTemp > tempLimit)
       {
         throw std::runtime_error("Sem temporários disponíveis para expressão");
       }
-      return std::to_string(nextTemp++);
+      return nextTemp++;
     }
 
-    std::string resolveName(const std::string &name) const
-    {
-      if (name.empty())
-        return name;
-      return resolveAlias(name, refPos);
-    }
-  };
-
-  bool collectAddSubTerms(const Expr &expr, std::vector<std::pair<int, const Expr *>> &terms, int sign);
-
-  bool emitCallForContext(const Expr &expr, std::size_t refPos, std::vector<std::string> &code, const std::string *storeTarget)
-  {
-    if (expr.kind != Expr::Kind::Call)
-      return false;
-    ensureFunctionsParsed();
-    ensureParametersRegistered();
-    const FunctionInfo *fn = findFunction(expr.value);
-    if (!fn)
-    {
-      throw SemanticError("A rotina \"" + expr.value + "\" não existe.", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-    }
-    if (storeTarget && fn->returnType == Semantico::Type::VOID)
-    {
-      throw SemanticError("A rotina \"" + fn->name + "\" não retorna valor.", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-    }
-    if (storeTarget && fn->returnType != Semantico::Type::INT && fn->returnType != Semantico::Type::VOID)
+    void releaseTemp()
     {
-      throw SemanticError("Tipo de retorno incompatível na rotina \"" + fn->name + "\".", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-    }
-    const std::size_t expected = fn->params.size();
-    const std::size_t provided = expr.args.size();
-    if (expected != provided)
-    {
-      throw SemanticError("A função \"" + expr.value + "\" esperava " + std::to_string(expected) + " parâmetros e foram passados " + std::to_string(provided) + " parâmetros.", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
+      --nextTemp;
     }
 
-    ExpressionEmitter emitter(code, refPos);
-    emitter.reset();
-    for (std::size_t idx = 0; idx < fn->params.size(); ++idx)
+    int spill(const Expr &expr)
     {
-      if (fn->params[idx].type != Semantico::Type::INT)
-      {
-        throw SemanticError("Tipo de parâmetro incompatível na rotina \"" + fn->name + "\".", static_cast<int>(refPos), static_cast<int>(expr.value.size()));
-      }
-      std::string argTemp = emitter.emit(*expr.args[idx]);
-      const std::string paramAlias = parameterAlias(fn->lowerName, fn->params[idx].name);
-      code.push_back("LD " + argTemp);
-      code.push_back("STO " + paramAlias);
+      load(expr);
+      const int temp = allocateTemp();
+      instructions.push_back(Bip::temp(Bip::Opcode::STO, temp));
+      return temp;
     }
 
-    code.push_back("CALL " + fn->label);
-    if (storeTarget)
+    // Instrução que aplica op com node de operando, sem passar por
+    // temporário. Variável só quando o outro lado não chama rotinas: a
+    // leitura viria depois da chamada, que pode alterá-la.
+    std::optional<Bip::Instruction> directOperand(std::string_view op, const Expr &node, bool otherCalls) const
     {
-      code.push_back("STO " + *storeTarget);
-    }
-    return true;
-  }
-
-  bool emitIndexValue(const Expr &expr, std::vector<std::string> &code, ExpressionEmitter &emitter)
-  {
-    auto emitDirect = [&](const Expr &node) -> bool {
       if (node.kind == Expr::Kind::Literal)
       {
-        std::string decimalValue = convertLiteralToDecimal(node.value);
-        code.push_back("LDI " + decimalValue);
-        return true;
+        // SLL/SRL não têm forma imediata: o deslocamento literal vai como está
+        return literalOperand(state, Bip::immediateForm(opcodeForOperator(op)), node.value);
       }
-      if (node.kind == Expr::Kind::Variable)
+      if (node.kind == Expr::Kind::Variable && !otherCalls)
       {
-        const std::string name = emitter.resolveSymbol(node.value);
-        code.push_back("LD " + name);
-        return true;
+        return Bip::symbol(opcodeForOperator(op), resolveName(node.name));
       }
-      return false;
-    };
-
-    if (emitDirect(expr))
-    {
-      return true;
+      return std::nullopt;
     }
 
-    std::vector<std::pair<int, const Expr *>> terms;
-    if (collectAddSubTerms(expr, terms, 1) && !terms.empty())
+    void loadBinary(const Expr &expr)
     {
-      bool onlySimple = true;
-      for (const auto &term : terms)
+      if (!expr.left || !expr.right)
       {
-        auto kind = term.second->kind;
-        if (kind != Expr::Kind::Literal && kind != Expr::Kind::Variable)
-        {
-          onlySimple = false;
-          break;
-        }
+        throw std::runtime_error("Expressão binária inválida");
       }
-      if (onlySimple)
+      const Expr &left = *expr.left;
+      const Expr &right = *expr.right;
+
+      if (expr.op == "+" || expr.op == "-")
       {
-        int firstPositive = -1;
-        for (std::size_t i = 0; i < terms.size(); ++i)
-        {
-          if (terms[i].first > 0)
-          {
-            firstPositive = static_cast<int>(i);
-            break;
-          }
-        }
-        if (firstPositive >= 0)
+        // cadeia só de literais e variáveis: a - (b - c) vira LD a; SUB b; ADD c
+        std::vector<std::pair<int, const Expr *>> terms;
+        if (collectSimpleTerms(expr, terms, 1))
         {
-          const Expr *firstTerm = terms[firstPositive].second;
-          emitDirect(*firstTerm);
-        }
-        else
-        {
-          code.push_back("LDI 0");
-        }
-        for (std::size_t i = 0; i < terms.size(); ++i)
-        {
-          if (static_cast<int>(i) == firstPositive)
-            continue;
-          const Expr *termExpr = terms[i].second;
-          bool positive = terms[i].first > 0;
-          if (termExpr->kind == Expr::Kind::Literal)
+          load(*terms.front().second);
+          for (std::size_t i = 1; i < terms.size(); ++i)
           {
-            std::string decimalValue = convertLiteralToDecimal(termExpr->value);
-            code.push_back(std::string(positive ? "ADDI " : "SUBI ") + decimalValue);
+            instructions.push_back(*directOperand(terms[i].first > 0 ? "+" : "-", *terms[i].second, false));
           }
-          else
-          {
-            const std::string name = emitter.resolveSymbol(termExpr->value);
-            code.push_back(std::string(positive ? "ADD " : "SUB ") + name);
-          }
-        }
-        if (firstPositive < 0)
-        {
-          // all terms were negativos: already handled in loop
+          return;
         }
-        return true;
       }
-    }
 
-    std::string temp = emitter.emit(expr);
-    code.push_back("LD " + temp);
-    return true;
-  }
-
-  bool emitArrayValueInto(const Expr &expr, const std::string &destination, std::vector<std::string> &code, ExpressionEmitter &emitter)
-  {
-    if (expr.kind != Expr::Kind::ArrayAccess || !expr.index)
-    {
-      return false;
-    }
-    if (!emitIndexValue(*expr.index, code, emitter))
-    {
-      return false;
-    }
-    code.push_back("STO $indr");
-    const std::string name = emitter.resolveSymbol(expr.value);
-    code.push_back("LDV " + name);
-    code.push_back("STO " + destination);
-    return true;
-  }
-
-  bool collectAddSubTerms(const Expr &expr, std::vector<std::pair<int, const Expr *>> &terms, int sign)
-  {
-    if (expr.kind == Expr::Kind::Binary && (expr.op == "+" || expr.op == "-"))
-    {
-      if (!collectAddSubTerms(*expr.left, terms, sign))
-        return false;
-      int rightSign = expr.op == "+" ? sign : -sign;
-      return collectAddSubTerms(*expr.right, terms, rightSign);
-    }
-
-    if (expr.kind == Expr::Kind::Literal || expr.kind == Expr::Kind::Variable || expr.kind == Expr::Kind::ArrayAccess)
-    {
-      terms.push_back({sign, &expr});
-      return true;
-    }
-
-    return false;
-  }
-
-  bool emitOptimizedAddSub(const Expr &expr, const std::string &target, std::vector<std::string> &code, std::size_t refPos)
-  {
-    std::vector<std::pair<int, const Expr *>> terms;
-    if (!collectAddSubTerms(expr, terms, 1))
-      return false;
-    if (terms.size() < 2)
-      return false;
-
-    int firstIndex = -1;
-    for (std::size_t i = 0; i < terms.size(); ++i)
-    {
-      if (terms[i].first > 0)
+      if (std::optional<Bip::Instruction> operand = directOperand(expr.op, right, containsCall(left)))
       {
-        firstIndex = static_cast<int>(i);
-        break;
+        load(left);
+        instructions.push_back(*operand);
+        return;
       }
-    }
-    if (firstIndex < 0)
-      return false;
-
-    ExpressionEmitter emitter(code, refPos);
-    emitter.reset();
-    const std::string running = TEMP_VECTOR_VALUE;
-    const std::string scratch = TEMP_VECTOR_VALUE_ALT;
 
-    auto storeTermInto = [&](const std::string &dest, const Expr *node) -> bool {
-      if (node->kind == Expr::Kind::Literal)
-      {
-        std::string decimalValue = convertLiteralToDecimal(node->value);
-        code.push_back("LDI " + decimalValue);
-        code.push_back("STO " + dest);
-        return true;
-      }
-      if (node->kind == Expr::Kind::Variable)
-      {
-        const std::string name = emitter.resolveSymbol(node->value);
-        code.push_back("LD " + name);
-        code.push_back("STO " + dest);
-        return true;
-      }
-      if (node->kind == Expr::Kind::ArrayAccess)
+      // comutativo com a esquerda simples: a direita vai para o acumulador,
+      // mantendo a ordem original (direita antes da esquerda)
+      const bool commutative = expr.op == "+" || expr.op == "*" || expr.op == "&" || expr.op == "|" || expr.op == "^";
+      if (commutative)
       {
-        return emitArrayValueInto(*node, dest, code, emitter);
+        if (std::optional<Bip::Instruction> operand = directOperand(expr.op, left, false))
+        {
+          load(right);
+          instructions.push_back(*operand);
+          return;
+        }
       }
-      std::string temp = emitter.emit(*node);
-      code.push_back("LD " + temp);
-      code.push_back("STO " + dest);
-      return true;
-    };
 
-    auto applyTerm = [&](int sign, const Expr *node) -> bool {
-      const bool positive = sign > 0;
-      if (node->kind == Expr::Kind::Literal)
-      {
-        code.push_back("LD " + running);
-        std::string decimalValue = convertLiteralToDecimal(node->value);
-        code.push_back(std::string(positive ? "ADDI " : "SUBI ") + decimalValue);
-        code.push_back("STO " + running);
-        return true;
-      }
-      if (node->kind == Expr::Kind::Variable)
+      const int rightTemp = spill(right);
+      load(left);
+      instructions.push_back(Bip::temp(opcodeForOperator(expr.op), rightTemp));
+      releaseTemp();
+    }
+
+    void loadCall(const Expr &expr)
+    {
+      ensureFunctionsParsed(state);
+      ensureParametersRegistered(state);
+      if (!state.functionsParsed)
       {
-        const std::string name = emitter.resolveSymbol(node->value);
-        code.push_back("LD " + running);
-        code.push_back(std::string(positive ? "ADD " : "SUB ") + name);
-        code.push_back("STO " + running);
-        return true;
+        throw std::runtime_error("Nenhuma função registrada");
       }
-      if (!storeTermInto(scratch, node))
+      // O Semantico já conferiu a chamada (rotina, aridade e tipos).
+      const FunctionInfo *fn = findFunction(state, expr.name);
+      if (!fn || fn->params.size() != expr.args.size())
       {
-        return false;
+        throw std::runtime_error("Chamada inválida");
       }
-      code.push_back("LD " + running);
-      code.push_back(std::string(positive ? "ADD " : "SUB ") + scratch);
-      code.push_back("STO " + running);
-      return true;
-    };
 
-    if (firstIndex >= 0)
-    {
-      if (!storeTermInto(running, terms[firstIndex].second))
+      // Avalia e copia parâmetros por cópia
+      for (std::size_t idx = 0; idx < fn->params.size(); ++idx)
       {
-        return false;
+        load(*expr.args[idx]);
+        instructions.push_back(Bip::symbol(Bip::Opcode::STO, parameterAlias(state, *fn, idx)));
       }
-    }
-    else
-    {
-      code.push_back("LDI 0");
-      code.push_back("STO " + running);
-    }
 
-    for (std::size_t i = 0; i < terms.size(); ++i)
-    {
-      if (static_cast<int>(i) == firstIndex)
-        continue;
-      if (!applyTerm(terms[i].first, terms[i].second))
-        return false;
+      instructions.push_back(Bip::symbol(Bip::Opcode::CALL, fn->label));
     }
 
-    code.push_back("LD " + running);
-    code.push_back("STO " + target);
-    return true;
-  }
-
-  void generateReadIntoExpression(const Expr &expr, std::vector<std::string> &out, std::size_t refPos)
-  {
-    ExpressionEmitter emitter(out, refPos);
-    emitter.reset();
-    if (expr.kind == Expr::Kind::Variable)
+    Interner::Id resolveName(Interner::Id name) const
     {
-      const std::string name = emitter.resolveSymbol(expr.value);
-      out.push_back("LD $in_port");
-      out.push_back("STO " + name);
-      return;
+      if (name == Interner::NONE)
+        return state.names.intern("");
+      return resolveAlias(state, name, refPos);
     }
-    if (expr.kind == Expr::Kind::ArrayAccess && expr.index)
-    {
-      if (expr.index->kind == Expr::Kind::Literal)
-      {
-        std::string decimalValue = convertLiteralToDecimal(expr.index->value);
-        out.push_back("LDI " + decimalValue);
-      }
-      else if (expr.index->kind == Expr::Kind::Variable)
-      {
-        const std::string name = emitter.resolveSymbol(expr.index->value);
-        out.push_back("LD " + name);
-      }
-      else
-      {
-        std::string indexTemp = emitter.emit(*expr.index);
-        out.push_back("LD " + indexTemp);
-      }
-      out.push_back("STO $indr");
-      out.push_back("LD $in_port");
-      const std::string arrayName = emitter.resolveSymbol(expr.value);
-      out.push_back("STOV " + arrayName);
-      return;
-    }
-    throw std::runtime_error("Destino inválido para leitura");
-  }
+  };
 
-  void generatePrintExpression(const Expr &expr, std::vector<std::string> &out, std::size_t refPos)
+  bool emitCallForContext(BipState &state, const Expr &expr, std::size_t refPos, Code &code, const Interner::Id *storeTarget)
   {
-    ExpressionEmitter emitter(out, refPos);
-    emitter.reset();
-
-    auto emitArrayIndex = [&](const Expr &index) {
-      if (index.kind == Expr::Kind::Literal)
-      {
-        std::string decimalValue = convertLiteralToDecimal(index.value);
-        out.push_back("LDI " + decimalValue);
-        return;
-      }
-      if (index.kind == Expr::Kind::Variable)
-      {
-        const std::string name = emitter.resolveSymbol(index.value);
-        out.push_back("LD " + name);
-        return;
-      }
-      std::string indexTemp = emitter.emit(index);
-      out.push_back("LD " + indexTemp);
-    };
-
-    if (expr.kind == Expr::Kind::ArrayAccess)
+    if (expr.kind != Expr::Kind::Call)
+      return false;
+    ensureFunctionsParsed(state);
+    ensureParametersRegistered(state);
+    const FunctionInfo *fn = findFunction(state, expr.name);
+    if (!fn || fn->params.size() != expr.args.size())
     {
-      if (!expr.index)
-      {
-        throw std::runtime_error("Acesso a vetor sem índice na impressão");
-      }
-      emitArrayIndex(*expr.index);
-      out.push_back("STO $indr");
-      const std::string arrayName = emitter.resolveSymbol(expr.value);
-      out.push_back("LDV " + arrayName);
-      out.push_back("STO $out_port");
-      return;
+      throw std::runtime_error("Chamada inválida");
     }
 
-    if (expr.kind == Expr::Kind::Literal)
+    ExpressionEmitter emitter(state, code, refPos);
+    emitter.reset();
+    for (std::size_t idx = 0; idx < fn->params.size(); ++idx)
     {
-      std::string decimalValue = convertLiteralToDecimal(expr.value);
-      out.push_back("LDI " + decimalValue);
-      out.push_back("STO $out_port");
-      return;
+      emitter.load(*expr.args[idx]);
+      code.push_back(Bip::symbol(Bip::Opcode::STO, parameterAlias(state, *fn, idx)));
     }
 
-    if (expr.kind == Expr::Kind::Variable)
+    code.push_back(Bip::symbol(Bip::Opcode::CALL, fn->label));
+    if (storeTarget)
     {
-      const std::string name = emitter.resolveSymbol(expr.value);
-      out.push_back("LD " + name);
-      out.push_back("STO $out_port");
-      return;
+      code.push_back(Bip::symbol(Bip::Opcode::STO, *storeTarget));
     }
-
-    // Demais expressões: avalia e imprime o resultado temporário
-    std::string temp = emitter.emit(expr);
-    out.push_back("LD " + temp);
-    out.push_back("STO $out_port");
+    return true;
   }
 
-  struct RelationalParts
+  void generateReadIntoExpression(BipState &state, const Expr &expr, Code &out, std::size_t refPos)
   {
-    std::string left;
-    std::string op;
-    std::string right;
-  };
-
-  bool splitRelationalExpression(const std::string &exprText, RelationalParts &out)
-  {
-    int depthParen = 0;
-    int depthBracket = 0;
-    int depthBrace = 0;
-    bool inString = false;
-    char stringDelim = 0;
-    const std::size_t len = exprText.size();
-
-    for (std::size_t i = 0; i < len; ++i)
-    {
-      char c = exprText[i];
-      if (inString)
-      {
-        if (c == '\\' && i + 1 < len)
-        {
-          ++i;
-          continue;
-        }
-        if (c == stringDelim)
-        {
-          inString = false;
-        }
-        continue;
-      }
-      if (c == '"' || c == '\'')
-      {
-        inString = true;
-        stringDelim = c;
-        continue;
-      }
-      if (c == '(')
-      {
-        ++depthParen;
-        continue;
-      }
-      if (c == ')')
-      {
-        --depthParen;
-        continue;
-      }
-      if (c == '[')
-      {
-        ++depthBracket;
-        continue;
-      }
-      if (c == ']')
-      {
-        --depthBracket;
-        continue;
-      }
-      if (c == '{')
-      {
-        ++depthBrace;
-        continue;
-      }
-      if (c == '}')
-      {
-        --depthBrace;
-        continue;
-      }
-      if (depthParen || depthBracket || depthBrace)
-        continue;
+    ExpressionEmitter emitter(state, out, refPos);
+    emitter.reset();
+    if (expr.kind == Expr::Kind::Variable)
+    {
+      const Interner::Id name = emitter.resolveSymbol(expr.name);
+      out.push_back(Bip::make(Bip::Opcode::LD, Bip::Operand::InPort));
+      out.push_back(Bip::symbol(Bip::Opcode::STO, name));
+      return;
+    }
+    if (expr.kind == Expr::Kind::ArrayAccess && expr.index)
+    {
+      emitter.load(*expr.index);
+      out.push_back(STORE_INDEX);
+      out.push_back(Bip::make(Bip::Opcode::LD, Bip::Operand::InPort));
+      const Interner::Id arrayName = emitter.resolveSymbol(expr.name);
+      out.push_back(Bip::symbol(Bip::Opcode::STOV, arrayName));
+      return;
+    }
+    throw std::runtime_error("Destino inválido para leitura");
+  }
+
+  void generatePrintExpression(BipState &state, const Expr &expr, Code &out, std::size_t refPos)
+  {
+    ExpressionEmitter emitter(state, out, refPos);
+    emitter.reset();
+
+    if (expr.kind == Expr::Kind::ArrayAccess && !expr.index)
+    {
+      throw std::runtime_error("Acesso a vetor sem índice na impressão");
+    }
+    emitter.load(expr);
+    out.push_back(Bip::make(Bip::Opcode::STO, Bip::Operand::OutPort));
+  }
 
-      if ((c == '<' || c == '>') && i + 1 < len && exprText[i + 1] == c)
+  // Primeiro operador relacional fora de parênteses e colchetes; o
+  // operador vai em op, como no fonte.
+  bool splitRelational(BipState &state, TokenRange condition, TokenRange &left, std::string_view &op, TokenRange &right)
+  {
+    for (std::size_t idx = condition.first; idx < condition.last; ++idx)
+    {
+      const SourceToken &token = state.sourceTokens[idx];
+      if (isOpeningDelimiter(token.id) && token.match != std::string::npos && token.match < condition.last)
       {
-        ++i;
+        idx = token.match;
         continue;
       }
-
-      if (c == '<' || c == '>' || c == '!' || c == '=')
+      switch (token.id)
       {
-        std::size_t opLen = 1;
-        std::string op(1, c);
-        if (i + 1 < len && exprText[i + 1] == '=')
-        {
-          opLen = 2;
-          op = exprText.substr(i, 2);
-        }
-        else if (c == '!' || c == '=')
-        {
-          continue;
-        }
-
-        std::size_t rightStart = i + opLen;
-        if ((op == "==" || op == "!=") && rightStart < len && exprText[rightStart] == '=')
-        {
-          ++rightStart; // trata === e !== como == e !=
-        }
-
-        out.left = trim(exprText.substr(0, i));
-        out.right = trim(exprText.substr(rightStart));
-        out.op = op;
-        return !out.left.empty() && !out.right.empty();
+      case t_KEY_LESSER: op = "<"; break;
+      case t_KEY_GREATER: op = ">"; break;
+      case t_KEY_LESSER_EQUAL: op = "<="; break;
+      case t_KEY_GREATER_EQUAL: op = ">="; break;
+      case t_KEY_EQUAL: op = "=="; break;
+      case t_KEY_NOT_EQUAL: op = "!="; break;
+      default: continue;
       }
+      left = {condition.first, idx};
+      right = {idx + 1, condition.last};
+      return !left.empty() && !right.empty();
     }
-
     return false;
   }
 
-  std::string branchOpcodeFor(const std::string &op, bool invert, bool preferStrictLess)
+  Bip::Opcode branchOpcodeFor(std::string_view op, bool invert, bool preferStrictLess)
   {
-    const std::string normalized = (op == "===") ? "==" : (op == "!==") ? "!=" : op;
     if (!invert)
     {
-      if (normalized == "<")
-        return "BLT";
-      if (normalized == ">")
-        return "BGT";
-      if (normalized == "<=")
-        return "BLE";
-      if (normalized == ">=")
-        return "BGE";
-      if (normalized == "==")
-        return "BEQ";
-      if (normalized == "!=")
-        return "BNE";
+      if (op == "<")
+        return Bip::Opcode::BLT;
+      if (op == ">")
+        return Bip::Opcode::BGT;
+      if (op == "<=")
+        return Bip::Opcode::BLE;
+      if (op == ">=")
+        return Bip::Opcode::BGE;
+      if (op == "==")
+        return Bip::Opcode::BEQ;
+      if (op == "!=")
+        return Bip::Opcode::BNE;
     }
     else
     {
-      if (normalized == "<")
-        return preferStrictLess ? "BGT" : "BGE";
-      if (normalized == ">")
-        return "BLE";
-      if (normalized == "<=")
-        return "BGT";
-      if (normalized == ">=")
-        return "BLT";
-      if (normalized == "==")
-        return "BNE";
-      if (normalized == "!=")
-        return "BEQ";
+      if (op == "<")
+        return preferStrictLess ? Bip::Opcode::BGT : Bip::Opcode::BGE;
+      if (op == ">")
+        return Bip::Opcode::BLE;
+      if (op == "<=")
+        return Bip::Opcode::BGT;
+      if (op == ">=")
+        return Bip::Opcode::BLT;
+      if (op == "==")
+        return Bip::Opcode::BNE;
+      if (op == "!=")
+        return Bip::Opcode::BEQ;
     }
-    throw std::runtime_error("Operador relacional não suportado: " + op);
+    throw std::runtime_error(std::string("Operador relacional não suportado: ").append(op));
   }
 
-  std::vector<std::string> emitRelationalJump(const std::string &conditionText, const std::string &targetLabel, bool invert, std::size_t refPos, bool preferStrictLess = false)
+  Code emitRelationalJump(BipState &state, TokenRange condition, Interner::Id targetLabel, bool invert, std::size_t refPos, bool preferStrictLess = false)
   {
-    RelationalParts parts;
-    if (!splitRelationalExpression(conditionText, parts))
+    TokenRange leftRange;
+    TokenRange rightRange;
+    std::string_view op;
+    if (!splitRelational(state, condition, leftRange, op, rightRange))
+    {
+      return {};
+    }
+    ExprPtr leftExpr = buildExpression(state, leftRange);
+    ExprPtr rightExpr = buildExpression(state, rightRange);
+    if (!leftExpr || !rightExpr)
     {
       return {};
     }
 
-    std::vector<std::string> code;
+    Code code;
     try
     {
-      auto leftExpr = parseExpressionString(parts.left);
-      auto rightExpr = parseExpressionString(parts.right);
-
-      ExpressionEmitter emitter(code, refPos);
+      ExpressionEmitter emitter(state, code, refPos);
       emitter.reset();
 
-      auto emitIntoTemp = [&](const Expr &expr, const std::string &temp) {
-        if (expr.kind == Expr::Kind::Literal)
-        {
-          std::string decimalValue = convertLiteralToDecimal(expr.value);
-          code.push_back("LDI " + decimalValue);
-          code.push_back("STO " + temp);
-          return;
-        }
-        if (expr.kind == Expr::Kind::Variable)
-        {
-          const std::string name = emitter.resolveSymbol(expr.value);
-          code.push_back("LD " + name);
-          code.push_back("STO " + temp);
-          return;
-        }
-        if (expr.kind == Expr::Kind::ArrayAccess && expr.index)
-        {
-          std::vector<std::string> tmpCode;
-          emitArrayValueInto(expr, temp, tmpCode, emitter);
-          code.insert(code.end(), tmpCode.begin(), tmpCode.end());
-          return;
-        }
-        std::string tmp = emitter.emit(expr);
-        code.push_back("LD " + tmp);
-        code.push_back("STO " + temp);
-      };
-
-      emitIntoTemp(*leftExpr, TEMP_VECTOR_VALUE);
-      emitIntoTemp(*rightExpr, TEMP_VECTOR_VALUE_ALT);
-
-      code.push_back(std::string("LD ") + TEMP_VECTOR_VALUE);
-      code.push_back(std::string("SUB ") + TEMP_VECTOR_VALUE_ALT);
-      const std::string opcode = branchOpcodeFor(parts.op, invert, preferStrictLess);
-      code.push_back(opcode + " " + targetLabel);
+      emitter.loadDifference(*leftExpr, *rightExpr);
+      code.push_back(Bip::symbol(branchOpcodeFor(op, invert, preferStrictLess), targetLabel));
     }
     catch (const std::exception &)
     {
@@ -2180,24 +1615,38 @@ namespace
     return code;
   }
 
-  void addStatementBlock(std::size_t position, std::vector<std::string> code)
+  // Balde da rotina dona de position.
+  StatementBucket &statementBucket(BipState &state, std::size_t position)
+  {
+    const FunctionInfo *fn = functionAt(state, position);
+    auto &buckets = state.statementBuckets;
+    return fn ? buckets[static_cast<std::size_t>(fn - state.functions.data())] : buckets.back();
+  }
+
+  // Blocos já registrados em position, na ordem de saída.
+  std::pair<StatementBucket::const_iterator, StatementBucket::const_iterator> blocksAt(BipState &state, std::size_t position)
+  {
+    const StatementBucket &bucket = statementBucket(state, position);
+    return {bucket.lower_bound({position, false}), bucket.upper_bound({position, true})};
+  }
+
+  void addStatementBlock(BipState &state, std::size_t position, Code code)
   {
     if (code.empty())
       return;
-    statementInstructions.emplace_back(position, std::move(code));
+    const bool label = code.front().isLabel();
+    statementBucket(state, position).emplace(StatementKey{position, !label}, std::move(code));
   }
 
-  void removeBlocksInRange(std::size_t start, std::size_t end)
+  void removeBlocksInRange(BipState &state, std::size_t start, std::size_t end)
   {
     if (start > end)
       return;
-    statementInstructions.erase(
-        std::remove_if(statementInstructions.begin(), statementInstructions.end(),
-                       [&](const auto &entry) { return entry.first >= start && entry.first <= end; }),
-        statementInstructions.end());
+    for (StatementBucket &bucket : state.statementBuckets)
+      bucket.erase(bucket.lower_bound({start, false}), bucket.upper_bound({end, true}));
   }
 
-  bool isIntegerLiteral(const std::string &lexeme)
+  bool isIntegerLiteral(std::string_view lexeme)
   {
     if (lexeme.empty())
     {
@@ -2222,7 +1671,7 @@ namespace
     return true;
   }
 
-  std::size_t inferArrayLength(const Semantico::Variable &variable)
+  std::size_t inferArrayLength(BipState &state, const Semantico::Variable &variable)
   {
     if (!variable.isArray)
     {
@@ -2235,8 +1684,9 @@ namespace
     }
 
     std::size_t count = 0;
-    for (const auto &token : variable.value)
+    for (const Interner::Id id : variable.value)
     {
+      const std::string_view token = state.names.text(id);
       if (isIntegerLiteral(token))
       {
         ++count;
@@ -2255,18 +1705,19 @@ namespace
     return count;
   }
 
-  std::vector<std::string> extractArrayLiterals(const Semantico::Variable &variable)
+  std::vector<std::string> extractArrayLiterals(BipState &state, const Semantico::Variable &variable)
   {
     std::vector<std::string> values;
     if (!variable.literalIsArray)
     {
       return values;
     }
-    for (const auto &token : variable.value)
+    for (const Interner::Id id : variable.value)
     {
+      const std::string_view token = state.names.text(id);
       if (isIntegerLiteral(token))
       {
-        values.push_back(token);
+        values.emplace_back(token);
       }
       else if (isBinaryLiteral(token))
       {
@@ -2276,15 +1727,16 @@ namespace
     return values;
   }
 
-  std::string extractScalarLiteral(const Semantico::Variable &variable)
+  std::string extractScalarLiteral(BipState &state, const Semantico::Variable &variable)
   {
     if (variable.literalIsArray)
     {
       return "";
     }
     std::string literal;
-    for (const auto &token : variable.value)
+    for (const Interner::Id id : variable.value)
     {
+      const std::string_view token = state.names.text(id);
       if (token.empty())
       {
         continue;
@@ -2316,226 +1768,75 @@ namespace
     return literal;
   }
 
-  void emitScalarStore(const std::string &name, const std::string &literal, std::size_t position)
+  void emitScalarStore(BipState &state, Interner::Id name, const std::string &literal, std::size_t position)
   {
-    std::string decimalValue = convertLiteralToDecimal(literal);
-    std::vector<std::string> code;
-    code.push_back("LDI " + decimalValue);
-    code.push_back("STO " + name);
+    Code code;
+    code.push_back(literalOperand(state, Bip::Opcode::LDI, literal));
+    code.push_back(Bip::symbol(Bip::Opcode::STO, name));
     // Se a posição não for válida, empurra para o final para não bagunçar fluxo
     const std::size_t safePos = position == std::string::npos ? std::numeric_limits<std::size_t>::max() - 1 : position;
-    statementInstructions.emplace_back(safePos, std::move(code));
-  }
-
-  bool extractConditionAt(const std::string &src, std::size_t keywordPos, std::size_t keywordLen, std::string &condition, std::size_t &condOpen, std::size_t &condClose)
-  {
-    std::size_t pos = skipWhitespaceAndComments(src, keywordPos + keywordLen);
-    if (pos >= src.size() || src[pos] != '(')
-      return false;
-    condOpen = pos;
-    condClose = findMatchingParenthesis(src, condOpen);
-    if (condClose == std::string::npos)
-      return false;
-    condition = trim(src.substr(condOpen + 1, condClose - condOpen - 1));
-    return true;
+    addStatementBlock(state, safePos, std::move(code));
   }
 
-  bool extractBlockAfter(const std::string &src, std::size_t startPos, std::size_t &openBrace, std::size_t &closeBrace)
+  // Atualização do cabeçalho de um for: i++, i--, ++i, --i ou uma
+  // atribuição "destino = valor".
+  Code generateUpdateInstructions(BipState &state, TokenRange update, std::size_t refPos)
   {
-    std::size_t pos = skipWhitespaceAndComments(src, startPos);
-    if (pos >= src.size() || src[pos] != '{')
-      return false;
-    openBrace = pos;
-    closeBrace = findMatchingBrace(src, openBrace);
-    return closeBrace != std::string::npos;
-  }
-
-  std::vector<std::string> generateUpdateInstructions(const std::string &updateText, std::size_t refPos)
-  {
-    std::string trimmed = trim(updateText);
-    if (trimmed.empty())
+    if (update.empty())
       return {};
+    const auto &tokens = state.sourceTokens;
 
-    auto simpleIncrement = [&](const std::string &name, bool increment) {
-      std::vector<std::string> code;
-      const std::string alias = resolveAlias(name, refPos);
-      code.push_back("LD " + alias);
-      code.push_back(std::string(increment ? "ADDI " : "SUBI ") + "1");
-      code.push_back("STO " + alias);
-      return code;
-    };
-
-    if (trimmed.size() >= 2 && trimmed.substr(trimmed.size() - 2) == "++")
-    {
-      std::string name = trim(trimmed.substr(0, trimmed.size() - 2));
-      if (name.empty())
-        return {};
-      return simpleIncrement(name, true);
-    }
-    if (trimmed.size() >= 2 && trimmed.substr(trimmed.size() - 2) == "--")
-    {
-      std::string name = trim(trimmed.substr(0, trimmed.size() - 2));
-      if (name.empty())
-        return {};
-      return simpleIncrement(name, false);
-    }
-    if (trimmed.size() >= 2 && trimmed[0] == '+' && trimmed[1] == '+')
+    if (update.last - update.first == 2)
     {
-      std::string name = trim(trimmed.substr(2));
-      if (name.empty())
-        return {};
-      return simpleIncrement(name, true);
+      const bool postfix = tokens[update.first].id == t_KEY_VARIABLE;
+      const std::size_t name = postfix ? update.first : update.first + 1;
+      const TokenId step = tokens[postfix ? update.first + 1 : update.first].id;
+      if (tokens[name].id == t_KEY_VARIABLE && (step == t_KEY_INCREMENT || step == t_KEY_DECREMENT))
+      {
+        Code code;
+        const Interner::Id alias = resolveAlias(state, tokens[name].name, refPos);
+        code.push_back(Bip::symbol(Bip::Opcode::LD, alias));
+        code.push_back(Bip::immediate(step == t_KEY_INCREMENT ? Bip::Opcode::ADDI : Bip::Opcode::SUBI, 1));
+        code.push_back(Bip::symbol(Bip::Opcode::STO, alias));
+        return code;
+      }
     }
-    if (trimmed.size() >= 2 && trimmed[0] == '-' && trimmed[1] == '-')
+
+    std::size_t assignIdx = std::string::npos;
+    for (std::size_t idx = update.first; idx < update.last; ++idx)
     {
-      std::string name = trim(trimmed.substr(2));
-      if (name.empty())
-        return {};
-      return simpleIncrement(name, false);
-    }
-
-    int depthParen = 0;
-    int depthBracket = 0;
-    int depthBrace = 0;
-    std::size_t assignPos = std::string::npos;
-    for (std::size_t i = 0; i < trimmed.size(); ++i)
-    {
-      char c = trimmed[i];
-      if (c == '(')
-        ++depthParen;
-      else if (c == ')')
-        --depthParen;
-      else if (c == '[')
-        ++depthBracket;
-      else if (c == ']')
-        --depthBracket;
-      else if (c == '{')
-        ++depthBrace;
-      else if (c == '}')
-        --depthBrace;
-      if (depthParen || depthBracket || depthBrace)
-        continue;
-      if (c == '=')
+      if (isOpeningDelimiter(tokens[idx].id) && tokens[idx].match != std::string::npos && tokens[idx].match < update.last)
+        idx = tokens[idx].match;
+      else if (tokens[idx].id == t_KEY_ATTR)
       {
-        if (i > 0 && (trimmed[i - 1] == '<' || trimmed[i - 1] == '>' || trimmed[i - 1] == '='))
-          continue;
-        if (i + 1 < trimmed.size() && trimmed[i + 1] == '=')
-          continue;
-        assignPos = i;
+        assignIdx = idx;
         break;
       }
     }
-
-    if (assignPos == std::string::npos)
+    if (assignIdx == std::string::npos || tokens[update.first].id != t_KEY_VARIABLE)
       return {};
 
-    const std::string targetText = trim(trimmed.substr(0, assignPos));
-    const std::string rhsText = trim(trimmed.substr(assignPos + 1));
-    if (targetText.empty() || rhsText.empty())
+    ParsedAssignment parsed;
+    parsed.targetName = tokens[update.first].name;
+    if (!parseAssignmentTarget(state, {update.first, assignIdx}, parsed))
+      return {};
+    parsed.rhsExpr = buildExpression(state, {assignIdx + 1, update.last});
+    if (!parsed.rhsExpr || (!parsed.targetIsArray && assignIdx != update.first + 1))
       return {};
 
-    std::vector<std::string> code;
+    Code code;
     try
     {
-      bool targetIsArray = false;
-      std::unique_ptr<Expr> targetIndex;
-      std::string targetName = targetText;
-      std::size_t bracketPos = targetText.find('[');
-      if (bracketPos != std::string::npos)
-      {
-        std::size_t closeBracket = targetText.rfind(']');
-        if (closeBracket != std::string::npos && closeBracket > bracketPos)
-        {
-          targetIsArray = true;
-          targetName = trim(targetText.substr(0, bracketPos));
-          const std::string indexExprText = trim(targetText.substr(bracketPos + 1, closeBracket - bracketPos - 1));
-          if (!indexExprText.empty())
-          {
-            targetIndex = parseExpressionString(indexExprText);
-          }
-        }
-      }
-
-      auto rhsExpr = parseExpressionString(rhsText);
-      const std::string targetAlias = resolveAlias(targetName, refPos);
-
-      // Caminho otimizado: atualizações simples sem temporários extras.
-      auto isSimple = [](const Expr &expr) {
-        return expr.kind == Expr::Kind::Literal || expr.kind == Expr::Kind::Variable;
-      };
-      auto loadSimple = [&](const Expr &expr) -> void {
-        if (expr.kind == Expr::Kind::Literal)
-        {
-          std::string decimalValue = convertLiteralToDecimal(expr.value);
-          code.push_back("LDI " + decimalValue);
-        }
-        else if (expr.kind == Expr::Kind::Variable)
-        {
-          const std::string name = resolveAlias(expr.value, refPos);
-          code.push_back("LD " + name);
-        }
-      };
-
-      if (!targetIsArray)
-      {
-        if (rhsExpr->kind == Expr::Kind::Literal)
-        {
-          std::string decimalValue = convertLiteralToDecimal(rhsExpr->value);
-          code.push_back("LDI " + decimalValue);
-          code.push_back("STO " + targetAlias);
-          return code;
-        }
-        if (rhsExpr->kind == Expr::Kind::Variable)
-        {
-          const std::string srcName = resolveAlias(rhsExpr->value, refPos);
-          code.push_back("LD " + srcName);
-          code.push_back("STO " + targetAlias);
-          return code;
-        }
-        if (rhsExpr->kind == Expr::Kind::Binary && rhsExpr->left && rhsExpr->right &&
-            (rhsExpr->op == "+" || rhsExpr->op == "-") &&
-            isSimple(*rhsExpr->left) && isSimple(*rhsExpr->right))
-        {
-          loadSimple(*rhsExpr->left);
-
-          const Expr &rightNode = *rhsExpr->right;
-          if (rightNode.kind == Expr::Kind::Literal)
-          {
-            std::string decimalValue = convertLiteralToDecimal(rightNode.value);
-            code.push_back(std::string(rhsExpr->op == "+" ? "ADDI " : "SUBI ") + decimalValue);
-          }
-          else
-          {
-            const std::string name = resolveAlias(rightNode.value, refPos);
-            code.push_back(std::string(rhsExpr->op == "+" ? "ADD " : "SUB ") + name);
-          }
-
-          code.push_back("STO " + targetAlias);
-          return code;
-        }
-      }
-
-      // Caminho geral (usa temporários)
-      ExpressionEmitter emitter(code, refPos);
+      ExpressionEmitter emitter(state, code, refPos);
       emitter.reset();
-      std::string valueTemp = emitter.emit(*rhsExpr);
-
-      if (targetIsArray && targetIndex)
+      if (parsed.targetIsArray)
       {
-        std::string idxTemp = emitter.emit(*targetIndex);
-        code.push_back("LD " + idxTemp);
-        code.push_back(std::string("STO ") + TEMP_VECTOR_INDEX);
-        code.push_back("LD " + valueTemp);
-        code.push_back(std::string("STO ") + TEMP_VECTOR_VALUE);
-        code.push_back(std::string("LD ") + TEMP_VECTOR_INDEX);
-        code.push_back("STO $indr");
-        code.push_back(std::string("LD ") + TEMP_VECTOR_VALUE);
-        code.push_back("STOV " + targetAlias);
+        emitter.storeElement(parsed.targetName, *parsed.targetIndex, *parsed.rhsExpr, false);
       }
       else
       {
-        code.push_back("LD " + valueTemp);
-        code.push_back("STO " + targetAlias);
+        emitter.load(*parsed.rhsExpr);
+        code.push_back(Bip::symbol(Bip::Opcode::STO, resolveAlias(state, parsed.targetName, refPos)));
       }
     }
     catch (const std::exception &)
@@ -2545,374 +1846,566 @@ namespace
     return code;
   }
 
-  struct ForHeaderInfo
-  {
-    std::string conditionText;
-    std::string updateText;
-    std::size_t condStart = 0;
-    std::size_t condEnd = 0;
-    std::size_t updateStart = 0;
-    std::size_t updateEnd = 0;
-  };
-
-  bool parseForHeader(const std::string &src, std::size_t parenOpen, std::size_t parenClose, ForHeaderInfo &info)
+  bool parseForHeader(BipState &state, std::size_t parenOpenIdx, std::size_t parenCloseIdx, ForHeaderInfo &info)
   {
-    if (parenOpen >= parenClose || parenClose >= src.size())
-      return false;
-    const std::size_t headerStart = parenOpen + 1;
-    const std::size_t headerLen = parenClose - parenOpen - 1;
-    const std::string header = src.substr(headerStart, headerLen);
+    const auto &tokens = state.sourceTokens;
     int depth = 0;
     std::size_t firstSemi = std::string::npos;
     std::size_t secondSemi = std::string::npos;
-    for (std::size_t i = 0; i < header.size(); ++i)
+    for (std::size_t idx = parenOpenIdx + 1; idx < parenCloseIdx; ++idx)
     {
-      char c = header[i];
-      if (c == '(')
-        ++depth;
-      else if (c == ')')
-        --depth;
-      else if (c == '[')
+      const TokenId id = tokens[idx].id;
+      if (id == t_KEY_LPAREN || id == t_KEY_LBRACKET)
         ++depth;
-      else if (c == ']')
+      else if (id == t_KEY_RPAREN || id == t_KEY_RBRACKET)
         --depth;
-      if (depth == 0 && c == ';')
+      else if (depth == 0 && id == t_KEY_SEMICOLON)
       {
         if (firstSemi == std::string::npos)
-          firstSemi = i;
+          firstSemi = idx;
         else
         {
-          secondSemi = i;
+          secondSemi = idx;
           break;
         }
       }
     }
     if (firstSemi == std::string::npos)
       return false;
-    const std::size_t condStart = headerStart + firstSemi + 1;
-    const std::size_t condEnd = (secondSemi == std::string::npos) ? (parenClose - 1) : (headerStart + secondSemi - 1);
-    const std::size_t updateStart = (secondSemi == std::string::npos) ? condEnd : headerStart + secondSemi + 1;
-    const std::size_t updateEnd = parenClose - 1;
-
-    info.conditionText = trim(src.substr(condStart, condEnd - condStart + 1));
-    info.updateText = trim(src.substr(updateStart, updateEnd - updateStart + 1));
-    info.condStart = condStart;
+    const std::size_t parenClose = tokens[parenCloseIdx].position;
+    const std::size_t condEnd = (secondSemi == std::string::npos) ? (parenClose - 1) : (tokens[secondSemi].position - 1);
+
+    info.condition = {firstSemi + 1, secondSemi == std::string::npos ? parenCloseIdx : secondSemi};
+    info.update = {secondSemi == std::string::npos ? parenCloseIdx : secondSemi + 1, parenCloseIdx};
+    info.condStart = tokens[firstSemi].position + 1;
     info.condEnd = condEnd;
-    info.updateStart = updateStart;
-    info.updateEnd = updateEnd;
+    info.updateStart = (secondSemi == std::string::npos) ? condEnd : tokens[secondSemi].position + 1;
+    info.updateEnd = parenClose - 1;
     return true;
   }
 
-  class ControlFlowGenerator
+  class OutlineBuilder
   {
   public:
-    explicit ControlFlowGenerator(const std::string &source) : src(source), limit(source.size()) {}
+    explicit OutlineBuilder(BipState &state) : state(state) {}
 
-    void parse(std::size_t start = 0, std::size_t end = std::string::npos)
+    void build()
     {
-      if (end == std::string::npos || end > limit)
-        end = limit;
-      parseRange(start, end);
+      state.functions.clear();
+      state.readStatements.clear();
+      state.returnStatements.clear();
+      state.callStatements.clear();
+      state.flowNodes.clear();
+
+      const std::size_t count = state.sourceTokens.size();
+      for (std::size_t idx = 0; idx < count; ++idx)
+      {
+        switch (state.sourceTokens[idx].id)
+        {
+        case t_KEY_FUNCTION:
+          collectFunction(idx);
+          break;
+        case t_KEY_READ:
+          collectRead(idx);
+          break;
+        case t_KEY_RETURN:
+          collectReturn(idx);
+          break;
+        case t_KEY_VARIABLE:
+          collectCall(idx);
+          break;
+        default:
+          break;
+        }
+      }
+      parseRange(0, count, state.flowNodes);
     }
 
   private:
-    const std::string &src;
-    const std::size_t limit;
+    BipState &state;
 
-    void parseRange(std::size_t start, std::size_t end)
+    void collectFunction(std::size_t keywordIdx)
     {
-      std::size_t pos = start;
-      while (pos < end)
+      const std::size_t nameIdx = nextCodeToken(state, keywordIdx + 1);
+      if (nameIdx >= state.sourceTokens.size() || state.sourceTokens[nameIdx].id != t_KEY_VARIABLE)
+        return;
+      FunctionInfo fn;
+      fn.name = state.sourceTokens[nameIdx].name;
+      fn.id = state.names.intern(toLower(std::string(state.names.text(fn.name))));
+      fn.label = functionLabel(state, fn.name);
+      fn.headerStart = state.sourceTokens[keywordIdx].position;
+
+      const std::size_t parenOpen = nextCodeToken(state, nameIdx + 1);
+      const std::size_t parenClose = matchingToken(state, parenOpen, t_KEY_LPAREN);
+      if (parenClose == std::string::npos)
+        return;
+
+      for (std::size_t idx = nextCodeToken(state, parenOpen + 1); idx < parenClose; idx = nextCodeToken(state, idx + 1))
       {
-        pos = skipWhitespaceAndComments(src, pos);
-        if (pos >= end)
-          break;
-        if (isKeywordAt(src, pos, "if"))
-        {
-          if (parseIf(pos, end))
-            continue;
+        if (state.sourceTokens[idx].id != t_KEY_VARIABLE)
+          continue;
+        ParameterInfo param;
+        param.name = state.sourceTokens[idx].name;
+        param.position = state.sourceTokens[idx].position;
+        param.type = Semantico::Type::INT;
+        std::size_t next = nextCodeToken(state, idx + 1);
+        if (next < parenClose && state.sourceTokens[next].id == t_KEY_COLON)
+        {
+          const std::size_t typeIdx = nextCodeToken(state, next + 1);
+          if (typeIdx < parenClose)
+          {
+            param.type = parseTypeName(tokenText(state, typeIdx));
+            next = nextCodeToken(state, typeIdx + 1);
+            if (next < parenClose && state.sourceTokens[next].id == t_KEY_LBRACKET)
+            {
+              param.isArray = true;
+              next = nextCodeToken(state, next + 1);
+            }
+          }
         }
-        else if (isKeywordAt(src, pos, "while"))
+        fn.params.push_back(param);
+        while (next < parenClose && state.sourceTokens[next].id != t_KEY_COMMA)
+          next = nextCodeToken(state, next + 1);
+        idx = next;
+      }
+
+      std::size_t afterParams = nextCodeToken(state, parenClose + 1);
+      fn.returnType = Semantico::Type::VOID;
+      if (afterParams < state.sourceTokens.size() && state.sourceTokens[afterParams].id == t_KEY_COLON)
+      {
+        const std::size_t typeIdx = nextCodeToken(state, afterParams + 1);
+        if (typeIdx >= state.sourceTokens.size())
+          return;
+        fn.returnType = parseTypeName(tokenText(state, typeIdx));
+        afterParams = nextCodeToken(state, typeIdx + 1);
+        // "tipo[]" não é um tipo de retorno suportado pelo BIP
+        while (afterParams < state.sourceTokens.size() && (state.sourceTokens[afterParams].id == t_KEY_LBRACKET || state.sourceTokens[afterParams].id == t_KEY_RBRACKET))
         {
-          if (parseWhile(pos, end))
-            continue;
+          fn.returnType = Semantico::Type::NULLABLE;
+          afterParams = nextCodeToken(state, afterParams + 1);
         }
-        else if (isKeywordAt(src, pos, "do"))
+      }
+
+      const std::size_t bodyClose = matchingToken(state, afterParams, t_KEY_LBRACE);
+      if (bodyClose == std::string::npos)
+        return;
+      fn.bodyStart = state.sourceTokens[afterParams].position;
+      fn.bodyEnd = state.sourceTokens[bodyClose].position;
+      state.functions.push_back(std::move(fn));
+    }
+
+    void collectRead(std::size_t keywordIdx)
+    {
+      const std::size_t open = keywordIdx + 1;
+      const std::size_t close = matchingToken(state, open, t_KEY_LPAREN);
+      if (close == std::string::npos || close == open + 1)
+        return;
+      state.readStatements.push_back({state.sourceTokens[keywordIdx].position, {open + 1, close}});
+    }
+
+    void collectReturn(std::size_t keywordIdx)
+    {
+      const std::size_t exprStart = nextCodeToken(state, keywordIdx + 1);
+      int depth = 0;
+      std::size_t end = exprStart;
+      for (; end < state.sourceTokens.size(); ++end)
+      {
+        const TokenId id = state.sourceTokens[end].id;
+        if (id == t_KEY_SEMICOLON && depth == 0)
+          break;
+        if (isOpeningDelimiter(id))
+          ++depth;
+        else if (isClosingDelimiter(id))
+          --depth;
+      }
+      if (end >= state.sourceTokens.size())
+        return;
+      state.returnStatements.push_back({state.sourceTokens[keywordIdx].position, {exprStart, end}});
+    }
+
+    void collectCall(std::size_t nameIdx)
+    {
+      const std::size_t parenOpen = nextCodeToken(state, nameIdx + 1);
+      const std::size_t parenClose = matchingToken(state, parenOpen, t_KEY_LPAREN);
+      if (parenClose == std::string::npos)
+        return;
+      const std::size_t afterCall = nextCodeToken(state, parenClose + 1);
+      if (afterCall >= state.sourceTokens.size() || state.sourceTokens[afterCall].id != t_KEY_SEMICOLON)
+        return;
+
+      // garante que não é parte de uma atribuição ou expressão maior
+      std::size_t previous = nameIdx;
+      while (previous > 0 && isCommentToken(state.sourceTokens[previous - 1].id))
+        --previous;
+      if (previous > 0)
+      {
+        const TokenId id = state.sourceTokens[previous - 1].id;
+        if (id != t_KEY_SEMICOLON && id != t_KEY_LBRACE && id != t_KEY_RBRACE)
+          return;
+      }
+
+      state.callStatements.push_back({state.sourceTokens[nameIdx].position, {nameIdx, parenClose + 1}});
+    }
+
+    void parseRange(std::size_t start, std::size_t end, std::vector<FlowNode> &out)
+    {
+      std::size_t idx = start;
+      while (idx < end)
+      {
+        idx = nextCodeToken(state, idx);
+        if (idx >= end)
+          break;
+        FlowNode node;
+        bool parsed = false;
+        switch (state.sourceTokens[idx].id)
         {
-          if (parseDoWhile(pos, end))
-            continue;
+        case t_KEY_IF:
+          parsed = parseIf(idx, end, node);
+          break;
+        case t_KEY_WHILE:
+          parsed = parseWhile(idx, end, node);
+          break;
+        case t_KEY_DO:
+          parsed = parseDoWhile(idx, end, node);
+          break;
+        case t_KEY_FOR:
+          parsed = parseFor(idx, end, node);
+          break;
+        default:
+          break;
         }
-        else if (isKeywordAt(src, pos, "for"))
+        if (parsed)
         {
-          if (parseFor(pos, end))
-            continue;
+          out.push_back(std::move(node));
+          continue;
         }
-        ++pos;
+        ++idx;
       }
     }
 
-    bool parseIf(std::size_t &pos, std::size_t end)
+    bool parseCondition(std::size_t keywordIdx, FlowNode &node, std::size_t &condCloseIdx)
+    {
+      const std::size_t condOpenIdx = nextCodeToken(state, keywordIdx + 1);
+      condCloseIdx = matchingToken(state, condOpenIdx, t_KEY_LPAREN);
+      if (condCloseIdx == std::string::npos)
+        return false;
+      node.condOpen = state.sourceTokens[condOpenIdx].position;
+      node.condition = {condOpenIdx + 1, condCloseIdx};
+      return true;
+    }
+
+    bool parseBlock(std::size_t openIdx, std::size_t end, std::size_t &closeIdx)
+    {
+      closeIdx = matchingToken(state, openIdx, t_KEY_LBRACE);
+      return closeIdx != std::string::npos && closeIdx < end;
+    }
+
+    bool parseIf(std::size_t &idx, std::size_t end, FlowNode &node)
     {
-      const std::size_t keywordPos = pos;
-      std::string condition;
-      std::size_t condOpen = 0;
+      node.kind = FlowNode::Kind::If;
+      node.keywordPos = state.sourceTokens[idx].position;
       std::size_t condClose = 0;
-      if (!extractConditionAt(src, keywordPos, 2, condition, condOpen, condClose))
-      {
-        ++pos;
+      if (!parseCondition(idx, node, condClose))
         return false;
-      }
 
-      std::size_t bodyOpen = 0;
+      const std::size_t bodyOpen = nextCodeToken(state, condClose + 1);
       std::size_t bodyClose = 0;
-      if (!extractBlockAfter(src, condClose + 1, bodyOpen, bodyClose) || bodyClose > end)
-      {
-        ++pos;
+      if (!parseBlock(bodyOpen, end, bodyClose))
         return false;
-      }
+      node.bodyOpen = state.sourceTokens[bodyOpen].position;
+      node.bodyClose = state.sourceTokens[bodyClose].position;
 
-      std::size_t afterBody = skipWhitespaceAndComments(src, bodyClose + 1);
-      bool hasElse = afterBody < end && isKeywordAt(src, afterBody, "else");
+      const std::size_t afterBody = nextCodeToken(state, bodyClose + 1);
       std::size_t elseOpen = std::string::npos;
       std::size_t elseClose = std::string::npos;
-
-      if (hasElse)
+      if (afterBody < end && state.sourceTokens[afterBody].id == t_KEY_ELSE)
       {
-        std::size_t afterElse = skipWhitespaceAndComments(src, afterBody + 4);
-        if (!extractBlockAfter(src, afterElse, elseOpen, elseClose))
-        {
-          // else-if sem bloco explícito: tratamos como ausência de else
-          hasElse = false;
-        }
+        // else-if sem bloco explícito: tratamos como ausência de else
+        elseOpen = nextCodeToken(state, afterBody + 1);
+        elseClose = matchingToken(state, elseOpen, t_KEY_LBRACE);
+        node.hasElse = elseClose != std::string::npos;
       }
 
-      std::string falseLabel = nextLabel();
-      auto condInstr = emitRelationalJump(condition, falseLabel, true, condOpen);
-      if (!condInstr.empty())
+      parseRange(bodyOpen + 1, bodyClose, node.body);
+      if (!node.hasElse)
       {
-        addStatementBlock(keywordPos, std::move(condInstr));
+        idx = bodyClose + 1;
+        return true;
       }
 
-      parseRange(bodyOpen + 1, bodyClose);
+      node.elseOpen = state.sourceTokens[elseOpen].position;
+      node.elseClose = state.sourceTokens[elseClose].position;
+      parseRange(elseOpen + 1, elseClose, node.elseBody);
+      idx = elseClose + 1;
+      return true;
+    }
 
-      if (!hasElse || elseOpen == std::string::npos || elseClose == std::string::npos)
-      {
-        addStatementBlock(bodyClose + 1, {falseLabel + ":"});
-        pos = bodyClose + 1;
-        return true;
-      }
+    bool parseWhile(std::size_t &idx, std::size_t end, FlowNode &node)
+    {
+      node.kind = FlowNode::Kind::While;
+      node.keywordPos = state.sourceTokens[idx].position;
+      std::size_t condClose = 0;
+      if (!parseCondition(idx, node, condClose))
+        return false;
 
-      std::string endLabel = nextLabel();
-      addStatementBlock(bodyClose, {"JMP " + endLabel});
-      addStatementBlock(elseOpen, {falseLabel + ":"});
-      parseRange(elseOpen + 1, elseClose);
-      addStatementBlock(elseClose + 1, {endLabel + ":"});
-      pos = elseClose + 1;
+      const std::size_t bodyOpen = nextCodeToken(state, condClose + 1);
+      std::size_t bodyClose = 0;
+      if (!parseBlock(bodyOpen, end, bodyClose))
+        return false;
+      node.bodyOpen = state.sourceTokens[bodyOpen].position;
+      node.bodyClose = state.sourceTokens[bodyClose].position;
+      parseRange(bodyOpen + 1, bodyClose, node.body);
+      idx = bodyClose + 1;
       return true;
     }
 
-    bool parseWhile(std::size_t &pos, std::size_t end)
+    bool parseDoWhile(std::size_t &idx, std::size_t end, FlowNode &node)
     {
-      const std::size_t keywordPos = pos;
-      std::string condition;
-      std::size_t condOpen = 0;
+      node.kind = FlowNode::Kind::DoWhile;
+      node.keywordPos = state.sourceTokens[idx].position;
+      const std::size_t blockOpen = nextCodeToken(state, idx + 1);
+      std::size_t blockClose = 0;
+      if (!parseBlock(blockOpen, end, blockClose))
+        return false;
+      node.bodyOpen = state.sourceTokens[blockOpen].position;
+      node.bodyClose = state.sourceTokens[blockClose].position;
+      parseRange(blockOpen + 1, blockClose, node.body);
+      idx = blockClose + 1;
+
+      const std::size_t afterBlock = nextCodeToken(state, blockClose + 1);
+      if (afterBlock >= end || state.sourceTokens[afterBlock].id != t_KEY_WHILE)
+        return true;
+
       std::size_t condClose = 0;
-      if (!extractConditionAt(src, keywordPos, 5, condition, condOpen, condClose))
-      {
-        ++pos;
+      if (!parseCondition(afterBlock, node, condClose))
+        return true;
+
+      node.hasTrailingCondition = true;
+      node.trailingKeywordPos = state.sourceTokens[afterBlock].position;
+      idx = nextCodeToken(state, condClose + 1);
+      if (idx < end && state.sourceTokens[idx].id == t_KEY_SEMICOLON)
+        ++idx;
+      return true;
+    }
+
+    bool parseFor(std::size_t &idx, std::size_t end, FlowNode &node)
+    {
+      node.kind = FlowNode::Kind::For;
+      node.keywordPos = state.sourceTokens[idx].position;
+      const std::size_t parenOpen = nextCodeToken(state, idx + 1);
+      if (parenOpen >= end)
+        return false;
+      const std::size_t parenClose = matchingToken(state, parenOpen, t_KEY_LPAREN);
+      if (parenClose == std::string::npos || parenClose > end)
+        return false;
+      if (!parseForHeader(state, parenOpen, parenClose, node.header))
         return false;
-      }
 
-      std::size_t bodyOpen = 0;
+      const std::size_t bodyOpen = nextCodeToken(state, parenClose + 1);
       std::size_t bodyClose = 0;
-      if (!extractBlockAfter(src, condClose + 1, bodyOpen, bodyClose) || bodyClose > end)
-      {
-        ++pos;
+      if (!parseBlock(bodyOpen, end, bodyClose))
         return false;
+      node.bodyOpen = state.sourceTokens[bodyOpen].position;
+      node.bodyClose = state.sourceTokens[bodyClose].position;
+      parseRange(bodyOpen + 1, bodyClose, node.body);
+      idx = bodyClose + 1;
+      return true;
+    }
+  };
+
+  void ensureFunctionsParsed(BipState &state)
+  {
+    if (state.functionsParsed)
+      return;
+    state.functionsParsed = true;
+    OutlineBuilder builder(state);
+    builder.build();
+    state.outerFunctions.clear();
+    for (std::size_t idx = 0; idx < state.functions.size(); ++idx)
+    {
+      if (state.outerFunctions.empty() || state.functions[idx].bodyStart > state.functions[state.outerFunctions.back()].bodyEnd)
+        state.outerFunctions.push_back(idx);
+    }
+    state.statementBuckets.assign(state.functions.size() + 1, StatementBucket());
+  }
+
+  class ControlFlowGenerator
+  {
+  public:
+    explicit ControlFlowGenerator(BipState &state) : state(state) {}
+
+    void generate(const std::vector<FlowNode> &nodes)
+    {
+      for (const auto &node : nodes)
+      {
+        switch (node.kind)
+        {
+        case FlowNode::Kind::If:
+          generateIf(node);
+          break;
+        case FlowNode::Kind::While:
+          generateWhile(node);
+          break;
+        case FlowNode::Kind::DoWhile:
+          generateDoWhile(node);
+          break;
+        case FlowNode::Kind::For:
+          generateFor(node);
+          break;
+        }
       }
+    }
 
-      std::string startLabel = nextLabel();
-      std::string endLabel = nextLabel();
+  private:
+    BipState &state;
 
-      addStatementBlock(keywordPos, {startLabel + ":"});
-      auto condInstr = emitRelationalJump(condition, endLabel, true, condOpen);
+    void generateIf(const FlowNode &node)
+    {
+      const Interner::Id falseLabel = nextLabel(state);
+      auto condInstr = emitRelationalJump(state, node.condition, falseLabel, true, node.condOpen);
       if (!condInstr.empty())
       {
-        addStatementBlock(keywordPos + 1, std::move(condInstr));
+        addStatementBlock(state, node.keywordPos, std::move(condInstr));
       }
 
-      parseRange(bodyOpen + 1, bodyClose);
-      // Mantém o salto de repetição colado ao fechamento do bloco,
-      // seguido imediatamente pelo rótulo de saída, para evitar que
-      // instruções após o while caiam entre o JMP e o label.
-      addStatementBlock(bodyClose, {"JMP " + startLabel});
-      addStatementBlock(bodyClose, {endLabel + ":"});
-      pos = bodyClose + 1;
-      return true;
-    }
+      generate(node.body);
 
-    bool parseDoWhile(std::size_t &pos, std::size_t end)
-    {
-      const std::size_t keywordPos = pos;
-      std::size_t blockOpen = 0;
-      std::size_t blockClose = 0;
-      std::size_t afterDo = skipWhitespaceAndComments(src, keywordPos + 2);
-      if (!extractBlockAfter(src, afterDo, blockOpen, blockClose) || blockClose > end)
+      if (!node.hasElse)
       {
-        ++pos;
-        return false;
+        addStatementBlock(state, node.bodyClose + 1, {Bip::label(falseLabel)});
+        return;
       }
 
-      std::string startLabel = nextLabel();
-      addStatementBlock(keywordPos, {startLabel + ":"});
-      parseRange(blockOpen + 1, blockClose);
-
-      std::size_t afterBlock = skipWhitespaceAndComments(src, blockClose + 1);
-      if (afterBlock >= end || !isKeywordAt(src, afterBlock, "while"))
-      {
-        pos = blockClose + 1;
-        return true;
-      }
+      const Interner::Id endLabel = nextLabel(state);
+      addStatementBlock(state, node.bodyClose, {Bip::symbol(Bip::Opcode::JMP, endLabel)});
+      addStatementBlock(state, node.elseOpen, {Bip::label(falseLabel)});
+      generate(node.elseBody);
+      addStatementBlock(state, node.elseClose + 1, {Bip::label(endLabel)});
+    }
 
-      std::string condition;
-      std::size_t condOpen = 0;
-      std::size_t condClose = 0;
-      if (!extractConditionAt(src, afterBlock, 5, condition, condOpen, condClose))
-      {
-        pos = blockClose + 1;
-        return true;
-      }
+    void generateWhile(const FlowNode &node)
+    {
+      const Interner::Id startLabel = nextLabel(state);
+      const Interner::Id endLabel = nextLabel(state);
 
-      auto condInstr = emitRelationalJump(condition, startLabel, false, condOpen);
+      addStatementBlock(state, node.keywordPos, {Bip::label(startLabel)});
+      auto condInstr = emitRelationalJump(state, node.condition, endLabel, true, node.condOpen);
       if (!condInstr.empty())
       {
-        addStatementBlock(afterBlock, std::move(condInstr));
+        addStatementBlock(state, node.keywordPos + 1, std::move(condInstr));
       }
 
-      pos = condClose + 1;
-      pos = skipWhitespaceAndComments(src, pos);
-      if (pos < end && src[pos] == ';')
-        ++pos;
-      return true;
+      generate(node.body);
+      // Mantém o salto de repetição colado ao fechamento do bloco e o
+      // rótulo de saída logo depois dele: na mesma posição o rótulo viria
+      // antes do JMP (rótulos primeiro) e o laço nunca sairia.
+      addStatementBlock(state, node.bodyClose, {Bip::symbol(Bip::Opcode::JMP, startLabel)});
+      addStatementBlock(state, node.bodyClose + 1, {Bip::label(endLabel)});
     }
 
-    bool parseFor(std::size_t &pos, std::size_t end)
+    void generateDoWhile(const FlowNode &node)
     {
-      const std::size_t keywordPos = pos;
-      std::size_t parenOpen = skipWhitespaceAndComments(src, keywordPos + 3);
-      if (parenOpen >= end || src[parenOpen] != '(')
-      {
-        ++pos;
-        return false;
-      }
-      std::size_t parenClose = findMatchingParenthesis(src, parenOpen);
-      if (parenClose == std::string::npos || parenClose > end)
-      {
-        ++pos;
-        return false;
-      }
+      const Interner::Id startLabel = nextLabel(state);
+      addStatementBlock(state, node.keywordPos, {Bip::label(startLabel)});
+      generate(node.body);
 
-      ForHeaderInfo header;
-      if (!parseForHeader(src, parenOpen, parenClose, header))
-      {
-        ++pos;
-        return false;
-      }
+      if (!node.hasTrailingCondition)
+        return;
 
-      std::size_t bodyOpen = 0;
-      std::size_t bodyClose = 0;
-      if (!extractBlockAfter(src, parenClose + 1, bodyOpen, bodyClose) || bodyClose > end)
+      auto condInstr = emitRelationalJump(state, node.condition, startLabel, false, node.condOpen);
+      if (!condInstr.empty())
       {
-        ++pos;
-        return false;
+        addStatementBlock(state, node.trailingKeywordPos, std::move(condInstr));
       }
+    }
 
-      std::string startLabel = nextLabel();
-      std::string endLabel = nextLabel();
+    void generateFor(const FlowNode &node)
+    {
+      const ForHeaderInfo &header = node.header;
+      const Interner::Id startLabel = nextLabel(state);
+      const Interner::Id endLabel = nextLabel(state);
 
-      addStatementBlock(header.condStart, {startLabel + ":"});
-      if (!header.conditionText.empty())
+      addStatementBlock(state, header.condStart, {Bip::label(startLabel)});
+      if (!header.condition.empty())
       {
-        auto condInstr = emitRelationalJump(header.conditionText, endLabel, true, header.condStart, true);
+        auto condInstr = emitRelationalJump(state, header.condition, endLabel, true, header.condStart, true);
         if (!condInstr.empty())
         {
-          addStatementBlock(header.condStart + 1, std::move(condInstr));
+          addStatementBlock(state, header.condStart + 1, std::move(condInstr));
         }
       }
 
-      parseRange(bodyOpen + 1, bodyClose);
+      generate(node.body);
 
-      removeBlocksInRange(header.updateStart, header.updateEnd);
-      auto updateInstr = generateUpdateInstructions(header.updateText, header.updateStart);
+      removeBlocksInRange(state, header.updateStart, header.updateEnd);
+      auto updateInstr = generateUpdateInstructions(state, header.update, header.updateStart);
       if (!updateInstr.empty())
       {
-        const std::size_t updatePos = bodyClose > 0 ? bodyClose - 1 : bodyClose;
-        addStatementBlock(updatePos, std::move(updateInstr));
+        const std::size_t updatePos = node.bodyClose > 0 ? node.bodyClose - 1 : node.bodyClose;
+        addStatementBlock(state, updatePos, std::move(updateInstr));
       }
 
-      addStatementBlock(bodyClose, {"JMP " + startLabel});
-      addStatementBlock(bodyClose + 1, {endLabel + ":"});
-      pos = bodyClose + 1;
-      return true;
+      addStatementBlock(state, node.bodyClose, {Bip::symbol(Bip::Opcode::JMP, startLabel)});
+      addStatementBlock(state, node.bodyClose + 1, {Bip::label(endLabel)});
     }
   };
 
-  void generateControlFlow()
+  void generateControlFlow(BipState &state)
   {
-    if (controlFlowGenerated)
+    if (state.controlFlowGenerated)
       return;
-    controlFlowGenerated = true;
-    ControlFlowGenerator parser(Semantico::sourceCode);
-    parser.parse();
+    state.controlFlowGenerated = true;
+    ensureFunctionsParsed(state);
+    ControlFlowGenerator generator(state);
+    generator.generate(state.flowNodes);
   }
 
-  std::string buildCode()
+  // Seção .text na ordem final: rotinas na ordem do fonte (a de
+  // functions) e depois o programa principal. Os baldes já estão em ordem,
+  // então é só percorrê-los.
+  Code buildText(BipState &state)
   {
-    ensureFunctionsParsed();
-    ensureParametersRegistered();
-
-    std::unordered_map<std::string, std::vector<std::pair<std::size_t, std::vector<std::string>>>> grouped;
-    for (const auto &stmt : statementInstructions)
-    {
-      const std::string fn = functionForPosition(stmt.first);
-      grouped[fn].push_back(stmt);
-    }
+    ensureFunctionsParsed(state);
+    ensureParametersRegistered(state);
 
-    auto emitInstructionBlocks = [&](const std::vector<std::pair<std::size_t, std::vector<std::string>>> &blocks, std::ostringstream &os) {
-      if (blocks.empty())
-        return;
-      auto sorted = blocks;
-      std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
-        if (a.first != b.first)
-          return a.first < b.first;
-        const bool aLabel = !a.second.empty() && !a.second.front().empty() && a.second.front().back() == ':';
-        const bool bLabel = !b.second.empty() && !b.second.front().empty() && b.second.front().back() == ':';
-        if (aLabel != bLabel)
-          return aLabel && !bLabel;
-        return false;
-      });
-      for (const auto &blk : sorted)
+    Code text;
+    auto emitBucket = [&text](const StatementBucket &bucket) {
+      for (const auto &block : bucket)
       {
-        for (const auto &instr : blk.second)
-        {
-          const bool isLabel = !instr.empty() && instr.back() == ':';
-          if (isLabel)
-          {
-            os << instr << "\n";
-          }
-          else
-          {
-            os << "    " << instr << "\n";
-          }
-        }
+        text.insert(text.end(), block.second.begin(), block.second.end());
       }
     };
 
-    std::ostringstream out;
-    out << ".data\n";
-    for (const auto &entry : entries)
+    const Interner::Id principal = state.names.intern("_PRINCIPAL");
+    text.push_back(Bip::symbol(Bip::Opcode::JMP, principal));
+
+    for (std::size_t idx = 0; idx < state.functions.size(); ++idx)
+    {
+      const FunctionInfo &fn = state.functions[idx];
+      text.push_back(Bip::label(fn.label));
+      emitBucket(state.statementBuckets[idx]);
+      // Garante retorno apenas se não houver return explícito
+      if (!state.functionsWithReturn.count(fn.id))
+      {
+        text.push_back(Bip::immediate(Bip::Opcode::RETURN, 0));
+      }
+    }
+
+    text.push_back(Bip::label(principal));
+    emitBucket(state.statementBuckets.back());
+    text.push_back(Bip::immediate(Bip::Opcode::HLT, 0));
+    return text;
+  }
+
+  // O programa em texto: .data das entradas e .text formatado de uma vez.
+  std::string formatCode(BipState &state, const Code &text)
+  {
+    std::string out = ".data\n";
+    for (const auto &entry : state.entries)
     {
-      out << "  " << entry.name << ": ";
+      out += "  ";
+      out += state.names.text(entry.name);
+      out += ": ";
       if (entry.isArray)
       {
         const std::size_t length = entry.elementCount > 0 ? entry.elementCount : 1;
@@ -2920,79 +2413,245 @@ namespace
         {
           if (idx > 0)
           {
-            out << ",";
+            out += ',';
           }
-          out << "0";
+          out += '0';
         }
       }
       else
       {
         if (entry.hasInitializer && !entry.literalValues.empty())
         {
-          out << entry.literalValues.front();
+          out += entry.literalValues.front();
         }
         else
         {
-          out << "0";
+          out += '0';
         }
       }
-      out << "\n";
+      out += '\n';
+    }
+    out += ".text\n";
+    for (const Bip::Instruction &instruction : text)
+    {
+      Bip::format(instruction, state.names, out);
+    }
+    return out;
+  }
+}
+
+namespace BipGenerator
+{
+
+  // Limpa só o que render() produz; os tokens e as instruções registradas
+  // durante o parse continuam valendo.
+  void resetRenderState(BipState &state)
+  {
+    state.entries.clear();
+    state.entryNames.clear();
+    state.cachedCode.clear();
+    state.peepholeStats = BipPeephole::Stats();
+    state.statementBuckets.clear();
+    state.controlFlowGenerated = false;
+    state.scopeIndexBuilt = false;
+    state.braceEvents.clear();
+    state.forHeaderRanges.clear();
+    state.recordedStatementsGenerated = false;
+    state.readStatements.clear();
+    state.returnStatements.clear();
+    state.callStatements.clear();
+    state.flowNodes.clear();
+    state.labelCounter = 1;
+    state.aliasEntries.clear();
+    state.aliasIndex.clear();
+    state.aliasCounters.clear();
+    state.seenPrints.clear();
+    state.functions.clear();
+    state.outerFunctions.clear();
+    state.parameterAliasMap.clear();
+    state.functionsByName.clear();
+    state.functionsParsed = false;
+    state.parametersRegistered = false;
+    state.functionsWithReturn.clear();
+    state.exprArena.reset();
+  }
+
+  void reset(CompilationContext &context)
+  {
+    BipState &state = context.bip();
+    state.sourceTokens.clear();
+    state.openDelimiters.clear();
+    state.recordedStatements.clear();
+    resetRenderState(state);
+  }
+
+  Checkpoint checkpoint(CompilationContext &context)
+  {
+    const BipState &state = context.bip();
+    return {state.sourceTokens.size(), state.recordedStatements.size(), state.openDelimiters};
+  }
+
+  struct ParseTail
+  {
+    std::size_t tokenOffset = 0;
+    std::size_t statementOffset = 0;
+    std::vector<SourceToken> sourceTokens;
+    std::vector<RecordedStatement> recordedStatements;
+    std::vector<std::size_t> openDelimiters;
+  };
+
+  std::shared_ptr<ParseTail> restoreCheckpoint(CompilationContext &context, const Checkpoint &saved)
+  {
+    BipState &state = context.bip();
+    auto tail = std::make_shared<ParseTail>();
+    tail->tokenOffset = saved.tokens;
+    tail->statementOffset = saved.statements;
+    tail->sourceTokens.assign(std::make_move_iterator(state.sourceTokens.begin() + saved.tokens),
+                              std::make_move_iterator(state.sourceTokens.end()));
+    tail->recordedStatements.assign(std::make_move_iterator(state.recordedStatements.begin() + saved.statements),
+                                    std::make_move_iterator(state.recordedStatements.end()));
+    tail->openDelimiters = std::move(state.openDelimiters);
+
+    state.sourceTokens.resize(saved.tokens);
+    state.recordedStatements.resize(saved.statements);
+    // delimitadores abertos no ponto salvo podem ter sido fechados depois
+    state.openDelimiters = saved.openDelimiters;
+    for (std::size_t opener : state.openDelimiters)
+      state.sourceTokens[opener].match = std::string::npos;
+    resetRenderState(state);
+    return tail;
+  }
+
+  bool checkpointMatches(CompilationContext &context, const Checkpoint &saved, const TokenShift &tokens)
+  {
+    const BipState &state = context.bip();
+    if (state.openDelimiters.size() != saved.openDelimiters.size())
+      return false;
+    for (std::size_t i = 0; i < saved.openDelimiters.size(); ++i)
+    {
+      if (state.openDelimiters[i] != tokens.apply(saved.openDelimiters[i]))
+        return false;
     }
-    out << ".text\n";
-    out << "    JMP _PRINCIPAL\n";
+    return true;
+  }
 
-    auto sortedFunctions = functions;
-    std::sort(sortedFunctions.begin(), sortedFunctions.end(), [](const FunctionInfo &a, const FunctionInfo &b) {
-      return a.headerStart < b.headerStart;
-    });
+  void appendParseTail(CompilationContext &context, ParseTail &tail, const Checkpoint &from,
+                       const TokenShift &tokens, const SourceShift &shift)
+  {
+    BipState &state = context.bip();
+    const auto movePosition = [&shift](std::size_t position) {
+      return static_cast<std::size_t>(shift.apply(static_cast<int>(position)));
+    };
 
-    for (const auto &fn : sortedFunctions)
+    for (std::size_t i = from.tokens - tail.tokenOffset; i < tail.sourceTokens.size(); ++i)
     {
-      out << fn.label << ":\n";
-      const auto it = grouped.find(fn.lowerName);
-      if (it != grouped.end())
+      SourceToken token = tail.sourceTokens[i];
+      token.position = movePosition(token.position);
+      if (token.match != std::string::npos)
       {
-        emitInstructionBlocks(it->second, out);
+        token.match = tokens.apply(token.match);
+        // abridor anterior ao ponto de junção: fecha aqui
+        if (token.match < state.sourceTokens.size())
+          state.sourceTokens[token.match].match = state.sourceTokens.size();
       }
-      // Garante retorno apenas se não houver return explícito
-      if (!functionsWithReturn.count(fn.lowerName))
+      state.sourceTokens.push_back(token);
+    }
+
+    for (std::size_t i = from.statements - tail.statementOffset; i < tail.recordedStatements.size(); ++i)
+    {
+      RecordedStatement statement = std::move(tail.recordedStatements[i]);
+      statement.position = movePosition(statement.position);
+      Semantico::Variable &variable = statement.variable;
+      shift.apply(variable.position, variable.line, variable.column);
+      for (int &position : variable.valuePositions)
+        position = shift.apply(position);
+      if (statement.kind == RecordedStatement::Kind::Print)
+        statement.argumentOpen = tokens.apply(statement.argumentOpen);
+      state.recordedStatements.push_back(std::move(statement));
+    }
+
+    state.openDelimiters.clear();
+    for (std::size_t opener : tail.openDelimiters)
+      state.openDelimiters.push_back(tokens.apply(opener));
+  }
+
+  void shiftCheckpoint(Checkpoint &saved, const TokenShift &tokens, std::ptrdiff_t statements)
+  {
+    saved.tokens = tokens.apply(saved.tokens);
+    saved.statements += statements;
+    for (std::size_t &opener : saved.openDelimiters)
+      opener = tokens.apply(opener);
+  }
+
+  void generateAssignment(BipState &state, const Semantico::Variable &variable);
+
+  void registerToken(CompilationContext &context, const ::Token &token)
+  {
+    BipState &state = context.bip();
+    SourceToken recorded;
+    recorded.id = token.getId();
+    recorded.position = static_cast<std::size_t>(token.getPosition());
+    recorded.length = token.getLexeme().size();
+    if (recorded.id == t_KEY_VARIABLE)
+      recorded.name = context.names().intern(token.getLexeme());
+    const std::size_t index = state.sourceTokens.size();
+    if (isOpeningDelimiter(recorded.id))
+    {
+      state.openDelimiters.push_back(index);
+    }
+    else if (isClosingDelimiter(recorded.id) && !state.openDelimiters.empty())
+    {
+      const std::size_t opener = state.openDelimiters.back();
+      if (matchesDelimiter(state.sourceTokens[opener].id, recorded.id))
       {
-        out << "    RETURN 0\n";
+        state.openDelimiters.pop_back();
+        state.sourceTokens[opener].match = index;
+        recorded.match = opener;
       }
     }
+    state.sourceTokens.push_back(recorded);
+  }
+
+  std::size_t openDelimiterCount(CompilationContext &context)
+  {
+    return context.bip().openDelimiters.size();
+  }
 
-    out << "_PRINCIPAL:\n";
-    emitInstructionBlocks(grouped[""], out);
-    out << "  HLT 0\n";
+  void abandonDelimiters(CompilationContext &context, std::size_t count)
+  {
+    std::vector<std::size_t> &open = context.bip().openDelimiters;
+    if (open.size() > count)
+      open.resize(count);
+  }
 
-    return out.str();
+  void registerDeclaration(CompilationContext &context, const Semantico::Variable &variable)
+  {
+    context.bip().recordedStatements.push_back({RecordedStatement::Kind::Declaration, variable, 0, {}});
   }
-}
 
-namespace BipGenerator
-{
+  void registerAssignment(CompilationContext &context, const Semantico::Variable &variable)
+  {
+    context.bip().recordedStatements.push_back({RecordedStatement::Kind::Assignment, variable, 0, {}});
+  }
 
-  void reset()
+  void registerPrintStatement(CompilationContext &context)
   {
-    entries.clear();
-    cachedCode.clear();
-    statementInstructions.clear();
-    readStatementsScanned = false;
-    controlFlowGenerated = false;
-    labelCounter = 1;
-    aliasEntries.clear();
-    aliasCounters.clear();
-    seenPrints.clear();
-    functions.clear();
-    parameterAliasMap.clear();
-    functionsParsed = false;
-    parametersRegistered = false;
-    functionsWithReturn.clear();
+    // o print acabou de ser aceito: o último "print" registrado é o dele, e
+    // o bloco fica na posição do argumento
+    const std::vector<SourceToken> &tokens = context.bip().sourceTokens;
+    for (std::size_t idx = tokens.size(); idx-- > 0;)
+    {
+      if (tokens[idx].id != t_KEY_PRINT)
+        continue;
+      if (idx + 2 < tokens.size() && tokens[idx + 1].id == t_KEY_LPAREN)
+        context.bip().recordedStatements.push_back({RecordedStatement::Kind::Print, {}, tokens[idx + 2].position, idx + 1});
+      return;
+    }
   }
 
-  void registerDeclaration(const Semantico::Variable &variable)
+  void generateDeclaration(BipState &state, const Semantico::Variable &variable)
   {
-    if (variable.name.empty())
+    if (variable.name == Interner::NONE)
     {
       return;
     }
@@ -3002,12 +2661,12 @@ namespace BipGenerator
     }
 
     const std::size_t declPos = variable.position >= 0 ? static_cast<std::size_t>(variable.position) : 0;
-    const std::string alias = registerAlias(variable.name, static_cast<int>(declPos));
+    const Interner::Id alias = registerAlias(state, variable.name, static_cast<int>(declPos));
 
     Entry entry;
     entry.name = alias;
     entry.isArray = variable.isArray;
-    entry.elementCount = entry.isArray ? inferArrayLength(variable) : 1;
+    entry.elementCount = entry.isArray ? inferArrayLength(state, variable) : 1;
     
     bool hasSimpleLiteral = false;
     
@@ -3015,13 +2674,13 @@ namespace BipGenerator
     {
       if (entry.isArray)
       {
-        entry.literalValues = extractArrayLiterals(variable);
+        entry.literalValues = extractArrayLiterals(state, variable);
         entry.hasInitializer = !entry.literalValues.empty();
         hasSimpleLiteral = entry.hasInitializer;
       }
       else
       {
-        std::string literal = extractScalarLiteral(variable);
+        std::string literal = extractScalarLiteral(state, variable);
         if (!literal.empty())
         {
           entry.literalValues.push_back(std::move(literal));
@@ -3031,301 +2690,132 @@ namespace BipGenerator
       }
     }
 
-    entries.push_back(std::move(entry));
-    Entry &current = entries.back();
+    state.entryNames.insert(entry.name);
+    state.entries.push_back(std::move(entry));
+    Entry &current = state.entries.back();
     
     // Inicialização de arrays com valores literais (inserida na posição da declaração)
     if (current.isArray && !current.literalValues.empty())
     {
       const std::size_t count = current.literalValues.size();
       current.elementCount = count;
-      std::vector<std::string> code;
+      Code code;
+      const Interner::Id name = current.name;
       for (std::size_t idx = 0; idx < count; ++idx)
       {
-        code.push_back("LDI " + std::to_string(static_cast<int>(idx)));
-        code.push_back("STO $indr");
-        code.push_back("LDI " + current.literalValues[idx]);
-        code.push_back("STOV " + current.name);
+        code.push_back(Bip::immediate(Bip::Opcode::LDI, static_cast<int>(idx)));
+        code.push_back(STORE_INDEX);
+        code.push_back(Bip::literal(Bip::Opcode::LDI, current.literalValues[idx], state.names));
+        code.push_back(Bip::symbol(Bip::Opcode::STOV, name));
       }
       if (!code.empty())
       {
-        statementInstructions.emplace_back(declPos, std::move(code));
+        addStatementBlock(state, declPos, std::move(code));
       }
     }
     // Inicialização de variável escalar com literal simples
     else if (!current.isArray && current.hasInitializer && !current.literalValues.empty())
     {
-      std::vector<std::string> code;
-      code.push_back("LDI " + current.literalValues.front());
-      code.push_back("STO " + current.name);
-      statementInstructions.emplace_back(declPos, std::move(code));
+      Code code;
+      code.push_back(Bip::literal(Bip::Opcode::LDI, current.literalValues.front(), state.names));
+      code.push_back(Bip::symbol(Bip::Opcode::STO, current.name));
+      addStatementBlock(state, declPos, std::move(code));
     }
     // Se tem inicialização mas não é literal simples, tenta processar como atribuição
     else if (!current.isArray && variable.isInitialized && !hasSimpleLiteral)
     {
       // Tem inicialização com expressão complexa, processa como atribuição
-      registerAssignment(variable);
+      generateAssignment(state, variable);
     }
   }
 
-  void registerAssignment(const Semantico::Variable &variable)
+  void generateAssignment(BipState &state, const Semantico::Variable &variable)
   {
-    if (variable.name.empty())
+    if (variable.name == Interner::NONE)
     {
       return;
     }
     ParsedAssignment parsed;
-
-    try
-    {
-      if (!parseAssignmentFromSource(variable, parsed))
-      {
-        if (!variable.value.empty())
-        {
-          std::string literal = extractScalarLiteral(variable);
-          if (!literal.empty())
-          {
-            const std::size_t refPos = variable.position >= 0 ? static_cast<std::size_t>(variable.position) : 0;
-            const std::string alias = resolveAlias(variable.name, refPos);
-            emitScalarStore(alias, literal, refPos);
-          }
-        }
-        return;
-      }
-    }
-    catch (const std::exception &)
+    if (!parseAssignment(state, variable, parsed))
     {
-      if (!variable.value.empty())
+      // sem expressão que o BIP represente: só um literal isolado vira código
+      std::string literal = extractScalarLiteral(state, variable);
+      if (!literal.empty())
       {
-        std::string literal = extractScalarLiteral(variable);
-        if (!literal.empty())
-        {
-          const std::size_t refPos = variable.position >= 0 ? static_cast<std::size_t>(variable.position) : 0;
-          const std::string alias = resolveAlias(variable.name, refPos);
-          emitScalarStore(alias, literal, refPos);
-        }
+        const std::size_t refPos = variable.position >= 0 ? static_cast<std::size_t>(variable.position) : 0;
+        emitScalarStore(state, resolveAlias(state, variable.name, refPos), literal, refPos);
       }
       return;
     }
 
     try
     {
-      std::vector<std::string> code;
+      Code code;
       const std::size_t refPos = parsed.statementStart;
-      const std::string targetAlias = resolveAlias(parsed.targetName, refPos);
+      const Interner::Id targetAlias = resolveAlias(state, parsed.targetName, refPos);
 
-      if (!parsed.targetIsArray && parsed.rhsExpr)
+      // chamada isolada: emitCallForContext dá as mensagens com o nome declarado
+      if (!parsed.targetIsArray && parsed.rhsExpr && parsed.rhsExpr->kind == Expr::Kind::Call)
       {
-        const Expr &expr = *parsed.rhsExpr;
-        auto emitAndStore = [&](std::vector<std::string> generated) {
-          statementInstructions.emplace_back(parsed.statementStart, std::move(generated));
-        };
-
-        if (expr.kind == Expr::Kind::ArrayAccess && expr.index)
-        {
-          std::vector<std::string> direct;
-          if (expr.index->kind == Expr::Kind::Literal)
-          {
-            std::string decimalValue = convertLiteralToDecimal(expr.index->value);
-            direct.push_back("LDI " + decimalValue);
-          }
-          else if (expr.index->kind == Expr::Kind::Variable)
-          {
-            const std::string name = resolveAlias(expr.index->value, refPos);
-            direct.push_back("LD " + name);
-          }
-          if (!direct.empty())
-          {
-            direct.push_back("STO $indr");
-            const std::string arrayName = resolveAlias(expr.value, refPos);
-            direct.push_back("LDV " + arrayName);
-            direct.push_back("STO " + targetAlias);
-            emitAndStore(std::move(direct));
-            return;
-          }
-        }
-
-        if (expr.kind == Expr::Kind::Call)
-        {
-          std::vector<std::string> callCode;
-          emitCallForContext(expr, refPos, callCode, &targetAlias);
-          emitAndStore(std::move(callCode));
-          return;
-        }
-
-        if (expr.kind == Expr::Kind::Literal)
-        {
-          std::string decimalValue = convertLiteralToDecimal(expr.value);
-          code.push_back("LDI " + decimalValue);
-          code.push_back("STO " + targetAlias);
-          emitAndStore(std::move(code));
-          return;
-        }
-        if (expr.kind == Expr::Kind::Variable)
-        {
-          const std::string name = resolveAlias(expr.value, refPos);
-          code.push_back("LD " + name);
-          code.push_back("STO " + targetAlias);
-          emitAndStore(std::move(code));
-          return;
-        }
-        
-        // Otimização para operações binárias simples (sem temporários desnecessários)
-        if (expr.kind == Expr::Kind::Binary && expr.left && expr.right)
-        {
-          // Caso especial: operação binária simples (variável op literal/variável)
-          bool leftIsSimple = (expr.left->kind == Expr::Kind::Variable || expr.left->kind == Expr::Kind::Literal);
-          bool rightIsSimple = (expr.right->kind == Expr::Kind::Variable || expr.right->kind == Expr::Kind::Literal);
-          
-          if (leftIsSimple && rightIsSimple)
-          {
-            // Carrega operando esquerdo
-            if (expr.left->kind == Expr::Kind::Literal)
-            {
-              std::string decimalValue = convertLiteralToDecimal(expr.left->value);
-              code.push_back("LDI " + decimalValue);
-            }
-            else
-            {
-              const std::string name = resolveAlias(expr.left->value, refPos);
-              code.push_back("LD " + name);
-            }
-            
-            // Aplica operação com operando direito
-            if (expr.op == "<<" || expr.op == ">>")
-            {
-              // Shifts
-              if (expr.right->kind == Expr::Kind::Literal)
-              {
-                std::string decimalValue = convertLiteralToDecimal(expr.right->value);
-                code.push_back(opcodeForOperator(expr.op) + " " + decimalValue);
-              }
-              else
-              {
-                const std::string name = resolveAlias(expr.right->value, refPos);
-                code.push_back(opcodeForOperator(expr.op) + " " + name);
-              }
-            }
-            else if (expr.op == "&" || expr.op == "|" || expr.op == "^")
-            {
-              // Operações bit a bit
-              if (expr.right->kind == Expr::Kind::Literal)
-              {
-                std::string decimalValue = convertLiteralToDecimal(expr.right->value);
-                code.push_back(opcodeForOperator(expr.op) + "I " + decimalValue);
-              }
-              else
-              {
-                const std::string name = resolveAlias(expr.right->value, refPos);
-                code.push_back(opcodeForOperator(expr.op) + " " + name);
-              }
-            }
-            else
-            {
-              // Operações aritméticas
-              if (expr.right->kind == Expr::Kind::Literal)
-              {
-                std::string decimalValue = convertLiteralToDecimal(expr.right->value);
-                code.push_back(opcodeForOperator(expr.op) + "I " + decimalValue);
-              }
-              else
-              {
-                const std::string name = resolveAlias(expr.right->value, refPos);
-                code.push_back(opcodeForOperator(expr.op) + " " + name);
-              }
-            }
-            
-            code.push_back("STO " + targetAlias);
-            emitAndStore(std::move(code));
-            return;
-          }
-        }
-        
-        if (emitOptimizedAddSub(expr, targetAlias, code, refPos))
-        {
-          emitAndStore(std::move(code));
-          return;
-        }
+        emitCallForContext(state, *parsed.rhsExpr, refPos, code, &targetAlias);
+        addStatementBlock(state, parsed.statementStart, std::move(code));
+        return;
       }
 
-      ExpressionEmitter emitter(code, refPos);
+      ExpressionEmitter emitter(state, code, refPos);
       emitter.reset();
       bool symbolIsArray = variable.isArray;
 
       if (!parsed.rhsArrayElements.empty())
       {
+        // vetor literal só vai para um vetor
         const bool wholeArray = parsed.targetIsArray || symbolIsArray;
         if (!wholeArray)
         {
-          throw std::runtime_error("Atribuição de vetor requer destino vetor");
+          return;
         }
         for (std::size_t idx = 0; idx < parsed.rhsArrayElements.size(); ++idx)
         {
-          std::string elementTemp = emitter.emit(*parsed.rhsArrayElements[idx]);
-          code.push_back("LDI " + std::to_string(static_cast<int>(idx)));
-          code.push_back(std::string("STO ") + TEMP_VECTOR_INDEX);
-          code.push_back(std::string("LD ") + TEMP_VECTOR_INDEX);
-          code.push_back("STO $indr");
-          code.push_back("LD " + elementTemp);
-          code.push_back("STOV " + targetAlias);
+          Expr position;
+          const std::string literal = std::to_string(static_cast<int>(idx));
+          position.value = literal;
+          emitter.storeElement(parsed.targetName, position, *parsed.rhsArrayElements[idx], true);
         }
-        statementInstructions.emplace_back(parsed.statementStart, std::move(code));
+        addStatementBlock(state, parsed.statementStart, std::move(code));
         return;
       }
 
-      if (!parsed.rhsExpr)
-      {
-        throw std::runtime_error("Expressão de atribuição ausente");
-      }
-
       if (parsed.targetIsArray)
       {
-        if (!parsed.targetIndex)
-        {
-          throw std::runtime_error("Índice de vetor ausente");
-        }
-        std::string indexTemp = emitter.emit(*parsed.targetIndex);
-        code.push_back("LD " + indexTemp);
-        code.push_back(std::string("STO ") + TEMP_VECTOR_INDEX);
-
-        std::string valueTemp = emitter.emit(*parsed.rhsExpr);
-        code.push_back("LD " + valueTemp);
-        code.push_back(std::string("STO ") + TEMP_VECTOR_VALUE);
-        code.push_back("LD " + indexTemp);
-        code.push_back(std::string("STO ") + TEMP_VECTOR_INDEX);
-        code.push_back(std::string("LD ") + TEMP_VECTOR_INDEX);
-        code.push_back("STO $indr");
-        code.push_back(std::string("LD ") + TEMP_VECTOR_VALUE);
-        code.push_back("STOV " + targetAlias);
+        emitter.storeElement(parsed.targetName, *parsed.targetIndex, *parsed.rhsExpr, true);
       }
       else
       {
-        std::string valueTemp = emitter.emit(*parsed.rhsExpr);
-        code.push_back("LD " + valueTemp);
-        code.push_back("STO " + targetAlias);
+        emitter.load(*parsed.rhsExpr);
+        code.push_back(Bip::symbol(Bip::Opcode::STO, targetAlias));
       }
 
-      statementInstructions.emplace_back(parsed.statementStart, std::move(code));
+      addStatementBlock(state, parsed.statementStart, std::move(code));
     }
     catch (const std::exception &)
     {
-      // falha no parse/geração: omite instruções para evitar código incorreto
+      // falha na geração: omite instruções para evitar código incorreto
     }
   }
 
-  void registerReadStatement(std::size_t position, const std::string &argument)
+  void registerReadStatement(BipState &state, std::size_t position, TokenRange argument)
   {
-    for (const auto &entry : statementInstructions)
-    {
-      if (entry.first == position)
-        return;
-    }
+    const auto existing = blocksAt(state, position);
+    if (existing.first != existing.second)
+      return;
+    ExprPtr expr = buildExpression(state, argument);
+    if (!expr)
+      return;
     try
     {
-      std::vector<std::string> code;
-      auto expr = parseExpressionString(argument);
-      generateReadIntoExpression(*expr, code, position);
-      statementInstructions.emplace_back(position, std::move(code));
+      Code code;
+      generateReadIntoExpression(state, *expr, code, position);
+      addStatementBlock(state, position, std::move(code));
     }
     catch (const std::exception &)
     {
@@ -3333,35 +2823,29 @@ namespace BipGenerator
     }
   }
 
-  void registerPrintStatement(std::size_t position, const std::string &expression)
+  void generatePrintStatement(BipState &state, std::size_t position, std::size_t argumentOpen)
   {
-    const std::string key = std::to_string(position) + ":" + expression;
-    if (seenPrints.count(key))
+    if (!state.seenPrints.insert(argumentOpen).second)
+      return;
+    const std::size_t argumentClose = state.sourceTokens[argumentOpen].match;
+    if (argumentClose == std::string::npos)
+      return;
+    ExprPtr expr = buildExpression(state, {argumentOpen + 1, argumentClose});
+    if (!expr)
       return;
-    seenPrints.insert(key);
     try
     {
-      std::vector<std::string> code;
-      auto expr = parseExpressionString(expression);
-      generatePrintExpression(*expr, code, position);
-      auto sameBlock = [&](const std::vector<std::string> &other) {
-        if (other.size() != code.size())
-          return false;
-        for (std::size_t i = 0; i < code.size(); ++i)
-        {
-          if (code[i] != other[i])
-            return false;
-        }
-        return true;
-      };
-      for (const auto &entry : statementInstructions)
+      Code code;
+      generatePrintExpression(state, *expr, code, position);
+      const auto existing = blocksAt(state, position);
+      for (auto it = existing.first; it != existing.second; ++it)
       {
-        if (entry.first == position && sameBlock(entry.second))
+        if (it->second == code)
         {
           return;
         }
       }
-      statementInstructions.emplace_back(position, std::move(code));
+      addStatementBlock(state, position, std::move(code));
     }
     catch (const std::exception &)
     {
@@ -3369,92 +2853,50 @@ namespace BipGenerator
     }
   }
 
-  void scanReadStatements()
+  void emitReadStatements(BipState &state)
   {
-    if (readStatementsScanned)
-      return;
-    readStatementsScanned = true;
-
-    const std::string &src = Semantico::sourceCode;
-    const std::string keyword = "read";
-    const std::size_t len = src.size();
-
-    for (std::size_t i = 0; i + keyword.size() < len; ++i)
+    for (const auto &statement : state.readStatements)
     {
-      if (src.compare(i, keyword.size(), keyword) != 0)
-        continue;
-      if (i > 0 && (std::isalnum(static_cast<unsigned char>(src[i - 1])) || src[i - 1] == '_'))
-        continue;
-      std::size_t j = i + keyword.size();
-      while (j < len && std::isspace(static_cast<unsigned char>(src[j])))
-        ++j;
-      if (j >= len || src[j] != '(')
-        continue;
-      std::size_t close = findMatchingParenthesis(src, j);
-      if (close == std::string::npos)
-        continue;
-      std::string argument = trim(src.substr(j + 1, close - j - 1));
-      if (argument.empty())
-        continue;
-      registerReadStatement(i, argument);
-      i = close;
+      registerReadStatement(state, statement.position, statement.argument);
     }
   }
 
-  void registerReturnStatement(std::size_t position, const std::string &expression)
+  void registerReturnStatement(BipState &state, std::size_t position, TokenRange expression)
   {
-    ensureFunctionsParsed();
-    const std::string funcName = functionForPosition(position);
-    if (funcName.empty())
+    ensureFunctionsParsed(state);
+    const FunctionInfo *owner = functionAt(state, position);
+    if (!owner)
       return;
-    const FunctionInfo *fn = findFunction(funcName);
+    const FunctionInfo *fn = findFunction(state, owner->id);
     if (!fn)
       return;
 
     try
     {
-      std::vector<std::string> code;
-      ExpressionEmitter emitter(code, position);
+      Code code;
+      ExpressionEmitter emitter(state, code, position);
       emitter.reset();
-      std::string exprText = trim(expression);
-      if (!exprText.empty())
+      if (!expression.empty())
       {
-        auto exprNode = parseExpressionString(exprText);
-        if (fn->returnType == Semantico::Type::VOID)
-        {
-          throw SemanticError("Retorno com valor em procedimento \"" + fn->name + "\".", static_cast<int>(position), static_cast<int>(fn->name.size()));
-        }
-        if (fn->returnType != Semantico::Type::INT)
-        {
-          throw SemanticError("Tipo de retorno incompatível na função \"" + fn->name + "\".", static_cast<int>(position), static_cast<int>(fn->name.size()));
-        }
+        ExprPtr exprNode = buildExpression(state, expression);
+        if (!exprNode)
+          return;
         if (exprNode->kind == Expr::Kind::Call)
         {
-          emitCallForContext(*exprNode, position, code, nullptr);
-        }
-        else if (exprNode->kind == Expr::Kind::Literal)
-        {
-          std::string decimalValue = convertLiteralToDecimal(exprNode->value);
-          code.push_back("LDI " + decimalValue);
-        }
-        else if (exprNode->kind == Expr::Kind::Variable)
-        {
-          const std::string name = emitter.resolveSymbol(exprNode->value);
-          code.push_back("LD " + name);
+          emitCallForContext(state, *exprNode, position, code, nullptr);
         }
         else
         {
-          std::string valueTemp = emitter.emit(*exprNode);
-          code.push_back("LD " + valueTemp);
+          emitter.load(*exprNode);
         }
       }
       else
       {
-        code.push_back("LDI 0");
+        code.push_back(Bip::immediate(Bip::Opcode::LDI, 0));
       }
-      code.push_back("RETURN 0");
-      statementInstructions.emplace_back(position, std::move(code));
-      functionsWithReturn.insert(funcName);
+      code.push_back(Bip::immediate(Bip::Opcode::RETURN, 0));
+      addStatementBlock(state, position, std::move(code));
+      state.functionsWithReturn.insert(fn->id);
     }
     catch (const std::exception &)
     {
@@ -3462,145 +2904,104 @@ namespace BipGenerator
     }
   }
 
-  void scanReturnStatements()
+  void emitReturnStatements(BipState &state)
   {
-    const std::string &src = Semantico::sourceCode;
-    const std::string keyword = "return";
-    const std::size_t len = src.size();
-
-    for (std::size_t i = 0; i + keyword.size() <= len; ++i)
+    for (const auto &statement : state.returnStatements)
     {
-      if (!isKeywordAt(src, i, keyword))
-        continue;
-      std::size_t exprStart = skipWhitespaceAndComments(src, i + keyword.size());
-      int depthParen = 0;
-      int depthBracket = 0;
-      int depthBrace = 0;
-      std::size_t end = exprStart;
-      for (; end < len; ++end)
-      {
-        char c = src[end];
-        if (c == ';' && depthParen == 0 && depthBracket == 0 && depthBrace == 0)
-          break;
-        if (c == '(')
-          ++depthParen;
-        else if (c == ')')
-          --depthParen;
-        else if (c == '[')
-          ++depthBracket;
-        else if (c == ']')
-          --depthBracket;
-        else if (c == '{')
-          ++depthBrace;
-        else if (c == '}')
-          --depthBrace;
-      }
-      if (end >= len || src[end] != ';')
-        continue;
-      std::string exprText;
-      if (end > exprStart)
-      {
-        exprText = trim(src.substr(exprStart, end - exprStart));
-      }
-      registerReturnStatement(i, exprText);
-      i = end;
+      registerReturnStatement(state, statement.position, statement.expression);
     }
   }
 
-  bool isStandaloneCallCandidate(const std::string &identifier)
-  {
-    static const std::unordered_set<std::string> keywords = {"if", "else", "for", "while", "do", "function", "return", "switch", "case", "print", "read"};
-    return !keywords.count(identifier);
-  }
-
-  void scanCallStatements()
+  void emitCallStatements(BipState &state)
   {
-    const std::string &src = Semantico::sourceCode;
-    const std::size_t len = src.size();
-
-    for (std::size_t i = 0; i < len; ++i)
+    for (const auto &statement : state.callStatements)
     {
-      char c = src[i];
-      if (!isIdentifierStart(c))
-        continue;
-      if (i > 0 && isIdentifierChar(src[i - 1]))
-        continue;
-      std::size_t nameEnd = i + 1;
-      while (nameEnd < len && isIdentifierChar(src[nameEnd]))
-        ++nameEnd;
-      std::string ident = src.substr(i, nameEnd - i);
-      if (!isStandaloneCallCandidate(ident))
-      {
-        i = nameEnd > 0 ? nameEnd - 1 : i;
-        continue;
-      }
-      std::size_t afterName = skipWhitespaceAndComments(src, nameEnd);
-      if (afterName >= len || src[afterName] != '(')
-        continue;
-      std::size_t parenClose = findMatchingParenthesis(src, afterName);
-      if (parenClose == std::string::npos)
-        continue;
-      std::size_t afterCall = skipWhitespaceAndComments(src, parenClose + 1);
-      if (afterCall >= len || src[afterCall] != ';')
-        continue;
-
-      // garante que não é parte de uma atribuição ou expressão maior
-      std::size_t scan = i;
-      while (scan > 0 && std::isspace(static_cast<unsigned char>(src[scan - 1])))
-        --scan;
-      if (scan > 0)
-      {
-        char prev = src[scan - 1];
-        if (prev != ';' && prev != '{' && prev != '}' && prev != '\n')
-        {
-          continue;
-        }
-      }
-
-      const std::string callText = trim(src.substr(i, parenClose - i + 1));
       try
       {
-        std::vector<std::string> code;
-        ExpressionEmitter emitter(code, i, false);
+        Code code;
+        ExpressionEmitter emitter(state, code, statement.position);
         emitter.reset();
-        auto expr = parseExpressionString(callText);
+        ExprPtr expr = buildExpression(state, statement.call);
         if (expr && expr->kind == Expr::Kind::Call)
         {
-          emitter.emit(*expr);
-          statementInstructions.emplace_back(i, std::move(code));
+          emitter.load(*expr);
+          addStatementBlock(state, statement.position, std::move(code));
         }
       }
       catch (const std::exception &)
       {
         // ignora chamadas inválidas
       }
-      i = afterCall;
     }
   }
 
-  std::string render()
+  void generateRecordedStatements(BipState &state)
+  {
+    if (state.recordedStatementsGenerated)
+      return;
+    state.recordedStatementsGenerated = true;
+    for (const auto &statement : state.recordedStatements)
+    {
+      switch (statement.kind)
+      {
+      case RecordedStatement::Kind::Declaration:
+        generateDeclaration(state, statement.variable);
+        break;
+      case RecordedStatement::Kind::Assignment:
+        generateAssignment(state, statement.variable);
+        break;
+      case RecordedStatement::Kind::Print:
+        generatePrintStatement(state, statement.position, statement.argumentOpen);
+        break;
+      }
+    }
+  }
+
+  std::string render(CompilationContext &context)
+  {
+    BipState &state = context.bip();
+    state.source = context.source();
+    generateRecordedStatements(state);
+    generateControlFlow(state);
+    emitReadStatements(state);
+    emitReturnStatements(state);
+    emitCallStatements(state);
+    ensureParametersRegistered(state);
+    Code text = buildText(state);
+    if (state.peephole.rules != 0)
+      state.peepholeStats = BipPeephole::optimize(text, state.names, state.peephole);
+    state.cachedCode = formatCode(state, text);
+    return state.cachedCode;
+  }
+
+  void setPeephole(CompilationContext &context, const BipPeephole::Options &options)
   {
-    generateControlFlow();
-    scanReadStatements();
-    scanReturnStatements();
-    scanCallStatements();
-    ensureParametersRegistered();
-    cachedCode = buildCode();
-    return cachedCode;
+    context.bip().peephole = options;
   }
 
-  const std::string &lastCode()
+  const BipPeephole::Stats &peepholeStats(CompilationContext &context)
   {
-    return cachedCode;
+    return context.bip().peepholeStats;
+  }
+
+  const std::string &lastCode(CompilationContext &context)
+  {
+    return context.bip().cachedCode;
   }
 
   void writeToFile(const std::string &code)
   {
-    std::ofstream file(OUTPUT_FILE);
+    writeToFile(code, OUTPUT_FILE);
+  }
+
+  bool writeToFile(const std::string &code, const std::string &path)
+  {
+    std::ofstream file(path);
     if (!file)
     {
-      return;
+      return false;
     }
     file << code;
+    return static_cast<bool>(file);
   }
 }
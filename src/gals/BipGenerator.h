@@ -1,20 +1,76 @@
 #ifndef BIP_GENERATOR_H
 #define BIP_GENERATOR_H
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "BipPeephole.h"
+#include "CompilationContext.h"
 #include "Semantico.h"
+#include "Token.h"
 
+// Todo o estado do gerador fica no BipState do contexto recebido.
 namespace BipGenerator
 {
-  void reset();
-  void registerDeclaration(const Semantico::Variable &variable);
-  void registerAssignment(const Semantico::Variable &variable);
-  void registerReadStatement(std::size_t position, const std::string &argument);
-  void registerPrintStatement(std::size_t position, const std::string &expression);
-  std::string render();
-  const std::string &lastCode();
+  void reset(CompilationContext &context);
+
+  // Quanto o parse já registrou em um ponto da análise (CompilationSession).
+  struct Checkpoint
+  {
+    std::size_t tokens;
+    std::size_t statements;
+    std::vector<std::size_t> openDelimiters;
+  };
+  Checkpoint checkpoint(CompilationContext &context);
+
+  // Índices de token de antes de uma edição: os de from em diante andam delta.
+  struct TokenShift
+  {
+    std::size_t from;
+    std::ptrdiff_t delta;
+
+    std::size_t apply(std::size_t index) const { return index >= from ? index + delta : index; }
+  };
+
+  // O que restoreCheckpoint tirou do parse anterior.
+  struct ParseTail;
+
+  // Volta ao ponto salvo, descartando o que render() gerou. O resto do parse
+  // anterior é devolvido para appendParseTail, caso a nova análise convirja.
+  std::shared_ptr<ParseTail> restoreCheckpoint(CompilationContext &context, const Checkpoint &saved);
+
+  // saved (de antes da edição) corresponde ao ponto atual do parse?
+  bool checkpointMatches(CompilationContext &context, const Checkpoint &saved, const TokenShift &tokens);
+
+  // Completa o parse atual com o fim do anterior a partir de from, um ponto
+  // em que checkpointMatches valeu. Esvazia tail.
+  void appendParseTail(CompilationContext &context, ParseTail &tail, const Checkpoint &from,
+                       const TokenShift &tokens, const SourceShift &shift);
+
+  // Leva um ponto salvo antes da edição para a numeração atual; statements
+  // é quantas instruções registradas a mais há antes dele.
+  void shiftCheckpoint(Checkpoint &saved, const TokenShift &tokens, std::ptrdiff_t statements);
+
+  void registerToken(CompilationContext &context, const ::Token &token);
+  // Delimitadores abertos por registerToken e ainda sem par. Depois de um
+  // erro de sintaxe, os abertos no comando descartado são esquecidos.
+  std::size_t openDelimiterCount(CompilationContext &context);
+  void abandonDelimiters(CompilationContext &context, std::size_t count);
+  void registerDeclaration(CompilationContext &context, const Semantico::Variable &variable);
+  void registerAssignment(CompilationContext &context, const Semantico::Variable &variable);
+  // Chamado na ação do print; o argumento é lido dos tokens em render().
+  void registerPrintStatement(CompilationContext &context);
+  std::string render(CompilationContext &context);
+  // Regras de BipPeephole que render() aplica ao código (todas por padrão).
+  // É configuração: reset() e restoreCheckpoint não a alteram.
+  void setPeephole(CompilationContext &context, const BipPeephole::Options &options);
+  // O que o peephole removeu no último render(); zerado sem regras ativas.
+  const BipPeephole::Stats &peepholeStats(CompilationContext &context);
+  const std::string &lastCode(CompilationContext &context);
   void writeToFile(const std::string &code);
+  bool writeToFile(const std::string &code, const std::string &path);
 }
 
 #endif
@@ -0,0 +1,191 @@
+#include "BipInstruction.h"
+
+#include <charconv>
+#include <iterator>
+
+namespace Bip
+{
+  namespace
+  {
+    constexpr const char *MNEMONICS[] = {
+        "",    "HLT",  "LD",  "LDI", "STO", "LDV", "STOV", "ADD", "ADDI", "SUB", "SUBI", "MUL",
+        "MULI", "DIV", "DIVI", "MOD", "MODI", "AND", "ANDI", "OR", "ORI", "XOR", "XORI", "NOT",
+        "SLL", "SRL", "JMP", "BEQ", "BNE", "BGT", "BGE", "BLT", "BLE", "CALL", "RETURN"};
+    static_assert(std::size(MNEMONICS) == static_cast<std::size_t>(Opcode::RETURN) + 1, "MNEMONICS segue Opcode");
+
+    // Só a forma que format reproduz ("7", "-3"): "007" ou "+7" ficam como
+    // texto, para o código sair igual ao que foi escrito.
+    bool parseInt(std::string_view text, std::int32_t &value)
+    {
+      const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+      if (error != std::errc() || end != text.data() + text.size())
+        return false;
+      char digits[16];
+      const auto printed = std::to_chars(digits, digits + sizeof digits, value);
+      return text == std::string_view(digits, static_cast<std::size_t>(printed.ptr - digits));
+    }
+
+    // Opcodes cujo operando numérico é valor, não endereço.
+    bool takesImmediate(Opcode opcode)
+    {
+      switch (opcode)
+      {
+      case Opcode::HLT:
+      case Opcode::RETURN:
+      case Opcode::LDI:
+      case Opcode::ADDI:
+      case Opcode::SUBI:
+      case Opcode::MULI:
+      case Opcode::DIVI:
+      case Opcode::MODI:
+      case Opcode::ANDI:
+      case Opcode::ORI:
+      case Opcode::XORI:
+        return true;
+      default:
+        return false;
+      }
+    }
+  }
+
+  Instruction literal(Opcode opcode, std::string_view decimal, Interner &names)
+  {
+    std::int32_t value = 0;
+    if (parseInt(decimal, value))
+      return immediate(opcode, value);
+    return {opcode, Operand::Literal, static_cast<std::int32_t>(names.intern(decimal))};
+  }
+
+  const char *mnemonic(Opcode opcode)
+  {
+    return MNEMONICS[static_cast<std::size_t>(opcode)];
+  }
+
+  bool parseOpcode(std::string_view text, Opcode &opcode)
+  {
+    for (std::size_t i = 1; i < std::size(MNEMONICS); ++i)
+    {
+      if (text == MNEMONICS[i])
+      {
+        opcode = static_cast<Opcode>(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Opcode immediateForm(Opcode opcode)
+  {
+    switch (opcode)
+    {
+    case Opcode::ADD:
+      return Opcode::ADDI;
+    case Opcode::SUB:
+      return Opcode::SUBI;
+    case Opcode::MUL:
+      return Opcode::MULI;
+    case Opcode::DIV:
+      return Opcode::DIVI;
+    case Opcode::MOD:
+      return Opcode::MODI;
+    case Opcode::AND:
+      return Opcode::ANDI;
+    case Opcode::OR:
+      return Opcode::ORI;
+    case Opcode::XOR:
+      return Opcode::XORI;
+    default:
+      return opcode;
+    }
+  }
+
+  bool isBranch(Opcode opcode)
+  {
+    return opcode >= Opcode::JMP && opcode <= Opcode::BLE;
+  }
+
+  bool takesLabel(Opcode opcode)
+  {
+    return isBranch(opcode) || opcode == Opcode::CALL;
+  }
+
+  void format(const Instruction &instruction, const Interner &names, std::string &out)
+  {
+    if (instruction.isLabel())
+    {
+      out += names.text(static_cast<Interner::Id>(instruction.value));
+      out += ":\n";
+      return;
+    }
+    out += "    ";
+    out += mnemonic(instruction.opcode);
+    switch (instruction.kind)
+    {
+    case Operand::None:
+      break;
+    case Operand::Immediate:
+    case Operand::Temp:
+    {
+      char digits[16];
+      const auto result = std::to_chars(digits, digits + sizeof digits, instruction.value);
+      out += ' ';
+      out.append(digits, result.ptr);
+      break;
+    }
+    case Operand::Literal:
+    case Operand::Symbol:
+      out += ' ';
+      out += names.text(static_cast<Interner::Id>(instruction.value));
+      break;
+    case Operand::Index:
+      out += " $indr";
+      break;
+    case Operand::InPort:
+      out += " $in_port";
+      break;
+    case Operand::OutPort:
+      out += " $out_port";
+      break;
+    }
+    out += '\n';
+  }
+
+  bool parse(std::string_view line, Interner &names, Instruction &instruction)
+  {
+    if (!line.empty() && line.back() == ':')
+    {
+      instruction = label(names.intern(line.substr(0, line.size() - 1)));
+      return true;
+    }
+    const std::size_t space = line.find_first_of(" \t");
+    Opcode opcode;
+    if (!parseOpcode(line.substr(0, space), opcode))
+      return false;
+    instruction = make(opcode);
+    if (space == std::string_view::npos)
+      return true;
+    std::string_view operand = line.substr(space + 1);
+    operand.remove_prefix(std::min(operand.size(), operand.find_first_not_of(" \t")));
+    if (operand.empty())
+      return true;
+
+    std::int32_t number = 0;
+    if (operand == "$indr")
+      instruction.kind = Operand::Index;
+    else if (operand == "$in_port")
+      instruction.kind = Operand::InPort;
+    else if (operand == "$out_port")
+      instruction.kind = Operand::OutPort;
+    else if (parseInt(operand, number))
+    {
+      // como no BipMachine: deslocamento abaixo de 900 é literal
+      const bool shift = opcode == Opcode::SLL || opcode == Opcode::SRL;
+      instruction.kind = takesImmediate(opcode) || (shift && number < 900) ? Operand::Immediate : Operand::Temp;
+      instruction.value = number;
+    }
+    else
+      instruction = {opcode, takesImmediate(opcode) ? Operand::Literal : Operand::Symbol,
+                     static_cast<std::int32_t>(names.intern(operand))};
+    return true;
+  }
+}
@@ -0,0 +1,113 @@
+#ifndef BIP_INSTRUCTION_H
+#define BIP_INSTRUCTION_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "Interner.h"
+
+// Instrução BIP como o gerador e o peephole a manipulam: opcode, tipo do
+// operando e o operando em si (imediato, endereço de temporário ou nome
+// internado no Interner da compilação). São 8 bytes sem nada alocado; o
+// texto só é montado uma vez, em format, quando o programa está pronto.
+namespace Bip
+{
+  enum class Opcode : std::uint8_t
+  {
+    Label, // rótulo: operand é o nome
+    HLT,
+    LD,
+    LDI,
+    STO,
+    LDV,
+    STOV,
+    ADD,
+    ADDI,
+    SUB,
+    SUBI,
+    MUL,
+    MULI,
+    DIV,
+    DIVI,
+    MOD,
+    MODI,
+    AND,
+    ANDI,
+    OR,
+    ORI,
+    XOR,
+    XORI,
+    NOT,
+    SLL,
+    SRL,
+    JMP,
+    BEQ,
+    BNE,
+    BGT,
+    BGE,
+    BLT,
+    BLE,
+    CALL,
+    RETURN
+  };
+
+  enum class Operand : std::uint8_t
+  {
+    None,
+    Immediate, // value é o número (também o deslocamento literal de SLL/SRL)
+    Literal,   // literal que Immediate não reproduz ("007", fora de 32 bits): value é o texto internado
+    Temp,      // value é o endereço (900–999)
+    Symbol,    // value é o Interner::Id do nome (.data ou rótulo)
+    Index,     // $indr
+    InPort,    // $in_port
+    OutPort    // $out_port
+  };
+
+  struct Instruction
+  {
+    Opcode opcode = Opcode::HLT;
+    Operand kind = Operand::None;
+    std::int32_t value = 0;
+
+    bool isLabel() const { return opcode == Opcode::Label; }
+    bool sameOperand(const Instruction &other) const { return kind == other.kind && value == other.value; }
+    bool operator==(const Instruction &other) const { return opcode == other.opcode && sameOperand(other); }
+    bool operator!=(const Instruction &other) const { return !(*this == other); }
+  };
+
+  inline Instruction make(Opcode opcode, Operand kind = Operand::None, std::int32_t value = 0)
+  {
+    return {opcode, kind, value};
+  }
+  inline Instruction immediate(Opcode opcode, std::int32_t value) { return {opcode, Operand::Immediate, value}; }
+  inline Instruction temp(Opcode opcode, int address) { return {opcode, Operand::Temp, address}; }
+  inline Instruction symbol(Opcode opcode, Interner::Id name)
+  {
+    return {opcode, Operand::Symbol, static_cast<std::int32_t>(name)};
+  }
+  inline Instruction label(Interner::Id name) { return symbol(Opcode::Label, name); }
+
+  // Operando de um literal decimal: Immediate quando format o devolve igual,
+  // senão o texto como está.
+  Instruction literal(Opcode opcode, std::string_view decimal, Interner &names);
+
+  const char *mnemonic(Opcode opcode);
+  // false para mnemônico desconhecido.
+  bool parseOpcode(std::string_view mnemonic, Opcode &opcode);
+
+  // Forma imediata (ADD -> ADDI); SLL/SRL e o resto ficam como estão.
+  Opcode immediateForm(Opcode opcode);
+
+  bool isBranch(Opcode opcode); // JMP e os condicionais
+  bool takesLabel(Opcode opcode); // desvios e CALL
+
+  // Acrescenta a out a linha da instrução ("    LD x" ou "R1:"), com '\n'.
+  void format(const Instruction &instruction, const Interner &names, std::string &out);
+
+  // Lê uma linha de .text já sem espaços nas pontas; false se não for uma
+  // instrução conhecida. Nomes e literais estranhos são internados em names.
+  bool parse(std::string_view line, Interner &names, Instruction &instruction);
+}
+
+#endif
@@ -0,0 +1,868 @@
+#include "BipMachine.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace BipMachine
+{
+  namespace
+  {
+    struct Mnemonic
+    {
+      const char *name;
+      Opcode opcode;
+    };
+
+    constexpr Mnemonic MNEMONICS[] = {
+        {"HLT", Opcode::HLT}, {"LD", Opcode::LD}, {"LDI", Opcode::LDI}, {"STO", Opcode::STO},
+        {"LDV", Opcode::LDV}, {"STOV", Opcode::STOV}, {"ADD", Opcode::ADD}, {"ADDI", Opcode::ADDI},
+        {"SUB", Opcode::SUB}, {"SUBI", Opcode::SUBI}, {"MUL", Opcode::MUL}, {"MULI", Opcode::MULI},
+        {"DIV", Opcode::DIV}, {"DIVI", Opcode::DIVI}, {"MOD", Opcode::MOD}, {"MODI", Opcode::MODI},
+        {"AND", Opcode::AND}, {"ANDI", Opcode::ANDI}, {"OR", Opcode::OR}, {"ORI", Opcode::ORI},
+        {"XOR", Opcode::XOR}, {"XORI", Opcode::XORI}, {"NOT", Opcode::NOT}, {"SLL", Opcode::SLL},
+        {"SRL", Opcode::SRL}, {"JMP", Opcode::JMP}, {"BEQ", Opcode::BEQ}, {"BNE", Opcode::BNE},
+        {"BGT", Opcode::BGT}, {"BGE", Opcode::BGE}, {"BLT", Opcode::BLT}, {"BLE", Opcode::BLE},
+        {"CALL", Opcode::CALL}, {"RETURN", Opcode::RETURN}};
+
+    enum class OperandKind
+    {
+      None,
+      Immediate,
+      Memory,
+      Shift,
+      Array,
+      Label
+    };
+
+    OperandKind operandKind(Opcode opcode)
+    {
+      switch (opcode)
+      {
+      case Opcode::HLT:
+      case Opcode::NOT:
+      case Opcode::RETURN:
+        return OperandKind::None;
+      case Opcode::LDI:
+      case Opcode::ADDI:
+      case Opcode::SUBI:
+      case Opcode::MULI:
+      case Opcode::DIVI:
+      case Opcode::MODI:
+      case Opcode::ANDI:
+      case Opcode::ORI:
+      case Opcode::XORI:
+        return OperandKind::Immediate;
+      case Opcode::SLL:
+      case Opcode::SRL:
+        return OperandKind::Shift;
+      case Opcode::LDV:
+      case Opcode::STOV:
+        return OperandKind::Array;
+      case Opcode::JMP:
+      case Opcode::BEQ:
+      case Opcode::BNE:
+      case Opcode::BGT:
+      case Opcode::BGE:
+      case Opcode::BLT:
+      case Opcode::BLE:
+      case Opcode::CALL:
+        return OperandKind::Label;
+      default:
+        return OperandKind::Memory;
+      }
+    }
+
+    std::int16_t wrap(std::int64_t value)
+    {
+      return static_cast<std::int16_t>(static_cast<std::uint16_t>(value));
+    }
+
+    std::string_view trim(std::string_view text)
+    {
+      const std::size_t first = text.find_first_not_of(" \t\r");
+      if (first == std::string_view::npos)
+        return {};
+      const std::size_t last = text.find_last_not_of(" \t\r");
+      return text.substr(first, last - first + 1);
+    }
+
+    bool parseNumber(std::string_view text, std::int64_t &value)
+    {
+      if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+      const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+      return error == std::errc() && end == text.data() + text.size();
+    }
+
+    [[noreturn]] void fail(std::uint32_t line, const std::string &message)
+    {
+      throw std::runtime_error("linha " + std::to_string(line) + ": " + message);
+    }
+
+    struct DataName
+    {
+      std::int32_t address;
+      std::int32_t array;
+    };
+
+    // Tratadores de run(), na ordem da tabela de despacho. As variantes
+    // separam o que o texto mistura num mnemônico só: LD de memória ou de
+    // $in_port, STO em memória ou em $out_port, deslocamento imediato ou lido.
+    // $indr ocupa uma palavra da memória, então LD/STO/ULA com ele são os
+    // tratadores comuns.
+#define BIP_HANDLERS(X)                                                                       \
+  X(BLOCK) X(END) X(LIMIT) X(HLT) X(NOP) X(LD) X(LD_IN) X(LDI) X(STO) X(STO_OUT) X(LDV)      \
+  X(STOV) X(ADD) X(ADDI) X(SUB) X(SUBI) X(MUL) X(MULI) X(DIV) X(DIVI) X(MOD) X(MODI) X(AND) \
+  X(ANDI) X(OR) X(ORI) X(XOR) X(XORI) X(NOT) X(SLL) X(SLLI) X(SRL) X(SRLI) X(ALU_IN) X(JMP) \
+  X(BEQ) X(BNE) X(BGT) X(BGE) X(BLT) X(BLE) X(CALL) X(RETURN)
+
+    enum Handler : std::uint8_t
+    {
+#define BIP_ENUM(name) H_##name,
+      BIP_HANDLERS(BIP_ENUM)
+#undef BIP_ENUM
+    };
+
+    // Operação da ULA sobre um valor já lido; false para divisão por zero.
+    bool applyAlu(Opcode opcode, std::int16_t acc, std::int32_t value, std::int16_t &out)
+    {
+      switch (opcode)
+      {
+      case Opcode::ADD:
+        out = wrap(acc + value);
+        return true;
+      case Opcode::SUB:
+        out = wrap(acc - value);
+        return true;
+      case Opcode::MUL:
+        out = wrap(static_cast<std::int64_t>(acc) * value);
+        return true;
+      case Opcode::DIV:
+      case Opcode::MOD:
+        if (value == 0)
+          return false;
+        out = wrap(opcode == Opcode::DIV ? acc / value : acc % value);
+        return true;
+      case Opcode::AND:
+        out = wrap(acc & value);
+        return true;
+      case Opcode::OR:
+        out = wrap(acc | value);
+        return true;
+      case Opcode::XOR:
+        out = wrap(acc ^ value);
+        return true;
+      case Opcode::SLL:
+        out = wrap(static_cast<std::uint16_t>(acc) << (value & 15));
+        return true;
+      case Opcode::SRL:
+        out = wrap(static_cast<std::uint16_t>(acc) >> (value & 15));
+        return true;
+      default:
+        out = acc;
+        return true;
+      }
+    }
+
+    // Tratador de uma instrução de code; ajusta operand quando a forma
+    // escolhida pede outro (endereço de $indr, 0 de $out_port, índice da
+    // instrução para ALU_IN).
+    Handler threadedHandler(const Program &program, std::size_t index, std::int32_t &operand)
+    {
+      static constexpr Handler MEMORY[] = {H_ADD, H_SUB, H_MUL, H_DIV, H_MOD, H_AND, H_OR, H_XOR, H_SLL, H_SRL};
+      static constexpr Handler IMMEDIATE[] = {H_ADDI, H_SUBI, H_MULI, H_DIVI, H_MODI, H_ANDI, H_ORI, H_XORI, H_SLLI, H_SRLI};
+      static constexpr Opcode ALU[] = {Opcode::ADD, Opcode::SUB, Opcode::MUL, Opcode::DIV, Opcode::MOD,
+                                       Opcode::AND, Opcode::OR, Opcode::XOR, Opcode::SLL, Opcode::SRL};
+
+      const Instruction &instruction = program.code[index];
+      operand = instruction.operand;
+      const OperandKind kind = operandKind(instruction.opcode);
+      if (operand == INDEX_REGISTER && !instruction.immediate && (kind == OperandKind::Memory || kind == OperandKind::Shift))
+        operand = program.indexAddress;
+
+      switch (instruction.opcode)
+      {
+      case Opcode::HLT:
+        return H_HLT;
+      case Opcode::LD:
+        if (instruction.operand == IN_PORT)
+          return H_LD_IN;
+        if (instruction.operand == OUT_PORT)
+        {
+          operand = 0;
+          return H_LDI;
+        }
+        return H_LD;
+      case Opcode::LDI:
+        return H_LDI;
+      case Opcode::STO:
+        if (instruction.operand == OUT_PORT)
+          return H_STO_OUT;
+        return instruction.operand == IN_PORT ? H_NOP : H_STO;
+      case Opcode::LDV:
+        return H_LDV;
+      case Opcode::STOV:
+        return H_STOV;
+      case Opcode::ADDI:
+        return H_ADDI;
+      case Opcode::SUBI:
+        return H_SUBI;
+      case Opcode::MULI:
+        return H_MULI;
+      case Opcode::DIVI:
+        return H_DIVI;
+      case Opcode::MODI:
+        return H_MODI;
+      case Opcode::ANDI:
+        return H_ANDI;
+      case Opcode::ORI:
+        return H_ORI;
+      case Opcode::XORI:
+        return H_XORI;
+      case Opcode::NOT:
+        return H_NOT;
+      case Opcode::JMP:
+        return H_JMP;
+      case Opcode::BEQ:
+        return H_BEQ;
+      case Opcode::BNE:
+        return H_BNE;
+      case Opcode::BGT:
+        return H_BGT;
+      case Opcode::BGE:
+        return H_BGE;
+      case Opcode::BLT:
+        return H_BLT;
+      case Opcode::BLE:
+        return H_BLE;
+      case Opcode::CALL:
+        return H_CALL;
+      case Opcode::RETURN:
+        return H_RETURN;
+      default:
+        break;
+      }
+
+      const std::size_t alu = static_cast<std::size_t>(std::find(std::begin(ALU), std::end(ALU), instruction.opcode) - std::begin(ALU));
+      if (instruction.immediate)
+      {
+        operand = instruction.operand & 15;
+        return IMMEDIATE[alu];
+      }
+      if (instruction.operand == IN_PORT)
+      {
+        operand = static_cast<std::int32_t>(index);
+        return H_ALU_IN;
+      }
+      if (instruction.operand == OUT_PORT)
+      {
+        // $out_port lido vale 0
+        operand = 0;
+        return IMMEDIATE[alu];
+      }
+      return MEMORY[alu];
+    }
+
+    // Monta program.threaded: um BLOCK antes de cada líder (início, rótulos,
+    // alvos de desvio e o que vem depois de desvio, CALL, RETURN ou HLT) e
+    // END no fim, para onde vai também quem sai do código.
+    void thread(Program &program)
+    {
+      const std::size_t count = program.code.size();
+      program.indexAddress = static_cast<std::int32_t>(program.memory.size());
+      program.memory.push_back(0);
+
+      std::vector<bool> leader(count + 1, false);
+      leader[0] = true;
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        const Instruction &instruction = program.code[i];
+        if (i > 0 && program.region[i] != program.region[i - 1])
+          leader[i] = true;
+        if (operandKind(instruction.opcode) == OperandKind::Label)
+        {
+          leader[instruction.operand] = true;
+          leader[i + 1] = true;
+        }
+        else if (instruction.opcode == Opcode::HLT || instruction.opcode == Opcode::RETURN)
+          leader[i + 1] = true;
+      }
+
+      std::vector<std::uint32_t> position(count + 1);
+      program.threaded.reserve(count * 2 + 1);
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        position[i] = static_cast<std::uint32_t>(program.threaded.size());
+        if (leader[i])
+        {
+          program.threaded.push_back({H_BLOCK, static_cast<std::int32_t>(program.blocks.size())});
+          program.origin.push_back(static_cast<std::uint32_t>(i));
+          program.blocks.push_back({0, program.region[i], i == 0 || program.region[i] != program.region[i - 1]});
+        }
+        ++program.blocks.back().length;
+        ThreadedInstruction threaded;
+        threaded.handler = threadedHandler(program, i, threaded.operand);
+        program.threaded.push_back(threaded);
+        program.origin.push_back(static_cast<std::uint32_t>(i));
+      }
+      position[count] = static_cast<std::uint32_t>(program.threaded.size());
+      program.threaded.push_back({H_END, 0});
+      program.origin.push_back(0);
+
+      for (ThreadedInstruction &threaded : program.threaded)
+      {
+        if (threaded.handler >= H_JMP && threaded.handler <= H_CALL)
+          threaded.operand = static_cast<std::int32_t>(position[threaded.operand]);
+      }
+    }
+  }
+
+  Program assemble(std::string_view text)
+  {
+    Program program;
+    program.memory.assign(DIRECT_MEMORY, 0);
+    program.labels.push_back("(início)");
+
+    std::unordered_map<std::string_view, DataName> names;
+    std::unordered_map<std::string_view, std::int32_t> labels;
+    struct Fixup
+    {
+      std::size_t instruction;
+      std::string_view label;
+    };
+    std::vector<Fixup> fixups;
+
+    enum class Section
+    {
+      None,
+      Data,
+      Text
+    } section = Section::None;
+
+    std::uint32_t lineNumber = 0;
+    while (!text.empty())
+    {
+      ++lineNumber;
+      const std::size_t newline = text.find('\n');
+      const std::string_view line = trim(text.substr(0, newline));
+      text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+      if (line.empty())
+        continue;
+      if (line == ".data")
+      {
+        section = Section::Data;
+        continue;
+      }
+      if (line == ".text")
+      {
+        section = Section::Text;
+        continue;
+      }
+
+      if (section == Section::Data)
+      {
+        const std::size_t colon = line.find(':');
+        if (colon == std::string_view::npos)
+          fail(lineNumber, "declaração sem ':' no .data");
+        const std::string_view name = trim(line.substr(0, colon));
+        Array array{static_cast<std::int32_t>(program.memory.size()), 0};
+        std::string_view values = line.substr(colon + 1);
+        while (true)
+        {
+          const std::size_t comma = values.find(',');
+          std::int64_t value = 0;
+          if (!parseNumber(trim(values.substr(0, comma)), value))
+            fail(lineNumber, "valor inválido em \"" + std::string(name) + "\"");
+          program.memory.push_back(wrap(value));
+          ++array.length;
+          if (comma == std::string_view::npos)
+            break;
+          values.remove_prefix(comma + 1);
+        }
+        if (!names.emplace(name, DataName{array.base, static_cast<std::int32_t>(program.arrays.size())}).second)
+          fail(lineNumber, "\"" + std::string(name) + "\" declarado duas vezes");
+        program.arrays.push_back(array);
+        continue;
+      }
+
+      if (section != Section::Text)
+        fail(lineNumber, "instrução fora de .text");
+
+      if (line.back() == ':')
+      {
+        const std::string_view label = line.substr(0, line.size() - 1);
+        if (!labels.emplace(label, static_cast<std::int32_t>(program.code.size())).second)
+          fail(lineNumber, "rótulo \"" + std::string(label) + "\" repetido");
+        program.labels.emplace_back(label);
+        continue;
+      }
+
+      const std::size_t space = line.find_first_of(" \t");
+      const std::string_view mnemonic = line.substr(0, space);
+      const std::string_view operand = space == std::string_view::npos ? std::string_view() : trim(line.substr(space));
+      const Mnemonic *found = std::find_if(std::begin(MNEMONICS), std::end(MNEMONICS),
+                                           [&](const Mnemonic &m) { return mnemonic == m.name; });
+      if (found == std::end(MNEMONICS))
+        fail(lineNumber, "instrução desconhecida \"" + std::string(mnemonic) + "\"");
+
+      Instruction instruction;
+      instruction.opcode = found->opcode;
+      instruction.line = lineNumber;
+      const OperandKind kind = operandKind(found->opcode);
+      if (kind != OperandKind::None && operand.empty())
+        fail(lineNumber, std::string(mnemonic) + " sem operando");
+
+      std::int64_t number = 0;
+      switch (kind)
+      {
+      case OperandKind::None:
+        break;
+      case OperandKind::Immediate:
+        if (!parseNumber(operand, number))
+          fail(lineNumber, "imediato inválido \"" + std::string(operand) + "\"");
+        instruction.operand = wrap(number);
+        break;
+      case OperandKind::Shift:
+      case OperandKind::Memory:
+        if (operand == "$indr")
+          instruction.operand = INDEX_REGISTER;
+        else if (operand == "$in_port")
+          instruction.operand = IN_PORT;
+        else if (operand == "$out_port")
+          instruction.operand = OUT_PORT;
+        else if (parseNumber(operand, number))
+        {
+          // deslocamento literal; temporários do gerador (900–999) são memória
+          if (kind == OperandKind::Shift && number < 900)
+          {
+            instruction.immediate = true;
+            instruction.operand = static_cast<std::int32_t>(number);
+          }
+          else if (number < 0 || number >= DIRECT_MEMORY)
+            fail(lineNumber, "endereço fora da memória: " + std::string(operand));
+          else
+            instruction.operand = static_cast<std::int32_t>(number);
+        }
+        else
+        {
+          const auto it = names.find(operand);
+          if (it == names.end())
+            fail(lineNumber, "\"" + std::string(operand) + "\" não está no .data");
+          instruction.operand = it->second.address;
+        }
+        break;
+      case OperandKind::Array:
+      {
+        const auto it = names.find(operand);
+        if (it == names.end())
+          fail(lineNumber, "vetor \"" + std::string(operand) + "\" não está no .data");
+        instruction.operand = it->second.array;
+        break;
+      }
+      case OperandKind::Label:
+        fixups.push_back({program.code.size(), operand});
+        break;
+      }
+
+      program.code.push_back(instruction);
+      program.region.push_back(static_cast<std::uint32_t>(program.labels.size() - 1));
+    }
+
+    for (const Fixup &fixup : fixups)
+    {
+      const auto it = labels.find(fixup.label);
+      Instruction &instruction = program.code[fixup.instruction];
+      if (it == labels.end())
+        fail(instruction.line, "rótulo \"" + std::string(fixup.label) + "\" não existe");
+      instruction.operand = it->second;
+    }
+    thread(program);
+    return program;
+  }
+
+  Result run(const Program &program, const Options &options)
+  {
+    Result result;
+    result.instructions = program.code.size();
+
+    std::vector<std::int16_t> memory = program.memory;
+    std::vector<std::uint64_t> blockCount(program.blocks.size(), 0);
+    std::vector<std::uint32_t> callStack;
+    // cópia de threaded, só quando o limite de ciclos cai no meio de um bloco
+    std::vector<ThreadedInstruction> patched;
+
+    std::int16_t *const mem = memory.data();
+    const Array *const arrays = program.arrays.data();
+    const Block *const blocks = program.blocks.data();
+    const std::int32_t indexAddress = program.indexAddress;
+    const ThreadedInstruction *code = program.threaded.data();
+    const ThreadedInstruction *ip = code;
+    const ThreadedInstruction *blockEnd = code;
+    std::uint32_t block = 0;
+    std::uint64_t cycles = 0;
+    std::uint64_t unexecuted = 0; // do bloco corrente, quando a execução para no meio
+    std::size_t nextInput = 0;
+    std::int16_t acc = 0;
+    std::int16_t status = 0;
+
+    auto input = [&]() -> std::int16_t {
+      return nextInput < options.input.size() ? wrap(options.input[nextInput++]) : 0;
+    };
+    auto stop = [&](const std::string &message, bool executed) {
+      result.error = message;
+      result.errorLine = program.code[program.origin[ip - code]].line;
+      unexecuted = static_cast<std::uint64_t>(blockEnd - ip) - (executed ? 1 : 0);
+    };
+
+#define BIP_ALU(expression) \
+  acc = wrap(expression);   \
+  status = acc
+#define BIP_NEXT() \
+  ++ip;            \
+  BIP_DISPATCH()
+#define BIP_JUMP(target)   \
+  ip = code + (target);    \
+  BIP_DISPATCH()
+#define BIP_BRANCH(condition) \
+  if (condition)              \
+  {                           \
+    BIP_JUMP(ip->operand);    \
+  }                           \
+  BIP_NEXT()
+
+#if defined(__GNUC__)
+    // despacho encadeado: cada tratador salta direto para o próximo
+#define BIP_LABEL(name) &&L_##name,
+    static const void *const DISPATCH[] = {BIP_HANDLERS(BIP_LABEL)};
+#undef BIP_LABEL
+#define BIP_DISPATCH() goto *DISPATCH[ip->handler]
+#define BIP_HANDLER(name) L_##name:
+    BIP_DISPATCH();
+#else
+#define BIP_DISPATCH() continue
+#define BIP_HANDLER(name) case H_##name:
+    for (;;)
+      switch (ip->handler)
+      {
+#endif
+
+    BIP_HANDLER(BLOCK)
+    {
+      block = static_cast<std::uint32_t>(ip->operand);
+      const std::uint32_t length = blocks[block].length;
+      ++blockCount[block];
+      blockEnd = ip + 1 + length;
+      if (cycles + length > options.maxCycles)
+      {
+        // o limite cai dentro do bloco: marca a instrução onde ele para
+        const std::size_t at = static_cast<std::size_t>(ip - code) + 1 + (options.maxCycles - cycles);
+        if (patched.empty())
+        {
+          patched = program.threaded;
+          ip = patched.data() + (ip - code);
+          blockEnd = patched.data() + (blockEnd - code);
+          code = patched.data();
+        }
+        patched[at].handler = H_LIMIT;
+      }
+      cycles += length;
+      BIP_NEXT();
+    }
+    BIP_HANDLER(END)
+    {
+      result.halted = true;
+      goto done;
+    }
+    BIP_HANDLER(LIMIT)
+    {
+      stop("limite de " + std::to_string(options.maxCycles) + " ciclos atingido", false);
+      goto done;
+    }
+    BIP_HANDLER(HLT)
+    {
+      result.halted = true;
+      goto done;
+    }
+    BIP_HANDLER(NOP)
+    {
+      BIP_NEXT();
+    }
+    BIP_HANDLER(LD)
+    {
+      acc = mem[ip->operand];
+      BIP_NEXT();
+    }
+    BIP_HANDLER(LD_IN)
+    {
+      acc = input();
+      BIP_NEXT();
+    }
+    BIP_HANDLER(LDI)
+    {
+      acc = static_cast<std::int16_t>(ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(STO)
+    {
+      mem[ip->operand] = acc;
+      BIP_NEXT();
+    }
+    BIP_HANDLER(STO_OUT)
+    {
+      result.output.push_back(acc);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(LDV)
+    BIP_HANDLER(STOV)
+    {
+      const Array &array = arrays[ip->operand];
+      const std::int16_t index = mem[indexAddress];
+      if (index < 0 || index >= array.length)
+      {
+        stop("índice " + std::to_string(index) + " fora do vetor de tamanho " + std::to_string(array.length), true);
+        goto done;
+      }
+      if (ip->handler == H_LDV)
+        acc = mem[array.base + index];
+      else
+        mem[array.base + index] = acc;
+      BIP_NEXT();
+    }
+    BIP_HANDLER(ADD)
+    {
+      BIP_ALU(acc + mem[ip->operand]);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(ADDI)
+    {
+      BIP_ALU(acc + ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(SUB)
+    {
+      BIP_ALU(acc - mem[ip->operand]);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(SUBI)
+    {
+      BIP_ALU(acc - ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(MUL)
+    {
+      BIP_ALU(acc * mem[ip->operand]);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(MULI)
+    {
+      BIP_ALU(acc * ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(DIV)
+    BIP_HANDLER(DIVI)
+    BIP_HANDLER(MOD)
+    BIP_HANDLER(MODI)
+    {
+      const bool immediate = ip->handler == H_DIVI || ip->handler == H_MODI;
+      const std::int32_t divisor = immediate ? ip->operand : mem[ip->operand];
+      if (divisor == 0)
+      {
+        stop("divisão por zero", true);
+        goto done;
+      }
+      const bool quotient = ip->handler == H_DIV || ip->handler == H_DIVI;
+      BIP_ALU(quotient ? acc / divisor : acc % divisor);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(AND)
+    {
+      BIP_ALU(acc & mem[ip->operand]);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(ANDI)
+    {
+      BIP_ALU(acc & ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(OR)
+    {
+      BIP_ALU(acc | mem[ip->operand]);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(ORI)
+    {
+      BIP_ALU(acc | ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(XOR)
+    {
+      BIP_ALU(acc ^ mem[ip->operand]);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(XORI)
+    {
+      BIP_ALU(acc ^ ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(NOT)
+    {
+      BIP_ALU(~acc);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(SLL)
+    {
+      BIP_ALU(static_cast<std::uint16_t>(acc) << (mem[ip->operand] & 15));
+      BIP_NEXT();
+    }
+    BIP_HANDLER(SLLI)
+    {
+      BIP_ALU(static_cast<std::uint16_t>(acc) << ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(SRL)
+    {
+      BIP_ALU(static_cast<std::uint16_t>(acc) >> (mem[ip->operand] & 15));
+      BIP_NEXT();
+    }
+    BIP_HANDLER(SRLI)
+    {
+      BIP_ALU(static_cast<std::uint16_t>(acc) >> ip->operand);
+      BIP_NEXT();
+    }
+    BIP_HANDLER(ALU_IN)
+    {
+      // operação da ULA lendo $in_port: rara, vai pelo caminho genérico
+      if (!applyAlu(program.code[ip->operand].opcode, acc, input(), acc))
+      {
+        stop("divisão por zero", true);
+        goto done;
+      }
+      status = acc;
+      BIP_NEXT();
+    }
+    BIP_HANDLER(JMP)
+    {
+      BIP_JUMP(ip->operand);
+    }
+    BIP_HANDLER(BEQ)
+    {
+      BIP_BRANCH(status == 0);
+    }
+    BIP_HANDLER(BNE)
+    {
+      BIP_BRANCH(status != 0);
+    }
+    BIP_HANDLER(BGT)
+    {
+      BIP_BRANCH(status > 0);
+    }
+    BIP_HANDLER(BGE)
+    {
+      BIP_BRANCH(status >= 0);
+    }
+    BIP_HANDLER(BLT)
+    {
+      BIP_BRANCH(status < 0);
+    }
+    BIP_HANDLER(BLE)
+    {
+      BIP_BRANCH(status <= 0);
+    }
+    BIP_HANDLER(CALL)
+    {
+      if (callStack.size() >= options.maxCallDepth)
+      {
+        stop("pilha de chamadas passou de " + std::to_string(options.maxCallDepth), true);
+        goto done;
+      }
+      callStack.push_back(static_cast<std::uint32_t>(ip - code) + 1);
+      BIP_JUMP(ip->operand);
+    }
+    BIP_HANDLER(RETURN)
+    {
+      if (callStack.empty())
+      {
+        stop("RETURN sem CALL", true);
+        goto done;
+      }
+      const std::uint32_t target = callStack.back();
+      callStack.pop_back();
+      BIP_JUMP(target);
+    }
+
+#if !defined(__GNUC__)
+      }
+#endif
+#undef BIP_HANDLER
+#undef BIP_DISPATCH
+#undef BIP_BRANCH
+#undef BIP_JUMP
+#undef BIP_NEXT
+#undef BIP_ALU
+
+  done:
+    // ciclos e entradas por trecho saem das contagens de bloco
+    std::vector<std::uint64_t> regionCycles(program.labels.size(), 0);
+    std::vector<std::uint64_t> regionEntries(program.labels.size(), 0);
+    for (std::size_t b = 0; b < program.blocks.size(); ++b)
+    {
+      regionCycles[blocks[b].region] += blockCount[b] * blocks[b].length;
+      if (blocks[b].entersRegion)
+        regionEntries[blocks[b].region] += blockCount[b];
+    }
+    if (unexecuted > 0)
+    {
+      regionCycles[blocks[block].region] -= unexecuted;
+      // parou antes da primeira instrução do bloco: o trecho não foi executado
+      if (unexecuted == blocks[block].length && blocks[block].entersRegion)
+        --regionEntries[blocks[block].region];
+    }
+    result.cycles = cycles - unexecuted;
+
+    for (std::size_t region = 0; region < program.labels.size(); ++region)
+    {
+      if (regionCycles[region] > 0)
+        result.hotSpots.push_back({program.labels[region], regionCycles[region], regionEntries[region]});
+    }
+    std::stable_sort(result.hotSpots.begin(), result.hotSpots.end(),
+                     [](const HotSpot &a, const HotSpot &b) { return a.cycles > b.cycles; });
+    return result;
+  }
+
+  std::string report(const Result &result, std::size_t topSpots)
+  {
+    std::string out;
+    if (result.halted)
+      out += "Execução concluída (HLT)\n";
+    else
+      out += "Execução interrompida na linha " + std::to_string(result.errorLine) + ": " + result.error + "\n";
+    out += "Instruções no programa: " + std::to_string(result.instructions) + "\n";
+    out += "Ciclos executados: " + std::to_string(result.cycles) + "\n";
+    out += "Saída:";
+    for (int value : result.output)
+      out += " " + std::to_string(value);
+    out += "\n";
+
+    if (!result.hotSpots.empty())
+    {
+      out += "Trechos mais executados:\n";
+      const std::size_t shown = std::min(topSpots, result.hotSpots.size());
+      for (std::size_t i = 0; i < shown; ++i)
+      {
+        const HotSpot &spot = result.hotSpots[i];
+        char line[160];
+        const double share = result.cycles ? 100.0 * static_cast<double>(spot.cycles) / static_cast<double>(result.cycles) : 0.0;
+        std::snprintf(line, sizeof line, " %12llu ciclos %6.1f%%  %10llu entradas\n",
+                      static_cast<unsigned long long>(spot.cycles), share, static_cast<unsigned long long>(spot.entries));
+        // alinha pelo número de caracteres, não de bytes ("(início)" tem acento)
+        const std::size_t width = static_cast<std::size_t>(std::count_if(spot.label.begin(), spot.label.end(),
+                                                                          [](char c) { return (c & 0xC0) != 0x80; }));
+        out += "  " + spot.label + std::string(width < 16 ? 16 - width : 0, ' ') + line;
+      }
+    }
+    return out;
+  }
+}
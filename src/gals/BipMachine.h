@@ -0,0 +1,161 @@
+#ifndef BIP_MACHINE_H
+#define BIP_MACHINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Máquina BIP para medir o código gerado: monta o texto de
+// BipGenerator::render (.data, .text e rótulos) e executa com entrada e
+// saída simuladas.
+//
+// Modelo seguido:
+//   - palavras de 16 bits com sinal; as contas dão a volta;
+//   - endereços numéricos (os temporários 900–999) vão direto à memória
+//     de 1024 palavras; os nomes do .data ficam depois dela, então um
+//     .data de qualquer tamanho não colide com os temporários;
+//   - $indr é o registrador de índice de LDV/STOV, $in_port lê a próxima
+//     entrada (0 quando acabam) e $out_port grava na saída;
+//   - desvios olham o resultado da última operação da ULA (o SUB que o
+//     gerador põe antes de cada um);
+//   - SLL/SRL: número é deslocamento imediato, como no BIP; nome ou
+//     temporário (o gerador os usa quando o deslocamento não é literal) é
+//     lido da memória. Só os 4 bits baixos do deslocamento contam;
+//   - o BIP é monociclo: cada instrução executada custa um ciclo.
+namespace BipMachine
+{
+  enum class Opcode : std::uint8_t
+  {
+    HLT,
+    LD,
+    LDI,
+    STO,
+    LDV,
+    STOV,
+    ADD,
+    ADDI,
+    SUB,
+    SUBI,
+    MUL,
+    MULI,
+    DIV,
+    DIVI,
+    MOD,
+    MODI,
+    AND,
+    ANDI,
+    OR,
+    ORI,
+    XOR,
+    XORI,
+    NOT,
+    SLL,
+    SRL,
+    JMP,
+    BEQ,
+    BNE,
+    BGT,
+    BGE,
+    BLT,
+    BLE,
+    CALL,
+    RETURN
+  };
+
+  // Operando já resolvido: endereço de memória, valor imediato, índice de
+  // instrução (desvios) ou índice em Program::arrays (LDV/STOV).
+  struct Instruction
+  {
+    Opcode opcode = Opcode::HLT;
+    bool immediate = false; // SLL/SRL com deslocamento literal
+    std::int32_t operand = 0;
+    std::uint32_t line = 0;
+  };
+
+  struct Array
+  {
+    std::int32_t base = 0;
+    std::int32_t length = 0;
+  };
+
+  // Forma que run() executa, montada junto com code: 8 bytes por posição,
+  // com o tratador já escolhido pelo opcode e pelo tipo do operando (porta,
+  // $indr, imediato) e os desvios apontando para posições desta lista.
+  // Cada bloco básico começa com um marcador que soma os ciclos do bloco de
+  // uma vez, então as instruções em si não contam nada.
+  struct ThreadedInstruction
+  {
+    std::uint8_t handler = 0;
+    std::int32_t operand = 0;
+  };
+
+  struct Block
+  {
+    std::uint32_t length = 0; // instruções do bloco
+    std::uint32_t region = 0;
+    bool entersRegion = false; // começa no primeiro rótulo do trecho
+  };
+
+  struct Program
+  {
+    std::vector<Instruction> code;
+    std::vector<std::int16_t> memory; // imagem inicial, com o .data
+    std::vector<Array> arrays;
+    // Trecho de cada instrução: índice em labels do último rótulo antes
+    // dela ("(início)" antes do primeiro).
+    std::vector<std::string> labels;
+    std::vector<std::uint32_t> region;
+
+    std::vector<ThreadedInstruction> threaded;
+    std::vector<std::uint32_t> origin; // índice em code de cada posição de threaded
+    std::vector<Block> blocks;
+    std::int32_t indexAddress = 0; // $indr vive na memória, depois do .data
+  };
+
+  // Endereços fora da memória que identificam os registradores de E/S.
+  constexpr std::int32_t DIRECT_MEMORY = 1024;
+  constexpr std::int32_t INDEX_REGISTER = -1;
+  constexpr std::int32_t IN_PORT = -2;
+  constexpr std::int32_t OUT_PORT = -3;
+
+  // Lança std::runtime_error ("linha N: ...") para instrução, operando ou
+  // rótulo desconhecido.
+  Program assemble(std::string_view text);
+
+  struct Options
+  {
+    std::vector<int> input;
+    // Para programas que não terminam.
+    std::uint64_t maxCycles = 100000000;
+    std::size_t maxCallDepth = 65536;
+  };
+
+  struct HotSpot
+  {
+    std::string label;
+    std::uint64_t cycles = 0;
+    std::uint64_t entries = 0; // vezes que a execução entrou no trecho
+  };
+
+  struct Result
+  {
+    bool halted = false; // chegou a HLT (ou ao fim do código)
+    std::string error;   // motivo da parada quando !halted
+    std::uint32_t errorLine = 0;
+    std::vector<int> output;
+    std::size_t instructions = 0; // tamanho do programa montado
+    std::uint64_t cycles = 0;     // instruções executadas
+    std::vector<HotSpot> hotSpots; // mais ciclos primeiro; só trechos executados
+  };
+
+  // Pode ser chamada muitas vezes sobre o mesmo Program: cada execução
+  // copia só a memória.
+  Result run(const Program &program, const Options &options = Options());
+
+  // Relatório em texto (CLI): ciclos, saída e os trechos mais quentes.
+  std::string report(const Result &result, std::size_t topSpots = 10);
+}
+
+#endif
@@ -0,0 +1,410 @@
+#include "BipPeephole.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace BipPeephole
+{
+  namespace
+  {
+    constexpr const char *RULE_NAMES[RULE_COUNT] = {"carga-redundante", "armazenamento-redundante", "operacao-neutra",
+                                                    "salto-para-seguinte", "rotulos-seguidos", "codigo-inalcancavel"};
+
+    std::size_t ruleIndex(Rule rule)
+    {
+      std::size_t index = 0;
+      while ((1u << index) != static_cast<unsigned>(rule))
+        ++index;
+      return index;
+    }
+
+    using Bip::Instruction;
+    using Bip::Opcode;
+    using Bip::Operand;
+
+    bool endsFlow(Opcode opcode)
+    {
+      return opcode == Opcode::JMP || opcode == Opcode::RETURN || opcode == Opcode::HLT;
+    }
+
+    // Operações da ULA: mudam o acumulador e o resultado que os desvios olham.
+    bool writesStatus(Opcode opcode)
+    {
+      return opcode >= Opcode::ADD && opcode <= Opcode::SRL;
+    }
+
+    // Portas têm efeito ao ler ou gravar; $indr é um registrador comum.
+    bool isPort(const Instruction &instruction)
+    {
+      return instruction.kind == Operand::InPort || instruction.kind == Operand::OutPort;
+    }
+
+    // Desvio ou CALL para um rótulo (e não para um endereço numérico).
+    bool targetsLabel(const Instruction &instruction)
+    {
+      return Bip::takesLabel(instruction.opcode) && instruction.kind == Operand::Symbol;
+    }
+
+    bool isNeutral(const Instruction &instruction)
+    {
+      if (instruction.kind != Operand::Immediate)
+        return false;
+      switch (instruction.opcode)
+      {
+      case Opcode::ADDI:
+      case Opcode::SUBI:
+      case Opcode::ORI:
+      case Opcode::XORI:
+      case Opcode::SLL:
+      case Opcode::SRL:
+        return instruction.value == 0;
+      case Opcode::MULI:
+      case Opcode::DIVI:
+        return instruction.value == 1;
+      case Opcode::ANDI:
+        return instruction.value == -1;
+      default:
+        return false;
+      }
+    }
+
+    class Pass
+    {
+    public:
+      Pass(std::vector<Instruction> &code, const Interner &names, const Options &options, Stats &stats)
+          : code(code), names(names), options(options), stats(stats), alive(code.size(), true) {}
+
+      bool run()
+      {
+        const std::size_t removedBefore = removedCount;
+        if (options.rules & MERGE_LABELS)
+          mergeLabels();
+        if (options.rules & UNREACHABLE)
+          dropUnreachable();
+        for (std::size_t i = 0; i < code.size(); ++i)
+        {
+          if (!alive[i] || code[i].isLabel())
+            continue;
+          const Opcode opcode = code[i].opcode;
+          if ((options.rules & REDUNDANT_LOAD) && (opcode == Opcode::LD || opcode == Opcode::LDI) && redundantLoad(i))
+            remove(i, REDUNDANT_LOAD);
+          else if ((options.rules & REDUNDANT_STORE) && opcode == Opcode::STO && redundantStore(i))
+            remove(i, REDUNDANT_STORE);
+          else if ((options.rules & NEUTRAL_OPERATION) && isNeutral(code[i]) && statusDeadAfter(i))
+            remove(i, NEUTRAL_OPERATION);
+          else if ((options.rules & JUMP_TO_NEXT) && Bip::isBranch(opcode) && jumpsToNext(i))
+            remove(i, JUMP_TO_NEXT);
+        }
+
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < code.size(); ++i)
+        {
+          if (alive[i])
+            code[kept++] = code[i];
+        }
+        code.resize(kept);
+        return removedCount != removedBefore || labelsChanged;
+      }
+
+    private:
+      std::vector<Instruction> &code;
+      const Interner &names;
+      const Options &options;
+      Stats &stats;
+      std::vector<bool> alive;
+      std::size_t removedCount = 0;
+      bool labelsChanged = false;
+
+      bool isEntryLabel(std::int32_t label) const
+      {
+        const std::string_view name = names.text(static_cast<Interner::Id>(label));
+        return !name.empty() && name.front() == '_';
+      }
+
+      void remove(std::size_t i, Rule rule)
+      {
+        alive[i] = false;
+        if (!code[i].isLabel())
+        {
+          ++stats.removed[ruleIndex(rule)];
+          ++removedCount;
+        }
+        else
+          labelsChanged = true;
+      }
+
+      // Visita as instruções vivas antes de i, da mais próxima para trás, até
+      // visit recusar, um rótulo (pode-se chegar ali por salto) ou o fim da
+      // janela.
+      template <class Visit>
+      void scanBack(std::size_t i, Visit visit)
+      {
+        std::size_t seen = 0;
+        for (std::size_t j = i; j-- > 0 && seen < options.window;)
+        {
+          if (!alive[j])
+            continue;
+          if (code[j].isLabel() || !visit(code[j]))
+            return;
+          ++seen;
+        }
+      }
+
+      // LD x / LDI k: o acumulador já tem esse valor se, voltando só por
+      // STO/STOV (que não o mudam), chega-se a LD x, LDI k ou STO x.
+      bool redundantLoad(std::size_t i)
+      {
+        const Instruction &load = code[i];
+        if (isPort(load))
+          return false;
+        bool redundant = false;
+        scanBack(i, [&](const Instruction &previous) {
+          if (previous.opcode == Opcode::STO)
+          {
+            redundant = load.opcode == Opcode::LD && previous.sameOperand(load);
+            return !redundant;
+          }
+          if (previous.opcode == Opcode::STOV)
+            return !previous.sameOperand(load);
+          redundant = previous == load;
+          return false;
+        });
+        return redundant;
+      }
+
+      // STO x: x já vale o acumulador se, voltando por STO/STOV em outros
+      // nomes, chega-se a LD x ou a outro STO x.
+      bool redundantStore(std::size_t i)
+      {
+        const Instruction &store = code[i];
+        if (isPort(store))
+          return false;
+        bool redundant = false;
+        scanBack(i, [&](const Instruction &previous) {
+          if (previous.opcode == Opcode::STO || previous.opcode == Opcode::LD)
+          {
+            if (previous.sameOperand(store))
+            {
+              redundant = true;
+              return false;
+            }
+            return previous.opcode == Opcode::STO;
+          }
+          if (previous.opcode == Opcode::STOV)
+            return !previous.sameOperand(store);
+          return false;
+        });
+        return redundant;
+      }
+
+      // O resultado da ULA em i não é lido por desvio: outra operação da ULA
+      // (ou HLT) vem antes de qualquer desvio, chamada ou rótulo.
+      bool statusDeadAfter(std::size_t i)
+      {
+        std::size_t seen = 0;
+        for (std::size_t j = i + 1; j < code.size() && seen < options.window; ++j)
+        {
+          if (!alive[j])
+            continue;
+          const Opcode next = code[j].opcode;
+          if (next == Opcode::Label)
+            return false;
+          if (writesStatus(next) || next == Opcode::HLT)
+            return true;
+          if (next != Opcode::LD && next != Opcode::LDI && next != Opcode::LDV && next != Opcode::STO && next != Opcode::STOV)
+            return false;
+          ++seen;
+        }
+        return false;
+      }
+
+      bool jumpsToNext(std::size_t i)
+      {
+        if (code[i].kind != Operand::Symbol)
+          return false;
+        for (std::size_t j = i + 1; j < code.size(); ++j)
+        {
+          if (!alive[j])
+            continue;
+          if (!code[j].isLabel())
+            return false;
+          if (code[j].value == code[i].value)
+            return true;
+        }
+        return false;
+      }
+
+      // Rótulos seguidos: fica o de entrada, se houver, senão o primeiro; os
+      // desvios para os outros passam a usá-lo.
+      void mergeLabels()
+      {
+        std::unordered_map<std::int32_t, std::int32_t> renamed;
+        for (std::size_t i = 0; i < code.size();)
+        {
+          if (!code[i].isLabel())
+          {
+            ++i;
+            continue;
+          }
+          std::size_t end = i;
+          std::size_t keep = i;
+          std::size_t entries = 0;
+          for (; end < code.size() && code[end].isLabel(); ++end)
+          {
+            if (isEntryLabel(code[end].value) && entries++ == 0)
+              keep = end;
+          }
+          if (entries <= 1)
+          {
+            for (std::size_t j = i; j < end; ++j)
+            {
+              if (j != keep)
+              {
+                renamed[code[j].value] = code[keep].value;
+                remove(j, MERGE_LABELS);
+              }
+            }
+          }
+          i = end;
+        }
+        if (renamed.empty())
+          return;
+        for (Instruction &instruction : code)
+        {
+          if (!targetsLabel(instruction))
+            continue;
+          const auto it = renamed.find(instruction.value);
+          if (it != renamed.end())
+            instruction.value = it->second;
+        }
+      }
+
+      // Depois de JMP/RETURN/HLT só se chega por um rótulo alvo de desvio
+      // (ou de entrada); o que vem antes dele some, rótulos sem uso inclusive.
+      void dropUnreachable()
+      {
+        std::unordered_set<std::int32_t> targets;
+        for (const Instruction &instruction : code)
+        {
+          if (targetsLabel(instruction))
+            targets.insert(instruction.value);
+        }
+        bool dead = false;
+        for (std::size_t i = 0; i < code.size(); ++i)
+        {
+          const Instruction &instruction = code[i];
+          if (instruction.isLabel() && (targets.count(instruction.value) || isEntryLabel(instruction.value)))
+            dead = false;
+          else if (dead)
+            remove(i, UNREACHABLE);
+          else if (endsFlow(instruction.opcode))
+            dead = true;
+        }
+      }
+    };
+  }
+
+  const char *ruleName(std::size_t index)
+  {
+    return index < RULE_COUNT ? RULE_NAMES[index] : "";
+  }
+
+  bool parseRules(std::string_view list, unsigned &rules)
+  {
+    if (list == "todas")
+    {
+      rules = ALL_RULES;
+      return true;
+    }
+    if (list == "nenhuma")
+    {
+      rules = 0;
+      return true;
+    }
+    unsigned parsed = 0;
+    while (!list.empty())
+    {
+      const std::size_t comma = list.find(',');
+      const std::string_view name = list.substr(0, comma);
+      const auto *found = std::find_if(std::begin(RULE_NAMES), std::end(RULE_NAMES),
+                                       [&](const char *rule) { return name == rule; });
+      if (found == std::end(RULE_NAMES))
+        return false;
+      parsed |= 1u << (found - std::begin(RULE_NAMES));
+      list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+    }
+    rules = parsed;
+    return true;
+  }
+
+  Stats optimize(std::vector<Bip::Instruction> &code, const Interner &names, const Options &options)
+  {
+    const auto countInstructions = [&code] {
+      return static_cast<std::size_t>(std::count_if(code.begin(), code.end(), [](const Bip::Instruction &instruction) { return !instruction.isLabel(); }));
+    };
+    Stats stats;
+    stats.before = countInstructions();
+    if (options.rules != 0)
+    {
+      // uma remoção pode abrir outra (salto que vira seguinte, rótulos que se encostam)
+      while (Pass(code, names, options, stats).run())
+      {
+      }
+    }
+    stats.after = countInstructions();
+    return stats;
+  }
+
+  std::string optimize(std::string_view text, const Options &options, Stats *stats)
+  {
+    if (stats)
+      *stats = Stats();
+    const std::size_t section = text.find(".text\n");
+    if (section == std::string_view::npos)
+      return std::string(text);
+
+    Interner names;
+    std::vector<Bip::Instruction> code;
+    std::string_view rest = text.substr(section + 6);
+    while (!rest.empty())
+    {
+      const std::size_t newline = rest.find('\n');
+      std::string_view line = rest.substr(0, newline);
+      rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
+      const std::size_t first = line.find_first_not_of(" \t");
+      if (first == std::string_view::npos)
+        continue;
+      line = line.substr(first, line.find_last_not_of(" \t") - first + 1);
+      Bip::Instruction instruction;
+      if (!Bip::parse(line, names, instruction))
+        return std::string(text);
+      code.push_back(instruction);
+    }
+
+    const Stats result = optimize(code, names, options);
+    if (stats)
+      *stats = result;
+
+    std::string out(text.substr(0, section + 6));
+    for (const Bip::Instruction &instruction : code)
+      Bip::format(instruction, names, out);
+    return out;
+  }
+
+  std::string report(const Stats &stats)
+  {
+    std::string out = "Peephole: " + std::to_string(stats.before) + " -> " + std::to_string(stats.after) + " instruções (-" +
+                      std::to_string(stats.before - stats.after) + ")\n";
+    for (std::size_t rule = 0; rule < RULE_COUNT; ++rule)
+    {
+      if (stats.removed[rule] == 0)
+        continue;
+      char line[96];
+      std::snprintf(line, sizeof line, "  %-26s %8zu\n", RULE_NAMES[rule], stats.removed[rule]);
+      out += line;
+    }
+    return out;
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef BIP_PEEPHOLE_H
+#define BIP_PEEPHOLE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BipInstruction.h"
+
+// Otimização peephole do código de BipGenerator: uma lista de instruções
+// percorrida com uma janela deslizante de regras de reescrita, que só
+// removem instruções ou trocam o rótulo de um desvio.
+//
+// Rótulos que começam com '_' (_PRINCIPAL e as rotinas) são pontos de
+// entrada e nunca somem; os demais (R1, R2, ...) podem ser fundidos ou
+// descartados quando ninguém mais salta para eles.
+namespace BipPeephole
+{
+  enum Rule : unsigned
+  {
+    REDUNDANT_LOAD = 1u << 0,  // LD x / LDI k com o acumulador já igual
+    REDUNDANT_STORE = 1u << 1, // STO x com x já igual ao acumulador
+    NEUTRAL_OPERATION = 1u << 2, // ADDI 0, SLL 0, MULI 1... sem desvio que leia o resultado
+    JUMP_TO_NEXT = 1u << 3,    // JMP/Bxx para a instrução seguinte
+    MERGE_LABELS = 1u << 4,    // rótulos seguidos viram um só
+    UNREACHABLE = 1u << 5,     // código depois de JMP/RETURN/HLT que ninguém alcança
+    ALL_RULES = (1u << 6) - 1
+  };
+  constexpr std::size_t RULE_COUNT = 6;
+
+  // Nome de cada regra no CLI (--peephole=...) e nos relatórios.
+  const char *ruleName(std::size_t index);
+
+  // "todas", "nenhuma" ou nomes separados por vírgula; false para nome
+  // desconhecido.
+  bool parseRules(std::string_view list, unsigned &rules);
+
+  struct Options
+  {
+    unsigned rules = ALL_RULES;
+    std::size_t window = 8; // instruções olhadas para trás/à frente
+  };
+
+  struct Stats
+  {
+    std::size_t before = 0; // instruções (rótulos não contam)
+    std::size_t after = 0;
+    std::size_t removed[RULE_COUNT] = {};
+  };
+
+  // Reescreve code até nenhuma regra se aplicar e devolve o que cada uma
+  // removeu. names é o Interner em que os rótulos de code foram internados.
+  Stats optimize(std::vector<Bip::Instruction> &code, const Interner &names, const Options &options);
+
+  // O mesmo sobre o texto completo (.data e .text); o .data passa intacto e
+  // um .text com linha que Bip::parse não reconhece volta como está.
+  std::string optimize(std::string_view code, const Options &options, Stats *stats = nullptr);
+
+  // "Peephole: N -> M instruções (-K)" e uma linha por regra que atuou.
+  std::string report(const Stats &stats);
+}
+
+#endif
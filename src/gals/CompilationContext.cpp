@@ -0,0 +1,15 @@
+#include "CompilationContext.h"
+
+#include <iostream>
+#include <utility>
+
+CompilationContext::CompilationContext()
+    : report(&std::cout), semanticState(createSemanticState(nameTable)), bipState(createBipState(nameTable))
+{
+}
+
+void CompilationContext::setSource(std::shared_ptr<const SourceBuffer> source)
+{
+    sourceBuffer = std::move(source);
+    sourceCode = sourceBuffer ? sourceBuffer->view() : std::string_view();
+}
@@ -0,0 +1,66 @@
+#ifndef COMPILATION_CONTEXT_H
+#define COMPILATION_CONTEXT_H
+
+#include <iosfwd>
+#include <memory>
+#include <string_view>
+
+#include "Interner.h"
+#include "SourceBuffer.h"
+
+// Estado privado de cada etapa, definido no módulo dono
+// (SemanticState em Semantico.cpp, BipState em BipGenerator.cpp).
+struct SemanticState;
+struct BipState;
+
+struct SemanticStateDeleter
+{
+    void operator()(SemanticState *state) const;
+};
+
+struct BipStateDeleter
+{
+    void operator()(BipState *state) const;
+};
+
+std::unique_ptr<SemanticState, SemanticStateDeleter> createSemanticState(Interner &names);
+std::unique_ptr<BipState, BipStateDeleter> createBipState(Interner &names);
+
+// Tudo o que uma compilação acumula: o fonte, os nomes internados, a tabela
+// de símbolos e as pilhas do Semantico, e as instruções, aliases e funções
+// do BipGenerator.
+// Compilações com contextos diferentes são independentes e podem rodar em
+// threads separadas; reaproveitar um contexto reaproveita a memória já
+// alocada (resetState só limpa os vetores).
+class CompilationContext
+{
+public:
+    CompilationContext();
+
+    CompilationContext(const CompilationContext &) = delete;
+    CompilationContext &operator=(const CompilationContext &) = delete;
+
+    void setSource(std::shared_ptr<const SourceBuffer> source);
+    std::string_view source() const { return sourceCode; }
+
+    // Destino do relatório final (tabela de símbolos e diagnósticos);
+    // std::cout por padrão, nullptr desliga.
+    void setReportStream(std::ostream *stream) { report = stream; }
+    std::ostream *reportStream() const { return report; }
+
+    // Identificadores da compilação; Semantico::resetState os descarta.
+    Interner &names() { return nameTable; }
+
+    SemanticState &semantic() { return *semanticState; }
+    BipState &bip() { return *bipState; }
+
+private:
+    std::shared_ptr<const SourceBuffer> sourceBuffer;
+    std::string_view sourceCode;
+    std::ostream *report;
+    Interner nameTable;
+    std::unique_ptr<SemanticState, SemanticStateDeleter> semanticState;
+    std::unique_ptr<BipState, BipStateDeleter> bipState;
+};
+
+#endif
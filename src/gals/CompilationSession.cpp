@@ -0,0 +1,301 @@
+#include "CompilationSession.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+  // Cada ponto de retomada copia o estado do Semantico; com pontos muito
+  // próximos a primeira compilação gasta mais copiando do que analisando.
+  const std::size_t CHECKPOINT_INTERVAL = 512;
+
+  bool endsStatement(TokenId id)
+  {
+    return id == t_KEY_SEMICOLON || id == t_KEY_LBRACE || id == t_KEY_RBRACE;
+  }
+}
+
+CompilationSession::CompilationSession(std::string text)
+    : semantic(compilation), source(SourceBuffer::fromString(std::move(text)))
+{
+  compilation.setReportStream(nullptr);
+}
+
+void CompilationSession::setSource(std::shared_ptr<const SourceBuffer> text)
+{
+  source = std::move(text);
+  semantic.setSourceCode(source);
+  scanner.setInput(source);
+}
+
+void CompilationSession::compile()
+{
+  setSource(source);
+  tokens.clear();
+  scanEnds.clear();
+  checkpoints.clear();
+  finalState.reset();
+  compilation.names().clear();
+  lex(0);
+  analyse({0, std::nullopt, {0, 0}});
+}
+
+void CompilationSession::edit(std::size_t offset, std::size_t removed, std::string_view inserted)
+{
+  const std::string_view old = source->view();
+  if (offset > old.size() || removed > old.size() - offset)
+    throw std::out_of_range("edição fora do texto");
+
+  std::string text;
+  text.reserve(old.size() - removed + inserted.size());
+  text.append(old.substr(0, offset));
+  text.append(inserted);
+  text.append(old.substr(offset + removed));
+  const int delta = static_cast<int>(inserted.size()) - static_cast<int>(removed);
+
+  const int from = static_cast<int>(offset + removed);
+  const auto [fromLine, fromColumn] = sourceLineColumn(compilation, from);
+  setSource(SourceBuffer::fromString(std::move(text)));
+  const auto [toLine, toColumn] = sourceLineColumn(compilation, from + delta);
+  sourceShift = {from, delta, fromLine, toLine - fromLine, toColumn - fromColumn};
+
+  analyse(relex(offset, removed, inserted.size()));
+}
+
+CompilationSession::Damage CompilationSession::relex(std::size_t offset, std::size_t removed, std::size_t inserted)
+{
+  const std::string_view text = source->view();
+
+  // um token continua igual se o Lexico não leu nada a partir de offset
+  const std::size_t kept = std::lower_bound(scanEnds.begin(), scanEnds.end(), offset) - scanEnds.begin();
+  for (std::size_t i = 0; i < kept; ++i)
+  {
+    const Token &token = tokens[i];
+    tokens[i] = Token(token.getId(), text.substr(token.getPosition(), token.getLength()), token.getPosition());
+  }
+
+  // sem a lista antiga completa não há com o que ressincronizar
+  if (lexicalError)
+  {
+    tokens.resize(kept);
+    scanEnds.resize(kept);
+    lex(kept);
+    return {kept, std::nullopt, {0, 0}};
+  }
+
+  std::vector<Token> oldTokens(tokens.begin() + kept, tokens.end());
+  std::vector<unsigned> oldScanEnds(scanEnds.begin() + kept, scanEnds.end());
+  tokens.resize(kept);
+  scanEnds.resize(kept);
+
+  const long delta = static_cast<long>(inserted) - static_cast<long>(removed);
+  const std::size_t editEnd = offset + inserted;
+  Damage damage{kept, std::nullopt, {0, 0}};
+  std::size_t old = 0;
+
+  scanner.setPosition(kept ? tokens[kept - 1].getPosition() + tokens[kept - 1].getLength() : 0);
+  relexed = 0;
+  try
+  {
+    for (Token token = scanner.nextToken(); token.isValid(); token = scanner.nextToken())
+    {
+      // depois do trecho editado, um token que começa onde começava um
+      // token antigo (deslocado) inicia a mesma sequência de antes
+      const long position = token.getPosition();
+      if (static_cast<std::size_t>(position) >= editEnd)
+      {
+        while (old < oldTokens.size() && oldTokens[old].getPosition() + delta < position)
+          ++old;
+        if (old < oldTokens.size() && oldTokens[old].getPosition() + delta == position)
+        {
+          damage.resync = kept + old;
+          damage.tokens = {kept + old, static_cast<std::ptrdiff_t>(tokens.size()) - static_cast<std::ptrdiff_t>(kept + old)};
+          for (; old < oldTokens.size(); ++old)
+          {
+            const Token &shifted = oldTokens[old];
+            const std::size_t start = static_cast<std::size_t>(shifted.getPosition() + delta);
+            tokens.emplace_back(shifted.getId(), text.substr(start, shifted.getLength()), static_cast<int>(start));
+            pushScanEnd(static_cast<unsigned>(oldScanEnds[old] + delta));
+          }
+          break;
+        }
+      }
+      tokens.push_back(token);
+      pushScanEnd(scanner.lastScanEnd());
+      ++relexed;
+    }
+  }
+  catch (const LexicalError &error)
+  {
+    lexicalError = error;
+  }
+  return damage;
+}
+
+void CompilationSession::pushScanEnd(unsigned end)
+{
+  // um token anterior (comentário de bloco) pode ter lido mais longe
+  scanEnds.push_back(scanEnds.empty() ? end : std::max(end, scanEnds.back()));
+}
+
+void CompilationSession::lex(std::size_t from)
+{
+  lexicalError.reset();
+  scanner.setPosition(from ? tokens[from - 1].getPosition() + tokens[from - 1].getLength() : 0);
+  relexed = 0;
+  try
+  {
+    for (Token token = scanner.nextToken(); token.isValid(); token = scanner.nextToken())
+    {
+      tokens.push_back(token);
+      pushScanEnd(scanner.lastScanEnd());
+      ++relexed;
+    }
+  }
+  catch (const LexicalError &error)
+  {
+    lexicalError = error;
+  }
+}
+
+void CompilationSession::analyse(const Damage &damage)
+{
+  // Pontos antes do dano servem para retomar a análise. Os depois dele, se
+  // a análise anterior chegou ao fim, servem para reconhecer onde a nova
+  // volta a coincidir com ela; o token antes do ponto também precisa ter
+  // sido reaproveitado, já que o Semantico guarda o anterior ao atual.
+  ahead.clear();
+  nextAhead = 0;
+  tokenShift = damage.tokens;
+  auto firstStale = std::find_if(checkpoints.begin(), checkpoints.end(),
+                                 [&](const Checkpoint &saved) { return saved.tokenIndex >= damage.kept; });
+  if (finalState && damage.resync)
+  {
+    for (auto it = firstStale; it != checkpoints.end(); ++it)
+    {
+      if (it->tokenIndex > *damage.resync)
+        ahead.push_back(std::move(*it));
+    }
+  }
+  checkpoints.erase(firstStale, checkpoints.end());
+
+  const BipGenerator::Checkpoint start = checkpoints.empty() ? BipGenerator::Checkpoint{0, 0, {}} : checkpoints.back().bip;
+  tail = BipGenerator::restoreCheckpoint(compilation, start);
+
+  Sintatico::State state;
+  std::size_t first = 0;
+  if (checkpoints.empty())
+  {
+    // os pontos em ahead (e finalState) usam os nomes já internados
+    semantic.resetState(true);
+    semantic.setSourceCode(source);
+    state.stack.push_back(0);
+  }
+  else
+  {
+    const Checkpoint &resume = checkpoints.back();
+    restoreSemanticState(compilation, *resume.semantic);
+    state = resume.parser;
+    first = resume.tokenIndex;
+  }
+
+  rendered = false;
+  std::size_t last = tokens.size();
+  try
+  {
+    parser.parse(tokens, first, state, &semantic, [&](std::size_t index) {
+      if (observe(index))
+        return true;
+      last = index;
+      return false;
+    });
+  }
+  catch (...)
+  {
+    finalState.reset();
+    ahead.clear();
+    tail.reset();
+    throw;
+  }
+  ahead.clear();
+  tail.reset();
+  reparsed = last - first;
+
+  finalState = saveSemanticState(compilation);
+  closeSemanticScopes(compilation);
+}
+
+const std::string &CompilationSession::bipCode()
+{
+  if (!rendered)
+  {
+    BipGenerator::render(compilation);
+    rendered = true;
+  }
+  return BipGenerator::lastCode(compilation);
+}
+
+bool CompilationSession::observe(std::size_t index)
+{
+  if (index >= tokens.size())
+  {
+    // o erro léxico aparece onde a compilação completa o encontraria
+    if (lexicalError)
+      throw *lexicalError;
+    return true;
+  }
+
+  // no meio de uma recuperação de erro a pilha ainda não reflete a entrada
+  if (parser.recovering())
+    return true;
+
+  if (nextAhead < ahead.size() && converge(index))
+    return false;
+
+  if (!checkpoints.empty() && index < checkpoints.back().tokenIndex + CHECKPOINT_INTERVAL)
+    return true;
+  if (index > 0 && !endsStatement(tokens[index - 1].getId()))
+    return true;
+
+  // leituras à frente do Semantico (cabeçalho do for, argumentos de
+  // chamadas) não passam de um comando fora de parênteses e colchetes
+  BipGenerator::Checkpoint bip = BipGenerator::checkpoint(compilation);
+  for (std::size_t opener : bip.openDelimiters)
+  {
+    if (tokens[opener].getId() != t_KEY_LBRACE)
+      return true;
+  }
+  checkpoints.push_back({index, parser.state(), saveSemanticState(compilation), std::move(bip)});
+  return true;
+}
+
+bool CompilationSession::converge(std::size_t index)
+{
+  while (nextAhead < ahead.size() && tokenShift.apply(ahead[nextAhead].tokenIndex) < index)
+    ++nextAhead;
+  if (nextAhead == ahead.size() || tokenShift.apply(ahead[nextAhead].tokenIndex) != index)
+    return false;
+
+  const Checkpoint &old = ahead[nextAhead];
+  if (parser.state().stack != old.parser.stack || !BipGenerator::checkpointMatches(compilation, old.bip, tokenShift) ||
+      !semanticStateMatches(compilation, *old.semantic, sourceShift))
+    return false;
+
+  // daqui em diante a análise antiga vale, com posições e índices deslocados
+  const std::ptrdiff_t statements = static_cast<std::ptrdiff_t>(BipGenerator::checkpoint(compilation).statements) -
+                                    static_cast<std::ptrdiff_t>(old.bip.statements);
+  BipGenerator::appendParseTail(compilation, *tail, old.bip, tokenShift, sourceShift);
+  spliceSemanticState(compilation, *old.semantic, std::move(*finalState), sourceShift);
+
+  for (std::size_t i = nextAhead; i < ahead.size(); ++i)
+  {
+    Checkpoint &saved = ahead[i];
+    saved.tokenIndex = tokenShift.apply(saved.tokenIndex);
+    saved.parser.previousToken = tokens[saved.tokenIndex - 1];
+    BipGenerator::shiftCheckpoint(saved.bip, tokenShift, statements);
+    shiftSemanticState(*saved.semantic, sourceShift);
+    checkpoints.push_back(std::move(saved));
+  }
+  return true;
+}
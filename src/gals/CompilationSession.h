@@ -0,0 +1,119 @@
+#ifndef COMPILATION_SESSION_H
+#define COMPILATION_SESSION_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "BipGenerator.h"
+#include "CompilationContext.h"
+#include "LexicalError.h"
+#include "Lexico.h"
+#include "Semantico.h"
+#include "Sintatico.h"
+#include "SourceBuffer.h"
+#include "Token.h"
+
+// Compilação retida entre edições do mesmo programa (editor web).
+//
+// A sessão guarda os tokens do último texto e, a cada tantos tokens, um
+// ponto de retomada da análise (pilha do Sintatico, cópia do estado do
+// Semantico e o que o BipGenerator já registrou), sempre no fim de um
+// comando e fora de parênteses e colchetes. Uma edição:
+//   - relê só os tokens que o trecho alterado alcança, até reencontrar a
+//     sequência antiga deslocada;
+//   - retoma a análise do último ponto anterior ao dano;
+//   - para no primeiro ponto depois do dano em que o estado volta a ser o
+//     da análise antiga, e adota o fim dela com as posições deslocadas.
+//
+// Tabela de símbolos e diagnósticos ficam prontos ao fim de compile() e
+// edit(), com todos os erros da compilação completa (as chamadas são
+// conferidas pelo Semantico). O código BIP só é montado quando pedido
+// (bipCode()): rótulos e aliases são numerados no programa inteiro, então
+// uma edição local muda os blocos seguintes, e o editor não precisa dele a
+// cada tecla.
+class CompilationSession
+{
+public:
+    explicit CompilationSession(std::string text);
+
+    CompilationSession(const CompilationSession &) = delete;
+    CompilationSession &operator=(const CompilationSession &) = delete;
+
+    // Compila o texto inteiro, descartando tokens e pontos de retomada.
+    void compile();
+
+    // Troca removed bytes a partir de offset por inserted e recompila o que
+    // a troca alcança. Lança os mesmos erros que a compilação completa
+    // (std::out_of_range se a faixa não existe); a sessão continua valendo
+    // para as próximas edições.
+    void edit(std::size_t offset, std::size_t removed, std::string_view inserted);
+
+    // Monta o código BIP da última compilação, uma vez por compilação; só
+    // faz sentido se ela terminou sem erro.
+    const std::string &bipCode();
+
+    CompilationContext &context() { return compilation; }
+    std::string_view text() const { return source->view(); }
+
+    // Tokens relidos e reanalisados na última compilação.
+    std::size_t relexedTokens() const { return relexed; }
+    std::size_t reparsedTokens() const { return reparsed; }
+
+private:
+    using SavedState = std::unique_ptr<SemanticState, SemanticStateDeleter>;
+
+    struct Checkpoint
+    {
+        std::size_t tokenIndex;
+        Sintatico::State parser;
+        SavedState semantic;
+        BipGenerator::Checkpoint bip;
+    };
+
+    // Onde a edição mexeu na lista de tokens: os kept primeiros ficaram, e
+    // os antigos a partir de resync (se houver) andaram tokens.delta.
+    struct Damage
+    {
+        std::size_t kept;
+        std::optional<std::size_t> resync;
+        BipGenerator::TokenShift tokens;
+    };
+
+    CompilationContext compilation;
+    Semantico semantic;
+    Sintatico parser;
+    Lexico scanner;
+    std::shared_ptr<const SourceBuffer> source;
+
+    std::vector<Token> tokens;
+    std::vector<unsigned> scanEnds; // maior lastScanEnd() até cada token
+    std::optional<LexicalError> lexicalError; // tokens pararam neste erro
+    std::vector<Checkpoint> checkpoints;
+    SavedState finalState; // fim da última análise sem erro, antes de fechar os escopos
+
+    // Durante edit(): pontos antigos depois do dano, ainda na numeração
+    // antiga, e o fim do parse anterior para emendar na convergência.
+    std::vector<Checkpoint> ahead;
+    std::size_t nextAhead = 0;
+    std::shared_ptr<BipGenerator::ParseTail> tail;
+    BipGenerator::TokenShift tokenShift{0, 0};
+    SourceShift sourceShift{0, 0};
+
+    bool rendered = false;
+    std::size_t relexed = 0;
+    std::size_t reparsed = 0;
+
+    void setSource(std::shared_ptr<const SourceBuffer> text);
+    Damage relex(std::size_t offset, std::size_t removed, std::size_t inserted);
+    void pushScanEnd(unsigned end);
+    void lex(std::size_t from);
+    void analyse(const Damage &damage);
+    bool observe(std::size_t index);
+    bool converge(std::size_t index);
+};
+
+#endif
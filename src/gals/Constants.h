@@ -98,7 +98,38 @@ const int ACCEPT = 3;
 const int GO_TO  = 4;
 const int ERROR  = 5;
 
-extern const int PARSER_TABLE[381][248][2];
+const int PARSER_STATES = 381;
+const int PARSER_TERMINALS = 69;
+
+const int PARSER_CELL_SHIFT = 12;
+const int PARSER_CELL_MASK = (1 << PARSER_CELL_SHIFT) - 1;
+const int PARSER_ERROR_CELL = ERROR << PARSER_CELL_SHIFT;
+
+extern const unsigned short PARSER_ACTION_BASE[381];
+extern const unsigned short PARSER_ACTION_CHECK[6420];
+extern const unsigned short PARSER_ACTION_CELL[6420];
+
+extern const unsigned short PARSER_GOTO_BASE[381];
+extern const unsigned short PARSER_GOTO_CHECK[1514];
+extern const unsigned short PARSER_GOTO_STATE[1514];
+
+// Célula ACTION de (estado, token - 1): comando nos bits altos, valor nos baixos.
+inline int parserActionCell(int state, int terminal)
+{
+    const int index = PARSER_ACTION_BASE[state] + terminal;
+    return PARSER_ACTION_CHECK[index] == state ? PARSER_ACTION_CELL[index] : PARSER_ERROR_CELL;
+}
+
+inline int parserCommand(int cell) { return cell >> PARSER_CELL_SHIFT; }
+
+inline int parserValue(int cell) { return cell & PARSER_CELL_MASK; }
+
+// Estado de desvio para a coluna (símbolo - 1) de um não terminal ou ação semântica.
+inline int parserGoto(int state, int column)
+{
+    const int index = PARSER_GOTO_BASE[state] + column - PARSER_TERMINALS;
+    return PARSER_GOTO_CHECK[index] == state ? PARSER_GOTO_STATE[index] : 0;
+}
 
 extern const int PRODUCTIONS[174][2];
 
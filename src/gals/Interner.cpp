@@ -0,0 +1,60 @@
+#include "Interner.h"
+
+#include <functional>
+
+std::size_t Interner::slotOf(std::string_view text, std::size_t hash) const
+{
+    const std::size_t mask = slots.size() - 1;
+    for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        const Id id = slots[slot];
+        if (id == NONE || (hashes[id] == hash && names[id] == text))
+            return slot;
+    }
+}
+
+Interner::Id Interner::intern(std::string_view text)
+{
+    // no máximo metade dos slots ocupados
+    if ((names.size() + 1) * 2 > slots.size())
+        grow();
+
+    const std::size_t hash = std::hash<std::string_view>()(text);
+    const std::size_t slot = slotOf(text, hash);
+    if (slots[slot] != NONE)
+        return slots[slot];
+
+    const Id id = static_cast<Id>(names.size());
+    names.emplace_back(text);
+    hashes.push_back(hash);
+    slots[slot] = id;
+    return id;
+}
+
+Interner::Id Interner::find(std::string_view text) const
+{
+    if (slots.empty())
+        return NONE;
+    return slots[slotOf(text, std::hash<std::string_view>()(text))];
+}
+
+void Interner::grow()
+{
+    std::vector<Id> larger(slots.empty() ? 64 : slots.size() * 2, NONE);
+    const std::size_t mask = larger.size() - 1;
+    for (Id id = 0; id < names.size(); ++id)
+    {
+        std::size_t slot = hashes[id] & mask;
+        while (larger[slot] != NONE)
+            slot = (slot + 1) & mask;
+        larger[slot] = id;
+    }
+    slots = std::move(larger);
+}
+
+void Interner::clear()
+{
+    names.clear();
+    hashes.clear();
+    slots.assign(slots.size(), NONE);
+}
@@ -0,0 +1,43 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Nomes de uma compilação guardados uma única vez. Cada texto ganha um id
+// estável; a tabela de símbolos e o BipGenerator comparam e indexam por id,
+// e as visões devolvidas por text() valem até clear().
+class Interner
+{
+public:
+    using Id = std::uint32_t;
+    static constexpr Id NONE = ~Id(0);
+
+    Id intern(std::string_view text);
+
+    // Não cria: NONE se o texto nunca foi internado.
+    Id find(std::string_view text) const;
+
+    std::string_view text(Id id) const { return names[id]; }
+    std::size_t size() const { return names.size(); }
+
+    void clear();
+
+private:
+    // Endereçamento aberto com sondagem linear: slots guarda ids (NONE nos
+    // vazios) e hashes[id] o hash do nome, então uma busca só lê o texto
+    // de um candidato com o mesmo hash. deque: os textos não mudam de lugar
+    // quando ela cresce.
+    std::deque<std::string> names;
+    std::vector<std::size_t> hashes;
+    std::vector<Id> slots;
+
+    std::size_t slotOf(std::string_view text, std::size_t hash) const;
+    void grow();
+};
+
+#endif
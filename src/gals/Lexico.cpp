@@ -1,15 +1,25 @@
 #include "Lexico.h"
+#include "ScannerRuns.h"
+
+#include <algorithm>
+#include <vector>
 
 void Lexico::setInput(const char *input)
 {
-    this->input = input;
+    setInput(SourceBuffer::fromString(input));
+}
+
+void Lexico::setInput(std::shared_ptr<const SourceBuffer> source)
+{
+    this->source = std::move(source);
+    input = this->source->view();
     setPosition(0);
 }
 
-Token *Lexico::nextToken()
+Token Lexico::nextToken()
 {
     if ( ! hasInput() )
-        return 0;
+        return Token();
 
     unsigned start = position;
 
@@ -33,22 +43,39 @@ Token *Lexico::nextToken()
                 endState = state;
                 end = position;
             }
+
+            // trecho em que o DFA não sai do estado: pula de uma vez
+            if (hasInput() && nextState(input[position], state) == state)
+            {
+                const std::size_t run = skipScannerRun(state, input.data() + position, input.data() + input.size());
+                position += static_cast<unsigned>(run);
+                oldState = state;
+                if (tokenForState(state) >= 0)
+                    end = position;
+            }
         }
     }
     if (endState < 0 || (endState != state && tokenForState(oldState) == -2))
         throw LexicalError(SCANNER_ERROR[oldState], start);
 
+    scanEnd = position;
     position = end;
 
     TokenId token = tokenForState(endState);
 
     if (token == 0)
-        return nextToken();
+    {
+        // o token ignorado também conta: o DFA pode ter lido além do seguinte
+        const unsigned ignoredEnd = scanEnd;
+        Token next = nextToken();
+        scanEnd = std::max(scanEnd, ignoredEnd);
+        return next;
+    }
     else
     {
-            std::string lexeme = input.substr(start, end-start);
+            std::string_view lexeme(input.data() + start, end - start);
             token = lookupToken(token, lexeme);
-            return new Token(token, lexeme, start);
+            return Token(token, lexeme, start);
     }
 }
 
@@ -68,24 +95,136 @@ TokenId Lexico::tokenForState(int state) const
     return static_cast<TokenId>(token);
 }
 
-TokenId Lexico::lookupToken(TokenId base, const std::string &key)
+namespace
 {
-    int start = SPECIAL_CASES_INDEXES[base];
-    int end   = SPECIAL_CASES_INDEXES[base+1]-1;
+    // Tabela de casos especiais (palavras reservadas) de um token base.
+    // Os casos vêm do GALS em Constants.cpp; a tabela é montada uma vez,
+    // no primeiro uso, com um hash perfeito sobre (tamanho, primeiro e
+    // último caractere). Cada consulta custa um filtro de tamanho, um hash
+    // e uma única comparação, sem alocar.
+    const unsigned KEYWORD_SLOTS = 64;
+    const unsigned MAX_KEYWORD_SEED = 4096;
+
+    struct KeywordTable
+    {
+        bool perfect = false;
+        unsigned seed = 0;
+        std::size_t minLength = 0;
+        std::size_t maxLength = 0;
+        signed char slot[KEYWORD_SLOTS];
+    };
+
+    inline unsigned keywordHash(std::string_view key, unsigned seed)
+    {
+        const unsigned first = static_cast<unsigned char>(key.front());
+        const unsigned last = static_cast<unsigned char>(key.back());
+        const unsigned mixed = (first * 31u + last * 131u + static_cast<unsigned>(key.size()) * 7u) * (2u * seed + 1u);
+        return (mixed >> 5) & (KEYWORD_SLOTS - 1);
+    }
+
+    bool placeKeywords(KeywordTable &table, int begin, int end, unsigned seed)
+    {
+        for (unsigned i = 0; i < KEYWORD_SLOTS; ++i)
+            table.slot[i] = -1;
+
+        for (int i = begin; i < end; ++i)
+        {
+            signed char &slot = table.slot[keywordHash(SPECIAL_CASES_KEYS[i], seed)];
+            if (slot >= 0)
+                return false;
+            slot = static_cast<signed char>(i - begin);
+        }
+        return true;
+    }
+
+    KeywordTable buildKeywordTable(int base)
+    {
+        KeywordTable table;
+        const int begin = SPECIAL_CASES_INDEXES[base];
+        const int end = SPECIAL_CASES_INDEXES[base+1];
+        const int count = end - begin;
+
+        if (count <= 0 || count > 127 || static_cast<unsigned>(count) > KEYWORD_SLOTS)
+            return table;
+
+        table.minLength = std::string_view(SPECIAL_CASES_KEYS[begin]).size();
+        for (int i = begin; i < end; ++i)
+        {
+            const std::size_t length = std::string_view(SPECIAL_CASES_KEYS[i]).size();
+            if (length == 0)
+                return table;
+            table.minLength = std::min(table.minLength, length);
+            table.maxLength = std::max(table.maxLength, length);
+        }
 
-    while (start <= end)
+        for (unsigned seed = 0; seed < MAX_KEYWORD_SEED; ++seed)
+        {
+            if (placeKeywords(table, begin, end, seed))
+            {
+                table.perfect = true;
+                table.seed = seed;
+                return table;
+            }
+        }
+        return table;
+    }
+
+    const KeywordTable &keywordTable(TokenId base)
     {
-        int half = (start+end)/2;
-        const std::string current = SPECIAL_CASES_KEYS[half];
-
-        if (current == key)
-            return static_cast<TokenId>(SPECIAL_CASES_VALUES[half]);
-        else if (current < key)
-            start = half+1;
-        else  //(current > key)
-            end = half-1;
+        static const std::vector<KeywordTable> tables = []
+        {
+            const int bases = sizeof(SPECIAL_CASES_INDEXES) / sizeof(SPECIAL_CASES_INDEXES[0]) - 1;
+            std::vector<KeywordTable> built;
+            built.reserve(bases);
+            for (int base = 0; base < bases; ++base)
+                built.push_back(buildKeywordTable(base));
+            return built;
+        }();
+        return tables[base];
     }
 
-    return base;
+    TokenId searchSpecialCases(TokenId base, std::string_view key)
+    {
+        int start = SPECIAL_CASES_INDEXES[base];
+        int end   = SPECIAL_CASES_INDEXES[base+1]-1;
+
+        while (start <= end)
+        {
+            int half = (start+end)/2;
+            const std::string_view current = SPECIAL_CASES_KEYS[half];
+
+            if (current == key)
+                return static_cast<TokenId>(SPECIAL_CASES_VALUES[half]);
+            else if (current < key)
+                start = half+1;
+            else  //(current > key)
+                end = half-1;
+        }
+
+        return base;
+    }
 }
 
+TokenId Lexico::lookupToken(TokenId base, std::string_view key)
+{
+    if (SPECIAL_CASES_INDEXES[base] == SPECIAL_CASES_INDEXES[base+1])
+        return base;
+
+    const KeywordTable &table = keywordTable(base);
+    // sem hash perfeito (gramática regerada com muitos casos), volta à busca binária
+    if (!table.perfect)
+        return searchSpecialCases(base, key);
+
+    if (key.size() < table.minLength || key.size() > table.maxLength)
+        return base;
+
+    const int slot = table.slot[keywordHash(key, table.seed)];
+    if (slot < 0)
+        return base;
+
+    const int index = SPECIAL_CASES_INDEXES[base] + slot;
+    if (key != SPECIAL_CASES_KEYS[index])
+        return base;
+
+    return static_cast<TokenId>(SPECIAL_CASES_VALUES[index]);
+}
@@ -3,8 +3,11 @@
 
 #include "Token.h"
 #include "LexicalError.h"
+#include "SourceBuffer.h"
 
+#include <memory>
 #include <string>
+#include <string_view>
 
 class Lexico
 {
@@ -12,16 +15,23 @@ public:
     Lexico(const char *input = "") { setInput(input); }
 
     void setInput(const char *input);
+    void setInput(std::shared_ptr<const SourceBuffer> source);
     void setPosition(unsigned pos) { position = pos; }
-    Token *nextToken();
+    Token nextToken();
+
+    // Até onde o último nextToken() leu a entrada, contando o caractere que
+    // encerrou o token: editar antes disso pode mudar o token.
+    unsigned lastScanEnd() const { return scanEnd; }
 
 private:
     unsigned position;
-    std::string input;
+    unsigned scanEnd = 0;
+    std::shared_ptr<const SourceBuffer> source;
+    std::string_view input;
 
     int nextState(unsigned char c, int state) const;
     TokenId tokenForState(int state) const;
-    TokenId lookupToken(TokenId base, const std::string &key);
+    TokenId lookupToken(TokenId base, std::string_view key);
 
     bool hasInput() const { return position < input.size(); }
     char nextChar() { return hasInput() ? input[position++] : (char) -1; }
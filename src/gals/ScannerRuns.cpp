@@ -0,0 +1,192 @@
+#include "ScannerRuns.h"
+#include "Constants.h"
+
+#include <cstddef>
+
+// -DSCANNER_RUNS_SCALAR força o laço escalar (para comparar com os núcleos
+// vetoriais).
+#if defined(SCANNER_RUNS_SCALAR)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define SCANNER_RUNS_AVX2 1
+#define SCANNER_RUNS_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCANNER_RUNS_SSE2 1
+#define SCANNER_RUNS_SIMD 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SCANNER_RUNS_WASM 1
+#define SCANNER_RUNS_SIMD 1
+#endif
+
+namespace
+{
+    // Acima disso o estado fica com o DFA byte a byte.
+    const int MAX_RUN_RANGES = 8;
+
+    // Bytes testados um a um antes de usar o núcleo vetorial.
+    const std::ptrdiff_t SHORT_RUN = 8;
+
+    // Autotransições de um estado, como intervalos [low, low + width].
+    struct RunClass
+    {
+        int rangeCount = 0;
+        unsigned char low[MAX_RUN_RANGES];
+        unsigned char width[MAX_RUN_RANGES];
+        bool member[256];
+    };
+
+    struct RunTable
+    {
+        RunClass classes[STATES_COUNT];
+        bool loops[STATES_COUNT];
+
+        RunTable()
+        {
+            for (int state = 0; state < STATES_COUNT; ++state)
+            {
+                RunClass &runClass = classes[state];
+                bool overflow = false;
+                int c = 0;
+                while (c < 256)
+                {
+                    runClass.member[c] = SCANNER_TABLE[state][c] == state;
+                    if (!runClass.member[c])
+                    {
+                        ++c;
+                        continue;
+                    }
+                    const int first = c;
+                    while (c < 256 && SCANNER_TABLE[state][c] == state)
+                        runClass.member[c++] = true;
+                    if (runClass.rangeCount == MAX_RUN_RANGES)
+                    {
+                        overflow = true;
+                        continue;
+                    }
+                    runClass.low[runClass.rangeCount] = static_cast<unsigned char>(first);
+                    runClass.width[runClass.rangeCount] = static_cast<unsigned char>(c - 1 - first);
+                    ++runClass.rangeCount;
+                }
+                loops[state] = runClass.rangeCount > 0 && !overflow;
+            }
+        }
+    };
+
+    // SCANNER_TABLE é inicializada estaticamente, então pode ser lida aqui.
+    const RunTable RUN_TABLE;
+
+#ifdef SCANNER_RUNS_SIMD
+    inline unsigned firstZeroBit(unsigned mask)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctz(~mask));
+#else
+        unsigned bit = 0;
+        while (mask & (1u << bit))
+            ++bit;
+        return bit;
+#endif
+    }
+#endif
+
+#if defined(SCANNER_RUNS_AVX2)
+    const std::size_t BLOCK = 32;
+    const unsigned FULL_BLOCK = 0xFFFFFFFFu;
+
+    // Bit i ligado se o byte i pertence à classe: (c - low) <= width sem sinal.
+    inline unsigned blockMask(const RunClass &runClass, const char *at)
+    {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at));
+        __m256i inside = _mm256_setzero_si256();
+        for (int i = 0; i < runClass.rangeCount; ++i)
+        {
+            const __m256i shifted = _mm256_sub_epi8(bytes, _mm256_set1_epi8(static_cast<char>(runClass.low[i])));
+            const __m256i clamped = _mm256_min_epu8(shifted, _mm256_set1_epi8(static_cast<char>(runClass.width[i])));
+            inside = _mm256_or_si256(inside, _mm256_cmpeq_epi8(clamped, shifted));
+        }
+        return static_cast<unsigned>(_mm256_movemask_epi8(inside));
+    }
+#elif defined(SCANNER_RUNS_SSE2)
+    const std::size_t BLOCK = 16;
+    const unsigned FULL_BLOCK = 0xFFFFu;
+
+    inline unsigned blockMask(const RunClass &runClass, const char *at)
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(at));
+        __m128i inside = _mm_setzero_si128();
+        for (int i = 0; i < runClass.rangeCount; ++i)
+        {
+            const __m128i shifted = _mm_sub_epi8(bytes, _mm_set1_epi8(static_cast<char>(runClass.low[i])));
+            const __m128i clamped = _mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(runClass.width[i])));
+            inside = _mm_or_si128(inside, _mm_cmpeq_epi8(clamped, shifted));
+        }
+        return static_cast<unsigned>(_mm_movemask_epi8(inside));
+    }
+#elif defined(SCANNER_RUNS_WASM)
+    const std::size_t BLOCK = 16;
+    const unsigned FULL_BLOCK = 0xFFFFu;
+
+    inline unsigned blockMask(const RunClass &runClass, const char *at)
+    {
+        const v128_t bytes = wasm_v128_load(at);
+        v128_t inside = wasm_i8x16_splat(0);
+        for (int i = 0; i < runClass.rangeCount; ++i)
+        {
+            const v128_t shifted = wasm_i8x16_sub(bytes, wasm_i8x16_splat(static_cast<char>(runClass.low[i])));
+            inside = wasm_v128_or(inside, wasm_u8x16_le(shifted, wasm_u8x16_splat(runClass.width[i])));
+        }
+        return static_cast<unsigned>(wasm_i8x16_bitmask(inside));
+    }
+#endif
+}
+
+std::size_t skipScannerRun(int state, const char *begin, const char *end)
+{
+    if (state < 0 || state >= STATES_COUNT || begin >= end)
+        return 0;
+
+    const RunTable &table = RUN_TABLE;
+    if (!table.loops[state])
+        return 0;
+
+    const RunClass &runClass = table.classes[state];
+    const char *at = begin;
+
+    // a maioria dos trechos é curta (identificadores, indentação): os
+    // primeiros bytes vão no laço escalar e só trechos longos chegam ao
+    // núcleo vetorial
+    const char *shortEnd = end - begin > SHORT_RUN ? begin + SHORT_RUN : end;
+    while (at < shortEnd && runClass.member[static_cast<unsigned char>(*at)])
+        ++at;
+    if (at < shortEnd || at == end)
+        return static_cast<std::size_t>(at - begin);
+
+#ifdef SCANNER_RUNS_SIMD
+    while (static_cast<std::size_t>(end - at) >= BLOCK)
+    {
+        const unsigned mask = blockMask(runClass, at);
+        if (mask != FULL_BLOCK)
+            return static_cast<std::size_t>(at - begin) + firstZeroBit(mask);
+        at += BLOCK;
+    }
+#endif
+
+    while (at < end && runClass.member[static_cast<unsigned char>(*at)])
+        ++at;
+    return static_cast<std::size_t>(at - begin);
+}
+
+const char *scannerRunKernel()
+{
+#if defined(SCANNER_RUNS_AVX2)
+    return "avx2";
+#elif defined(SCANNER_RUNS_SSE2)
+    return "sse2";
+#elif defined(SCANNER_RUNS_WASM)
+    return "wasm-simd128";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef SCANNER_RUNS_H
+#define SCANNER_RUNS_H
+
+#include <cstddef>
+
+// Salto rápido do Lexico sobre trechos em que o DFA fica no mesmo estado:
+// espaços, identificadores, corpo de comentários e conteúdo de strings.
+// As classes de bytes são lidas das autotransições de SCANNER_TABLE, então
+// pular um trecho é equivalente a rodar o DFA byte a byte sobre ele.
+// Os núcleos vetoriais são escolhidos na compilação: AVX2, SSE2, WASM SIMD
+// (-msimd128) ou laço escalar (sempre com -DSCANNER_RUNS_SCALAR).
+
+// Quantos bytes a partir de begin mantêm o DFA em state (0 se nenhum).
+std::size_t skipScannerRun(int state, const char *begin, const char *end);
+
+// Nome do núcleo em uso ("avx2", "sse2", "wasm-simd128" ou "scalar").
+const char *scannerRunKernel();
+
+#endif
@@ -5,24 +5,175 @@
 #include <utility>
 #include <optional>
 #include <limits>
+#include <algorithm>
+#include <iterator>
 
 #include "Semantico.h"
 #include "Constants.h"
 #include "../SemanticTable.cpp"
 #include "BipGenerator.h"
+#include "CompilationContext.h"
 
 using namespace std;
 
 #define SEMANTIC_DEBUG 0
 
-SemanticTable semanticTable;
+namespace
+{
+  enum class ScopeKind
+  {
+    IfBranch,
+    WhileLoop,
+    DoLoop,
+    ForLoop,
+    SwitchRoot,
+    CaseBranch
+  };
+
+  enum class ForHeaderPhase
+  {
+    Init,
+    Condition,
+    Update,
+    Body
+  };
+
+  struct ForHeaderState
+  {
+    ForHeaderPhase phase = ForHeaderPhase::Init;
+    int parenthesisDepth = 0;
+    bool initializerCommitted = false;
+    int headerEndPosition = -1;
+    bool bodyPhaseHandled = false;
+  };
+
+  struct ArrayLiteralState
+  {
+    SemanticTable::Types declaredType = SemanticTable::INT;
+    bool hasDeclaredType = false;
+    SemanticTable::Types elementType = SemanticTable::INT;
+    bool hasElementType = false;
+  };
+
+  enum class OperatorKind
+  {
+    LogicalOr,
+    LogicalAnd,
+    BitwiseOr,
+    BitwiseAnd,
+    BitwiseXor,
+    ShiftLeft,
+    ShiftRight,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Power,
+    RelationalCompare,
+    RelationalEquality
+  };
+
+  enum class UnaryKind
+  {
+    LogicalNot,
+    ArithmeticNeg,
+    BitwiseNot
+  };
+
+  struct PendingOperator
+  {
+    OperatorKind kind = OperatorKind::Add;
+    int position = -1;
+    int length = 1;
+    std::string lexeme;
+  };
+
+  struct PendingUnary
+  {
+    UnaryKind kind = UnaryKind::LogicalNot;
+    int position = -1;
+    int length = 1;
+    std::string lexeme;
+  };
+
+  // Chamada de rotina cujos argumentos ainda estão sendo lidos.
+  struct CallFrame
+  {
+    Interner::Id name = 0;
+    int position = -1;
+    int length = 1;
+    int nesting = -1; // -1 até o "(" da chamada
+    int commas = 0;
+    bool hasArgument = false;
+    bool isStatement = false;
+  };
+
+  struct ExpressionContext
+  {
+    bool hasAccumulated = false;
+    SemanticTable::Types accumulatedType = SemanticTable::INT;
+    std::optional<PendingOperator> pendingOperator;
+    std::vector<PendingUnary> pendingUnary;
+    bool isIndexContext = false;
+  };
+}
+
+// Estado do Semantico para uma compilação; vive no CompilationContext.
+struct SemanticState
+{
+  explicit SemanticState(Interner &names) : table(names) {}
+
+  SemanticTable table;
+  Semantico::Variable currentVariable;
+  vector<Semantico::Variable> currentParameters;
+  bool isTypeParameter = false;
+  vector<ScopeKind> activeScopes;
+  vector<ForHeaderState> forHeaderStates;
+  bool waitingDoWhileCondition = false;
+  vector<ArrayLiteralState> arrayLiteralStates;
+  std::vector<ExpressionContext> expressionStack;
+  // Chamadas abertas, a mais interna no topo: registerToken conta os
+  // argumentos e confere a chamada no ")" dela. pendingReturn é a posição
+  // do return à espera do token seguinte, que diz se ele tem expressão.
+  std::vector<CallFrame> openCalls;
+  int pendingReturn = -1;
+  TokenId lastToken = EPSILON;
+  TokenId tokenBeforeLast = EPSILON;
+  // Início de cada linha do fonte, montado uma vez em setSourceCode;
+  // a conversão de offset vira uma busca binária.
+  std::vector<int> lineStarts{0};
+};
+
+void SemanticStateDeleter::operator()(SemanticState *state) const
+{
+  delete state;
+}
 
-bool Semantico::isTypeParameter = false;
-Semantico::Variable Semantico::currentVariable = {"", Semantico::Type::NULLABLE, {}, {}, {}, -1, false, false, false, false, false, false, false, false, -1, -1, -1};
-vector<Semantico::Variable> Semantico::currentParameters = {};
-std::string Semantico::sourceCode = "";
+std::unique_ptr<SemanticState, SemanticStateDeleter> createSemanticState(Interner &names)
+{
+  return std::unique_ptr<SemanticState, SemanticStateDeleter>(new SemanticState(names));
+}
 
-static SemanticTable::Types inferLiteralType(const std::string &lex)
+namespace
+{
+  // Vazio para Interner::NONE.
+  std::string_view nameText(CompilationContext &compilation, Interner::Id name)
+  {
+    return name == Interner::NONE ? std::string_view() : compilation.names().text(name);
+  }
+
+  // Acrescenta o token ao valor da variável corrente.
+  void appendValue(CompilationContext &compilation, const Token &token)
+  {
+    Semantico::Variable &variable = compilation.semantic().currentVariable;
+    variable.value.push_back(compilation.names().intern(token.getLexeme()));
+    variable.valuePositions.push_back(token.getPosition());
+    variable.valueLengths.push_back(static_cast<int>(token.getLexeme().size()));
+  }
+}
+
+static SemanticTable::Types inferLiteralType(CompilationContext &compilation, const std::string &lex)
 {
   if (lex == "true" || lex == "false")
     return SemanticTable::BOOLEAN;
@@ -33,7 +184,7 @@ static SemanticTable::Types inferLiteralType(const std::string &lex)
     const unsigned char first = static_cast<unsigned char>(lex.front());
     if (std::isalpha(first) || first == '_')
     {
-      return semanticTable.getSymbolType(lex);
+      return compilation.semantic().table.getSymbolType(lex);
     }
   }
   if (lex.empty())
@@ -69,126 +220,15 @@ static SemanticTable::Types inferLiteralType(const std::string &lex)
 
 namespace
 {
+  void finalizarInstrucao(CompilationContext &compilation, Semantico &semantico);
+  ForHeaderState *currentForHeaderState(CompilationContext &compilation);
+  void resetExpressionContexts(CompilationContext &compilation);
 
-  void finalizarInstrucao(Semantico &semantico);
-  std::string trimString(const std::string &text)
-  {
-    std::size_t start = 0;
-    while (start < text.size() && std::isspace(static_cast<unsigned char>(text[start])))
-      ++start;
-    std::size_t end = text.size();
-    while (end > start && std::isspace(static_cast<unsigned char>(text[end - 1])))
-      --end;
-    return text.substr(start, end - start);
-  }
-
-  bool extractCallArgumentAt(const std::string &keyword, std::size_t referencePos, std::string &argument)
-  {
-    const std::string &src = Semantico::sourceCode;
-    if (referencePos >= src.size())
-    {
-      return false;
-    }
-
-    std::size_t openPos = std::string::npos;
-    std::size_t pos = referencePos;
-    while (pos > 0)
-    {
-      char c = src[pos - 1];
-      if (c == '(')
-      {
-        openPos = pos - 1;
-        break;
-      }
-      if (c == ';' || c == '\n')
-      {
-        break;
-      }
-      --pos;
-    }
-    if (openPos == std::string::npos)
-      return false;
-
-    std::size_t keywordEnd = openPos;
-    while (keywordEnd > 0 && std::isspace(static_cast<unsigned char>(src[keywordEnd - 1])))
-      --keywordEnd;
-    std::size_t keywordBegin = keywordEnd;
-    while (keywordBegin > 0 && std::isalpha(static_cast<unsigned char>(src[keywordBegin - 1])))
-      --keywordBegin;
-    if (keywordBegin == keywordEnd)
-      return false;
-    if (src.substr(keywordBegin, keywordEnd - keywordBegin) != keyword)
-      return false;
-
-    int depth = 0;
-    for (std::size_t idx = openPos; idx < src.size(); ++idx)
-    {
-      char c = src[idx];
-      if (c == '(')
-      {
-        ++depth;
-      }
-      else if (c == ')')
-      {
-        --depth;
-        if (depth == 0)
-        {
-          std::size_t closePos = idx;
-          argument = trimString(src.substr(openPos + 1, closePos - openPos - 1));
-          return true;
-        }
-      }
-    }
-    return false;
-  }
-
-  enum class ScopeKind
-  {
-    IfBranch,
-    WhileLoop,
-    DoLoop,
-    ForLoop,
-    SwitchRoot,
-    CaseBranch
-  };
-
-  enum class ForHeaderPhase
-  {
-    Init,
-    Condition,
-    Update,
-    Body
-  };
-
-  struct ForHeaderState
-  {
-    ForHeaderPhase phase = ForHeaderPhase::Init;
-    int parenthesisDepth = 0;
-    bool initializerCommitted = false;
-    int headerEndPosition = -1;
-    bool bodyPhaseHandled = false;
-  };
-
-  static vector<ScopeKind> activeScopes;
-  static vector<ForHeaderState> forHeaderStates;
-  static bool waitingDoWhileCondition = false;
-  struct ArrayLiteralState
-  {
-    SemanticTable::Types declaredType = SemanticTable::INT;
-    bool hasDeclaredType = false;
-    SemanticTable::Types elementType = SemanticTable::INT;
-    bool hasElementType = false;
-  };
-  static vector<ArrayLiteralState> arrayLiteralStates;
-
-  ForHeaderState *currentForHeaderState();
-  void resetExpressionContexts();
-
-  int findForHeaderEndPosition(int forTokenPos)
+  int findForHeaderEndPosition(CompilationContext &compilation, int forTokenPos)
   {
     if (forTokenPos < 0)
       return -1;
-    const std::string &src = Semantico::sourceCode;
+    const std::string_view src = compilation.source();
     const int limit = static_cast<int>(src.size());
     int idx = forTokenPos;
     bool foundOpening = false;
@@ -243,11 +283,11 @@ namespace
     return -1;
   }
 
-  void ensureForBodyPhase(Semantico &semantico, const Token *token)
+  void ensureForBodyPhase(CompilationContext &compilation, Semantico &semantico, const Token *token)
   {
     if (!token)
       return;
-    auto *headerState = currentForHeaderState();
+    auto *headerState = currentForHeaderState(compilation);
     if (!headerState)
       return;
     if (headerState->phase == ForHeaderPhase::Body && headerState->bodyPhaseHandled)
@@ -260,84 +300,32 @@ namespace
     headerState->phase = ForHeaderPhase::Body;
     if (!headerState->bodyPhaseHandled)
     {
-      semanticTable.discardPendingExpression();
-      resetExpressionContexts();
+      compilation.semantic().table.discardPendingExpression();
+      resetExpressionContexts(compilation);
       semantico.resetCurrentVariable();
       headerState->bodyPhaseHandled = true;
     }
   }
 
-  enum class OperatorKind
-  {
-    LogicalOr,
-    LogicalAnd,
-    BitwiseOr,
-    BitwiseAnd,
-    BitwiseXor,
-    ShiftLeft,
-    ShiftRight,
-    Add,
-    Subtract,
-    Multiply,
-    Divide,
-    Modulo,
-    Power,
-    RelationalCompare,
-    RelationalEquality
-  };
-
-  enum class UnaryKind
-  {
-    LogicalNot,
-    ArithmeticNeg,
-    BitwiseNot
-  };
-
-  struct PendingOperator
-  {
-    OperatorKind kind = OperatorKind::Add;
-    int position = -1;
-    int length = 1;
-    std::string lexeme;
-  };
-
-  struct PendingUnary
-  {
-    UnaryKind kind = UnaryKind::LogicalNot;
-    int position = -1;
-    int length = 1;
-    std::string lexeme;
-  };
-
-  struct ExpressionContext
-  {
-    bool hasAccumulated = false;
-    SemanticTable::Types accumulatedType = SemanticTable::INT;
-    std::optional<PendingOperator> pendingOperator;
-    std::vector<PendingUnary> pendingUnary;
-    bool isIndexContext = false;
-  };
-
-  static std::vector<ExpressionContext> expressionStack;
 
-  ExpressionContext &ensureExpressionContext()
+  ExpressionContext &ensureExpressionContext(CompilationContext &compilation)
   {
-    if (expressionStack.empty())
+    if (compilation.semantic().expressionStack.empty())
     {
-      expressionStack.push_back({});
+      compilation.semantic().expressionStack.push_back({});
     }
-    return expressionStack.back();
+    return compilation.semantic().expressionStack.back();
   }
 
-  void resetExpressionContexts()
+  void resetExpressionContexts(CompilationContext &compilation)
   {
-    expressionStack.clear();
+    compilation.semantic().expressionStack.clear();
   }
 
-  void pushExpressionContext(bool isIndex = false)
+  void pushExpressionContext(CompilationContext &compilation, bool isIndex = false)
   {
-    expressionStack.push_back({});
-    expressionStack.back().isIndexContext = isIndex;
+    compilation.semantic().expressionStack.push_back({});
+    compilation.semantic().expressionStack.back().isIndexContext = isIndex;
   }
 
   std::string typeName(SemanticTable::Types type)
@@ -345,6 +333,14 @@ namespace
     return SemanticTable::typeToStr(type);
   }
 
+  // Erros de tipo não interrompem a análise: ficam nos diagnósticos e quem
+  // chama segue com SemanticTable::POISONED no lugar do tipo.
+  SemanticTable::Types reportError(CompilationContext &compilation, const std::string &message, int position = -1, int length = 1)
+  {
+    compilation.semantic().table.addError(message, position, length);
+    return SemanticTable::POISONED;
+  }
+
   bool isNumeric(SemanticTable::Types type)
   {
     return type == SemanticTable::INT || type == SemanticTable::FLOAT;
@@ -358,33 +354,35 @@ namespace
            type == SemanticTable::STRING;
   }
 
-  SemanticTable::Types applyUnaryOperation(const PendingUnary &unary, SemanticTable::Types operandType)
+  SemanticTable::Types applyUnaryOperation(CompilationContext &compilation, const PendingUnary &unary, SemanticTable::Types operandType)
   {
+    if (operandType == SemanticTable::POISONED)
+      return operandType;
     switch (unary.kind)
     {
     case UnaryKind::LogicalNot:
       if (!isBoolConvertible(operandType))
       {
-        throw SemanticError("Operador '" + unary.lexeme + "' requer valor convertível para booleano, encontrado '" + typeName(operandType) + "'", unary.position, unary.length);
+        return reportError(compilation, "Operador '" + unary.lexeme + "' requer valor convertível para booleano, encontrado '" + typeName(operandType) + "'", unary.position, unary.length);
       }
       return SemanticTable::BOOLEAN;
     case UnaryKind::BitwiseNot:
       if (operandType != SemanticTable::INT)
       {
-        throw SemanticError("Operador '" + unary.lexeme + "' requer operando inteiro, encontrado '" + typeName(operandType) + "'", unary.position, unary.length);
+        return reportError(compilation, "Operador '" + unary.lexeme + "' requer operando inteiro, encontrado '" + typeName(operandType) + "'", unary.position, unary.length);
       }
       return SemanticTable::INT;
     case UnaryKind::ArithmeticNeg:
       if (!isNumeric(operandType))
       {
-        throw SemanticError("Operador '" + unary.lexeme + "' requer operando numérico, encontrado '" + typeName(operandType) + "'", unary.position, unary.length);
+        return reportError(compilation, "Operador '" + unary.lexeme + "' requer operando numérico, encontrado '" + typeName(operandType) + "'", unary.position, unary.length);
       }
       return operandType;
     }
     return operandType;
   }
 
-  void applyPendingUnary(ExpressionContext &ctx, SemanticTable::Types &operandType)
+  void applyPendingUnary(CompilationContext &compilation, ExpressionContext &ctx, SemanticTable::Types &operandType)
   {
     if (ctx.pendingUnary.empty())
     {
@@ -392,12 +390,12 @@ namespace
     }
     for (auto it = ctx.pendingUnary.rbegin(); it != ctx.pendingUnary.rend(); ++it)
     {
-      operandType = applyUnaryOperation(*it, operandType);
+      operandType = applyUnaryOperation(compilation, *it, operandType);
     }
     ctx.pendingUnary.clear();
   }
 
-  SemanticTable::Types evalArithmeticOperation(SemanticTable::Operations op, SemanticTable::Types lhs, SemanticTable::Types rhs, const PendingOperator &info)
+  SemanticTable::Types evalArithmeticOperation(CompilationContext &compilation, SemanticTable::Operations op, SemanticTable::Types lhs, SemanticTable::Types rhs, const PendingOperator &info)
   {
     int lhsIdx = static_cast<int>(lhs);
     int rhsIdx = static_cast<int>(rhs);
@@ -405,22 +403,24 @@ namespace
     int result = SemanticTable::resultType(lhsIdx, rhsIdx, opIdx);
     if (result == SemanticTable::ERR)
     {
-      throw SemanticError("Tipos incompatíveis para operador '" + info.lexeme + "': '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", info.position, info.length);
+      return reportError(compilation, "Tipos incompatíveis para operador '" + info.lexeme + "': '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", info.position, info.length);
     }
     return static_cast<SemanticTable::Types>(result);
   }
 
-  SemanticTable::Types evaluateBinaryOperation(const PendingOperator &op, SemanticTable::Types lhs, SemanticTable::Types rhs)
+  SemanticTable::Types evaluateBinaryOperation(CompilationContext &compilation, const PendingOperator &op, SemanticTable::Types lhs, SemanticTable::Types rhs)
   {
+    if (lhs == SemanticTable::POISONED || rhs == SemanticTable::POISONED)
+      return SemanticTable::POISONED;
     switch (op.kind)
     {
     case OperatorKind::LogicalOr:
     case OperatorKind::LogicalAnd:
       if (!isBoolConvertible(lhs) || !isBoolConvertible(rhs))
       {
-        throw SemanticError("Operador '" + op.lexeme + "' requer valores convertíveis para booleano, encontrados '" +
-                                typeName(lhs) + "' e '" + typeName(rhs) + "'",
-                            op.position, op.length);
+        return reportError(compilation, "Operador '" + op.lexeme + "' requer valores convertíveis para booleano, encontrados '" +
+                               typeName(lhs) + "' e '" + typeName(rhs) + "'",
+                           op.position, op.length);
       }
       return SemanticTable::BOOLEAN;
     case OperatorKind::BitwiseOr:
@@ -430,33 +430,33 @@ namespace
     case OperatorKind::ShiftRight:
       if (lhs != SemanticTable::INT || rhs != SemanticTable::INT)
       {
-        throw SemanticError("Operador '" + op.lexeme + "' requer operandos inteiros, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
+        return reportError(compilation, "Operador '" + op.lexeme + "' requer operandos inteiros, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
       }
       return SemanticTable::INT;
     case OperatorKind::Add:
-      return evalArithmeticOperation(SemanticTable::SUM, lhs, rhs, op);
+      return evalArithmeticOperation(compilation, SemanticTable::SUM, lhs, rhs, op);
     case OperatorKind::Subtract:
-      return evalArithmeticOperation(SemanticTable::SUB, lhs, rhs, op);
+      return evalArithmeticOperation(compilation, SemanticTable::SUB, lhs, rhs, op);
     case OperatorKind::Multiply:
-      return evalArithmeticOperation(SemanticTable::MUL, lhs, rhs, op);
+      return evalArithmeticOperation(compilation, SemanticTable::MUL, lhs, rhs, op);
     case OperatorKind::Divide:
-      return evalArithmeticOperation(SemanticTable::DIV, lhs, rhs, op);
+      return evalArithmeticOperation(compilation, SemanticTable::DIV, lhs, rhs, op);
     case OperatorKind::Modulo:
       if (lhs != SemanticTable::INT || rhs != SemanticTable::INT)
       {
-        throw SemanticError("Operador '" + op.lexeme + "' requer operandos inteiros, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
+        return reportError(compilation, "Operador '" + op.lexeme + "' requer operandos inteiros, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
       }
-      return evalArithmeticOperation(SemanticTable::MOD, lhs, rhs, op);
+      return evalArithmeticOperation(compilation, SemanticTable::MOD, lhs, rhs, op);
     case OperatorKind::Power:
       if (!isNumeric(lhs) || !isNumeric(rhs))
       {
-        throw SemanticError("Operador '" + op.lexeme + "' requer operandos numéricos, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
+        return reportError(compilation, "Operador '" + op.lexeme + "' requer operandos numéricos, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
       }
-      return evalArithmeticOperation(SemanticTable::POT, lhs, rhs, op);
+      return evalArithmeticOperation(compilation, SemanticTable::POT, lhs, rhs, op);
     case OperatorKind::RelationalCompare:
       if (!isNumeric(lhs) || !isNumeric(rhs))
       {
-        throw SemanticError("Operador '" + op.lexeme + "' requer operandos numéricos, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
+        return reportError(compilation, "Operador '" + op.lexeme + "' requer operandos numéricos, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
       }
       return SemanticTable::BOOLEAN;
     case OperatorKind::RelationalEquality:
@@ -468,22 +468,22 @@ namespace
       {
         return SemanticTable::BOOLEAN;
       }
-      throw SemanticError("Operador '" + op.lexeme + "' requer operandos comparáveis, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
+      return reportError(compilation, "Operador '" + op.lexeme + "' requer operandos comparáveis, encontrados '" + typeName(lhs) + "' e '" + typeName(rhs) + "'", op.position, op.length);
     }
     return lhs;
   }
 
-  void registerExpressionOperand(SemanticTable::Types operandType, const Token *token)
+  void registerExpressionOperand(CompilationContext &compilation, SemanticTable::Types operandType, const Token *token)
   {
     (void)token;
-    auto &ctx = ensureExpressionContext();
-    applyPendingUnary(ctx, operandType);
+    auto &ctx = ensureExpressionContext(compilation);
+    applyPendingUnary(compilation, ctx, operandType);
     bool updated = false;
     if (ctx.hasAccumulated)
     {
       if (ctx.pendingOperator.has_value())
       {
-        operandType = evaluateBinaryOperation(*ctx.pendingOperator, ctx.accumulatedType, operandType);
+        operandType = evaluateBinaryOperation(compilation, *ctx.pendingOperator, ctx.accumulatedType, operandType);
         ctx.pendingOperator.reset();
         ctx.accumulatedType = operandType;
         updated = true;
@@ -497,33 +497,31 @@ namespace
     }
     if (updated && !ctx.isIndexContext)
     {
-      semanticTable.noteExprType(ctx.accumulatedType);
+      compilation.semantic().table.noteExprType(ctx.accumulatedType);
 #if SEMANTIC_DEBUG
       std::cerr << "    [expr] operand=" << typeName(ctx.accumulatedType) << " accumulated=" << typeName(ctx.accumulatedType) << std::endl;
 #endif
     }
   }
 
-  void registerBinaryOperator(OperatorKind kind, const Token *token)
+  void registerBinaryOperator(CompilationContext &compilation, OperatorKind kind, const Token *token)
   {
-    auto &ctx = ensureExpressionContext();
+    auto &ctx = ensureExpressionContext(compilation);
     PendingOperator op;
     op.kind = kind;
     op.position = token ? token->getPosition() : -1;
     op.length = token ? static_cast<int>(token->getLexeme().size()) : 1;
     op.lexeme = token ? token->getLexeme() : "";
     ctx.pendingOperator = op;
-    if (token && !Semantico::currentVariable.isFunction)
+    if (token && !compilation.semantic().currentVariable.isFunction)
     {
-      Semantico::currentVariable.value.push_back(token->getLexeme());
-      Semantico::currentVariable.valuePositions.push_back(token->getPosition());
-      Semantico::currentVariable.valueLengths.push_back(static_cast<int>(token->getLexeme().size()));
+      appendValue(compilation, *token);
     }
   }
 
-  void registerUnaryOperator(UnaryKind kind, const Token *token)
+  void registerUnaryOperator(CompilationContext &compilation, UnaryKind kind, const Token *token)
   {
-    auto &ctx = ensureExpressionContext();
+    auto &ctx = ensureExpressionContext(compilation);
     PendingUnary unary;
     unary.kind = kind;
     unary.position = token ? token->getPosition() : -1;
@@ -532,36 +530,37 @@ namespace
     ctx.pendingUnary.push_back(unary);
   }
 
-  void finalizeIndexExpression(const Token *token)
+  void finalizeIndexExpression(CompilationContext &compilation, const Token *token)
   {
-    if (expressionStack.empty())
+    if (compilation.semantic().expressionStack.empty())
       return;
-    ExpressionContext finished = expressionStack.back();
+    ExpressionContext finished = compilation.semantic().expressionStack.back();
     if (!finished.isIndexContext)
       return;
-    expressionStack.pop_back();
+    compilation.semantic().expressionStack.pop_back();
     if (finished.pendingOperator.has_value())
     {
       const auto &pending = *finished.pendingOperator;
-      throw SemanticError("Operador '" + pending.lexeme + "' sem operando à direita", pending.position, pending.length);
+      reportError(compilation, "Operador '" + pending.lexeme + "' sem operando à direita", pending.position, pending.length);
+      return;
     }
     if (finished.hasAccumulated)
     {
       SemanticTable::Types indexType = finished.accumulatedType;
-      if (indexType != SemanticTable::INT)
+      if (indexType != SemanticTable::INT && indexType != SemanticTable::POISONED)
       {
         int position = token ? token->getPosition() : -1;
         int length = token ? static_cast<int>(token->getLexeme().size()) : 1;
-        throw SemanticError("Índice de vetor deve ser inteiro, encontrado '" + typeName(indexType) + "'", position, length);
+        reportError(compilation, "Índice de vetor deve ser inteiro, encontrado '" + typeName(indexType) + "'", position, length);
       }
     }
   }
 
-  bool hasOpeningBracketBefore(const Token *token)
+  bool hasOpeningBracketBefore(CompilationContext &compilation, const Token *token)
   {
     if (!token)
       return false;
-    const std::string &src = Semantico::sourceCode;
+    const std::string_view src = compilation.source();
     int pos = token->getPosition();
     if (pos <= 0 || pos > static_cast<int>(src.size()))
       return false;
@@ -581,11 +580,11 @@ namespace
     return true;
   }
 
-  bool closesArrayAfter(const Token *token)
+  bool closesArrayAfter(CompilationContext &compilation, const Token *token)
   {
     if (!token)
       return false;
-    const std::string &src = Semantico::sourceCode;
+    const std::string_view src = compilation.source();
     size_t pos = static_cast<size_t>(token->getPosition()) + token->getLexeme().size();
     while (pos < src.size())
     {
@@ -600,11 +599,11 @@ namespace
     return false;
   }
 
-  bool hasIndexingBracketBefore(const Token *token)
+  bool hasIndexingBracketBefore(CompilationContext &compilation, const Token *token)
   {
     if (!token)
       return false;
-    const std::string &src = Semantico::sourceCode;
+    const std::string_view src = compilation.source();
     int pos = token->getPosition();
     if (pos <= 0 || pos > static_cast<int>(src.size()))
       return false;
@@ -624,11 +623,11 @@ namespace
     return false;
   }
 
-  bool typeHasArraySuffix(const Token *token)
+  bool typeHasArraySuffix(CompilationContext &compilation, const Token *token)
   {
     if (!token)
       return false;
-    const std::string &src = Semantico::sourceCode;
+    const std::string_view src = compilation.source();
     size_t pos = static_cast<size_t>(token->getPosition()) + token->getLexeme().size();
     while (pos < src.size() && std::isspace(static_cast<unsigned char>(src[pos])))
       ++pos;
@@ -642,11 +641,11 @@ namespace
     return true;
   }
 
-  bool hasIndexingAfter(const Token *token)
+  bool hasIndexingAfter(CompilationContext &compilation, const Token *token)
   {
     if (!token)
       return false;
-    const std::string &src = Semantico::sourceCode;
+    const std::string_view src = compilation.source();
     size_t pos = static_cast<size_t>(token->getPosition()) + token->getLexeme().size();
     while (pos < src.size())
     {
@@ -661,126 +660,216 @@ namespace
     return false;
   }
 
-  std::pair<int, int> offsetToLineCol(int pos)
+  void rebuildLineStarts(CompilationContext &compilation)
   {
-    if (pos < 0)
-      return {-1, -1};
-    int line = 1;
-    int column = 1;
-    const std::string &src = Semantico::sourceCode;
-    const int limit = static_cast<int>(src.size());
-    for (int i = 0; i < pos && i < limit; ++i)
+    compilation.semantic().lineStarts.assign(1, 0);
+    const std::string_view src = compilation.source();
+    for (std::size_t i = 0; i < src.size(); ++i)
     {
       if (src[i] == '\n')
-      {
-        ++line;
-        column = 1;
-      }
-      else
-      {
-        ++column;
-      }
+        compilation.semantic().lineStarts.push_back(static_cast<int>(i + 1));
     }
-    return {line, column};
   }
 
-  void resetScopeState()
+  std::pair<int, int> offsetToLineCol(CompilationContext &compilation, int pos)
   {
-    activeScopes.clear();
-    forHeaderStates.clear();
-    waitingDoWhileCondition = false;
-    arrayLiteralStates.clear();
+    if (pos < 0)
+      return {-1, -1};
+    const int offset = std::min(pos, static_cast<int>(compilation.source().size()));
+    auto it = std::upper_bound(compilation.semantic().lineStarts.begin(), compilation.semantic().lineStarts.end(), offset);
+    const int line = static_cast<int>(it - compilation.semantic().lineStarts.begin());
+    return {line, offset - *std::prev(it) + 1};
   }
 
-  void openScope(ScopeKind kind)
+  void resetScopeState(CompilationContext &compilation)
   {
-    semanticTable.enterScope();
-    activeScopes.push_back(kind);
+    compilation.semantic().activeScopes.clear();
+    compilation.semantic().forHeaderStates.clear();
+    compilation.semantic().waitingDoWhileCondition = false;
+    compilation.semantic().arrayLiteralStates.clear();
+    compilation.semantic().openCalls.clear();
+    compilation.semantic().pendingReturn = -1;
+    compilation.semantic().lastToken = EPSILON;
+    compilation.semantic().tokenBeforeLast = EPSILON;
   }
 
-  void closeScope(ScopeKind expected)
+  void openScope(CompilationContext &compilation, ScopeKind kind)
   {
-    if (activeScopes.empty())
+    compilation.semantic().table.enterScope();
+    compilation.semantic().activeScopes.push_back(kind);
+  }
+
+  void closeScope(CompilationContext &compilation, ScopeKind expected)
+  {
+    if (compilation.semantic().activeScopes.empty())
       return;
-    if (activeScopes.back() != expected)
+    if (compilation.semantic().activeScopes.back() != expected)
       return;
-    activeScopes.pop_back();
-    semanticTable.exitScope();
+    compilation.semantic().activeScopes.pop_back();
+    compilation.semantic().table.exitScope();
   }
 
-  ForHeaderState *currentForHeaderState()
+  ForHeaderState *currentForHeaderState(CompilationContext &compilation)
   {
-    if (forHeaderStates.empty())
+    if (compilation.semantic().forHeaderStates.empty())
       return nullptr;
-    return &forHeaderStates.back();
+    return &compilation.semantic().forHeaderStates.back();
+  }
+
+  // Chamada como comando ("f(1);"): começa depois de ";", chave, rótulo de
+  // case ou comentário, fora do cabeçalho de um for. As demais usam o valor.
+  void openCall(CompilationContext &compilation, const Token &token)
+  {
+    SemanticState &state = compilation.semantic();
+    const TokenId before = state.tokenBeforeLast;
+    const ForHeaderState *header = currentForHeaderState(compilation);
+    CallFrame call;
+    call.name = compilation.names().intern(token.getLexeme());
+    call.position = token.getPosition();
+    call.length = static_cast<int>(token.getLexeme().size());
+    call.isStatement = (before == EPSILON || before == t_KEY_SEMICOLON || before == t_KEY_LBRACE || before == t_KEY_RBRACE ||
+                        before == t_KEY_COLON || before == t_KEY_COMMENT_LINE || before == t_KEY_COMMENT_MULT_LINE) &&
+                       (!header || header->phase == ForHeaderPhase::Body);
+    state.openCalls.push_back(call);
+  }
+
+  // O BIP só passa e devolve int: rotinas com outros tipos não podem ser
+  // chamadas, e procedimentos não dão valor.
+  void closeCall(CompilationContext &compilation)
+  {
+    SemanticState &state = compilation.semantic();
+    const CallFrame call = state.openCalls.back();
+    state.openCalls.pop_back();
+    const std::string name(compilation.names().text(call.name));
+    const SemanticTable::SymbolEntry *routine = state.table.findSymbol(name);
+    if (!routine || routine->type == SemanticTable::POISONED)
+      return; // markUseIfDeclared já acusou, ou a declaração tinha erro
+    if (!routine->isFunction)
+    {
+      state.table.addError("A rotina \"" + name + "\" não existe.", call.position, call.length);
+      return;
+    }
+    const int provided = call.hasArgument ? call.commas + 1 : 0;
+    if (provided != routine->paramCount)
+      state.table.addError("A função \"" + name + "\" esperava " + std::to_string(routine->paramCount) + " parâmetros e foram passados " + std::to_string(provided) + " parâmetros.", call.position, call.length);
+    else if (!routine->intParams)
+      state.table.addError("Tipo de parâmetro incompatível na rotina \"" + name + "\".", call.position, call.length);
+    if (call.isStatement)
+      return;
+    if (routine->type == SemanticTable::VOID)
+      state.table.addError("A rotina \"" + name + "\" não retorna valor.", call.position, call.length);
+    else if (routine->type != SemanticTable::INT || routine->returnsArray)
+      state.table.addError("Tipo de retorno incompatível na rotina \"" + name + "\".", call.position, call.length);
+  }
+
+  void checkReturnValue(CompilationContext &compilation, int position)
+  {
+    SemanticState &state = compilation.semantic();
+    const SemanticTable::SymbolEntry *routine = state.table.currentFunction();
+    if (!routine)
+      return;
+    const std::string name(routine->name);
+    if (routine->type == SemanticTable::VOID)
+      state.table.addError("Retorno com valor em procedimento \"" + name + "\".", position, 6);
+    else if (routine->type != SemanticTable::INT || routine->returnsArray)
+      state.table.addError("Tipo de retorno incompatível na função \"" + name + "\".", position, 6);
   }
 
-  void ensureForInitializerCommitted(Semantico &semantico)
+  // Chamado a cada token aceito pelo Sintatico, antes das ações dele.
+  void trackCallToken(CompilationContext &compilation, const Token &token)
   {
-    auto *headerState = currentForHeaderState();
+    SemanticState &state = compilation.semantic();
+    const TokenId id = token.getId();
+    if (state.pendingReturn >= 0)
+    {
+      if (id != t_KEY_SEMICOLON)
+        checkReturnValue(compilation, state.pendingReturn);
+      state.pendingReturn = -1;
+    }
+    if (!state.openCalls.empty())
+    {
+      CallFrame &call = state.openCalls.back();
+      if (call.nesting < 0)
+        call.nesting = 0;
+      else if (id == t_KEY_RPAREN && call.nesting == 0)
+        closeCall(compilation);
+      else
+      {
+        call.hasArgument = true;
+        if (id == t_KEY_LPAREN || id == t_KEY_LBRACKET)
+          ++call.nesting;
+        else if (id == t_KEY_RPAREN || id == t_KEY_RBRACKET)
+          --call.nesting;
+        else if (id == t_KEY_COMMA && call.nesting == 0)
+          ++call.commas;
+      }
+    }
+    state.tokenBeforeLast = state.lastToken;
+    state.lastToken = id;
+  }
+
+  void ensureForInitializerCommitted(CompilationContext &compilation, Semantico &semantico)
+  {
+    auto *headerState = currentForHeaderState(compilation);
     if (!headerState || headerState->phase != ForHeaderPhase::Init || headerState->initializerCommitted)
       return;
 
-    if (Semantico::currentVariable.name.empty())
+    if (compilation.semantic().currentVariable.name == Interner::NONE)
     {
       headerState->initializerCommitted = true;
       headerState->phase = ForHeaderPhase::Condition;
       return;
     }
 
-    finalizarInstrucao(semantico);
+    finalizarInstrucao(compilation, semantico);
     headerState->initializerCommitted = true;
     headerState->phase = ForHeaderPhase::Condition;
   }
 
-  void registrarLiteral(Semantico &semantico, const Token *token)
+  void registrarLiteral(CompilationContext &compilation, Semantico &semantico, const Token *token)
   {
-    if (!token || Semantico::currentVariable.isFunction)
+    if (!token || compilation.semantic().currentVariable.isFunction)
       return;
-    ensureForInitializerCommitted(semantico);
-    const string lexema = token->getLexeme();
-    const bool startsIndex = hasIndexingBracketBefore(token);
+    ensureForInitializerCommitted(compilation, semantico);
+    const string lexema(token->getLexeme());
+    const bool startsIndex = hasIndexingBracketBefore(compilation, token);
     if (startsIndex)
     {
-      pushExpressionContext(true);
+      pushExpressionContext(compilation, true);
     }
     if (lexema == "[")
     {
-      Semantico::currentVariable.value.push_back(lexema);
-      Semantico::currentVariable.valuePositions.push_back(token ? token->getPosition() : -1);
-      Semantico::currentVariable.valueLengths.push_back(token ? static_cast<int>(token->getLexeme().size()) : 1);
+      appendValue(compilation, *token);
       return;
     }
     if (lexema == "]")
     {
-      Semantico::currentVariable.value.push_back(lexema);
-      Semantico::currentVariable.valuePositions.push_back(token ? token->getPosition() : -1);
-      Semantico::currentVariable.valueLengths.push_back(token ? static_cast<int>(token->getLexeme().size()) : 1);
-      finalizeIndexExpression(token);
+      appendValue(compilation, *token);
+      finalizeIndexExpression(compilation, token);
       return;
     }
     if (lexema == ")" || lexema == "(" || lexema == "{" || lexema == "}" || lexema == "++" || lexema == "--")
     {
       return;
     }
-    const bool startsArray = hasOpeningBracketBefore(token);
+    const bool startsArray = hasOpeningBracketBefore(compilation, token);
     if (startsArray)
     {
-      Semantico::currentVariable.literalIsArray = true;
+      compilation.semantic().currentVariable.literalIsArray = true;
       ArrayLiteralState state;
-      if (Semantico::currentVariable.type != Semantico::Type::NULLABLE)
+      if (compilation.semantic().currentVariable.type != Semantico::Type::NULLABLE)
       {
         state.hasDeclaredType = true;
-        state.declaredType = static_cast<SemanticTable::Types>(Semantico::currentVariable.type);
+        state.declaredType = static_cast<SemanticTable::Types>(compilation.semantic().currentVariable.type);
         state.elementType = state.declaredType;
       }
-      else if (!Semantico::currentVariable.name.empty() && semanticTable.hasSymbol(Semantico::currentVariable.name))
+      else if (compilation.semantic().currentVariable.name != Interner::NONE && compilation.semantic().table.hasSymbol(compilation.semantic().currentVariable.name))
       {
         state.hasDeclaredType = true;
-        state.declaredType = semanticTable.getSymbolType(Semantico::currentVariable.name);
+        state.declaredType = compilation.semantic().table.getSymbolType(compilation.semantic().currentVariable.name);
         state.elementType = state.declaredType;
       }
-      arrayLiteralStates.push_back(state);
+      compilation.semantic().arrayLiteralStates.push_back(state);
     }
     if (!lexema.empty())
     {
@@ -788,29 +877,27 @@ namespace
       const bool isIdentifier = std::isalpha(first) || first == '_';
       if (isIdentifier && lexema != "true" && lexema != "false")
       {
-        const bool requiresArray = hasIndexingAfter(token);
-        semanticTable.markUseIfDeclared(lexema, token ? token->getPosition() : -1, token ? static_cast<int>(token->getLexeme().size()) : 1, requiresArray);
+        const bool requiresArray = hasIndexingAfter(compilation, token);
+        compilation.semantic().table.markUseIfDeclared(lexema, token ? token->getPosition() : -1, token ? static_cast<int>(token->getLexeme().size()) : 1, requiresArray);
       }
     }
-    Semantico::currentVariable.value.push_back(lexema);
-    Semantico::currentVariable.valuePositions.push_back(token ? token->getPosition() : -1);
-    Semantico::currentVariable.valueLengths.push_back(token ? static_cast<int>(token->getLexeme().size()) : 1);
-    Semantico::currentVariable.isInitialized = true;
-    const auto literalType = inferLiteralType(lexema);
-    if (!arrayLiteralStates.empty())
+    appendValue(compilation, *token);
+    compilation.semantic().currentVariable.isInitialized = true;
+    const auto literalType = inferLiteralType(compilation, lexema);
+    if (!compilation.semantic().arrayLiteralStates.empty())
     {
-      auto &state = arrayLiteralStates.back();
+      auto &state = compilation.semantic().arrayLiteralStates.back();
       SemanticTable::Types expectedType = state.hasDeclaredType ? state.declaredType : state.elementType;
       if (!state.hasElementType)
       {
         if (state.hasDeclaredType)
         {
           const int compat = SemanticTable::atribType(static_cast<int>(state.declaredType), static_cast<int>(literalType));
-          if (compat != SemanticTable::OK)
+          if (compat != SemanticTable::OK && literalType != SemanticTable::POISONED && state.declaredType != SemanticTable::POISONED)
           {
-            throw SemanticError("Tipos incompatíveis no elemento do vetor: esperado '" +
-                                SemanticTable::typeToStr(state.declaredType) + "', encontrado '" +
-                                SemanticTable::typeToStr(literalType) + "'");
+            reportError(compilation, "Tipos incompatíveis no elemento do vetor: esperado '" +
+                        SemanticTable::typeToStr(state.declaredType) + "', encontrado '" +
+                        SemanticTable::typeToStr(literalType) + "'");
           }
           state.elementType = state.declaredType;
         }
@@ -824,30 +911,30 @@ namespace
       {
         expectedType = state.hasDeclaredType ? state.declaredType : state.elementType;
         const int compat = SemanticTable::atribType(static_cast<int>(expectedType), static_cast<int>(literalType));
-        if (compat != SemanticTable::OK)
+        if (compat != SemanticTable::OK && literalType != SemanticTable::POISONED && expectedType != SemanticTable::POISONED)
         {
-          throw SemanticError("Tipos incompatíveis no elemento do vetor: esperado '" +
-                              SemanticTable::typeToStr(expectedType) + "', encontrado '" +
-                              SemanticTable::typeToStr(literalType) + "'");
+          reportError(compilation, "Tipos incompatíveis no elemento do vetor: esperado '" +
+                      SemanticTable::typeToStr(expectedType) + "', encontrado '" +
+                      SemanticTable::typeToStr(literalType) + "'");
         }
       }
     }
-    registerExpressionOperand(literalType, token);
+    registerExpressionOperand(compilation, literalType, token);
 
-    const bool endsArray = closesArrayAfter(token);
-    if (endsArray && !arrayLiteralStates.empty())
+    const bool endsArray = closesArrayAfter(compilation, token);
+    if (endsArray && !compilation.semantic().arrayLiteralStates.empty())
     {
-      ArrayLiteralState state = arrayLiteralStates.back();
-      arrayLiteralStates.pop_back();
+      ArrayLiteralState state = compilation.semantic().arrayLiteralStates.back();
+      compilation.semantic().arrayLiteralStates.pop_back();
       if (!state.hasElementType)
       {
         if (state.hasDeclaredType)
         {
-          semanticTable.noteExprType(state.declaredType);
+          compilation.semantic().table.noteExprType(state.declaredType);
         }
         else
         {
-          throw SemanticError("Não é possível inferir o tipo de um vetor vazio");
+          compilation.semantic().table.noteExprType(reportError(compilation, "Não é possível inferir o tipo de um vetor vazio"));
         }
       }
       else
@@ -855,116 +942,121 @@ namespace
         SemanticTable::Types elemento = state.hasDeclaredType ? state.declaredType : state.elementType;
         if (!state.hasDeclaredType)
         {
-          Semantico::currentVariable.type = static_cast<Semantico::Type>(elemento);
+          compilation.semantic().currentVariable.type = static_cast<Semantico::Type>(elemento);
         }
-        semanticTable.noteExprType(elemento);
+        compilation.semantic().table.noteExprType(elemento);
       }
-      Semantico::currentVariable.isInitialized = true;
+      compilation.semantic().currentVariable.isInitialized = true;
     }
     if (endsArray)
     {
-      finalizeIndexExpression(token);
+      finalizeIndexExpression(compilation, token);
     }
   }
 
-  void aplicarTipo(Semantico &semantico, const Token *token)
+  void aplicarTipo(CompilationContext &compilation, Semantico &semantico, const Token *token)
   {
     if (!token)
       return;
-    const auto tipo = semantico.getTypeFromString(token->getLexeme());
+    const auto tipo = semantico.getTypeFromString(std::string(token->getLexeme()));
 
-    if (Semantico::isTypeParameter)
+    if (compilation.semantic().isTypeParameter)
     {
-      auto &parametro = Semantico::currentParameters.back();
-      const bool arraySuffix = typeHasArraySuffix(token);
+      auto &parametro = compilation.semantic().currentParameters.back();
+      const bool arraySuffix = typeHasArraySuffix(compilation, token);
       parametro.type = tipo;
       parametro.isUsed = false;
-      Semantico::isTypeParameter = false;
+      compilation.semantic().isTypeParameter = false;
       parametro.isArray = arraySuffix;
       parametro.literalIsArray = false;
       return;
     }
 
-    if (!Semantico::currentVariable.isFunction)
+    if (!compilation.semantic().currentVariable.isFunction)
     {
-      if (!Semantico::currentVariable.hasDeclarationKeyword)
+      if (!compilation.semantic().currentVariable.hasDeclarationKeyword)
       {
-        const std::string alvo = !Semantico::currentVariable.name.empty() ? Semantico::currentVariable.name : token->getLexeme();
+        const std::string alvo(compilation.semantic().currentVariable.name != Interner::NONE ? nameText(compilation, compilation.semantic().currentVariable.name) : token->getLexeme());
         const int position = token ? token->getPosition() : -1;
         const int length = token ? static_cast<int>(token->getLexeme().size()) : 1;
-        throw SemanticError("Declaração de variável requer 'var' ou 'const' antes de '" + alvo + "'", position, length);
+        reportError(compilation, "Declaração de variável requer 'var' ou 'const' antes de '" + alvo + "'", position, length);
       }
     }
 
-    const bool arraySuffix = typeHasArraySuffix(token);
-    Semantico::currentVariable.type = tipo;
-    Semantico::currentVariable.isInitialized = false;
-    Semantico::currentVariable.isArray = arraySuffix;
-    Semantico::currentVariable.literalIsArray = false;
+    const bool arraySuffix = typeHasArraySuffix(compilation, token);
+    compilation.semantic().currentVariable.type = tipo;
+    compilation.semantic().currentVariable.isInitialized = false;
+    compilation.semantic().currentVariable.isArray = arraySuffix;
+    compilation.semantic().currentVariable.literalIsArray = false;
 
-    if (Semantico::currentVariable.isFunction)
+    if (compilation.semantic().currentVariable.isFunction)
     {
       vector<SemanticTable::Param> parametros;
-      parametros.reserve(Semantico::currentParameters.size());
-      for (size_t i = 0; i < Semantico::currentParameters.size(); ++i)
+      parametros.reserve(compilation.semantic().currentParameters.size());
+      for (size_t i = 0; i < compilation.semantic().currentParameters.size(); ++i)
       {
-        const auto &parametro = Semantico::currentParameters[i];
+        const auto &parametro = compilation.semantic().currentParameters[i];
         SemanticTable::Types tipoParametro = SemanticTable::INT;
         if (parametro.type != Semantico::Type::NULLABLE)
         {
           tipoParametro = static_cast<SemanticTable::Types>(parametro.type);
         }
-        SemanticTable::Param info{parametro.name, tipoParametro, parametro.position};
+        SemanticTable::Param info{std::string(nameText(compilation, parametro.name)), tipoParametro, parametro.position};
         info.isArray = parametro.isArray;
         info.line = parametro.line;
         info.column = parametro.column;
         parametros.push_back(info);
       }
       SemanticTable::Types retorno = SemanticTable::INT;
-      if (Semantico::currentVariable.type != Semantico::Type::NULLABLE)
+      if (compilation.semantic().currentVariable.type != Semantico::Type::NULLABLE)
       {
-        retorno = static_cast<SemanticTable::Types>(Semantico::currentVariable.type);
+        retorno = static_cast<SemanticTable::Types>(compilation.semantic().currentVariable.type);
       }
-      semanticTable.beginFunction(Semantico::currentVariable.name, retorno, parametros, Semantico::currentVariable.position, Semantico::currentVariable.line, Semantico::currentVariable.column);
+      compilation.semantic().table.beginFunction(std::string(nameText(compilation, compilation.semantic().currentVariable.name)), retorno, compilation.semantic().currentVariable.isArray, parametros, compilation.semantic().currentVariable.position, compilation.semantic().currentVariable.line, compilation.semantic().currentVariable.column);
       semantico.resetCurrentParameters();
       semantico.resetCurrentVariable();
     }
   }
 
-  void registrarIdentificadorOuParametro(const Token *token)
+  void registrarIdentificadorOuParametro(CompilationContext &compilation, const Token *token)
   {
     if (!token)
       return;
-    const string nome = token->getLexeme();
+    const Interner::Id nome = compilation.names().intern(token->getLexeme());
 
-    if (Semantico::currentVariable.isFunction)
+    if (compilation.semantic().currentVariable.isFunction)
     {
-      const int position = token ? token->getPosition() : -1;
-      const auto [line, column] = offsetToLineCol(position);
-      Semantico::currentParameters.push_back({nome, Semantico::Type::NULLABLE, {}, {}, {}, -1, false, false, true, false, false, false, false, false, position, line, column});
-      Semantico::isTypeParameter = true;
+      Semantico::Variable parametro;
+      parametro.name = nome;
+      parametro.isConstant = true;
+      parametro.position = token->getPosition();
+      const auto [line, column] = offsetToLineCol(compilation, parametro.position);
+      parametro.line = line;
+      parametro.column = column;
+      compilation.semantic().currentParameters.push_back(std::move(parametro));
+      compilation.semantic().isTypeParameter = true;
     }
     else
     {
-      if (Semantico::currentVariable.name.empty())
-      {
-        semanticTable.discardPendingExpression();
-        resetExpressionContexts();
-        Semantico::currentVariable.hasDeclarationKeyword = false;
-      }
-      Semantico::currentVariable.name = nome;
-      Semantico::isTypeParameter = false;
-      Semantico::currentVariable.isArray = semanticTable.isArraySymbol(nome);
-      Semantico::currentVariable.literalIsArray = false;
-      Semantico::currentVariable.type = Semantico::Type::NULLABLE;
-      Semantico::currentVariable.position = token ? token->getPosition() : -1;
-      const auto [line, column] = offsetToLineCol(Semantico::currentVariable.position);
-      Semantico::currentVariable.line = line;
-      Semantico::currentVariable.column = column;
-      if (!Semantico::currentVariable.hasDeclarationKeyword && Semantico::currentVariable.position > 0)
-      {
-        const std::string &src = Semantico::sourceCode;
-        int idx = Semantico::currentVariable.position - 1;
+      if (compilation.semantic().currentVariable.name == Interner::NONE)
+      {
+        compilation.semantic().table.discardPendingExpression();
+        resetExpressionContexts(compilation);
+        compilation.semantic().currentVariable.hasDeclarationKeyword = false;
+      }
+      compilation.semantic().currentVariable.name = nome;
+      compilation.semantic().isTypeParameter = false;
+      compilation.semantic().currentVariable.isArray = compilation.semantic().table.isArraySymbol(nome);
+      compilation.semantic().currentVariable.literalIsArray = false;
+      compilation.semantic().currentVariable.type = Semantico::Type::NULLABLE;
+      compilation.semantic().currentVariable.position = token ? token->getPosition() : -1;
+      const auto [line, column] = offsetToLineCol(compilation, compilation.semantic().currentVariable.position);
+      compilation.semantic().currentVariable.line = line;
+      compilation.semantic().currentVariable.column = column;
+      if (!compilation.semantic().currentVariable.hasDeclarationKeyword && compilation.semantic().currentVariable.position > 0)
+      {
+        const std::string_view src = compilation.source();
+        int idx = compilation.semantic().currentVariable.position - 1;
         while (idx >= 0 && std::isspace(static_cast<unsigned char>(src[idx])))
         {
           --idx;
@@ -976,70 +1068,71 @@ namespace
         }
         if (end >= 0 && end >= idx + 1)
         {
-          const std::string keyword = src.substr(idx + 1, end - idx);
+          const std::string_view keyword = src.substr(idx + 1, end - idx);
           if (keyword == "var")
           {
-            Semantico::currentVariable.hasDeclarationKeyword = true;
-            Semantico::currentVariable.isConstant = false;
+            compilation.semantic().currentVariable.hasDeclarationKeyword = true;
+            compilation.semantic().currentVariable.isConstant = false;
           }
           else if (keyword == "const")
           {
-            Semantico::currentVariable.hasDeclarationKeyword = true;
-            Semantico::currentVariable.isConstant = true;
+            compilation.semantic().currentVariable.hasDeclarationKeyword = true;
+            compilation.semantic().currentVariable.isConstant = true;
           }
         }
       }
     }
   }
 
-  void executarLeitura()
+  void executarLeitura(CompilationContext &compilation)
   {
-    Semantico::currentVariable.value.clear();
-    Semantico::currentVariable.valuePositions.clear();
-    Semantico::currentVariable.valueLengths.clear();
-    Semantico::currentVariable.isInitialized = true;
-    semanticTable.noteExprType(SemanticTable::INT);
+    compilation.semantic().currentVariable.value.clear();
+    compilation.semantic().currentVariable.valuePositions.clear();
+    compilation.semantic().currentVariable.valueLengths.clear();
+    compilation.semantic().currentVariable.isInitialized = true;
+    compilation.semantic().table.noteExprType(SemanticTable::INT);
   }
 
-  void finalizarInstrucao(Semantico &semantico)
+  void finalizarInstrucao(CompilationContext &compilation, Semantico &semantico)
   {
     SemanticTable::SymbolEntry entrada;
-    entrada.name = Semantico::currentVariable.name;
-    const bool possuiTipo = Semantico::currentVariable.type != Semantico::Type::NULLABLE;
-    const bool declaracaoValida = Semantico::currentVariable.hasDeclarationKeyword &&
+    entrada.name = nameText(compilation, compilation.semantic().currentVariable.name);
+    const bool possuiTipo = compilation.semantic().currentVariable.type != Semantico::Type::NULLABLE;
+    const bool declaracaoValida = compilation.semantic().currentVariable.hasDeclarationKeyword &&
                                   possuiTipo &&
-                                  !Semantico::currentVariable.isFunction &&
-                                  !Semantico::currentVariable.isParameter;
-    entrada.type = possuiTipo ? static_cast<SemanticTable::Types>(Semantico::currentVariable.type)
+                                  !compilation.semantic().currentVariable.isFunction &&
+                                  !compilation.semantic().currentVariable.isParameter;
+    entrada.type = possuiTipo ? static_cast<SemanticTable::Types>(compilation.semantic().currentVariable.type)
                               : SemanticTable::INT;
-    entrada.initialized = Semantico::currentVariable.isInitialized;
-    entrada.used = Semantico::currentVariable.isUsed;
+    entrada.initialized = compilation.semantic().currentVariable.isInitialized;
+    entrada.used = compilation.semantic().currentVariable.isUsed;
     entrada.scope = -1;
-    entrada.isParameter = Semantico::currentVariable.isParameter;
-    entrada.position = Semantico::currentVariable.position;
-    entrada.line = Semantico::currentVariable.line;
-    entrada.column = Semantico::currentVariable.column;
-    entrada.isArray = Semantico::currentVariable.isArray;
+    entrada.isParameter = compilation.semantic().currentVariable.isParameter;
+    entrada.position = compilation.semantic().currentVariable.position;
+    entrada.line = compilation.semantic().currentVariable.line;
+    entrada.column = compilation.semantic().currentVariable.column;
+    entrada.isArray = compilation.semantic().currentVariable.isArray;
     entrada.isFunction = false;
-    entrada.isConstant = Semantico::currentVariable.isConstant;
+    entrada.isConstant = compilation.semantic().currentVariable.isConstant;
     entrada.hasExplicitType = possuiTipo;
 
-    if (Semantico::currentVariable.literalIsArray && !Semantico::currentVariable.isArray)
+    if (compilation.semantic().currentVariable.literalIsArray && !compilation.semantic().currentVariable.isArray)
     {
-      throw SemanticError("Variável não declarada como vetor: '" + entrada.name + "'", Semantico::currentVariable.position, static_cast<int>(Semantico::currentVariable.name.size()));
+      // o valor não é checado de novo contra a variável
+      compilation.semantic().table.noteExprType(reportError(compilation, "Variável não declarada como vetor: '" + std::string(entrada.name) + "'", compilation.semantic().currentVariable.position, static_cast<int>(entrada.name.size())));
     }
 
-    semanticTable.commitStatement(entrada);
+    compilation.semantic().table.commitStatement(entrada);
     if (declaracaoValida)
     {
-      BipGenerator::registerDeclaration(Semantico::currentVariable);
+      BipGenerator::registerDeclaration(compilation, compilation.semantic().currentVariable);
     }
-    else if (Semantico::currentVariable.isInitialized || !Semantico::currentVariable.value.empty() || Semantico::currentVariable.isArray)
+    else if (compilation.semantic().currentVariable.isInitialized || !compilation.semantic().currentVariable.value.empty() || compilation.semantic().currentVariable.isArray)
     {
-      auto symbolType = semanticTable.getSymbolType(entrada.name);
+      auto symbolType = compilation.semantic().table.getSymbolType(entrada.name);
       if (symbolType == SemanticTable::INT)
       {
-        BipGenerator::registerAssignment(Semantico::currentVariable);
+        BipGenerator::registerAssignment(compilation, compilation.semantic().currentVariable);
       }
     }
     semantico.resetCurrentVariable();
@@ -1048,30 +1141,34 @@ namespace
 
 void Semantico::resetCurrentVariable()
 {
-  Semantico::currentVariable = {"", Semantico::Type::NULLABLE, {}, {}, {}, -1, false, false, false, false, false, false, false, false, -1, -1, -1};
-  Semantico::isTypeParameter = false;
-  resetExpressionContexts();
+  compilation->semantic().currentVariable = Variable{};
+  compilation->semantic().isTypeParameter = false;
+  resetExpressionContexts(*compilation);
 }
 
 void Semantico::resetCurrentParameters()
 {
-  Semantico::currentParameters.clear();
-  Semantico::isTypeParameter = false;
+  compilation->semantic().currentParameters.clear();
+  compilation->semantic().isTypeParameter = false;
 }
 
-void Semantico::resetState()
+void Semantico::resetState(bool keepNames)
 {
-  semanticTable.reset();
-  BipGenerator::reset();
-  resetScopeState();
+  compilation->semantic().table.reset();
+  if (!keepNames)
+    compilation->names().clear();
+  BipGenerator::reset(*compilation);
+  resetScopeState(*compilation);
   resetCurrentVariable();
   resetCurrentParameters();
-  sourceCode.clear();
+  compilation->setSource(nullptr);
+  rebuildLineStarts(*compilation);
 }
 
-void Semantico::setSourceCode(const std::string &code)
+void Semantico::setSourceCode(std::shared_ptr<const SourceBuffer> source)
 {
-  sourceCode = code;
+  compilation->setSource(std::move(source));
+  rebuildLineStarts(*compilation);
 }
 
 bool Semantico::isConstant(const string &variableName)
@@ -1095,8 +1192,16 @@ Semantico::Type Semantico::getTypeFromString(const string &typeString)
     throw SemanticError("Tipo desconhecido: " + typeString);
 }
 
-void Semantico::executeAction(int action, const Token *token)
+void Semantico::registerToken(const Token &token)
+{
+  BipGenerator::registerToken(*compilation, token);
+  trackCallToken(*compilation, token);
+}
+
+void Semantico::executeAction(int action, const Token &previousToken)
 {
+  // as rotinas auxiliares tratam "nenhum token" como ponteiro nulo
+  const Token *token = previousToken.isValid() ? &previousToken : nullptr;
 #if SEMANTIC_DEBUG
   std::cerr << "[SEM] action=" << action;
   if (token)
@@ -1109,157 +1214,157 @@ void Semantico::executeAction(int action, const Token *token)
   }
   std::cerr << std::endl;
 #endif
-  ensureForBodyPhase(*this, token);
-  if (token && Semantico::currentVariable.name.empty() && !Semantico::currentVariable.isFunction)
+  ensureForBodyPhase(*compilation, *this, token);
+  if (token && compilation->semantic().currentVariable.name == Interner::NONE && !compilation->semantic().currentVariable.isFunction)
   {
-    semanticTable.discardPendingExpression();
-    resetExpressionContexts();
-    Semantico::currentVariable.hasDeclarationKeyword = false;
+    compilation->semantic().table.discardPendingExpression();
+    resetExpressionContexts(*compilation);
+    compilation->semantic().currentVariable.hasDeclarationKeyword = false;
   }
   switch (action)
   {
   case 1:
     // VALUE
-    registrarLiteral(*this, token);
+    registrarLiteral(*compilation, *this, token);
     break;
   case 2:  // OR
-    registerBinaryOperator(OperatorKind::LogicalOr, token);
+    registerBinaryOperator(*compilation, OperatorKind::LogicalOr, token);
     break;
   case 3:  // AND
-    registerBinaryOperator(OperatorKind::LogicalAnd, token);
+    registerBinaryOperator(*compilation, OperatorKind::LogicalAnd, token);
     break;
   case 4:  // BIT OR
-    registerBinaryOperator(OperatorKind::BitwiseOr, token);
+    registerBinaryOperator(*compilation, OperatorKind::BitwiseOr, token);
     break;
   case 5:  // EXPO
-    registerBinaryOperator(OperatorKind::Power, token);
+    registerBinaryOperator(*compilation, OperatorKind::Power, token);
     break;
   case 6:  // BIT AND
-    registerBinaryOperator(OperatorKind::BitwiseAnd, token);
+    registerBinaryOperator(*compilation, OperatorKind::BitwiseAnd, token);
     break;
   case 7:  // OP REL
     if (token)
     {
-      const std::string lex = token->getLexeme();
+      const std::string lex(token->getLexeme());
       if (lex == "=")
       {
-        semanticTable.discardPendingExpression();
-        resetExpressionContexts();
+        compilation->semantic().table.discardPendingExpression();
+        resetExpressionContexts(*compilation);
       }
       else if (lex == "==" || lex == "!=")
       {
-        registerBinaryOperator(OperatorKind::RelationalEquality, token);
+        registerBinaryOperator(*compilation, OperatorKind::RelationalEquality, token);
       }
       else
       {
-        registerBinaryOperator(OperatorKind::RelationalCompare, token);
+        registerBinaryOperator(*compilation, OperatorKind::RelationalCompare, token);
       }
     }
     break;
   case 8:  // OP BITWISE
     if (token)
     {
-      const std::string lex = token->getLexeme();
+      const std::string lex(token->getLexeme());
       if (lex == "^")
       {
-        registerBinaryOperator(OperatorKind::BitwiseXor, token);
+        registerBinaryOperator(*compilation, OperatorKind::BitwiseXor, token);
       }
       else if (lex == "<<")
       {
-        registerBinaryOperator(OperatorKind::ShiftLeft, token);
+        registerBinaryOperator(*compilation, OperatorKind::ShiftLeft, token);
       }
       else if (lex == ">>")
       {
-        registerBinaryOperator(OperatorKind::ShiftRight, token);
+        registerBinaryOperator(*compilation, OperatorKind::ShiftRight, token);
       }
     }
     break;
   case 9:  // ARIT LOWER
     if (token)
     {
-      const std::string lex = token->getLexeme();
+      const std::string lex(token->getLexeme());
       if (lex == "+")
       {
-        registerBinaryOperator(OperatorKind::Add, token);
+        registerBinaryOperator(*compilation, OperatorKind::Add, token);
       }
       else
       {
-        registerBinaryOperator(OperatorKind::Subtract, token);
+        registerBinaryOperator(*compilation, OperatorKind::Subtract, token);
       }
     }
     break;
   case 10: // ARIT UPPER
     if (token)
     {
-      const std::string lex = token->getLexeme();
+      const std::string lex(token->getLexeme());
       if (lex == "*")
       {
-        registerBinaryOperator(OperatorKind::Multiply, token);
+        registerBinaryOperator(*compilation, OperatorKind::Multiply, token);
       }
       else if (lex == "/")
       {
-        registerBinaryOperator(OperatorKind::Divide, token);
+        registerBinaryOperator(*compilation, OperatorKind::Divide, token);
       }
       else if (lex == "%")
       {
-        registerBinaryOperator(OperatorKind::Modulo, token);
+        registerBinaryOperator(*compilation, OperatorKind::Modulo, token);
       }
     }
     break;
   case 11: // NEG
     if (token)
     {
-      const std::string lex = token->getLexeme();
+      const std::string lex(token->getLexeme());
       if (lex == "!")
       {
-        registerUnaryOperator(UnaryKind::LogicalNot, token);
+        registerUnaryOperator(*compilation, UnaryKind::LogicalNot, token);
       }
       else if (lex == "~")
       {
-        registerUnaryOperator(UnaryKind::BitwiseNot, token);
+        registerUnaryOperator(*compilation, UnaryKind::BitwiseNot, token);
       }
       else if (lex == "-")
       {
-        registerUnaryOperator(UnaryKind::ArithmeticNeg, token);
+        registerUnaryOperator(*compilation, UnaryKind::ArithmeticNeg, token);
       }
     }
     break;
   case 12: // LEFT PARENTHESIS
   {
-    auto *headerState = currentForHeaderState();
+    auto *headerState = currentForHeaderState(*compilation);
     if (headerState && headerState->phase != ForHeaderPhase::Body)
     {
       headerState->parenthesisDepth++;
     }
-    pushExpressionContext();
+    pushExpressionContext(*compilation);
     break;
   }
   case 13: // RIGHT PARENTHESIS
   {
-    auto *headerState = currentForHeaderState();
+    auto *headerState = currentForHeaderState(*compilation);
     if (headerState && headerState->phase != ForHeaderPhase::Body && headerState->parenthesisDepth > 0)
     {
       headerState->parenthesisDepth--;
       if (headerState->parenthesisDepth == 0)
       {
         headerState->phase = ForHeaderPhase::Body;
-        semanticTable.discardPendingExpression();
+        compilation->semantic().table.discardPendingExpression();
         resetCurrentVariable();
         break;
       }
     }
-    if (!expressionStack.empty())
+    if (!compilation->semantic().expressionStack.empty())
     {
-      ExpressionContext finished = expressionStack.back();
-      expressionStack.pop_back();
+      ExpressionContext finished = compilation->semantic().expressionStack.back();
+      compilation->semantic().expressionStack.pop_back();
       if (finished.pendingOperator.has_value())
       {
         const auto &pending = *finished.pendingOperator;
-        throw SemanticError("Operador '" + pending.lexeme + "' sem operando à direita", pending.position, pending.length);
+        registerExpressionOperand(*compilation, reportError(*compilation, "Operador '" + pending.lexeme + "' sem operando à direita", pending.position, pending.length), token);
       }
-      if (finished.hasAccumulated)
+      else if (finished.hasAccumulated)
       {
-        registerExpressionOperand(finished.accumulatedType, token);
+        registerExpressionOperand(*compilation, finished.accumulatedType, token);
       }
     }
     break;
@@ -1268,41 +1373,34 @@ void Semantico::executeAction(int action, const Token *token)
     // FUNCTION CALL
     if (token)
     {
-      const std::string lexema = token->getLexeme();
-      semanticTable.markUseIfDeclared(lexema, token->getPosition(), static_cast<int>(token->getLexeme().size()));
-      const auto retorno = semanticTable.getSymbolType(lexema);
-      registerExpressionOperand(retorno, token);
-      Semantico::currentVariable.value.push_back(lexema);
-      Semantico::currentVariable.valuePositions.push_back(token ? token->getPosition() : -1);
-      Semantico::currentVariable.valueLengths.push_back(token ? static_cast<int>(token->getLexeme().size()) : 1);
-      Semantico::currentVariable.isInitialized = true;
+      const Interner::Id nome = compilation->names().intern(token->getLexeme());
+      compilation->semantic().table.markUseIfDeclared(nome, token->getPosition(), static_cast<int>(token->getLexeme().size()));
+      const auto retorno = compilation->semantic().table.getSymbolType(nome);
+      registerExpressionOperand(*compilation, retorno, token);
+      openCall(*compilation, *token);
+      appendValue(*compilation, *token);
+      compilation->semantic().currentVariable.isInitialized = true;
     }
-    Semantico::currentVariable.isUsed = true;
+    compilation->semantic().currentVariable.isUsed = true;
     break;
   case 15:
     // INDEXED VALUE
     if (token)
     {
-      const std::string lexema = token->getLexeme();
-      if (Semantico::currentVariable.name.empty())
+      const Interner::Id nome = compilation->names().intern(token->getLexeme());
+      if (compilation->semantic().currentVariable.name == Interner::NONE)
       {
-        Semantico::currentVariable.name = lexema;
+        compilation->semantic().currentVariable.name = nome;
       }
       {
-        auto *headerState = currentForHeaderState();
-        if (!(headerState && headerState->phase == ForHeaderPhase::Init && Semantico::currentVariable.value.empty()))
+        auto *headerState = currentForHeaderState(*compilation);
+        if (!(headerState && headerState->phase == ForHeaderPhase::Init && compilation->semantic().currentVariable.value.empty()))
         {
-          semanticTable.markUseIfDeclared(lexema, token ? token->getPosition() : -1, token ? static_cast<int>(token->getLexeme().size()) : 1, true);
+          compilation->semantic().table.markUseIfDeclared(nome, token->getPosition(), static_cast<int>(token->getLexeme().size()), true);
         }
       }
-      Semantico::currentVariable.value.push_back(lexema);
-      Semantico::currentVariable.valuePositions.push_back(token ? token->getPosition() : -1);
-      Semantico::currentVariable.valueLengths.push_back(token ? static_cast<int>(token->getLexeme().size()) : 1);
-      if (!lexema.empty())
-      {
-        const auto type = semanticTable.getSymbolType(lexema);
-        registerExpressionOperand(type, token);
-      }
+      appendValue(*compilation, *token);
+      registerExpressionOperand(*compilation, compilation->semantic().table.getSymbolType(nome), token);
     }
     break;
   case 16:
@@ -1311,44 +1409,32 @@ void Semantico::executeAction(int action, const Token *token)
   case 17:
     // PRINT
   {
-    int bestPos = std::numeric_limits<int>::max();
-    for (size_t idx = 0; idx < Semantico::currentVariable.value.size(); ++idx)
+    for (size_t idx = 0; idx < compilation->semantic().currentVariable.value.size(); ++idx)
     {
-      const auto &value = Semantico::currentVariable.value[idx];
-      const int valuePos = idx < Semantico::currentVariable.valuePositions.size() ? Semantico::currentVariable.valuePositions[idx] : -1;
-      const int valueLen = idx < Semantico::currentVariable.valueLengths.size() ? Semantico::currentVariable.valueLengths[idx] : static_cast<int>(value.size());
-      if (valuePos >= 0 && valuePos < bestPos)
-      {
-        bestPos = valuePos;
-      }
+      const std::string_view value = nameText(*compilation, compilation->semantic().currentVariable.value[idx]);
+      const int valuePos = idx < compilation->semantic().currentVariable.valuePositions.size() ? compilation->semantic().currentVariable.valuePositions[idx] : -1;
+      const int valueLen = idx < compilation->semantic().currentVariable.valueLengths.size() ? compilation->semantic().currentVariable.valueLengths[idx] : static_cast<int>(value.size());
       if (!value.empty() && (std::isalpha(static_cast<unsigned char>(value.front())) || value.front() == '_'))
       {
         if (value != "true" && value != "false")
         {
-          semanticTable.markUseIfDeclared(value, valuePos, valueLen);
+          compilation->semantic().table.markUseIfDeclared(value, valuePos, valueLen);
         }
       }
     }
-    if (bestPos != std::numeric_limits<int>::max())
-    {
-      std::string argument;
-      if (extractCallArgumentAt("print", static_cast<std::size_t>(bestPos), argument) && !argument.empty())
-      {
-        BipGenerator::registerPrintStatement(static_cast<std::size_t>(bestPos), argument);
-      }
-    }
-    Semantico::currentVariable.isUsed = true;
-    Semantico::currentVariable.name.clear();
-    Semantico::currentVariable.hasDeclarationKeyword = false;
+    BipGenerator::registerPrintStatement(*compilation);
+    compilation->semantic().currentVariable.isUsed = true;
+    compilation->semantic().currentVariable.name = Interner::NONE;
+    compilation->semantic().currentVariable.hasDeclarationKeyword = false;
     break;
   }
   case 18:
     // READ
-    executarLeitura();
+    executarLeitura(*compilation);
     break;
   case 19:
     // TYPE
-    aplicarTipo(*this, token);
+    aplicarTipo(*compilation, *this, token);
     break;
   case 20:
     // OPEN BRACKET
@@ -1358,38 +1444,38 @@ void Semantico::executeAction(int action, const Token *token)
     break;
   case 22:
     // ATTRIBUTION
-    registrarIdentificadorOuParametro(token);
+    registrarIdentificadorOuParametro(*compilation, token);
     break;
   case 23:
     // FUNCTION DECLARATION
-    Semantico::currentVariable.name = token->getLexeme();
-    Semantico::currentVariable.position = token ? token->getPosition() : -1;
+    compilation->semantic().currentVariable.name = compilation->names().intern(token->getLexeme());
+    compilation->semantic().currentVariable.position = token ? token->getPosition() : -1;
     {
-      const auto [line, column] = offsetToLineCol(Semantico::currentVariable.position);
-      Semantico::currentVariable.line = line;
-      Semantico::currentVariable.column = column;
+      const auto [line, column] = offsetToLineCol(*compilation, compilation->semantic().currentVariable.position);
+      compilation->semantic().currentVariable.line = line;
+      compilation->semantic().currentVariable.column = column;
     }
     break;
   case 24:
     // VALUE INCREMENT/DECREMENT
   {
-    const std::string identifier = token ? token->getLexeme() : "";
+    const std::string_view identifier = token ? token->getLexeme() : std::string_view();
     const int position = token ? token->getPosition() : -1;
     const int length = token ? static_cast<int>(token->getLexeme().size()) : 1;
-    const bool standalone = Semantico::currentVariable.name.empty();
+    const bool standalone = compilation->semantic().currentVariable.name == Interner::NONE;
     if (standalone && !identifier.empty())
     {
-      Semantico::currentVariable.name = identifier;
-      Semantico::currentVariable.position = position;
-      const auto [line, column] = offsetToLineCol(position);
-      Semantico::currentVariable.line = line;
-      Semantico::currentVariable.column = column;
+      compilation->semantic().currentVariable.name = compilation->names().intern(identifier);
+      compilation->semantic().currentVariable.position = position;
+      const auto [line, column] = offsetToLineCol(*compilation, position);
+      compilation->semantic().currentVariable.line = line;
+      compilation->semantic().currentVariable.column = column;
     }
-    semanticTable.markUseIfDeclared(identifier, position, length);
+    compilation->semantic().table.markUseIfDeclared(identifier, position, length);
     if (!identifier.empty())
     {
-      const auto symbolType = semanticTable.getSymbolType(identifier);
-      registerExpressionOperand(symbolType, token);
+      const auto symbolType = compilation->semantic().table.getSymbolType(identifier);
+      registerExpressionOperand(*compilation, symbolType, token);
     }
     break;
   }
@@ -1397,14 +1483,14 @@ void Semantico::executeAction(int action, const Token *token)
     // CONST/VAR
     if (token)
     {
-      const std::string lexema = token->getLexeme();
-      Semantico::currentVariable.isConstant = isConstant(lexema);
-      Semantico::currentVariable.hasDeclarationKeyword = (lexema == "var" || lexema == "const");
+      const std::string lexema(token->getLexeme());
+      compilation->semantic().currentVariable.isConstant = isConstant(lexema);
+      compilation->semantic().currentVariable.hasDeclarationKeyword = (lexema == "var" || lexema == "const");
     }
     else
     {
-      Semantico::currentVariable.isConstant = false;
-      Semantico::currentVariable.hasDeclarationKeyword = false;
+      compilation->semantic().currentVariable.isConstant = false;
+      compilation->semantic().currentVariable.hasDeclarationKeyword = false;
     }
     break;
   case 26:
@@ -1412,25 +1498,27 @@ void Semantico::executeAction(int action, const Token *token)
     break;
   case 27:
     // ATTRIBUTION INCREMENT/DECREMENT
-    Semantico::currentVariable.isInitialized = true;
-    Semantico::currentVariable.isUsed = true;
-    Semantico::currentVariable.hasDeclarationKeyword = false;
+    compilation->semantic().currentVariable.isInitialized = true;
+    compilation->semantic().currentVariable.isUsed = true;
+    compilation->semantic().currentVariable.hasDeclarationKeyword = false;
     break;
   case 28:
     // OPEN BRACKET INDEX
-    pushExpressionContext();
+    pushExpressionContext(*compilation);
     break;
   case 29:
     // CLOSE BRACKET INDEX
-    finalizeIndexExpression(token);
+    finalizeIndexExpression(*compilation, token);
     break;
   case 30:
     // FUNCTION TYPE
-    Semantico::currentVariable.isFunction = true;
+    compilation->semantic().currentVariable.isFunction = true;
     break;
   case 31:
     // RETURN
-    semanticTable.discardPendingExpression();
+    if (token)
+      compilation->semantic().pendingReturn = token->getPosition();
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 32:
@@ -1442,72 +1530,69 @@ void Semantico::executeAction(int action, const Token *token)
   case 34:
     if (token)
     {
-      const std::string lexema = token->getLexeme();
+      const std::string lexema(token->getLexeme());
       if (lexema == "if" || lexema == "elif" || lexema == "else")
       {
-        openScope(ScopeKind::IfBranch);
+        openScope(*compilation, ScopeKind::IfBranch);
       }
     }
     else
     {
-      openScope(ScopeKind::IfBranch);
+      openScope(*compilation, ScopeKind::IfBranch);
     }
     break;
   case 35:
-    openScope(ScopeKind::DoLoop);
-    waitingDoWhileCondition = false;
+    openScope(*compilation, ScopeKind::DoLoop);
+    compilation->semantic().waitingDoWhileCondition = false;
     break;
   case 36:
-    if (waitingDoWhileCondition)
+    if (compilation->semantic().waitingDoWhileCondition)
     {
-      waitingDoWhileCondition = false;
+      compilation->semantic().waitingDoWhileCondition = false;
     }
     else
     {
-      openScope(ScopeKind::WhileLoop);
+      openScope(*compilation, ScopeKind::WhileLoop);
     }
     break;
   case 37:
   {
-    openScope(ScopeKind::ForLoop);
+    openScope(*compilation, ScopeKind::ForLoop);
     ForHeaderState state;
     if (token)
     {
-      state.headerEndPosition = findForHeaderEndPosition(token->getPosition());
+      state.headerEndPosition = findForHeaderEndPosition(*compilation, token->getPosition());
     }
-    forHeaderStates.push_back(state);
+    compilation->semantic().forHeaderStates.push_back(state);
     break;
   }
   case 38:
     if (token)
     {
-      registrarIdentificadorOuParametro(token);
+      registrarIdentificadorOuParametro(*compilation, token);
     }
     break;
   case 39:
     if (token)
     {
-      aplicarTipo(*this, token);
+      aplicarTipo(*compilation, *this, token);
     }
     break;
   case 40:
   {
-    auto *headerState = currentForHeaderState();
+    auto *headerState = currentForHeaderState(*compilation);
     if (headerState && headerState->phase == ForHeaderPhase::Init)
     {
-      if (token && !Semantico::currentVariable.isFunction)
+      if (token && !compilation->semantic().currentVariable.isFunction)
       {
-        const std::string lexema = token->getLexeme();
-        Semantico::currentVariable.value.push_back(lexema);
-        Semantico::currentVariable.valuePositions.push_back(token->getPosition());
-        Semantico::currentVariable.valueLengths.push_back(static_cast<int>(token->getLexeme().size()));
-        Semantico::currentVariable.isInitialized = true;
-        semanticTable.noteExprType(inferLiteralType(lexema));
+        appendValue(*compilation, *token);
+        compilation->semantic().currentVariable.isInitialized = true;
+        compilation->semantic().table.noteExprType(inferLiteralType(*compilation, std::string(token->getLexeme())));
       }
     }
     else if (headerState && headerState->phase == ForHeaderPhase::Update)
     {
-      finalizarInstrucao(*this);
+      finalizarInstrucao(*compilation, *this);
       headerState->phase = ForHeaderPhase::Body;
     }
     break;
@@ -1515,92 +1600,95 @@ void Semantico::executeAction(int action, const Token *token)
   case 41:
     if (token)
     {
-      const std::string lexema = token->getLexeme();
+      const std::string lexema(token->getLexeme());
       if (lexema == "switch")
       {
-        openScope(ScopeKind::SwitchRoot);
+        openScope(*compilation, ScopeKind::SwitchRoot);
       }
       else if (lexema == "case" || lexema == "default")
       {
-        openScope(ScopeKind::CaseBranch);
+        openScope(*compilation, ScopeKind::CaseBranch);
       }
     }
     break;
   case 42:
   {
-    auto *headerState = currentForHeaderState();
+    auto *headerState = currentForHeaderState(*compilation);
     if (headerState && headerState->phase != ForHeaderPhase::Body)
     {
       if (headerState->phase == ForHeaderPhase::Init)
       {
-        finalizarInstrucao(*this);
+        finalizarInstrucao(*compilation, *this);
         headerState->phase = ForHeaderPhase::Condition;
       }
       else if (headerState->phase == ForHeaderPhase::Condition)
       {
-        semanticTable.discardPendingExpression();
+        compilation->semantic().table.discardPendingExpression();
         resetCurrentVariable();
         headerState->phase = ForHeaderPhase::Update;
       }
       else
       {
-        finalizarInstrucao(*this);
+        finalizarInstrucao(*compilation, *this);
       }
       break;
     }
-    finalizarInstrucao(*this);
+    finalizarInstrucao(*compilation, *this);
     break;
   }
   case 43:
     // FUNCTION FINAL
-    semanticTable.maybeCloseFunction();
+    compilation->semantic().table.maybeCloseFunction();
     break;
   case 44:
-    closeScope(ScopeKind::IfBranch);
-    semanticTable.discardPendingExpression();
+    closeScope(*compilation, ScopeKind::IfBranch);
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 45:
-    closeScope(ScopeKind::WhileLoop);
-    semanticTable.discardPendingExpression();
+    closeScope(*compilation, ScopeKind::WhileLoop);
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 46:
-    closeScope(ScopeKind::DoLoop);
-    waitingDoWhileCondition = true;
-    semanticTable.discardPendingExpression();
+    closeScope(*compilation, ScopeKind::DoLoop);
+    compilation->semantic().waitingDoWhileCondition = true;
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 47:
-    waitingDoWhileCondition = false;
-    semanticTable.discardPendingExpression();
+    compilation->semantic().waitingDoWhileCondition = false;
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 48:
-    closeScope(ScopeKind::ForLoop);
-    if (!forHeaderStates.empty())
+    closeScope(*compilation, ScopeKind::ForLoop);
+    if (!compilation->semantic().forHeaderStates.empty())
     {
-      forHeaderStates.pop_back();
+      compilation->semantic().forHeaderStates.pop_back();
     }
-    semanticTable.discardPendingExpression();
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 49:
-    closeScope(ScopeKind::SwitchRoot);
-    semanticTable.discardPendingExpression();
+    closeScope(*compilation, ScopeKind::SwitchRoot);
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 50:
   case 51:
-    closeScope(ScopeKind::CaseBranch);
-    semanticTable.discardPendingExpression();
+    closeScope(*compilation, ScopeKind::CaseBranch);
+    compilation->semantic().table.discardPendingExpression();
     resetCurrentVariable();
     break;
   case 99:
     // FINAL CODE
-    semanticTable.closeAllScopes();
-    semanticTable.printTable(std::cout);
-    semanticTable.printDiagnostics(std::cout);
+    compilation->semantic().table.closeAllScopes();
+    if (std::ostream *report = compilation->reportStream())
+    {
+      compilation->semantic().table.printTable(*report);
+      compilation->semantic().table.printDiagnostics(*report);
+    }
     break;
   default:
     cout << "Ação semântica desconhecida" << endl;
@@ -1610,7 +1698,7 @@ void Semantico::executeAction(int action, const Token *token)
 
 void Semantico::printVariable(const Variable &variable)
 {
-  cout << "Nome da variável: " << variable.name << endl;
+  cout << "Nome da variável: " << nameText(*compilation, variable.name) << endl;
   cout << "Tipo: ";
   switch (variable.type)
   {
@@ -1636,9 +1724,9 @@ void Semantico::printVariable(const Variable &variable)
   cout << endl;
 
   cout << "Valor: ";
-  for (const auto &valor : variable.value)
+  for (const Interner::Id valor : variable.value)
   {
-    cout << valor << " ";
+    cout << nameText(*compilation, valor) << " ";
   }
   cout << endl;
 
@@ -1654,7 +1742,7 @@ void Semantico::printVariable(const Variable &variable)
 std::vector<SymbolInfo> Semantico::symbolTable() const
 {
   std::vector<SymbolInfo> result;
-  const auto &entries = semanticTable.getSymbolTable();
+  const auto &entries = compilation->semantic().table.getSymbolTable();
   result.reserve(entries.size());
 
   for (const auto &entry : entries)
@@ -1670,7 +1758,7 @@ std::vector<SymbolInfo> Semantico::symbolTable() const
     info.column = entry.column;
     if ((info.line < 0 || info.column < 0) && entry.position >= 0)
     {
-      const auto [line, column] = offsetToLineCol(entry.position);
+      const auto [line, column] = offsetToLineCol(*compilation, entry.position);
       info.line = line;
       info.column = column;
     }
@@ -1685,17 +1773,65 @@ std::vector<SymbolInfo> Semantico::symbolTable() const
 
 void Semantico::clearSymbolTable()
 {
-  semanticTable.reset();
-  resetScopeState();
+  compilation->semantic().table.reset();
+  resetScopeState(*compilation);
+  resetCurrentVariable();
+  resetCurrentParameters();
+  compilation->setSource(nullptr);
+  rebuildLineStarts(*compilation);
+}
+
+Semantico::RecoveryPoint Semantico::recoveryPoint() const
+{
+  const SemanticState &state = compilation->semantic();
+  return {state.table.scopeDepth(), state.table.functionDepth(), state.activeScopes.size(),
+          state.forHeaderStates.size(), state.arrayLiteralStates.size(),
+          state.openCalls.size(), BipGenerator::openDelimiterCount(*compilation), state.waitingDoWhileCondition};
+}
+
+void Semantico::recoverTo(const RecoveryPoint &point)
+{
+  SemanticState &state = compilation->semantic();
+  state.table.unwindTo(point.scopes, point.functions);
+  if (state.activeScopes.size() > point.activeScopes)
+    state.activeScopes.resize(point.activeScopes);
+  if (state.forHeaderStates.size() > point.forHeaders)
+    state.forHeaderStates.resize(point.forHeaders);
+  if (state.arrayLiteralStates.size() > point.arrayLiterals)
+    state.arrayLiteralStates.resize(point.arrayLiterals);
+  if (state.openCalls.size() > point.calls)
+    state.openCalls.resize(point.calls);
+  state.pendingReturn = -1;
+  state.waitingDoWhileCondition = point.waitingDoWhileCondition;
+  // O comando descartado declarava um nome já lido: ele entra na tabela
+  // mesmo assim, e os usos seguintes não viram "não declarado".
+  const Semantico::Variable &broken = state.currentVariable;
+  if (broken.name != Interner::NONE && (broken.hasDeclarationKeyword || broken.isFunction))
+    state.table.declarePoisoned(nameText(*compilation, broken.name), broken.position, broken.line, broken.column, broken.isFunction, broken.isArray);
+  BipGenerator::abandonDelimiters(*compilation, point.delimiters);
   resetCurrentVariable();
   resetCurrentParameters();
-  sourceCode.clear();
 }
 
-vector<ExportedSymbol> snapshotSymbolTable()
+void Semantico::reportSyntaxError(const SyntacticError &error)
+{
+  compilation->semantic().table.addSyntaxError(error.getMessage(), error.getPosition(), error.getLength());
+}
+
+void Semantico::throwFirstError() const
+{
+  const SemanticTable::DiagnosticEntry *first = compilation->semantic().table.firstError();
+  if (!first)
+    return;
+  if (first->syntactic)
+    throw SyntacticError(first->message, first->position, first->length);
+  throw SemanticError(first->message, first->position, first->length);
+}
+
+vector<ExportedSymbol> snapshotSymbolTable(CompilationContext &compilation)
 {
   vector<ExportedSymbol> exported;
-  const auto &symbols = semanticTable.getSymbolTable();
+  const auto &symbols = compilation.semantic().table.getSymbolTable();
   exported.reserve(symbols.size());
 
   for (const auto &entry : symbols)
@@ -1712,7 +1848,7 @@ vector<ExportedSymbol> snapshotSymbolTable()
     symbol.column = entry.column;
     if (symbol.position >= 0 && (entry.line < 0 || entry.column < 0))
     {
-      const auto [line, column] = offsetToLineCol(symbol.position);
+      const auto [line, column] = offsetToLineCol(compilation, symbol.position);
       symbol.line = line;
       symbol.column = column;
     }
@@ -1725,28 +1861,190 @@ vector<ExportedSymbol> snapshotSymbolTable()
   return exported;
 }
 
-vector<ExportedDiagnostic> snapshotDiagnostics()
+vector<ExportedDiagnostic> snapshotDiagnostics(CompilationContext &compilation)
 {
   vector<ExportedDiagnostic> exported;
-  const auto &items = semanticTable.getDiagnostics();
+  const auto &items = compilation.semantic().table.getDiagnostics();
   exported.reserve(items.size());
 
   for (const auto &diag : items)
   {
-    exported.push_back({diag.severity, diag.message, diag.position, diag.length});
+    const auto [line, column] = offsetToLineCol(compilation, diag.position);
+    const auto [endLine, endColumn] = offsetToLineCol(compilation, diag.position < 0 ? -1 : diag.position + std::max(1, diag.length));
+    exported.push_back({diag.severity, diag.message, diag.position, diag.length, line, column, endLine, endColumn});
   }
 
   return exported;
 }
 
-std::string snapshotBipCode()
+std::pair<int, int> sourceLineColumn(CompilationContext &compilation, int position)
+{
+  return offsetToLineCol(compilation, position);
+}
+
+std::string snapshotBipCode(CompilationContext &compilation)
+{
+  return BipGenerator::lastCode(compilation);
+}
+
+void closeSemanticScopes(CompilationContext &compilation)
+{
+  compilation.semantic().table.closeAllScopes();
+}
+
+void finalizeSemanticAnalysis(CompilationContext &compilation, bool writeOutputFile)
+{
+  closeSemanticScopes(compilation);
+  const std::string bipCode = BipGenerator::render(compilation);
+  if (writeOutputFile)
+    BipGenerator::writeToFile(bipCode);
+}
+
+namespace
+{
+  void shiftVariable(const SourceShift &shift, Semantico::Variable &variable)
+  {
+    shift.apply(variable.position, variable.line, variable.column);
+    for (int &position : variable.valuePositions)
+      position = shift.apply(position);
+  }
+
+  bool sameVariable(const Semantico::Variable &current, const Semantico::Variable &saved, const SourceShift &shift)
+  {
+    if (current.position != shift.apply(saved.position) || current.valuePositions.size() != saved.valuePositions.size())
+      return false;
+    for (std::size_t i = 0; i < current.valuePositions.size(); ++i)
+    {
+      if (current.valuePositions[i] != shift.apply(saved.valuePositions[i]))
+        return false;
+    }
+    return current.name == saved.name && current.type == saved.type && current.value == saved.value &&
+           current.valueLengths == saved.valueLengths && current.scope == saved.scope &&
+           current.isInitialized == saved.isInitialized && current.isUsed == saved.isUsed &&
+           current.isConstant == saved.isConstant && current.hasDeclarationKeyword == saved.hasDeclarationKeyword &&
+           current.isParameter == saved.isParameter && current.isFunction == saved.isFunction &&
+           current.isArray == saved.isArray && current.literalIsArray == saved.literalIsArray;
+  }
+
+  template <class Pending>
+  bool samePending(const Pending &current, const Pending &saved, const SourceShift &shift)
+  {
+    return current.kind == saved.kind && current.position == shift.apply(saved.position) &&
+           current.length == saved.length && current.lexeme == saved.lexeme;
+  }
+
+  bool sameExpression(const ExpressionContext &current, const ExpressionContext &saved, const SourceShift &shift)
+  {
+    if (current.hasAccumulated != saved.hasAccumulated || current.accumulatedType != saved.accumulatedType ||
+        current.isIndexContext != saved.isIndexContext || current.pendingOperator.has_value() != saved.pendingOperator.has_value() ||
+        current.pendingUnary.size() != saved.pendingUnary.size())
+      return false;
+    if (current.pendingOperator && !samePending(*current.pendingOperator, *saved.pendingOperator, shift))
+      return false;
+    for (std::size_t i = 0; i < current.pendingUnary.size(); ++i)
+    {
+      if (!samePending(current.pendingUnary[i], saved.pendingUnary[i], shift))
+        return false;
+    }
+    return true;
+  }
+
+  bool sameForHeader(const ForHeaderState &current, const ForHeaderState &saved, const SourceShift &shift)
+  {
+    return current.phase == saved.phase && current.parenthesisDepth == saved.parenthesisDepth &&
+           current.initializerCommitted == saved.initializerCommitted &&
+           current.headerEndPosition == shift.apply(saved.headerEndPosition) &&
+           current.bodyPhaseHandled == saved.bodyPhaseHandled;
+  }
+
+  bool sameCall(const CallFrame &current, const CallFrame &saved, const SourceShift &shift)
+  {
+    return current.name == saved.name && current.position == shift.apply(saved.position) && current.length == saved.length &&
+           current.nesting == saved.nesting && current.commas == saved.commas && current.hasArgument == saved.hasArgument &&
+           current.isStatement == saved.isStatement;
+  }
+
+  bool sameArrayLiteral(const ArrayLiteralState &current, const ArrayLiteralState &saved)
+  {
+    return current.declaredType == saved.declaredType && current.hasDeclaredType == saved.hasDeclaredType &&
+           current.elementType == saved.elementType && current.hasElementType == saved.hasElementType;
+  }
+
+  template <class T, class Same>
+  bool sameVector(const std::vector<T> &current, const std::vector<T> &saved, Same same)
+  {
+    if (current.size() != saved.size())
+      return false;
+    for (std::size_t i = 0; i < current.size(); ++i)
+    {
+      if (!same(current[i], saved[i]))
+        return false;
+    }
+    return true;
+  }
+}
+
+std::unique_ptr<SemanticState, SemanticStateDeleter> saveSemanticState(CompilationContext &compilation)
 {
-  return BipGenerator::lastCode();
+  SemanticState &state = compilation.semantic();
+  std::vector<int> lineStarts = std::move(state.lineStarts);
+  std::unique_ptr<SemanticState, SemanticStateDeleter> saved(new SemanticState(state));
+  state.lineStarts = std::move(lineStarts);
+  return saved;
+}
+
+void restoreSemanticState(CompilationContext &compilation, const SemanticState &saved)
+{
+  SemanticState &state = compilation.semantic();
+  std::vector<int> lineStarts = std::move(state.lineStarts);
+  state = saved;
+  state.lineStarts = std::move(lineStarts);
+}
+
+bool semanticStateMatches(CompilationContext &compilation, const SemanticState &saved, const SourceShift &shift)
+{
+  const SemanticState &state = compilation.semantic();
+  const auto position = [&shift](int value) { return shift.apply(value); };
+  const auto variable = [&shift](const Semantico::Variable &a, const Semantico::Variable &b) { return sameVariable(a, b, shift); };
+  const auto expression = [&shift](const ExpressionContext &a, const ExpressionContext &b) { return sameExpression(a, b, shift); };
+  const auto forHeader = [&shift](const ForHeaderState &a, const ForHeaderState &b) { return sameForHeader(a, b, shift); };
+  const auto call = [&shift](const CallFrame &a, const CallFrame &b) { return sameCall(a, b, shift); };
+  return state.isTypeParameter == saved.isTypeParameter && state.waitingDoWhileCondition == saved.waitingDoWhileCondition &&
+         state.activeScopes == saved.activeScopes && sameVariable(state.currentVariable, saved.currentVariable, shift) &&
+         sameVector(state.currentParameters, saved.currentParameters, variable) &&
+         sameVector(state.forHeaderStates, saved.forHeaderStates, forHeader) &&
+         sameVector(state.arrayLiteralStates, saved.arrayLiteralStates, sameArrayLiteral) &&
+         sameVector(state.expressionStack, saved.expressionStack, expression) &&
+         sameVector(state.openCalls, saved.openCalls, call) && state.pendingReturn == shift.apply(saved.pendingReturn) &&
+         state.lastToken == saved.lastToken && state.tokenBeforeLast == saved.tokenBeforeLast &&
+         state.table.sameState(saved.table, position);
+}
+
+void shiftSemanticState(SemanticState &saved, const SourceShift &shift)
+{
+  saved.table.shiftPositions([&shift](int &position, int &line, int &column) { shift.apply(position, line, column); });
+  shiftVariable(shift, saved.currentVariable);
+  for (auto &parameter : saved.currentParameters)
+    shiftVariable(shift, parameter);
+  for (auto &header : saved.forHeaderStates)
+    header.headerEndPosition = shift.apply(header.headerEndPosition);
+  for (auto &call : saved.openCalls)
+    call.position = shift.apply(call.position);
+  saved.pendingReturn = shift.apply(saved.pendingReturn);
+  for (auto &expression : saved.expressionStack)
+  {
+    if (expression.pendingOperator)
+      expression.pendingOperator->position = shift.apply(expression.pendingOperator->position);
+    for (auto &unary : expression.pendingUnary)
+      unary.position = shift.apply(unary.position);
+  }
 }
 
-void finalizeSemanticAnalysis()
+void spliceSemanticState(CompilationContext &compilation, const SemanticState &converged, SemanticState &&finalState, const SourceShift &shift)
 {
-  semanticTable.closeAllScopes();
-  const std::string bipCode = BipGenerator::render();
-  BipGenerator::writeToFile(bipCode);
+  SemanticState &state = compilation.semantic();
+  shiftSemanticState(finalState, shift);
+  finalState.table.replaceDiagnostics(converged.table.diagnosticCount(), state.table);
+  finalState.lineStarts = std::move(state.lineStarts);
+  state = std::move(finalState);
 }
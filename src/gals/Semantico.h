@@ -1,17 +1,22 @@
 #ifndef SEMANTICO_H
 #define SEMANTICO_H
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "Token.h"
 #include "SemanticError.h"
+#include "SyntacticError.h"
 #include "SymbolInfo.h"
+#include "SourceBuffer.h"
+#include "CompilationContext.h"
 
 using namespace std;
 
-class SemanticTable;
-
 struct ExportedSymbol {
   std::string name;
   std::string type;
@@ -32,6 +37,10 @@ struct ExportedDiagnostic {
   std::string message;
   int position;
   int length;
+  int line;
+  int column;
+  int endLine;
+  int endColumn;
 };
 
 class Semantico
@@ -46,49 +55,125 @@ public:
     BOOLEAN,
     VOID
   };
+  // Nomes e valores são ids do Interner da compilação (name é NONE sem
+  // variável corrente); o texto só é lido para mensagens e para o código.
   struct Variable
   {
-    string name;
-    Type type;
-    vector<string> value;
+    Interner::Id name = Interner::NONE;
+    Type type = NULLABLE;
+    vector<Interner::Id> value;
     vector<int> valuePositions;
     vector<int> valueLengths;
-    int scope;
-    bool isInitialized;
-    bool isUsed;
-    bool isConstant;
-    bool hasDeclarationKeyword;
-    bool isParameter;
-    bool isFunction;
-    bool isArray;
-    bool literalIsArray;
-    int position;
-    int line;
-    int column;
+    int scope = -1;
+    bool isInitialized = false;
+    bool isUsed = false;
+    bool isConstant = false;
+    bool hasDeclarationKeyword = false;
+    bool isParameter = false;
+    bool isFunction = false;
+    bool isArray = false;
+    bool literalIsArray = false;
+    int position = -1;
+    int line = -1;
+    int column = -1;
+  };
+
+  // Tamanho das pilhas do estado em um início de comando. recoverTo
+  // descarta o que foi aberto depois dele (recuperação de erro do Sintatico).
+  struct RecoveryPoint
+  {
+    std::size_t scopes;
+    std::size_t functions;
+    std::size_t activeScopes;
+    std::size_t forHeaders;
+    std::size_t arrayLiterals;
+    std::size_t calls;
+    std::size_t delimiters;
+    bool waitingDoWhileCondition;
   };
 
-  static bool isTypeParameter;
-  static Variable currentVariable;
-  static vector<Variable> currentParameters;
-  static std::string sourceCode;
+  // O estado da análise (variável corrente, tabela de símbolos, pilhas)
+  // fica em compilation; o Semantico em si não guarda nada.
+  explicit Semantico(CompilationContext &compilation) : compilation(&compilation) {}
+
+  CompilationContext &compilationContext() const { return *compilation; }
 
   void resetCurrentVariable();
   void resetCurrentParameters();
-  void resetState();
+  // keepNames mantém os nomes internados: a CompilationSession guarda
+  // estados salvos que apontam para eles.
+  void resetState(bool keepNames = false);
   void printVariable(const Variable &variable);
-  void executeAction(int action, const Token *token);
+  void registerToken(const Token &token);
+  void executeAction(int action, const Token &previousToken);
   bool isConstant(const string &variableName);
   Type getTypeFromString(const string &typeString);
-  void setSourceCode(const std::string &code);
+  void setSourceCode(std::shared_ptr<const SourceBuffer> source);
   std::vector<SymbolInfo> symbolTable() const;
   void clearSymbolTable();
+
+  RecoveryPoint recoveryPoint() const;
+  void recoverTo(const RecoveryPoint &point);
+  // Registra o erro como diagnóstico, sem interromper a análise.
+  void reportSyntaxError(const SyntacticError &error);
+  // Os erros ficam nos diagnósticos durante a análise; no fim, o primeiro
+  // (de sintaxe antes dos semânticos) é lançado uma única vez.
+  void throwFirstError() const;
+
+private:
+  CompilationContext *compilation;
 };
 
-extern SemanticTable semanticTable;
+std::vector<ExportedSymbol> snapshotSymbolTable(CompilationContext &compilation);
+std::vector<ExportedDiagnostic> snapshotDiagnostics(CompilationContext &compilation);
+std::string snapshotBipCode(CompilationContext &compilation);
+std::pair<int, int> sourceLineColumn(CompilationContext &compilation, int position);
+// Fecha os escopos ainda abertos, o que completa os avisos da tabela de
+// símbolos. finalizeSemanticAnalysis faz isso antes de gerar o código.
+void closeSemanticScopes(CompilationContext &compilation);
+// writeOutputFile grava output.bip no diretório atual (modo de um arquivo).
+void finalizeSemanticAnalysis(CompilationContext &compilation, bool writeOutputFile = true);
+
+// Uma edição do fonte vista pelas posições já registradas: as que ficavam
+// em from ou depois, no texto antigo, andam delta. Linha e coluna andam sem
+// consultar o texto: lines linhas a mais, e columns colunas a mais para quem
+// estava na linha de from.
+struct SourceShift
+{
+  int from;
+  int delta;
+  int line = -1;
+  int lines = 0;
+  int columns = 0;
+
+  int apply(int position) const { return position >= from ? position + delta : position; }
+
+  void apply(int &position, int &positionLine, int &positionColumn) const
+  {
+    if (position < from)
+      return;
+    position += delta;
+    if (positionLine < 0)
+      return;
+    if (positionLine == line)
+      positionColumn += columns;
+    positionLine += lines;
+  }
+};
 
-std::vector<ExportedSymbol> snapshotSymbolTable();
-std::vector<ExportedDiagnostic> snapshotDiagnostics();
-std::string snapshotBipCode();
-void finalizeSemanticAnalysis();
+// Cópia do estado do Semantico em um ponto da análise, para retomá-la dali
+// (CompilationSession). O índice de linhas fica de fora: ele segue o fonte
+// atual do contexto, não o ponto salvo.
+std::unique_ptr<SemanticState, SemanticStateDeleter> saveSemanticState(CompilationContext &compilation);
+void restoreSemanticState(CompilationContext &compilation, const SemanticState &saved);
+// O estado atual é o mesmo que saved, salvo antes de shift? Então o resto
+// da análise também seria igual ao da análise antiga.
+bool semanticStateMatches(CompilationContext &compilation, const SemanticState &saved, const SourceShift &shift);
+// Leva as posições (e linhas e colunas) de saved para o fonte atual.
+void shiftSemanticState(SemanticState &saved, const SourceShift &shift);
+// Adota finalState, o fim da análise antiga, a partir do ponto converged em
+// que semanticStateMatches valeu: os diagnósticos emitidos até aqui ficam no
+// lugar dos que a análise antiga emitiu antes de converged.
+void spliceSemanticState(CompilationContext &compilation, const SemanticState &converged, SemanticState &&finalState, const SourceShift &shift);
 
 #endif
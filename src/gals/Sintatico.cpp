@@ -1,79 +1,295 @@
 #include "Sintatico.h"
 
+#include <array>
+
+namespace
+{
+    // <command> em lexical/main.gals (símbolo 128, coluna 127 no desvio)
+    const int COMMAND_SYMBOL = 128;
+
+    // Estados em que começa um <command>: os que aceitam "if", que só
+    // aparece nesse lugar. A recuperação de erros retoma a análise neles.
+    const std::array<bool, PARSER_STATES> COMMAND_STATES = [] {
+        std::array<bool, PARSER_STATES> states{};
+        for (int state = 0; state < PARSER_STATES; ++state)
+            states[state] = parserCommand(parserActionCell(state, t_KEY_IF - 1)) != ERROR;
+        return states;
+    }();
+
+    // Tokens em que a análise pode recomeçar depois de um erro (além de
+    // qualquer token logo depois de um ';').
+    bool synchronizes(int token)
+    {
+        switch (token)
+        {
+            case DOLLAR:
+            case t_KEY_RBRACE:
+            case t_KEY_PRINT:
+            case t_KEY_READ:
+            case t_KEY_IF:
+            case t_KEY_DO:
+            case t_KEY_WHILE:
+            case t_KEY_FOR:
+            case t_KEY_RETURN:
+            case t_KEY_FUNCTION:
+            case t_KEY_CONST:
+            case t_KEY_VAR:
+            case t_KEY_SWITCH:
+            case t_KEY_BREAK:
+            case t_KEY_THROW:
+            case t_KEY_COMMENT_MULT_LINE:
+            case t_KEY_COMMENT_LINE:
+                return true;
+            default:
+                return false;
+        }
+    }
+}
+
 void Sintatico::parse(Lexico *scanner, Semantico *semanticAnalyser)
 {
     this->scanner = scanner;
     this->semanticAnalyser = semanticAnalyser;
+    tokens = nullptr;
+    observer = nullptr;
+    stopped = false;
+    suppressErrors = false;
 
     //Limpa a pilha
-    while (! stack.empty())
-        stack.pop();
+    stack.clear();
+    recoveryPoints.clear();
 
-    stack.push(0);
+    push(0);
 
-    if (previousToken != 0 && previousToken != currentToken)
-        delete previousToken;
-    previousToken = 0;
+    previousToken = Token();
+    currentToken = nextToken();
 
-    if (currentToken != 0)
-        delete currentToken;
-    currentToken = scanner->nextToken();
+    try
+    {
+        while ( ! step() )
+            ;
+    }
+    catch (const AnalysisError &)
+    {
+        // um erro já registrado vem primeiro: o que interrompeu a análise
+        // pode ser só consequência dele
+        semanticAnalyser->throwFirstError();
+        throw;
+    }
+    semanticAnalyser->throwFirstError();
+}
 
-    while ( ! step() )
-        ;
+bool Sintatico::parse(const std::vector<Token> &tokens, std::size_t first, const State &state,
+                      Semantico *semanticAnalyser, const TokenObserver &observer)
+{
+    this->scanner = nullptr;
+    this->semanticAnalyser = semanticAnalyser;
+    this->tokens = &tokens;
+    this->tokenIndex = first;
+    this->observer = &observer;
+    stopped = false;
+    suppressErrors = false;
+
+    stack = state.stack;
+    recoveryPoints = state.recoveryPoints;
+    // estado inicial montado pelo chamador: falta o ponto de recuperação
+    if (recoveryPoints.empty() && stack.size() == 1)
+    {
+        stack.clear();
+        push(state.stack.front());
+    }
+    previousToken = state.previousToken;
+    currentToken = nextToken();
+
+    try
+    {
+        while ( ! stopped && ! step() )
+            ;
+    }
+    catch (const AnalysisError &)
+    {
+        semanticAnalyser->throwFirstError();
+        throw;
+    }
+    semanticAnalyser->throwFirstError();
+    return ! stopped;
 }
 
-bool Sintatico::step()
+Token Sintatico::nextToken()
 {
-    if (currentToken == 0) //Fim de Sentença
+    if (scanner)
+        return scanner->nextToken();
+
+    if (*observer && ! (*observer)(tokenIndex))
     {
-        int pos = 0;
-        if (previousToken != 0)
-            pos = previousToken->getPosition() + previousToken->getLexeme().size();
+        stopped = true;
+        return Token();
+    }
+    if (tokenIndex < tokens->size())
+        return (*tokens)[tokenIndex++];
+    return Token();
+}
+
+Token Sintatico::endOfInput() const
+{
+    int pos = 0;
+    if (previousToken.isValid())
+        pos = previousToken.getPosition() + previousToken.getLength();
 
-        currentToken = new Token(DOLLAR, "$", pos);
+    return Token(DOLLAR, "$", pos);
+}
+
+void Sintatico::push(int state)
+{
+    stack.push_back(state);
+    if (COMMAND_STATES[state])
+    {
+        while ( ! recoveryPoints.empty() && recoveryPoints.back().first >= stack.size())
+            recoveryPoints.pop_back();
+        recoveryPoints.emplace_back(stack.size(), semanticAnalyser->recoveryPoint());
     }
+}
+
+bool Sintatico::step()
+{
+    if (!currentToken.isValid()) //Fim de Sentença
+        currentToken = endOfInput();
 
-    int token = currentToken->getId();
-    int state = stack.top();
+    int token = currentToken.getId();
+    int state = stack.back();
 
-    const int* cmd = PARSER_TABLE[state][token-1];
+    const int cell = parserActionCell(state, token-1);
 
-    switch (cmd[0])
+    switch (parserCommand(cell))
     {
         case SHIFT:
         {
-            stack.push(cmd[1]);
-            if (previousToken != 0)
-                delete previousToken;
+            push(parserValue(cell));
+            semanticAnalyser->registerToken(currentToken);
+            suppressErrors = false;
             previousToken = currentToken;
-            currentToken = scanner->nextToken();
+            currentToken = nextToken();
             return false;
         }
         case REDUCE:
         {
-            const int* prod = PRODUCTIONS[cmd[1]];
+            const int* prod = PRODUCTIONS[parserValue(cell)];
 
-            for (int i=0; i<prod[1]; i++)
-                stack.pop();
+            stack.resize(stack.size() - prod[1]);
 
-            int oldState = stack.top();
-            stack.push(PARSER_TABLE[oldState][prod[0]-1][1]);
+            int oldState = stack.back();
+            push(parserGoto(oldState, prod[0]-1));
             return false;
         }
         case ACTION:
         {
-            int action = FIRST_SEMANTIC_ACTION + cmd[1] - 1;
-            stack.push(PARSER_TABLE[state][action][1]);
-            semanticAnalyser->executeAction(cmd[1], previousToken);
+            int action = FIRST_SEMANTIC_ACTION + parserValue(cell) - 1;
+            push(parserGoto(state, action));
+            semanticAnalyser->executeAction(parserValue(cell), previousToken);
             return false;
         }
         case ACCEPT:
             return true;
 
         case ERROR:
-            throw SyntacticError(PARSER_ERROR[state], currentToken->getPosition());
+            return recover(state);
     }
     return false;
 }
 
+// Modo pânico: registra o erro, descarta tokens até um ponto de
+// sincronização e desce a pilha até um estado de início de comando em que o
+// trecho descartado, tomado como um <command>, deixe o token ser aceito. O
+// Semantico volta ao ponto guardado para esse estado. Erros antes de consumir
+// um token depois da recuperação não são registrados (seriam efeito do mesmo
+// erro). Retorna true se a entrada acabou sem onde retomar.
+bool Sintatico::recover(int state)
+{
+    // falhou de novo no token em que retomou: ele precisa ser descartado
+    bool skip = suppressErrors;
+    if ( ! suppressErrors)
+        semanticAnalyser->reportSyntaxError(SyntacticError(PARSER_ERROR[state], currentToken.getPosition()));
+    suppressErrors = true;
+
+    bool afterSemicolon = false;
+    for (;;)
+    {
+        if (skip)
+        {
+            if (currentToken.getId() == DOLLAR)
+                return true;
+            afterSemicolon = currentToken.getId() == t_KEY_SEMICOLON;
+            currentToken = nextToken();
+            if (stopped)
+                return true;
+            if (!currentToken.isValid())
+                currentToken = endOfInput();
+        }
+        skip = true;
+
+        const int token = currentToken.getId();
+        if ( ! afterSemicolon && ! synchronizes(token))
+            continue;
+
+        for (std::size_t depth = stack.size(); depth > 0; --depth)
+        {
+            if ( ! COMMAND_STATES[stack[depth - 1]])
+                continue;
+            const int command = parserGoto(stack[depth - 1], COMMAND_SYMBOL - 1);
+            if ( ! canResume(depth, command, token))
+                continue;
+
+            stack.resize(depth);
+            while ( ! recoveryPoints.empty() && recoveryPoints.back().first > depth)
+                recoveryPoints.pop_back();
+            if ( ! recoveryPoints.empty() && recoveryPoints.back().first == depth)
+                semanticAnalyser->recoverTo(recoveryPoints.back().second);
+            else
+                semanticAnalyser->recoverTo(semanticAnalyser->recoveryPoint());
+            push(command);
+            return false;
+        }
+    }
+}
+
+// A pilha até depth, com state empilhado, aceita token? Simula as reduções
+// (sem executar ações semânticas) até token ser empilhado.
+bool Sintatico::canResume(std::size_t depth, int state, int token) const
+{
+    std::vector<int> pushed{state};
+    std::size_t bottom = depth;
+    const auto top = [&] { return pushed.empty() ? stack[bottom - 1] : pushed.back(); };
+
+    for (;;)
+    {
+        const int cell = parserActionCell(top(), token - 1);
+        switch (parserCommand(cell))
+        {
+            case SHIFT:
+            case ACCEPT:
+                return true;
+
+            case REDUCE:
+            {
+                const int* prod = PRODUCTIONS[parserValue(cell)];
+                for (int i = 0; i < prod[1]; i++)
+                {
+                    if ( ! pushed.empty())
+                        pushed.pop_back();
+                    else if (bottom > 1)
+                        --bottom;
+                    else
+                        return false;
+                }
+                pushed.push_back(parserGoto(top(), prod[0]-1));
+                break;
+            }
+            case ACTION:
+                pushed.push_back(parserGoto(top(), FIRST_SEMANTIC_ACTION + parserValue(cell) - 1));
+                break;
+
+            default:
+                return false;
+        }
+    }
+}
@@ -7,29 +7,64 @@
 #include "Semantico.h"
 #include "SyntacticError.h"
 
-#include <stack>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
 
 class Sintatico
 {
 public:
-    Sintatico() : previousToken(0), currentToken(0) { }
-
-    ~Sintatico()
+    // Pilha e último token consumido: o bastante para retomar a análise
+    // no meio da entrada (CompilationSession). recoveryPoints guarda, para
+    // cada estado da pilha em que começa um comando, o ponto do Semantico
+    // para onde voltar se um erro de sintaxe descartar o que veio depois.
+    struct State
     {
-        if (previousToken != 0 && previousToken != currentToken) delete previousToken;
-        if (currentToken != 0)  delete currentToken;
-    }
+        std::vector<int> stack;
+        Token previousToken;
+        std::vector<std::pair<std::size_t, Semantico::RecoveryPoint>> recoveryPoints;
+    };
+
+    // Chamado sempre que o token tokens[index] é lido (index == tokens.size()
+    // no fim da entrada), antes de qualquer passo que o use. Retornar false
+    // encerra a análise ali.
+    using TokenObserver = std::function<bool(std::size_t index)>;
+
+    Sintatico() { }
 
     void parse(Lexico *scanner, Semantico *semanticAnalyser);
 
+    // Analisa tokens já lidos a partir de tokens[first], com a pilha em state.
+    // Retorna false se o observer encerrou a análise antes do fim.
+    bool parse(const std::vector<Token> &tokens, std::size_t first, const State &state,
+               Semantico *semanticAnalyser, const TokenObserver &observer);
+
+    State state() const { return {stack, previousToken, recoveryPoints}; }
+
+    // Entre um erro de sintaxe e o primeiro token consumido depois dele.
+    bool recovering() const { return suppressErrors; }
+
 private:
-    std::stack<int> stack;
-    Token *previousToken;
-    Token *currentToken;
+    std::vector<int> stack;
+    std::vector<std::pair<std::size_t, Semantico::RecoveryPoint>> recoveryPoints;
+    Token previousToken;
+    Token currentToken;
     Lexico *scanner;
     Semantico *semanticAnalyser;
 
+    const std::vector<Token> *tokens = nullptr;
+    std::size_t tokenIndex = 0;
+    const TokenObserver *observer = nullptr;
+    bool stopped = false;
+    bool suppressErrors = false;
+
+    Token nextToken();
+    Token endOfInput() const;
     bool step();
+    void push(int state);
+    bool recover(int state);
+    bool canResume(std::size_t depth, int state, int token) const;
 };
 
 #endif
@@ -0,0 +1,70 @@
+#include "SourceBuffer.h"
+
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SOURCE_BUFFER_MMAP 1
+#endif
+
+SourceBuffer::~SourceBuffer()
+{
+#ifdef SOURCE_BUFFER_MMAP
+    if (mapping)
+        munmap(mapping, size);
+#endif
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromFile(const std::string &path)
+{
+#ifdef SOURCE_BUFFER_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+    {
+        void *mapped = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED)
+        {
+            close(fd);
+            std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+            buffer->mapping = mapped;
+            buffer->data = static_cast<const char *>(mapped);
+            buffer->size = static_cast<std::size_t>(info.st_size);
+            return buffer;
+        }
+    }
+    close(fd);
+#endif
+
+    // arquivos vazios, pipes ou plataformas sem mmap: leitura comum
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return nullptr;
+    std::stringstream content;
+    content << file.rdbuf();
+    return fromString(content.str());
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::fromString(std::string text)
+{
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+    buffer->owned = std::move(text);
+    buffer->data = buffer->owned.data();
+    buffer->size = buffer->owned.size();
+    return buffer;
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::borrow(std::string_view text)
+{
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+    buffer->data = text.data();
+    buffer->size = text.size();
+    return buffer;
+}
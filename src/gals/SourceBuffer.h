@@ -0,0 +1,41 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Texto-fonte imutável compartilhado pelo Lexico, pelo Semantico e pelo
+// BipGenerator. Cada etapa guarda apenas uma visão do mesmo buffer, que pode
+// ser um arquivo mapeado em memória, uma string própria ou a memória de
+// quem chamou (sem cópia).
+class SourceBuffer
+{
+public:
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+    // Mapeia o arquivo (mmap) quando possível; senão lê para memória própria.
+    // Retorna nullptr se o arquivo não puder ser aberto.
+    static std::shared_ptr<const SourceBuffer> fromFile(const std::string &path);
+
+    static std::shared_ptr<const SourceBuffer> fromString(std::string text);
+
+    // Não copia: o chamador garante que text vive mais que o buffer.
+    static std::shared_ptr<const SourceBuffer> borrow(std::string_view text);
+
+    std::string_view view() const { return std::string_view(data, size); }
+
+private:
+    SourceBuffer() = default;
+
+    const char *data = "";
+    std::size_t size = 0;
+    std::string owned;
+    void *mapping = nullptr;
+};
+
+#endif
@@ -3,21 +3,29 @@
 
 #include "Constants.h"
 
-#include <string>
+#include <string_view>
 
+// Valor trivialmente copiável: o lexema é uma visão do buffer de entrada do
+// Lexico, válida enquanto a entrada não for trocada.
 class Token
 {
 public:
-    Token(TokenId id, const std::string &lexeme, int position)
+    Token() : id(EPSILON), lexeme(), position(-1) { }
+
+    Token(TokenId id, std::string_view lexeme, int position)
       : id(id), lexeme(lexeme), position(position) { }
 
     TokenId getId() const { return id; }
-    const std::string &getLexeme() const { return lexeme; }
+    std::string_view getLexeme() const { return lexeme; }
     int getPosition() const { return position; }
+    int getLength() const { return static_cast<int>(lexeme.size()); }
+
+    // EPSILON marca "nenhum token" (fim da entrada ou ainda não lido).
+    bool isValid() const { return id != EPSILON; }
 
 private:
     TokenId id;
-    std::string lexeme;
+    std::string_view lexeme;
     int position;
 };
 
@@ -1,49 +1,349 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
+#include "BatchCompiler.h"
+#include "gals/BipGenerator.h"
+#include "gals/BipMachine.h"
+#include "gals/BipPeephole.h"
 #include "gals/Lexico.h"
+#include "gals/ScannerRuns.h"
 #include "gals/Sintatico.h"
 #include "gals/Semantico.h"
+#include "gals/SourceBuffer.h"
+#include "gals/CompilationContext.h"
 
 using namespace std;
 
+// uniscript --batch <diretório|manifesto> [-j N] [-o diretório]
+static int batchMain(int argc, char* argv[]) {
+  BatchOptions options;
+  for (int i = 2; i < argc; ++i) {
+    const string arg = argv[i];
+    if ((arg == "-j" || arg == "--jobs") && i + 1 < argc) {
+      options.jobs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if ((arg == "-o" || arg == "--output") && i + 1 < argc) {
+      options.outputDir = argv[++i];
+    } else if (options.input.empty()) {
+      options.input = arg;
+    } else {
+      options.input.clear();
+      break;
+    }
+  }
+
+  if (options.input.empty()) {
+    cerr << "Uso: " << argv[0] << " --batch <diretorio|manifesto> [-j N] [-o diretorio]" << endl;
+    return 2;
+  }
+  return runBatch(options);
+}
+
+// uniscript --run <programa.us|programa.bip> [entradas...]
+// --peephole=<regras>: "todas", "nenhuma" ou nomes separados por vírgula.
+static bool parsePeepholeFlag(const string& arg, BipPeephole::Options& options) {
+  static const string FLAG = "--peephole=";
+  if (arg.compare(0, FLAG.size(), FLAG) != 0) {
+    return false;
+  }
+  if (!BipPeephole::parseRules(string_view(arg).substr(FLAG.size()), options.rules)) {
+    cerr << "Regra de peephole desconhecida em " << arg << "; as regras sao:";
+    for (std::size_t rule = 0; rule < BipPeephole::RULE_COUNT; ++rule) {
+      cerr << " " << BipPeephole::ruleName(rule);
+    }
+    cerr << endl;
+    std::exit(2);
+  }
+  return true;
+}
+
+// Compila (ou só monta um .bip), executa na máquina BIP e imprime ciclos,
+// saída e trechos mais executados. As entradas alimentam $in_port. Para um
+// .us, executa também o código sem peephole e mostra o que ele economizou.
+static int runMain(int argc, char* argv[]) {
+  if (argc < 3) {
+    cerr << "Uso: " << argv[0] << " --run <programa.us|programa.bip> [--repeat N] [--peephole=regras] [entradas...]" << endl;
+    return 2;
+  }
+  const string filename = argv[2];
+  auto source = SourceBuffer::fromFile(filename);
+  if (!source) {
+    cerr << "Erro ao abrir o arquivo: " << filename << endl;
+    return 1;
+  }
+
+  BipMachine::Options options;
+  BipPeephole::Options peephole;
+  unsigned long repeat = 0;
+  for (int i = 3; i < argc; ++i) {
+    if (parsePeepholeFlag(argv[i], peephole)) {
+      continue;
+    }
+    if (string(argv[i]) == "--repeat" && i + 1 < argc) {
+      repeat = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      options.input.push_back(static_cast<int>(std::strtol(argv[i], nullptr, 10)));
+    }
+  }
+
+  string code;
+  string unoptimized;
+  BipPeephole::Stats peepholeStats;
+  if (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".bip") == 0) {
+    code = string(source->view());
+  } else {
+    CompilationContext context;
+    BipGenerator::setPeephole(context, BipPeephole::Options{0});
+    Lexico lex;
+    Sintatico sint;
+    Semantico sem(context);
+    ostringstream report;
+    context.setReportStream(&report);
+    lex.setInput(source);
+    sem.setSourceCode(source);
+    try {
+      sint.parse(&lex, &sem);
+      finalizeSemanticAnalysis(context, false);
+    } catch (LexicalError err) {
+      cerr << "Problema lexico: " << err.getMessage() << endl;
+      return 1;
+    } catch (SyntacticError err) {
+      cerr << "Problema sintatico: " << err.getMessage() << endl;
+      return 1;
+    } catch (SemanticError err) {
+      cerr << "Problema semantico: " << err.getMessage() << endl;
+      return 1;
+    }
+    const auto diagnostics = snapshotDiagnostics(context);
+    if (std::any_of(diagnostics.begin(), diagnostics.end(), [](const ExportedDiagnostic& d) { return d.severity == "error"; })) {
+      cerr << report.str();
+      return 1;
+    }
+    unoptimized = snapshotBipCode(context);
+    code = peephole.rules != 0 ? BipPeephole::optimize(unoptimized, peephole, &peepholeStats) : unoptimized;
+  }
+
+  try {
+    const auto program = BipMachine::assemble(code);
+    auto result = BipMachine::run(program, options);
+    cout << BipMachine::report(result);
+    if (!unoptimized.empty() && peephole.rules != 0) {
+      const auto before = BipMachine::run(BipMachine::assemble(unoptimized), options);
+      cout << BipPeephole::report(peepholeStats);
+      cout << "Ciclos sem peephole: " << before.cycles << " (-" << (before.cycles - std::min(before.cycles, result.cycles)) << ")" << endl;
+    }
+
+    // --repeat N: executa de novo N vezes o programa já montado e mede a
+    // vazão do simulador
+    if (repeat > 0) {
+      std::uint64_t simulated = 0;
+      const auto start = std::chrono::steady_clock::now();
+      for (unsigned long i = 0; i < repeat; ++i) {
+        simulated += BipMachine::run(program, options).cycles;
+      }
+      const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      char line[160];
+      std::snprintf(line, sizeof line, "Vazão: %.1f milhões de instruções simuladas/s (%lu execuções em %.3f s)\n",
+                    seconds > 0 ? static_cast<double>(simulated) / seconds / 1e6 : 0.0, repeat, seconds);
+      cout << line;
+    }
+    return result.halted ? 0 : 1;
+  } catch (const std::runtime_error& err) {
+    cerr << "Erro ao montar o codigo BIP: " << err.what() << endl;
+    return 1;
+  }
+}
+
+// uniscript --lex <programa.us> [--repeat N] [--tokens]
+// Lê os tokens do programa N vezes e imprime a vazão do Lexico em MB/s e
+// tokens/s. --tokens imprime, em vez disso, um token por linha (código,
+// posição e tamanho) e o erro léxico, se houver, para comparar builds.
+static int lexMain(int argc, char* argv[]) {
+  if (argc < 3) {
+    cerr << "Uso: " << argv[0] << " --lex <programa.us> [--repeat N] [--tokens]" << endl;
+    return 2;
+  }
+  auto source = SourceBuffer::fromFile(argv[2]);
+  if (!source) {
+    cerr << "Erro ao abrir o arquivo: " << argv[2] << endl;
+    return 1;
+  }
+  unsigned long repeat = 1;
+  bool dump = false;
+  for (int i = 3; i < argc; ++i) {
+    if (string(argv[i]) == "--repeat" && i + 1 < argc) {
+      repeat = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+    } else if (string(argv[i]) == "--tokens") {
+      dump = true;
+    }
+  }
+
+  Lexico lex;
+  if (dump) {
+    lex.setInput(source);
+    string out;
+    char line[64];
+    try {
+      for (Token token = lex.nextToken(); token.isValid(); token = lex.nextToken()) {
+        std::snprintf(line, sizeof line, "%d %d %d\n", static_cast<int>(token.getId()), token.getPosition(), token.getLength());
+        out += line;
+      }
+    } catch (LexicalError err) {
+      std::snprintf(line, sizeof line, "erro %d ", err.getPosition());
+      out.append(line).append(err.getMessage()).append("\n");
+    }
+    cout << out;
+    return 0;
+  }
+
+  std::size_t tokens = 0;
+  double seconds = 0;
+  try {
+    for (unsigned long i = 0; i < repeat; ++i) {
+      lex.setInput(source);
+      tokens = 0;
+      const auto begin = std::chrono::steady_clock::now();
+      for (Token token = lex.nextToken(); token.isValid(); token = lex.nextToken()) {
+        ++tokens;
+      }
+      seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+  } catch (LexicalError err) {
+    cerr << "Problema lexico: " << err.getMessage() << endl;
+    return 1;
+  }
+
+  const double bytes = static_cast<double>(source->view().size());
+  char line[240];
+  std::snprintf(line, sizeof line, "Núcleo do scanner: %s\nEntrada: %.0f bytes, %zu tokens\nVazão: %.1f MB/s, %.2f milhões de tokens/s (%lu passadas em %.3f s)\n",
+                scannerRunKernel(), bytes, tokens, seconds > 0 ? bytes * repeat / seconds / 1e6 : 0.0,
+                seconds > 0 ? static_cast<double>(tokens) * repeat / seconds / 1e6 : 0.0, repeat, seconds);
+  cout << line;
+  return 0;
+}
+
+// uniscript --parse <programa.us> [--repeat N]
+// Lê os tokens uma vez e analisa o programa N vezes (sintaxe e ações
+// semânticas, sem gerar código), imprimindo a vazão em tokens/s.
+static int parseMain(int argc, char* argv[]) {
+  if (argc < 3) {
+    cerr << "Uso: " << argv[0] << " --parse <programa.us> [--repeat N]" << endl;
+    return 2;
+  }
+  auto source = SourceBuffer::fromFile(argv[2]);
+  if (!source) {
+    cerr << "Erro ao abrir o arquivo: " << argv[2] << endl;
+    return 1;
+  }
+  unsigned long repeat = 1;
+  if (argc > 4 && string(argv[3]) == "--repeat") {
+    repeat = std::max(1ul, std::strtoul(argv[4], nullptr, 10));
+  }
+
+  vector<Token> tokens;
+  Lexico lex;
+  lex.setInput(source);
+  try {
+    for (Token token = lex.nextToken(); token.isValid(); token = lex.nextToken()) {
+      tokens.push_back(token);
+    }
+  } catch (LexicalError err) {
+    cerr << "Problema lexico: " << err.getMessage() << endl;
+    return 1;
+  }
+
+  CompilationContext context;
+  context.setReportStream(nullptr);
+  Semantico sem(context);
+  Sintatico sint;
+  Sintatico::State start;
+  start.stack.push_back(0);
+  const auto keepGoing = [](std::size_t) { return true; };
+  double seconds = 0;
+  try {
+    for (unsigned long i = 0; i < repeat; ++i) {
+      sem.resetState();
+      sem.setSourceCode(source);
+      const auto begin = std::chrono::steady_clock::now();
+      sint.parse(tokens, 0, start, &sem, keepGoing);
+      seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+  } catch (SyntacticError err) {
+    cerr << "Problema sintatico: " << err.getMessage() << endl;
+    return 1;
+  } catch (SemanticError err) {
+    cerr << "Problema semantico: " << err.getMessage() << endl;
+    return 1;
+  }
+
+  char line[160];
+  std::snprintf(line, sizeof line, "Tokens: %zu\nVazão: %.2f milhões de tokens/s (%lu análises em %.3f s)\n", tokens.size(),
+                seconds > 0 ? static_cast<double>(tokens.size()) * repeat / seconds / 1e6 : 0.0, repeat, seconds);
+  cout << line;
+  return 0;
+}
+
 int main (int argc, char* argv[]) {
+  if (argc > 1 && string(argv[1]) == "--batch") {
+    return batchMain(argc, argv);
+  }
+  if (argc > 1 && string(argv[1]) == "--run") {
+    return runMain(argc, argv);
+  }
+  if (argc > 1 && string(argv[1]) == "--lex") {
+    return lexMain(argc, argv);
+  }
+  if (argc > 1 && string(argv[1]) == "--parse") {
+    return parseMain(argc, argv);
+  }
+
+  CompilationContext context;
   Lexico lex; 
   Sintatico sint;
-  Semantico sem;
+  Semantico sem(context);
+
+  BipPeephole::Options peephole;
+  int first = 1;
+  if (argc > first && parsePeepholeFlag(argv[first], peephole)) {
+    ++first;
+  }
+  BipGenerator::setPeephole(context, peephole);
 
   // Tenta ler o arquivo informado na linha de comando ou usa prompt.txt.
-  string filename = (argc > 1) ? argv[1] : "prompt.txt";
-  ifstream file;
-  file.open(filename);
+  // O arquivo é mapeado em memória e compartilhado por todas as etapas.
+  string filename = (argc > first) ? argv[first] : "prompt.txt";
+  auto source = SourceBuffer::fromFile(filename);
   
-  if (!file.is_open() && argc == 1) {
+  if (!source && argc == first) {
     string fallback = "../" + filename;
-    file.open(fallback);
-    if (file.is_open()) {
+    source = SourceBuffer::fromFile(fallback);
+    if (source) {
       filename = fallback;
     }
   }
   
-  if (!file.is_open()) {
+  if (!source) {
     cerr << "Erro ao abrir o arquivo: " << filename << endl;
     return 1;
   }
   
-  stringstream buffer;
-  buffer << file.rdbuf();
-  string content = buffer.str();
-  file.close();
-  
-  lex.setInput(content.c_str());
-  sem.setSourceCode(content);
+  lex.setInput(source);
+  sem.setSourceCode(source);
   // Não esquecer de remover o arquivo prompt.txt depois ----------------------
 
   try {
     sint.parse(&lex, &sem);
-    finalizeSemanticAnalysis();
+    finalizeSemanticAnalysis(context);
     cout << "Analise concluida com sucesso!" << endl;
+    if (peephole.rules != 0) {
+      cout << BipPeephole::report(BipGenerator::peepholeStats(context));
+    }
   } catch (LexicalError err) {
     cerr << "Problema lexico: " << err.getMessage() << endl;
   } catch (SyntacticError err) {
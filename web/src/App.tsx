@@ -7,7 +7,7 @@ import { StatusBar } from './components/StatusBar'
 import { SymbolTable } from './components/SymbolTable'
 import { BipViewer } from './components/BipViewer'
 import { theme } from './theme'
-import { compileSource, posToLineCol, type CompileKind, type SymbolInfo, type DiagnosticInfo, type CompileResult } from './wasm/uniscript'
+import { compileSource, runBip, CompileSession, type TextEdit, type CompileKind, type SymbolInfo, type DiagnosticInfo, type CompileResult } from './wasm/uniscript'
 
 export default function App() {
   const [code, setCode] = useState<string>('print("Hello, World!");')
@@ -18,9 +18,42 @@ export default function App() {
   const [cursor, setCursor] = useState({ line: 1, col: 1 })
   const monacoRef = useRef<typeof MonacoNS | null>(null)
   const modelRef = useRef<MonacoNS.editor.ITextModel | null>(null)
+  const sessionRef = useRef<CompileSession | null>(null)
 
   useMemo(() => theme, [])
 
+  // Compilação enquanto se digita: a sessão recompila só o trecho editado
+  // e atualiza tabela e marcadores; o código BIP fica para o botão Compilar.
+  useEffect(() => {
+    let disposed = false
+    CompileSession.create(() => modelRef.current?.getValue() ?? code)
+      .then((session) => {
+        if (disposed) {
+          session.dispose()
+          return
+        }
+        sessionRef.current = session
+        showLiveResult(session.compile())
+      })
+      .catch(() => {})
+    return () => {
+      disposed = true
+      sessionRef.current?.dispose()
+      sessionRef.current = null
+    }
+  }, [])
+
+  function handleEdits(edits: TextEdit[]) {
+    const session = sessionRef.current
+    if (!session) return
+    showLiveResult(session.edit(edits))
+  }
+
+  function showLiveResult(result: CompileResult) {
+    if (result.ok) setSymbols(result.symbolTable)
+    applyMarkers(result.diagnostics ?? [], result, monacoRef, modelRef)
+  }
+
   function addLog(text: string, color: string = theme.subtle) {
     const now = new Date()
     const hh = String(now.getHours()).padStart(2, '0')
@@ -36,7 +69,8 @@ export default function App() {
     monaco.editor.setModelMarkers(model, 'uniscript', [])
   }
 
-  async function handleCompile() {
+  // Devolve o código BIP quando a compilação termina sem erros.
+  async function handleCompile(): Promise<string> {
     clearMarkers()
     setLogs([])
     setBipCode('')
@@ -46,7 +80,7 @@ export default function App() {
       addLog('Nenhum codigo para compilar.', theme.red)
       setSymbols([])
       setBipCode('')
-      return
+      return ''
     }
     try {
       const result = await compileSource(code)
@@ -57,26 +91,21 @@ export default function App() {
       diagnostics.forEach((diag) => {
         const color = diag.severity === 'error' ? theme.red : diag.severity === 'warning' ? theme.yellow : theme.subtle
         const prefix = diag.severity === 'error' ? '[ERRO]' : diag.severity === 'warning' ? '[AVISO]' : '[INFO]'
-        const loc = diag.position >= 0 ? (() => {
-          const { line, col } = posToLineCol(code, diag.position)
-          return ` (linha ${line}, coluna ${col})`
-        })() : ''
+        const loc = diag.line > 0 && diag.column > 0 ? ` (linha ${diag.line}, coluna ${diag.column})` : ''
         addLog(`${prefix} ${diag.message}${loc}`, color)
       })
 
-      applyMarkers(code, diagnostics, result, monacoRef, modelRef)
+      applyMarkers(diagnostics, result, monacoRef, modelRef)
 
       const hasDiagnosticErrors = diagnostics.some((diag) => diag.severity === 'error')
       const hasWarnings = diagnostics.some((diag) => diag.severity === 'warning')
 
       if (!result.ok) {
         if (!hasDiagnosticErrors) {
-          const pos = result.pos ?? -1
-          const { line, col } = posToLineCol(code, pos)
-          const msg = summaryMessage(result.kind, result.message, line, col)
+          const msg = summaryMessage(result.kind, result.message, result.line ?? -1, result.column ?? -1)
           addLog(msg, theme.red)
         }
-        return
+        return ''
       }
 
       if (!hasDiagnosticErrors) {
@@ -85,7 +114,7 @@ export default function App() {
         } else {
           addLog('Analise concluida com sucesso!', theme.green)
         }
-        return
+        return result.bipCode
       }
 
       addLog('ERROR: Foram encontrados erros semanticos. Reveja os avisos acima.', theme.red)
@@ -93,6 +122,32 @@ export default function App() {
       setSymbols([])
       addLog(`Erro desconhecido durante a compilacao. ${String(e?.message ?? e)}`, theme.red)
     }
+    return ''
+  }
+
+  // Compila e executa na máquina BIP; leituras pedem os valores de uma vez.
+  async function handleRun() {
+    const bip = await handleCompile()
+    if (!bip) return
+    const inputs = bip.includes('$in_port')
+      ? (window.prompt('Valores para as leituras (separados por espaco):') ?? '').split(/[\s,]+/).filter(Boolean).map(Number)
+      : []
+    try {
+      const run = await runBip(bip, inputs)
+      if (!run.ok) {
+        addLog(`Erro ao montar o codigo BIP: ${run.message ?? ''}`, theme.red)
+        return
+      }
+      addLog(`Saida: ${run.output.length ? run.output.join(' ') : '(nenhuma)'}`, theme.text)
+      if (!run.halted) addLog(`Execucao interrompida na linha ${run.errorLine} do codigo BIP: ${run.error}`, theme.red)
+      addLog(`${run.instructions} instrucoes no programa, ${run.cycles} ciclos executados`, theme.blue)
+      run.hotSpots.slice(0, 5).forEach((spot) => {
+        const share = run.cycles ? ((100 * spot.cycles) / run.cycles).toFixed(1) : '0.0'
+        addLog(`  ${spot.label}: ${spot.cycles} ciclos (${share}%), ${spot.entries} entradas`, theme.subtle)
+      })
+    } catch (e: any) {
+      addLog(`Erro ao executar o codigo BIP. ${String(e?.message ?? e)}`, theme.red)
+    }
   }
 
   function summaryMessage(kind: CompileKind | undefined, message: string | undefined, line: number, col: number) {
@@ -111,7 +166,7 @@ export default function App() {
 
   return (
     <div style={{ display: 'flex', flexDirection: 'column', height: '100vh', background: theme.bg, color: theme.text }}>
-      <HeaderBar onCompile={handleCompile} />
+      <HeaderBar onCompile={handleCompile} onRun={handleRun} />
 
       <div style={{ flex: 1, display: 'flex', flexDirection: 'column', minHeight: 0 }}>
         <div style={{ flex: 3, minHeight: 0, display: 'flex' }}>
@@ -119,6 +174,7 @@ export default function App() {
             <Editor
               value={code}
               onChange={(v) => setCode(v)}
+              onEdits={handleEdits}
               onCursor={(line, col) => setCursor({ line, col })}
               monacoRef={monacoRef}
               modelRef={modelRef}
@@ -172,20 +228,18 @@ export default function App() {
   )
 }
 
-function rangeFromOffset(code: string, pos: number, length: number) {
-  if (pos < 0) return null
-  const safeLength = Math.max(1, length)
-  const start = posToLineCol(code, pos)
-  const end = posToLineCol(code, pos + safeLength)
+function rangeFromLocation(location: { line?: number, column?: number, endLine?: number, endColumn?: number }) {
+  const { line = -1, column = -1, endLine = -1, endColumn = -1 } = location
+  if (line <= 0 || column <= 0 || endLine <= 0 || endColumn <= 0) return null
   return {
-    startLineNumber: start.line,
-    startColumn: start.col,
-    endLineNumber: end.line,
-    endColumn: end.col
+    startLineNumber: line,
+    startColumn: column,
+    endLineNumber: endLine,
+    endColumn
   }
 }
 
-function applyMarkers(code: string, diagnostics: DiagnosticInfo[], result: CompileResult, monacoRef: MutableRefObject<typeof MonacoNS | null>, modelRef: MutableRefObject<MonacoNS.editor.ITextModel | null>) {
+function applyMarkers(diagnostics: DiagnosticInfo[], result: CompileResult, monacoRef: MutableRefObject<typeof MonacoNS | null>, modelRef: MutableRefObject<MonacoNS.editor.ITextModel | null>) {
   const monaco = monacoRef.current
   const model = modelRef.current
   if (!monaco || !model) return
@@ -194,7 +248,7 @@ function applyMarkers(code: string, diagnostics: DiagnosticInfo[], result: Compi
 
   diagnostics.forEach((diag) => {
     if (diag.position < 0) return
-    const range = rangeFromOffset(code, diag.position, diag.length)
+    const range = rangeFromLocation(diag)
     if (!range) return
     markers.push({
       severity: diag.severity === 'error' ? monaco.MarkerSeverity.Error
@@ -209,7 +263,7 @@ function applyMarkers(code: string, diagnostics: DiagnosticInfo[], result: Compi
   if (!result.ok && result.pos !== undefined && result.pos !== null && result.pos >= 0) {
     const hasPrimaryMarker = diagnostics.some((diag) => diag.severity === 'error' && diag.position === result.pos)
     if (!hasPrimaryMarker) {
-      const range = rangeFromOffset(code, result.pos, result.length ?? 1)
+      const range = rangeFromLocation(result)
       if (range) {
         markers.push({
           severity: monaco.MarkerSeverity.Error,
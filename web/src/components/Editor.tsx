@@ -1,16 +1,18 @@
 import { Editor as MonacoEditor } from '@monaco-editor/react'
 import type * as MonacoNS from 'monaco-editor'
 import { theme } from '../theme'
+import type { TextEdit } from '../wasm/uniscript'
 
 type Props = {
   value: string
   onChange: (v: string) => void
+  onEdits?: (edits: TextEdit[]) => void
   onCursor: (line: number, col: number) => void
   monacoRef: React.MutableRefObject<typeof MonacoNS | null>
   modelRef: React.MutableRefObject<MonacoNS.editor.ITextModel | null>
 }
 
-export function Editor({ value, onChange, onCursor, monacoRef, modelRef }: Props) {
+export function Editor({ value, onChange, onEdits, onCursor, monacoRef, modelRef }: Props) {
   return (
     <MonacoEditor
       height="100%"
@@ -26,6 +28,9 @@ export function Editor({ value, onChange, onCursor, monacoRef, modelRef }: Props
           }
         })
         monaco.editor.setTheme('uniscript-dark')
+        editor.onDidChangeModelContent((e) => {
+          onEdits?.(e.changes.map((c) => ({ offset: c.rangeOffset, removed: c.rangeLength, text: c.text })))
+        })
         editor.onDidChangeCursorPosition((e) => {
           onCursor(e.position.lineNumber, e.position.column)
         })
@@ -1,12 +1,15 @@
 import { useEffect } from 'react'
 import { theme } from '../theme'
 
-export function HeaderBar({ onCompile }: { onCompile: () => void }) {
+export function HeaderBar({ onCompile, onRun }: { onCompile: () => void; onRun: () => void }) {
   useEffect(() => {
     function onKeyDown(e: KeyboardEvent) {
       if (e.key === 'F5') {
         e.preventDefault()
         onCompile()
+      } else if (e.key === 'F6') {
+        e.preventDefault()
+        onRun()
       }
     }
 
@@ -22,6 +25,7 @@ export function HeaderBar({ onCompile }: { onCompile: () => void }) {
       <div style={{ fontSize: 16, fontWeight: 700 }}>UniScript</div>
       <div style={{ flex: 1 }} />
       <button title='Compilar (F5)' onClick={onCompile} style={{ color: theme.text, background: theme.button, border: `1px solid ${theme.border}`, borderRadius: 8, padding: '8px 14px' }}>Compilar</button>
+      <button title='Executar na máquina BIP (F6)' onClick={onRun} style={{ color: theme.text, background: theme.button, border: `1px solid ${theme.border}`, borderRadius: 8, padding: '8px 14px' }}>Executar</button>
     </header>
   )
 }
@@ -22,6 +22,10 @@ export interface DiagnosticInfo {
   message: string
   position: number
   length: number
+  line: number
+  column: number
+  endLine: number
+  endColumn: number
 }
 
 export interface CompileResult {
@@ -30,12 +34,16 @@ export interface CompileResult {
   message?: string
   pos?: number
   length?: number
+  line?: number
+  column?: number
+  endLine?: number
+  endColumn?: number
   symbolTable: SymbolInfo[]
   diagnostics: DiagnosticInfo[]
   bipCode: string
 }
 
-export async function compileSource(code: string): Promise<CompileResult> {
+function loadModule(): Promise<any> {
   if (!modPromise) {
     modPromise = (async () => {
       const factory = (window as any).createUniscriptModule
@@ -51,14 +59,195 @@ export async function compileSource(code: string): Promise<CompileResult> {
       })
     })()
   }
+  return modPromise
+}
 
-  const Module = await modPromise
-  const fn = Module.cwrap('uniscript_compile', 'number', ['string'])
-  const ptr = fn(code)
-  const json = Module.UTF8ToString(ptr)
+function takeString(Module: any, ptr: number): string {
+  const text = Module.UTF8ToString(ptr)
   Module._free(ptr)
-  const raw = JSON.parse(json)
-  return normalizeCompileResult(raw)
+  return text
+}
+
+// Usa o formato binário (docs/resultado-binario.md): o resultado é lido
+// direto da memória do WASM, sem cópia para string nem JSON.parse.
+export async function compileSource(code: string): Promise<CompileResult> {
+  const Module = await loadModule()
+  const fn = Module.cwrap('uniscript_compile_bin', 'number', ['string'])
+  const ptr = fn(code)
+  try {
+    return readBinaryResult(Module.HEAPU8, ptr)
+  } finally {
+    Module._free(ptr)
+  }
+}
+
+const BIN_MAGIC = 0x42525355
+const BIN_VERSION = 1
+const HEADER_WORDS = 24
+const SYMBOL_WORDS = 9
+const DIAGNOSTIC_WORDS = 9
+const BIN_KINDS: (CompileKind | undefined)[] = [undefined, 'lexical', 'syntactic', 'semantic', 'unknown']
+const BIN_SEVERITIES: DiagnosticInfo['severity'][] = ['error', 'warning', 'info']
+
+const utf8Decoder = new TextDecoder()
+
+export function readBinaryResult(heap: Uint8Array, ptr: number): CompileResult {
+  const header = new Int32Array(heap.buffer, heap.byteOffset + ptr, HEADER_WORDS)
+  if (header[0] >>> 0 !== BIN_MAGIC || header[1] !== BIN_VERSION) {
+    throw new Error(`Resultado binario desconhecido (versao ${header[1]})`)
+  }
+  const strings = ptr + header[8]
+  const text = (offset: number, length: number) =>
+    length > 0 ? utf8Decoder.decode(heap.subarray(strings + offset, strings + offset + length)) : ''
+
+  const symbolWords = new Int32Array(heap.buffer, heap.byteOffset + ptr + header[5], header[4] * SYMBOL_WORDS)
+  const symbolTable: SymbolInfo[] = []
+  for (let at = 0; at < symbolWords.length; at += SYMBOL_WORDS) {
+    const flags = symbolWords[at + 4]
+    symbolTable.push({
+      name: text(symbolWords[at], symbolWords[at + 1]),
+      type: text(symbolWords[at + 2], symbolWords[at + 3]),
+      initialized: (flags & 1) !== 0,
+      used: (flags & 2) !== 0,
+      isParameter: (flags & 4) !== 0,
+      isArray: (flags & 8) !== 0,
+      isFunction: (flags & 16) !== 0,
+      isConstant: (flags & 32) !== 0,
+      scope: symbolWords[at + 5],
+      position: symbolWords[at + 6],
+      line: symbolWords[at + 7],
+      column: symbolWords[at + 8]
+    })
+  }
+
+  const diagnosticWords = new Int32Array(heap.buffer, heap.byteOffset + ptr + header[7], header[6] * DIAGNOSTIC_WORDS)
+  const diagnostics: DiagnosticInfo[] = []
+  for (let at = 0; at < diagnosticWords.length; at += DIAGNOSTIC_WORDS) {
+    diagnostics.push({
+      severity: BIN_SEVERITIES[diagnosticWords[at]] ?? 'info',
+      message: text(diagnosticWords[at + 1], diagnosticWords[at + 2]),
+      position: diagnosticWords[at + 3],
+      length: diagnosticWords[at + 4],
+      line: diagnosticWords[at + 5],
+      column: diagnosticWords[at + 6],
+      endLine: diagnosticWords[at + 7],
+      endColumn: diagnosticWords[at + 8]
+    })
+  }
+
+  const result: CompileResult = {
+    ok: header[2] !== 0,
+    symbolTable,
+    diagnostics,
+    bipCode: text(header[10], header[11])
+  }
+  if (!result.ok) {
+    result.kind = BIN_KINDS[header[12]]
+    result.message = text(header[13], header[14])
+    result.pos = header[15]
+    result.length = header[16]
+    result.line = header[17]
+    result.column = header[18]
+    result.endLine = header[19]
+    result.endColumn = header[20]
+  }
+  return result
+}
+
+export interface HotSpot {
+  label: string
+  cycles: number
+  entries: number
+}
+
+export interface RunResult {
+  ok: boolean
+  message?: string
+  halted: boolean
+  error: string
+  errorLine: number
+  output: number[]
+  instructions: number
+  cycles: number
+  hotSpots: HotSpot[]
+}
+
+// Executa o código BIP na máquina BIP do núcleo (BipMachine). inputs
+// alimentam $in_port; hotSpots vem com os trechos de mais ciclos primeiro.
+export async function runBip(bipCode: string, inputs: number[] = []): Promise<RunResult> {
+  const Module = await loadModule()
+  const ptr = Module.cwrap('uniscript_run_bip', 'number', ['string', 'string'])(bipCode, inputs.join(' '))
+  const raw = JSON.parse(takeString(Module, ptr))
+  return {
+    ok: Boolean(raw?.ok),
+    message: typeof raw?.message === 'string' ? raw.message : undefined,
+    halted: Boolean(raw?.halted),
+    error: typeof raw?.error === 'string' ? raw.error : '',
+    errorLine: Number(raw?.errorLine) || 0,
+    output: Array.isArray(raw?.output) ? raw.output.map(Number) : [],
+    instructions: Number(raw?.instructions) || 0,
+    cycles: Number(raw?.cycles) || 0,
+    hotSpots: Array.isArray(raw?.hotSpots)
+      ? raw.hotSpots.map((spot: any) => ({
+          label: String(spot?.label ?? ''),
+          cycles: Number(spot?.cycles) || 0,
+          entries: Number(spot?.entries) || 0
+        }))
+      : []
+  }
+}
+
+// Trecho trocado no editor, em unidades UTF-16 (como o Monaco informa).
+export interface TextEdit {
+  offset: number
+  removed: number
+  text: string
+}
+
+const utf8 = new TextEncoder()
+
+// Compilação mantida entre edições: cada edit() recompila só o trecho que a
+// alteração alcança. O núcleo trabalha com bytes UTF-8, então a sessão guarda
+// o texto para converter as posições.
+export class CompileSession {
+  private constructor(private Module: any, private handle: number, private text: string) {}
+
+  // O texto é lido só depois de o módulo carregar, para não perder o que
+  // foi digitado enquanto isso.
+  static async create(source: () => string): Promise<CompileSession> {
+    const Module = await loadModule()
+    const code = source()
+    const handle = Module.cwrap('uniscript_session_create', 'number', ['string'])(code)
+    return new CompileSession(Module, handle, code)
+  }
+
+  compile(): CompileResult {
+    const ptr = this.Module.cwrap('uniscript_session_compile', 'number', ['number'])(this.handle)
+    return normalizeCompileResult(JSON.parse(takeString(this.Module, ptr)))
+  }
+
+  // Edições de um mesmo evento referem-se ao texto anterior a ele: aplicadas
+  // de trás para frente, uma não desloca a outra.
+  edit(edits: TextEdit[]): CompileResult {
+    const fn = this.Module.cwrap('uniscript_session_edit', 'number', ['number', 'number', 'number', 'string'])
+    let json = ''
+    for (const e of [...edits].sort((a, b) => b.offset - a.offset)) {
+      const offset = utf8.encode(this.text.slice(0, e.offset)).length
+      const removed = utf8.encode(this.text.slice(e.offset, e.offset + e.removed)).length
+      this.text = this.text.slice(0, e.offset) + e.text + this.text.slice(e.offset + e.removed)
+      json = takeString(this.Module, fn(this.handle, offset, removed, e.text))
+    }
+    return json ? normalizeCompileResult(JSON.parse(json)) : this.compile()
+  }
+
+  bipCode(): string {
+    return takeString(this.Module, this.Module.cwrap('uniscript_session_bip', 'number', ['number'])(this.handle))
+  }
+
+  dispose() {
+    this.Module.cwrap('uniscript_session_free', null, ['number'])(this.handle)
+    this.handle = 0
+  }
 }
 
 function normalizeCompileResult(raw: any): CompileResult {
@@ -75,6 +264,10 @@ function normalizeCompileResult(raw: any): CompileResult {
     message,
     pos,
     length: typeof raw?.length === 'number' ? raw.length : undefined,
+    line: typeof raw?.line === 'number' ? raw.line : undefined,
+    column: typeof raw?.column === 'number' ? raw.column : undefined,
+    endLine: typeof raw?.endLine === 'number' ? raw.endLine : undefined,
+    endColumn: typeof raw?.endColumn === 'number' ? raw.endColumn : undefined,
     symbolTable,
     diagnostics,
     bipCode
@@ -108,18 +301,14 @@ function normalizeDiagnosticInfo(raw: any): DiagnosticInfo {
     severity: severity === 'error' || severity === 'warning' ? severity : 'info',
     message: typeof raw?.message === 'string' ? raw.message : '',
     position: Number.isFinite(Number(raw?.position)) ? Number(raw?.position) : -1,
-    length: Number.isFinite(Number(raw?.length)) ? Number(raw?.length) : 1
+    length: Number.isFinite(Number(raw?.length)) ? Number(raw?.length) : 1,
+    line: Number.isFinite(Number(raw?.line)) ? Number(raw?.line) : -1,
+    column: Number.isFinite(Number(raw?.column)) ? Number(raw?.column) : -1,
+    endLine: Number.isFinite(Number(raw?.endLine)) ? Number(raw?.endLine) : -1,
+    endColumn: Number.isFinite(Number(raw?.endColumn)) ? Number(raw?.endColumn) : -1
   }
 }
 
 function isCompileKind(value: any): value is CompileKind {
   return value === 'lexical' || value === 'syntactic' || value === 'semantic' || value === 'unknown'
 }
-
-export function posToLineCol(text: string, pos: number) {
-  let line = 1, col = 1
-  for (let i = 0; i < Math.max(0, pos) && i < text.length; i++) {
-    if (text[i] === '\n') { line++; col = 1 } else { col++ }
-  }
-  return { line, col }
-}